@@ -0,0 +1,301 @@
+/**
+ * @file tftp_impaired_link.cpp
+ * @brief Loopback UDP relay adding loss, delay and reordering between TFTP clients and a server
+ */
+
+#include "tftp_impaired_link.h"
+#include "internal/tftp_poller.h"
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace tftpserver {
+namespace bench {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kReceiveBatch = 32;
+constexpr size_t kReceiveSlotSize = 65536;
+constexpr int kMaxDatagramsPerWakeup = 256;        // Keeps one busy flow from starving the others
+constexpr int kMaxWaitMs = 20;                     // Stop() is noticed within this
+constexpr auto kFlowIdleTimeout = std::chrono::seconds(30);
+constexpr auto kSweepInterval = std::chrono::seconds(1);
+constexpr uint64_t kFrontId = 0;
+
+// Poller tokens: 0 is the front socket, flow f owns 2f + 1 (upstream) and 2f + 2 (downstream)
+uint64_t UpstreamId(uint64_t flow) { return flow * 2 + 1; }
+uint64_t DownstreamId(uint64_t flow) { return flow * 2 + 2; }
+
+uint64_t AddressKey(const sockaddr_in& addr) {
+    return (static_cast<uint64_t>(ntohl(addr.sin_addr.s_addr)) << 16) | ntohs(addr.sin_port);
+}
+
+bool OpenLoopbackSocket(net::UdpSocket& socket) {
+    return socket.Create() && socket.Bind(net::SocketAddress("127.0.0.1", 0)) &&
+           internal::SetNonBlocking(socket.GetNativeHandle());
+}
+
+struct Flow {
+    sockaddr_in client = {};
+    sockaddr_in server_tid = {};  // Learned from the server's first answer
+    bool has_server_tid = false;
+    net::UdpSocket upstream;      // Faces the server, stands in for the client transfer ID
+    net::UdpSocket downstream;    // Faces the client, stands in for the server transfer ID
+    Clock::time_point last_active;
+};
+
+struct Pending {
+    Clock::time_point release;
+    uint64_t sequence;  // Keeps datagrams released at the same time in arrival order
+    uint64_t socket_id;
+    sockaddr_in to;
+    std::vector<uint8_t> bytes;
+};
+
+// Heap order: the earliest release on top
+bool ReleasedLater(const Pending& a, const Pending& b) {
+    return a.release != b.release ? a.release > b.release : a.sequence > b.sequence;
+}
+
+bool SendOne(net::UdpSocket& socket, const sockaddr_in& to, const uint8_t* data, size_t size) {
+    net::OutgoingDatagram datagram;
+    datagram.data = data;
+    datagram.size = size;
+    datagram.addr = to;
+    return socket.SendBatch(&datagram, 1) == 1;
+}
+
+} // namespace
+
+ImpairedLink::ImpairedLink(const sockaddr_in& server, const LinkImpairment& impairment)
+    : server_(server),
+      impairment_(impairment),
+      port_(0),
+      running_(false),
+      forwarded_(0),
+      dropped_(0),
+      reordered_(0),
+      flows_(0) {}
+
+ImpairedLink::~ImpairedLink() {
+    Stop();
+}
+
+bool ImpairedLink::Start() {
+    if (running_) {
+        return true;
+    }
+    if (!OpenLoopbackSocket(front_)) {
+        front_.Close();
+        return false;
+    }
+    sockaddr_in local = {};
+#ifdef _WIN32
+    int addr_len = sizeof(local);
+#else
+    socklen_t addr_len = sizeof(local);
+#endif
+    getsockname(front_.GetNativeHandle(), reinterpret_cast<sockaddr*>(&local), &addr_len);
+    port_ = ntohs(local.sin_port);
+
+    running_ = true;
+    thread_ = std::thread(&ImpairedLink::Run, this);
+    return true;
+}
+
+void ImpairedLink::Stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    front_.Close();
+}
+
+LinkStats ImpairedLink::GetStats() const {
+    LinkStats stats;
+    stats.forwarded = forwarded_.load();
+    stats.dropped = dropped_.load();
+    stats.reordered = reordered_.load();
+    stats.flows = flows_.load();
+    return stats;
+}
+
+void ImpairedLink::Run() {
+    internal::Poller poller;
+    if (!poller.IsValid() || !poller.Add(front_.GetNativeHandle(), kFrontId)) {
+        running_ = false;
+        return;
+    }
+
+    std::mt19937 rng(impairment_.seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<long long> jitter(0, impairment_.jitter.count());
+
+    std::unordered_map<uint64_t, Flow> flows;
+    std::unordered_map<uint64_t, uint64_t> flow_by_client;
+    std::vector<Pending> queue;
+    uint64_t next_flow = 0;
+    uint64_t sequence = 0;
+
+    std::vector<uint8_t> recv_buffer(kReceiveBatch * kReceiveSlotSize);
+    std::vector<net::IncomingDatagram> incoming(kReceiveBatch);
+    for (size_t i = 0; i < kReceiveBatch; ++i) {
+        incoming[i].buffer = recv_buffer.data() + i * kReceiveSlotSize;
+        incoming[i].capacity = kReceiveSlotSize;
+    }
+
+    auto socket_for = [&](uint64_t id) -> net::UdpSocket* {
+        if (id == kFrontId) {
+            return &front_;
+        }
+        auto it = flows.find((id - 1) / 2);
+        if (it == flows.end()) {
+            return nullptr;
+        }
+        return id % 2 == 1 ? &it->second.upstream : &it->second.downstream;
+    };
+
+    // Applies the impairment to one datagram and sends it or queues it for later
+    auto forward = [&](uint64_t socket_id, const sockaddr_in& to, const uint8_t* data, size_t size,
+                       Clock::time_point now) {
+        if (impairment_.loss > 0.0 && chance(rng) < impairment_.loss) {
+            dropped_++;
+            return;
+        }
+        std::chrono::microseconds hold = impairment_.delay;
+        if (impairment_.jitter.count() > 0) {
+            hold += std::chrono::microseconds(jitter(rng));
+        }
+        if (impairment_.reorder > 0.0 && chance(rng) < impairment_.reorder) {
+            hold += impairment_.reorder_delay;
+            reordered_++;
+        }
+        if (hold.count() == 0) {
+            net::UdpSocket* socket = socket_for(socket_id);
+            if (socket && SendOne(*socket, to, data, size)) {
+                forwarded_++;
+            }
+            return;
+        }
+        queue.push_back(Pending{now + hold, sequence++, socket_id, to, std::vector<uint8_t>(data, data + size)});
+        std::push_heap(queue.begin(), queue.end(), ReleasedLater);
+    };
+
+    auto handle = [&](uint64_t id, const net::IncomingDatagram& datagram, Clock::time_point now) {
+        if (id == kFrontId) {
+            // A request, or a retransmitted one: forwarded to the listener from the flow's upstream socket
+            uint64_t key = AddressKey(datagram.addr);
+            auto found = flow_by_client.find(key);
+            uint64_t flow_id;
+            if (found == flow_by_client.end()) {
+                flow_id = next_flow++;
+                Flow& flow = flows[flow_id];
+                flow.client = datagram.addr;
+                if (!OpenLoopbackSocket(flow.upstream) || !poller.Add(flow.upstream.GetNativeHandle(),
+                                                                      UpstreamId(flow_id))) {
+                    flows.erase(flow_id);
+                    return;
+                }
+                flow_by_client.emplace(key, flow_id);
+                flows_++;
+            } else {
+                flow_id = found->second;
+            }
+            flows[flow_id].last_active = now;
+            forward(UpstreamId(flow_id), server_, datagram.buffer, datagram.length, now);
+            return;
+        }
+
+        uint64_t flow_id = (id - 1) / 2;
+        auto it = flows.find(flow_id);
+        if (it == flows.end()) {
+            return;
+        }
+        Flow& flow = it->second;
+        flow.last_active = now;
+        if (id == UpstreamId(flow_id)) {
+            // The first answer fixes the server transfer ID the downstream socket mirrors
+            if (!flow.has_server_tid) {
+                if (!OpenLoopbackSocket(flow.downstream) ||
+                    !poller.Add(flow.downstream.GetNativeHandle(), DownstreamId(flow_id))) {
+                    flow.downstream.Close();
+                    return;
+                }
+                flow.has_server_tid = true;
+                flow.server_tid = datagram.addr;
+            }
+            forward(DownstreamId(flow_id), flow.client, datagram.buffer, datagram.length, now);
+        } else if (flow.has_server_tid) {
+            forward(UpstreamId(flow_id), flow.server_tid, datagram.buffer, datagram.length, now);
+        }
+    };
+
+    std::vector<uint64_t> ready;
+    Clock::time_point next_sweep = Clock::now() + kSweepInterval;
+    while (running_) {
+        Clock::time_point now = Clock::now();
+        while (!queue.empty() && queue.front().release <= now) {
+            std::pop_heap(queue.begin(), queue.end(), ReleasedLater);
+            Pending pending = std::move(queue.back());
+            queue.pop_back();
+            net::UdpSocket* socket = socket_for(pending.socket_id);
+            if (socket && SendOne(*socket, pending.to, pending.bytes.data(), pending.bytes.size())) {
+                forwarded_++;
+            }
+        }
+
+        int timeout_ms = kMaxWaitMs;
+        if (!queue.empty()) {
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(queue.front().release - now);
+            // Rounded up, so the loop does not wake just before the release and spin
+            timeout_ms = std::min<int>(kMaxWaitMs, static_cast<int>((wait.count() + 999) / 1000));
+        }
+
+        ready.clear();
+        poller.Wait(timeout_ms, ready);
+        now = Clock::now();
+        for (uint64_t id : ready) {
+            int handled = 0;
+            while (handled < kMaxDatagramsPerWakeup) {
+                net::UdpSocket* socket = socket_for(id);
+                if (!socket) {
+                    break;
+                }
+                int received = socket->ReceiveBatch(incoming.data(), incoming.size(), 0);
+                if (received <= 0) {
+                    break;
+                }
+                for (int i = 0; i < received; ++i) {
+                    handle(id, incoming[i], now);
+                }
+                handled += received;
+                if (static_cast<size_t>(received) < incoming.size()) {
+                    break;
+                }
+            }
+        }
+
+        if (now >= next_sweep) {
+            next_sweep = now + kSweepInterval;
+            for (auto it = flows.begin(); it != flows.end();) {
+                Flow& flow = it->second;
+                if (now - flow.last_active < kFlowIdleTimeout) {
+                    ++it;
+                    continue;
+                }
+                poller.Remove(flow.upstream.GetNativeHandle());
+                if (flow.downstream.IsValid()) {
+                    poller.Remove(flow.downstream.GetNativeHandle());
+                }
+                flow_by_client.erase(AddressKey(flow.client));
+                it = flows.erase(it);
+            }
+        }
+    }
+}
+
+} // namespace bench
+} // namespace tftpserver
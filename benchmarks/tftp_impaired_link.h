@@ -0,0 +1,88 @@
+/**
+ * @file tftp_impaired_link.h
+ * @brief Loopback UDP relay adding loss, delay and reordering between TFTP clients and a server
+ */
+
+#ifndef TFTP_IMPAIRED_LINK_H_
+#define TFTP_IMPAIRED_LINK_H_
+
+#include "tftp/tftp_socket.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace tftpserver {
+namespace bench {
+
+/**
+ * @brief What happens to each datagram crossing the link, in either direction
+ */
+struct LinkImpairment {
+    double loss = 0.0;                                   // Probability a datagram is dropped
+    double reorder = 0.0;                                // Probability a datagram is held back by reorder_delay
+    std::chrono::microseconds delay{0};                  // One-way delay added to every datagram
+    std::chrono::microseconds jitter{0};                 // Uniform extra delay in [0, jitter]
+    std::chrono::microseconds reorder_delay{2000};       // Extra hold letting later datagrams overtake
+    uint32_t seed = 1;                                   // Makes runs repeatable
+
+    bool IsEmpty() const {
+        return loss <= 0.0 && reorder <= 0.0 && delay.count() == 0 && jitter.count() == 0;
+    }
+};
+
+/**
+ * @brief Counters of a link, valid while it runs and after Stop
+ */
+struct LinkStats {
+    uint64_t forwarded = 0;  // Datagrams delivered
+    uint64_t dropped = 0;    // Datagrams lost on purpose
+    uint64_t reordered = 0;  // Datagrams held back by reorder_delay
+    uint64_t flows = 0;      // Client transfer IDs seen
+};
+
+/**
+ * @brief Relay standing in for the server on loopback
+ *
+ * Clients send their requests to GetPort(). Every client transfer ID gets its own upstream
+ * socket towards the server, and the server's transfer ID is mirrored by a downstream socket,
+ * so both sides see a peer with stable transfer IDs, exactly as without the relay. All sockets
+ * are served by one thread; delayed datagrams wait in a queue ordered by release time.
+ */
+class ImpairedLink {
+public:
+    ImpairedLink(const sockaddr_in& server, const LinkImpairment& impairment);
+    ~ImpairedLink();
+
+    // Disable copy
+    ImpairedLink(const ImpairedLink&) = delete;
+    ImpairedLink& operator=(const ImpairedLink&) = delete;
+
+    // Binds the front socket on 127.0.0.1 and starts relaying; false if the socket failed
+    bool Start();
+    // Stops relaying; datagrams still queued are discarded
+    void Stop();
+
+    uint16_t GetPort() const { return port_; }
+    LinkStats GetStats() const;
+
+private:
+    void Run();
+
+    sockaddr_in server_;
+    LinkImpairment impairment_;
+    uint16_t port_;
+    net::UdpSocket front_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    std::atomic<uint64_t> forwarded_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> reordered_;
+    std::atomic<uint64_t> flows_;
+};
+
+} // namespace bench
+} // namespace tftpserver
+
+#endif // TFTP_IMPAIRED_LINK_H_
@@ -0,0 +1,444 @@
+/**
+ * @file tftp_loadgen.cpp
+ * @brief End-to-end load generator: concurrent TftpClient transfers against an in-process TftpServer
+ *
+ * Every combination of --sessions and --workers starts a fresh server on loopback and runs
+ * that many read (and optionally write) transfers through the native client. With loss,
+ * reordering or delay requested, the traffic crosses an ImpairedLink relay. One line is
+ * printed per combination: throughput, time-to-first-byte and completion percentiles, and
+ * process CPU seconds per GB moved (client, relay and server together).
+ *
+ * The server serves synthetic files and discards uploads, so the disk never limits a run.
+ */
+
+#include "tftp/tftp_logger.h"
+#include "tftp/tftp_server.h"
+#include "tftp_impaired_link.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace tftpserver;
+
+namespace {
+
+struct LoadOptions {
+    std::vector<size_t> sessions = {100, 1000};
+    std::vector<size_t> workers = {1, 4};
+    TransferEngine engine = TransferEngine::kEventDriven;
+    size_t listeners = 1;
+    size_t block_size = 1428;
+    size_t window_size = 8;
+    uint64_t file_size = 256 * 1024;
+    double upload_ratio = 0.0;
+    size_t parallel = 0;        // Transfers in flight per run (0 = all sessions at once)
+    size_t client_threads = 1;
+    int timeout_secs = kDefaultTimeout;
+    uint16_t port = 16969;
+    bench::LinkImpairment impairment;
+    std::string csv_path;
+};
+
+// Serves size bytes for any name
+class SyntheticSource : public ReadSource {
+public:
+    explicit SyntheticSource(uint64_t size) : size_(size) {}
+    bool Open(const std::string&) override { return true; }
+    bool Stat(const std::string&, uint64_t& size) override {
+        size = size_;
+        return true;
+    }
+    uint64_t Size() const override { return size_; }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        bytes_read = offset >= size_ ? 0 : static_cast<size_t>(std::min<uint64_t>(length, size_ - offset));
+        std::memset(buffer, static_cast<int>(offset & 0xff), bytes_read);
+        return true;
+    }
+    void Close() override {}
+
+private:
+    uint64_t size_;
+};
+
+// Accepts and drops everything
+class DiscardSink : public WriteSink {
+public:
+    bool Open(const std::string&, uint64_t) override { return true; }
+    bool Write(uint64_t, const uint8_t*, size_t) override { return true; }
+    bool Commit() override { return true; }
+    void Abort() override {}
+};
+
+struct RunResult {
+    size_t sessions = 0;
+    size_t workers = 0;
+    size_t succeeded = 0;
+    size_t failed = 0;
+    uint64_t bytes = 0;
+    double wall_seconds = 0.0;
+    double cpu_seconds = 0.0;
+    std::vector<uint64_t> first_byte_us;
+    std::vector<uint64_t> elapsed_us;
+    uint64_t retransmits = 0;
+    uint64_t timeouts = 0;
+    uint64_t listener_min = 0;  // Requests on the least and most loaded listener
+    uint64_t listener_max = 0;
+    bench::LinkStats link;
+    std::string first_error;
+};
+
+double ProcessCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    auto to_seconds = [](const FILETIME& time) {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) / 1e7;  // 100 ns units
+    };
+    return to_seconds(kernel) + to_seconds(user);
+#else
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+// Nearest-rank percentile in milliseconds; values must be sorted
+double PercentileMs(const std::vector<uint64_t>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+    size_t index = std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1);
+    return static_cast<double>(sorted[index]) / 1000.0;
+}
+
+RunResult RunOnce(const LoadOptions& options, size_t sessions, size_t workers, const std::string& root) {
+    RunResult result;
+    result.sessions = sessions;
+    result.workers = workers;
+
+    TftpServer server(root, options.port);
+    if (options.engine == TransferEngine::kEventDriven) {
+        server.SetTransferEngine(TransferEngine::kEventDriven, workers);
+    } else {
+        server.SetThreadPoolSize(workers);
+    }
+    server.SetListenerCount(options.listeners);
+    server.SetTimeout(options.timeout_secs);
+    const uint64_t file_size = options.file_size;
+    server.SetReadSourceFactory([file_size]() { return std::make_unique<SyntheticSource>(file_size); });
+    server.SetWriteSinkFactory([]() { return std::make_unique<DiscardSink>(); });
+    if (!server.Start()) {
+        result.failed = sessions;
+        result.first_error = "server failed to start on port " + std::to_string(options.port);
+        return result;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint16_t target_port = options.port;
+    std::unique_ptr<bench::ImpairedLink> link;
+    if (!options.impairment.IsEmpty()) {
+        link = std::make_unique<bench::ImpairedLink>(net::SocketAddress("127.0.0.1", options.port).GetSockAddr(),
+                                                     options.impairment);
+        if (!link->Start()) {
+            server.Stop();
+            result.failed = sessions;
+            result.first_error = "relay failed to start";
+            return result;
+        }
+        target_port = link->GetPort();
+    }
+
+    // Uploads are spread evenly through the batch
+    std::vector<ClientTransfer> transfers(sessions);
+    std::vector<DiscardSink> sinks(sessions);
+    std::vector<std::unique_ptr<SyntheticSource>> sources;
+    double uploads_due = 0.0;
+    for (size_t i = 0; i < sessions; ++i) {
+        ClientTransfer& transfer = transfers[i];
+        uploads_due += options.upload_ratio;
+        if (uploads_due >= 1.0) {
+            uploads_due -= 1.0;
+            transfer.upload = true;
+            transfer.filename = "upload_" + std::to_string(i) + ".bin";
+            sources.push_back(std::make_unique<SyntheticSource>(file_size));
+            transfer.source = sources.back().get();
+        } else {
+            transfer.filename = "file_" + std::to_string(i % 64) + ".bin";
+            transfer.sink = &sinks[i];
+        }
+    }
+
+    const size_t threads = std::max<size_t>(1, std::min(options.client_threads, sessions));
+    const size_t parallel = options.parallel == 0 ? sessions : options.parallel;
+    std::vector<std::vector<ClientTransfer>> slices(threads);
+    for (size_t i = 0; i < sessions; ++i) {
+        slices[i % threads].push_back(std::move(transfers[i]));
+    }
+
+    double cpu_start = ProcessCpuSeconds();
+    auto wall_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (size_t t = 0; t < threads; ++t) {
+        clients.emplace_back([&, t]() {
+            TftpClient client;
+            client.SetTimeout(options.timeout_secs);
+            client.SetBlockSize(options.block_size);
+            client.SetWindowSize(options.window_size);
+            client.SetMaxParallelTransfers(std::max<size_t>(1, (parallel + threads - 1) / threads));
+            client.RunTransfers("127.0.0.1", slices[t], target_port);
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    result.cpu_seconds = ProcessCpuSeconds() - cpu_start;
+
+    for (const std::vector<ClientTransfer>& slice : slices) {
+        for (const ClientTransfer& transfer : slice) {
+            if (!transfer.success || transfer.bytes != file_size) {
+                result.failed++;
+                if (result.first_error.empty()) {
+                    result.first_error = transfer.filename + ": " + transfer.error;
+                }
+                continue;
+            }
+            result.succeeded++;
+            result.bytes += transfer.bytes;
+            result.first_byte_us.push_back(transfer.first_byte_us);
+            result.elapsed_us.push_back(transfer.elapsed_us);
+        }
+    }
+    std::sort(result.first_byte_us.begin(), result.first_byte_us.end());
+    std::sort(result.elapsed_us.begin(), result.elapsed_us.end());
+
+    if (link) {
+        link->Stop();
+        result.link = link->GetStats();
+    }
+    ServerStats stats = server.GetStats();
+    result.retransmits = stats.retransmits;
+    result.timeouts = stats.timeouts;
+    std::vector<ListenerStats> listeners = server.GetListenerStats();
+    if (!listeners.empty()) {
+        result.listener_min = result.listener_max = listeners[0].requests;
+        for (const ListenerStats& listener : listeners) {
+            result.listener_min = std::min(result.listener_min, listener.requests);
+            result.listener_max = std::max(result.listener_max, listener.requests);
+        }
+    }
+    server.Stop();
+    return result;
+}
+
+void PrintHeader() {
+    std::printf("%8s %7s %6s %5s %9s | %9s %9s %9s | %9s %9s %9s | %8s %8s %8s %11s\n",
+                "sessions", "workers", "ok", "fail", "MB/s",
+                "ttfb p50", "p99", "p999", "done p50", "p99", "p999",
+                "cpu s/GB", "rexmit", "dropped", "listeners");
+}
+
+void PrintRow(const RunResult& r) {
+    double megabytes = static_cast<double>(r.bytes) / (1024.0 * 1024.0);
+    double gigabytes = static_cast<double>(r.bytes) / (1024.0 * 1024.0 * 1024.0);
+    char listeners[32];
+    std::snprintf(listeners, sizeof(listeners), "%llu-%llu", static_cast<unsigned long long>(r.listener_min),
+                  static_cast<unsigned long long>(r.listener_max));
+    std::printf("%8zu %7zu %6zu %5zu %9.1f | %9.2f %9.2f %9.2f | %9.1f %9.1f %9.1f | %8.2f %8llu %8llu %11s\n",
+                r.sessions, r.workers, r.succeeded, r.failed,
+                r.wall_seconds > 0 ? megabytes / r.wall_seconds : 0.0,
+                PercentileMs(r.first_byte_us, 0.50), PercentileMs(r.first_byte_us, 0.99),
+                PercentileMs(r.first_byte_us, 0.999),
+                PercentileMs(r.elapsed_us, 0.50), PercentileMs(r.elapsed_us, 0.99), PercentileMs(r.elapsed_us, 0.999),
+                gigabytes > 0 ? r.cpu_seconds / gigabytes : 0.0,
+                static_cast<unsigned long long>(r.retransmits), static_cast<unsigned long long>(r.link.dropped),
+                listeners);
+    if (!r.first_error.empty()) {
+        std::printf("         first failure: %s\n", r.first_error.c_str());
+    }
+    std::fflush(stdout);
+}
+
+void WriteCsv(const std::string& path, const std::vector<RunResult>& results) {
+    std::ofstream csv(path);
+    csv << "sessions,workers,succeeded,failed,bytes,wall_seconds,cpu_seconds,"
+           "ttfb_p50_ms,ttfb_p99_ms,ttfb_p999_ms,done_p50_ms,done_p99_ms,done_p999_ms,"
+           "retransmits,timeouts,link_dropped,link_reordered,listener_min,listener_max\n";
+    for (const RunResult& r : results) {
+        csv << r.sessions << ',' << r.workers << ',' << r.succeeded << ',' << r.failed << ',' << r.bytes << ','
+            << r.wall_seconds << ',' << r.cpu_seconds << ','
+            << PercentileMs(r.first_byte_us, 0.50) << ',' << PercentileMs(r.first_byte_us, 0.99) << ','
+            << PercentileMs(r.first_byte_us, 0.999) << ','
+            << PercentileMs(r.elapsed_us, 0.50) << ',' << PercentileMs(r.elapsed_us, 0.99) << ','
+            << PercentileMs(r.elapsed_us, 0.999) << ','
+            << r.retransmits << ',' << r.timeouts << ',' << r.link.dropped << ',' << r.link.reordered << ','
+            << r.listener_min << ',' << r.listener_max << '\n';
+    }
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --sessions=N[,N...]     Concurrent transfers per run (default 100,1000)\n"
+        "  --workers=N[,N...]      Reactor threads or pool workers per run (default 1,4)\n"
+        "  --engine=event|pool     Server transfer engine (default event)\n"
+        "  --listeners=N           SO_REUSEPORT listening sockets (default 1, 0 = one per core)\n"
+        "  --blksize=N             Requested block size (default 1428)\n"
+        "  --windowsize=N          Requested window size (default 8)\n"
+        "  --size=BYTES            File size of every transfer (default 262144)\n"
+        "  --upload-ratio=F        Fraction of transfers that are uploads (default 0)\n"
+        "  --parallel=N            Transfers in flight at once (default 0 = all)\n"
+        "  --client-threads=N      Client event loops sharing the sessions (default 1)\n"
+        "  --timeout=SECONDS       Retransmission timeout ceiling (default %d)\n"
+        "  --port=N                Server port (default 16969)\n"
+        "  --loss=F                Datagram loss probability per direction (default 0)\n"
+        "  --reorder=F             Probability a datagram is held back (default 0)\n"
+        "  --reorder-delay=MS      Hold of a reordered datagram (default 2)\n"
+        "  --delay=MS              One-way delay (default 0)\n"
+        "  --jitter=MS             Uniform extra delay (default 0)\n"
+        "  --seed=N                Impairment random seed (default 1)\n"
+        "  --csv=FILE              Also write the results as CSV\n",
+        program, kDefaultTimeout);
+}
+
+std::vector<size_t> ParseList(const std::string& value) {
+    std::vector<size_t> list;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        list.push_back(static_cast<size_t>(std::stoul(item)));
+    }
+    if (list.empty()) {
+        throw std::invalid_argument("empty list");
+    }
+    return list;
+}
+
+std::chrono::microseconds ParseMs(const std::string& value) {
+    return std::chrono::microseconds(static_cast<long long>(std::stod(value) * 1000.0));
+}
+
+// Returns false (after printing why) if an argument is not understood
+bool ParseOptions(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        try {
+            if (name == "--sessions") {
+                options.sessions = ParseList(value);
+            } else if (name == "--workers") {
+                options.workers = ParseList(value);
+            } else if (name == "--engine" && (value == "event" || value == "pool")) {
+                options.engine = value == "event" ? TransferEngine::kEventDriven : TransferEngine::kThreadPool;
+            } else if (name == "--listeners") {
+                options.listeners = std::stoul(value);
+            } else if (name == "--blksize") {
+                options.block_size = std::stoul(value);
+            } else if (name == "--windowsize") {
+                options.window_size = std::stoul(value);
+            } else if (name == "--size") {
+                options.file_size = std::stoull(value);
+            } else if (name == "--upload-ratio") {
+                options.upload_ratio = std::stod(value);
+            } else if (name == "--parallel") {
+                options.parallel = std::stoul(value);
+            } else if (name == "--client-threads") {
+                options.client_threads = std::stoul(value);
+            } else if (name == "--timeout") {
+                options.timeout_secs = std::stoi(value);
+            } else if (name == "--port") {
+                options.port = static_cast<uint16_t>(std::stoul(value));
+            } else if (name == "--loss") {
+                options.impairment.loss = std::stod(value);
+            } else if (name == "--reorder") {
+                options.impairment.reorder = std::stod(value);
+            } else if (name == "--reorder-delay") {
+                options.impairment.reorder_delay = ParseMs(value);
+            } else if (name == "--delay") {
+                options.impairment.delay = ParseMs(value);
+            } else if (name == "--jitter") {
+                options.impairment.jitter = ParseMs(value);
+            } else if (name == "--seed") {
+                options.impairment.seed = static_cast<uint32_t>(std::stoul(value));
+            } else if (name == "--csv" && !value.empty()) {
+                options.csv_path = value;
+            } else {
+                std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::fprintf(stderr, "Invalid value for %s: %s\n", name.c_str(), value.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    if (argc > 1 && (std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0)) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    // Failures are counted in the report; per-packet logging would dominate the CPU figures
+    TftpLogger::GetInstance().SetLogLevel(kLogCritical);
+
+    const bench::LinkImpairment& link = options.impairment;
+    std::printf("engine=%s listeners=%zu blksize=%zu windowsize=%zu size=%llu upload-ratio=%.2f\n",
+                options.engine == TransferEngine::kEventDriven ? "event" : "pool", options.listeners,
+                options.block_size, options.window_size, static_cast<unsigned long long>(options.file_size),
+                options.upload_ratio);
+    std::printf("link: loss=%.3f reorder=%.3f delay=%.2fms jitter=%.2fms%s\n", link.loss, link.reorder,
+                static_cast<double>(link.delay.count()) / 1000.0, static_cast<double>(link.jitter.count()) / 1000.0,
+                link.IsEmpty() ? " (direct, no relay)" : "");
+    std::printf("latencies in ms; cpu covers client, relay and server threads\n\n");
+    PrintHeader();
+
+    std::string root = (std::filesystem::temp_directory_path() / "tftpserver_loadgen_root").string();
+    std::filesystem::create_directories(root);
+
+    std::vector<RunResult> results;
+    bool all_succeeded = true;
+    for (size_t sessions : options.sessions) {
+        for (size_t workers : options.workers) {
+            results.push_back(RunOnce(options, sessions, workers, root));
+            PrintRow(results.back());
+            all_succeeded = all_succeeded && results.back().failed == 0;
+        }
+    }
+    std::filesystem::remove_all(root);
+
+    if (!options.csv_path.empty()) {
+        WriteCsv(options.csv_path, results);
+    }
+    return all_succeeded ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file tftp_netascii_bench.cpp
+ * @brief Microbenchmarks of the netascii translation stage
+ */
+
+#include <benchmark/benchmark.h>
+#include "internal/tftp_netascii.h"
+#include "tftp/tftp_common.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+namespace {
+
+// Configuration-file-like text: the argument is the average line length
+std::vector<uint8_t> MakeText(size_t line_length) {
+    std::vector<uint8_t> text(64 * 1024);
+    for (size_t i = 0; i < text.size(); ++i) {
+        text[i] = (i % line_length == line_length - 1) ? '\n' : static_cast<uint8_t>('a' + i % 26);
+    }
+    return text;
+}
+
+void BM_NetAsciiCount(benchmark::State& state) {
+    std::vector<uint8_t> text = MakeText(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(CountLineBreaks(text.data(), text.size()));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// Encodes into 512-byte blocks, as a default-blksize transfer pulls them
+void BM_NetAsciiEncode(benchmark::State& state) {
+    std::vector<uint8_t> text = MakeText(static_cast<size_t>(state.range(0)));
+    std::vector<uint8_t> block(kMaxDataSize);
+    for (auto _ : state) {
+        NetAsciiEncoder encoder;
+        size_t position = 0;
+        while (position < text.size()) {
+            size_t consumed = 0;
+            encoder.Encode(text.data() + position, text.size() - position, block.data(), block.size(), consumed);
+            position += consumed;
+            benchmark::DoNotOptimize(block.data());
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+void BM_NetAsciiDecode(benchmark::State& state) {
+    std::vector<uint8_t> text = MakeText(static_cast<size_t>(state.range(0)));
+    std::vector<uint8_t> wire(text.size() * 2);
+    NetAsciiEncoder encoder;
+    size_t consumed = 0;
+    wire.resize(encoder.Encode(text.data(), text.size(), wire.data(), wire.size(), consumed));
+    std::vector<uint8_t> out(kMaxDataSize + 1);
+    for (auto _ : state) {
+        NetAsciiDecoder decoder;
+        for (size_t i = 0; i < wire.size(); i += kMaxDataSize) {
+            size_t length = std::min<size_t>(kMaxDataSize, wire.size() - i);
+            benchmark::DoNotOptimize(decoder.Decode(wire.data() + i, length, out.data()));
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * wire.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_NetAsciiCount)->Arg(16)->Arg(80)->Arg(4096);
+BENCHMARK(BM_NetAsciiEncode)->Arg(16)->Arg(80)->Arg(4096);
+BENCHMARK(BM_NetAsciiDecode)->Arg(16)->Arg(80)->Arg(4096);
@@ -0,0 +1,109 @@
+/**
+ * @file tftp_packet_bench.cpp
+ * @brief Microbenchmarks of the TFTP packet codecs (TftpPacket and PacketView)
+ */
+
+#include <benchmark/benchmark.h>
+#include "tftp/tftp_packet.h"
+#include "tftp/tftp_packet_view.h"
+#include <cstdint>
+#include <vector>
+
+using namespace tftpserver;
+
+namespace {
+
+TftpPacket MakeRequest() {
+    TftpPacket packet = TftpPacket::CreateReadRequest("images/firmware-v2.bin", TransferMode::kOctet);
+    packet.SetOption("blksize", "1428");
+    packet.SetOption("windowsize", "16");
+    packet.SetOption("tsize", "0");
+    return packet;
+}
+
+TftpPacket MakeData(size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; ++i) {
+        payload[i] = static_cast<uint8_t>(i);
+    }
+    return TftpPacket::CreateData(4242, std::move(payload));
+}
+
+TftpPacket MakeOack() {
+    return TftpPacket::CreateOACK({{"blksize", "1428"}, {"windowsize", "16"}, {"tsize", "1048576"}});
+}
+
+// Packet under test for each opcode case; the argument of the DATA cases is the payload size
+TftpPacket MakePacket(OpCode op_code, size_t data_size) {
+    switch (op_code) {
+        case OpCode::kReadRequest: return MakeRequest();
+        case OpCode::kData: return MakeData(data_size);
+        case OpCode::kAcknowledge: return TftpPacket::CreateAck(4242);
+        case OpCode::kError: return TftpPacket::CreateError(ErrorCode::kFileNotFound, "File not found");
+        default: return MakeOack();
+    }
+}
+
+template <OpCode kOpCode>
+void BM_Serialize(benchmark::State& state) {
+    TftpPacket packet = MakePacket(kOpCode, static_cast<size_t>(state.range(0)));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::vector<uint8_t> data = packet.Serialize();
+        bytes += data.size();
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+template <OpCode kOpCode>
+void BM_Deserialize(benchmark::State& state) {
+    std::vector<uint8_t> data = MakePacket(kOpCode, static_cast<size_t>(state.range(0))).Serialize();
+    for (auto _ : state) {
+        TftpPacket packet;
+        bool ok = packet.Deserialize(data.data(), data.size(), kMaxBlockSize);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+// The allocation-free codec used by the transfer engines, on the same datagrams
+template <OpCode kOpCode>
+void BM_PacketViewParse(benchmark::State& state) {
+    std::vector<uint8_t> data = MakePacket(kOpCode, static_cast<size_t>(state.range(0))).Serialize();
+    for (auto _ : state) {
+        PacketView view;
+        bool ok = view.Parse(data.data(), data.size(), kMaxBlockSize);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+void BM_EncodeDataHeader(benchmark::State& state) {
+    std::vector<uint8_t> buffer(codec::kHeaderSize + kMaxDataSize);
+    uint16_t block = 0;
+    for (auto _ : state) {
+        codec::EncodeDataHeader(buffer.data(), ++block);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_Serialize, OpCode::kReadRequest)->Arg(0);
+BENCHMARK_TEMPLATE(BM_Serialize, OpCode::kData)->Arg(512)->Arg(1428)->Arg(8192);
+BENCHMARK_TEMPLATE(BM_Serialize, OpCode::kAcknowledge)->Arg(0);
+BENCHMARK_TEMPLATE(BM_Serialize, OpCode::kError)->Arg(0);
+BENCHMARK_TEMPLATE(BM_Serialize, OpCode::kOACK)->Arg(0);
+
+BENCHMARK_TEMPLATE(BM_Deserialize, OpCode::kReadRequest)->Arg(0);
+BENCHMARK_TEMPLATE(BM_Deserialize, OpCode::kData)->Arg(512)->Arg(1428)->Arg(8192);
+BENCHMARK_TEMPLATE(BM_Deserialize, OpCode::kAcknowledge)->Arg(0);
+BENCHMARK_TEMPLATE(BM_Deserialize, OpCode::kError)->Arg(0);
+BENCHMARK_TEMPLATE(BM_Deserialize, OpCode::kOACK)->Arg(0);
+
+BENCHMARK_TEMPLATE(BM_PacketViewParse, OpCode::kReadRequest)->Arg(0);
+BENCHMARK_TEMPLATE(BM_PacketViewParse, OpCode::kData)->Arg(512)->Arg(1428)->Arg(8192);
+BENCHMARK_TEMPLATE(BM_PacketViewParse, OpCode::kAcknowledge)->Arg(0);
+
+BENCHMARK(BM_EncodeDataHeader);
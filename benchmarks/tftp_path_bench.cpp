@@ -0,0 +1,96 @@
+/**
+ * @file tftp_path_bench.cpp
+ * @brief Microbenchmarks of request path validation and normalization
+ */
+
+#include <benchmark/benchmark.h>
+#include "tftp/tftp_logger.h"
+#include "tftp/tftp_util.h"
+#include "tftp/tftp_validation.h"
+#include "internal/tftp_path_validator.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace tftpserver;
+
+namespace {
+
+// Root directory with one file, shared by all path benchmarks
+const std::string& BenchRoot() {
+    static const std::string root = [] {
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "tftpserver_bench_root";
+        std::filesystem::create_directories(dir / "images");
+        std::ofstream(dir / "images" / "firmware.bin") << "firmware";
+        return dir.string();
+    }();
+    return root;
+}
+
+// Rejections are logged as errors; the cost measured here is the check, not the log line
+void QuietLogger() {
+    TftpLogger::GetInstance().SetLogLevel(kLogCritical + 1);
+}
+
+void BM_IsPathSecureAccepted(benchmark::State& state) {
+    QuietLogger();
+    const std::string& root = BenchRoot();
+    for (auto _ : state) {
+        bool secure = util::IsPathSecure("images/firmware.bin", root);
+        benchmark::DoNotOptimize(secure);
+    }
+}
+
+void BM_IsPathSecureRejected(benchmark::State& state) {
+    QuietLogger();
+    const std::string& root = BenchRoot();
+    for (auto _ : state) {
+        bool secure = util::IsPathSecure("../../etc/passwd", root);
+        benchmark::DoNotOptimize(secure);
+    }
+}
+
+void BM_NormalizePath(benchmark::State& state) {
+    QuietLogger();
+    std::string path = BenchRoot() + "/images/./../images/firmware.bin";
+    for (auto _ : state) {
+        std::string normalized = util::NormalizePath(path);
+        benchmark::DoNotOptimize(normalized.data());
+    }
+}
+
+void BM_ValidateFilename(benchmark::State& state) {
+    QuietLogger();
+    for (auto _ : state) {
+        bool valid = validation::ValidateFilename("images/firmware.bin");
+        benchmark::DoNotOptimize(valid);
+    }
+}
+
+// The server's own path: the lexical checks and the resolution cache of PathValidator
+void BM_PathValidatorIsSafeName(benchmark::State& state) {
+    for (auto _ : state) {
+        bool safe = internal::PathValidator::IsSafeName("images/firmware.bin");
+        benchmark::DoNotOptimize(safe);
+    }
+}
+
+void BM_PathValidatorResolveCached(benchmark::State& state) {
+    QuietLogger();
+    internal::PathValidator validator;
+    validator.SetRoot(BenchRoot());
+    std::string resolved;
+    for (auto _ : state) {
+        bool ok = validator.Resolve("images/firmware.bin", true, resolved);
+        benchmark::DoNotOptimize(ok);
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_IsPathSecureAccepted);
+BENCHMARK(BM_IsPathSecureRejected);
+BENCHMARK(BM_NormalizePath);
+BENCHMARK(BM_ValidateFilename);
+BENCHMARK(BM_PathValidatorIsSafeName);
+BENCHMARK(BM_PathValidatorResolveCached);
@@ -0,0 +1,55 @@
+/**
+ * @file tftp_thread_pool_bench.cpp
+ * @brief Microbenchmarks of TftpThreadPool task throughput
+ */
+
+#include <benchmark/benchmark.h>
+#include "internal/tftp_thread_pool.h"
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+using tftpserver::internal::TftpThreadPool;
+
+namespace {
+
+constexpr int kTasksPerIteration = 1000;
+
+// Submit with a future per task, as callers that need the result use it; argument = workers
+void BM_ThreadPoolSubmit(benchmark::State& state) {
+    TftpThreadPool pool(static_cast<size_t>(state.range(0)));
+    std::vector<std::future<int>> futures;
+    futures.reserve(kTasksPerIteration);
+    for (auto _ : state) {
+        futures.clear();
+        for (int i = 0; i < kTasksPerIteration; ++i) {
+            futures.push_back(pool.Submit([i] { return i; }));
+        }
+        for (auto& future : futures) {
+            benchmark::DoNotOptimize(future.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kTasksPerIteration);
+}
+
+// Fire-and-forget Post, as the server queues requests
+void BM_ThreadPoolPost(benchmark::State& state) {
+    TftpThreadPool pool(static_cast<size_t>(state.range(0)));
+    std::atomic<int> done{0};
+    for (auto _ : state) {
+        done.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < kTasksPerIteration; ++i) {
+            pool.Post([&done] { done.fetch_add(1, std::memory_order_release); });
+        }
+        while (done.load(std::memory_order_acquire) != kTasksPerIteration) {
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kTasksPerIteration);
+}
+
+} // namespace
+
+BENCHMARK(BM_ThreadPoolSubmit)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+BENCHMARK(BM_ThreadPoolPost)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
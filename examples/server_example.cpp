@@ -1,4 +1,5 @@
 #include "tftp/tftp_server.h"
+#include "tftp/tftp_logger.h"
 #include <iostream>
 #include <string>
 #include <thread>
@@ -39,6 +40,9 @@ int main(int argc, char* argv[]) {
     signal(SIGTERM, signal_handler); // Termination signal
 
     try {
+        // Keep logging off the transfer threads: a background writer batches the output
+        tftpserver::TftpLogger::GetInstance().SetAsync(true);
+        
         // Create and configure TFTP server
         tftpserver::TftpServer server(root_dir, port);
         
@@ -71,6 +75,7 @@ int main(int argc, char* argv[]) {
         // Stop the server
         std::cout << "Stopping TFTP server..." << std::endl;
         server.Stop();
+        tftpserver::TftpLogger::GetInstance().Flush();
         std::cout << "TFTP server stopped" << std::endl;
         
     } catch (const std::exception& e) {
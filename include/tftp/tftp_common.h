@@ -29,6 +29,21 @@ constexpr uint16_t kDefaultTftpPort = 69;
 constexpr size_t kMaxPacketSize = 516;  // 512 + 4 (header)
 constexpr size_t kMaxDataSize = 512;
 constexpr int kDefaultTimeout = 5;  // seconds
+constexpr int kDefaultRetransmitFloorMs = 200;  // Lowest adaptive retransmission timeout
+constexpr size_t kDefaultMaxQueuedRequests = 1024;  // Requests waiting for the engine before "Server busy"
+constexpr size_t kDefaultClientParallelTransfers = 16;  // Transfers of a client batch in flight at once
+
+// Block size negotiation limits (RFC 2348)
+constexpr size_t kMinBlockSize = 8;
+constexpr size_t kMaxBlockSize = 65464;
+constexpr size_t kMaxBlockPacketSize = kMaxBlockSize + 4;  // blksize + 4 (header)
+
+// Window size negotiation limits (RFC 7440)
+constexpr size_t kMinWindowSize = 1;
+constexpr size_t kMaxWindowSize = 65535;
+
+// Multicast option (RFC 2090); requested with an empty value, the only option allowed one
+constexpr char kMulticastOptionName[] = "multicast";
 
 // Security limits for buffer overflow protection
 constexpr size_t kMaxFilenameLength = 255;     // Maximum filename length
@@ -68,6 +83,34 @@ enum class TransferMode {
     kMail
 };
 
+// Server transfer engines
+enum class TransferEngine {
+    kThreadPool,   // One pool worker blocks on each transfer
+    kEventDriven   // Transfers multiplexed on a few event loop threads
+};
+
+// Datagram and file I/O backends
+enum class IoBackend {
+    kPortable,  // Readiness polling with recvmmsg/sendmmsg and pread (all platforms)
+    kIoUring    // Linux io_uring: multishot receives, batched sends and file reads
+};
+
+// When uploaded files are flushed to stable storage
+enum class FsyncPolicy {
+    kOnCommit,    // Once, before the upload is published (default)
+    kEveryWrite,  // After every block as well, so little data is ever at risk
+    kNever        // Left to the operating system
+};
+
+// Counters of one listening socket (one per SO_REUSEPORT shard)
+struct ListenerStats {
+    uint64_t requests = 0;         // RRQ/WRQ datagrams received
+    uint64_t duplicates = 0;       // Retransmitted requests of a session still in flight
+    uint64_t dropped = 0;          // Requests that could not be handed to an engine
+    uint64_t rejected = 0;         // Requests refused with "Server busy" (queue full or no transfer socket)
+    uint64_t active_sessions = 0;  // Sessions currently in flight
+};
+
 // Custom exception class
 class TFTP_EXPORT TftpException : public std::runtime_error {
 public:
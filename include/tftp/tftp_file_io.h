@@ -0,0 +1,200 @@
+/**
+ * @file tftp_file_io.h
+ * @brief Streaming file access interfaces for TFTP transfers
+ */
+
+#ifndef TFTP_FILE_IO_H_
+#define TFTP_FILE_IO_H_
+
+#include "tftp/tftp_common.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace tftpserver {
+
+/**
+ * @brief Read cache counters (see TftpServer::SetFileCacheSize)
+ */
+struct FileCacheStats {
+    uint64_t hits = 0;           ///< Requests served from an existing mapping
+    uint64_t misses = 0;         ///< Requests that had to map the file
+    uint64_t evictions = 0;      ///< Entries dropped to stay within the memory limit
+    uint64_t entries = 0;        ///< Files currently cached
+    uint64_t cached_bytes = 0;   ///< Bytes currently mapped by cached entries
+};
+
+/**
+ * @brief Read callback memoization counters (see TftpServer::SetReadCallbackCache)
+ */
+struct CallbackCacheStats {
+    uint64_t hits = 0;           ///< Requests served from a kept result
+    uint64_t misses = 0;         ///< Requests that called the read callback
+    uint64_t coalesced = 0;      ///< Requests that waited for a call already in flight for the same path
+    uint64_t entries = 0;        ///< Results currently kept
+    uint64_t cached_bytes = 0;   ///< Bytes currently held by kept results
+};
+
+/**
+ * @brief One positioned read of a ReadSource::ReadBatch call
+ */
+struct ReadRequest {
+    uint64_t offset = 0;         ///< Byte offset from the start of the file
+    uint8_t* buffer = nullptr;   ///< Destination buffer
+    size_t length = 0;           ///< Number of bytes requested
+    size_t bytes_read = 0;       ///< Set by ReadBatch; less than length only at end of file
+};
+
+/**
+ * @brief Source of file contents for a read request (RRQ)
+ *
+ * A new source is created for every transfer. The server opens it, queries the size once,
+ * pulls blocks with positioned reads as the transfer advances and closes it when done.
+ * Retransmissions read the same range again, so ReadAt must be repeatable. When the request
+ * carries options, the server first asks Stat for the size and opens the source only once the
+ * client has acknowledged the OACK. Sources backed by memory that is never modified can also
+ * lend blocks with PeekAt, which the server then sends without copying.
+ */
+class TFTP_EXPORT ReadSource {
+public:
+    virtual ~ReadSource() = default;
+
+    /**
+     * @brief Open the file for reading
+     * @param path Resolved file path (root directory already applied)
+     * @return true if successful, false if the file cannot be served
+     */
+    virtual bool Open(const std::string& path) = 0;
+
+    /**
+     * @brief Get the size of a file without opening it (answers the tsize option, RFC 2349)
+     * @param path Resolved file path (root directory already applied)
+     * @param size Size in bytes
+     * @return true if the size is known; false (the default) makes the server Open the source first
+     */
+    virtual bool Stat(const std::string& path, uint64_t& size) {
+        (void)path;
+        (void)size;
+        return false;
+    }
+
+    /**
+     * @brief Get the total file size
+     * @return Size in bytes, valid after a successful Open
+     */
+    virtual uint64_t Size() const = 0;
+
+    /**
+     * @brief Read bytes at a given offset
+     * @param offset Byte offset from the start of the file
+     * @param buffer Destination buffer
+     * @param length Number of bytes requested
+     * @param bytes_read Number of bytes stored; less than length only at end of file
+     * @return true if successful, false on I/O error
+     */
+    virtual bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) = 0;
+
+    /**
+     * @brief Read several ranges at once (the blocks of one send window)
+     * @param requests Reads to perform; bytes_read is filled in for each
+     * @param count Number of requests
+     * @return true if all reads succeeded, false on I/O error
+     *
+     * The default performs one ReadAt per request. Sources that can overlap the reads (the
+     * built-in file source with the io_uring backend) override it.
+     */
+    virtual bool ReadBatch(ReadRequest* requests, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!ReadAt(requests[i].offset, requests[i].buffer, requests[i].length, requests[i].bytes_read)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Hint that a range will be read soon (asynchronous read-ahead)
+     * @param offset Byte offset from the start of the file
+     * @param length Number of bytes
+     *
+     * Called from an I/O thread, possibly while the transfer reads another range. The default
+     * does nothing; the built-in file source passes the hint on to the kernel.
+     */
+    virtual void Prefetch(uint64_t offset, size_t length) {
+        (void)offset;
+        (void)length;
+    }
+
+    /**
+     * @brief Borrow bytes in place instead of copying them (zero-copy sends)
+     * @param offset Byte offset from the start of the file
+     * @param length Number of bytes wanted; the range lies within Size()
+     * @return Pointer to length bytes that never change and stay readable until Close, or
+     *         nullptr (the default) to have the server copy the range with ReadAt
+     */
+    virtual const uint8_t* PeekAt(uint64_t offset, size_t length) {
+        (void)offset;
+        (void)length;
+        return nullptr;
+    }
+
+    /**
+     * @brief Release the file; called once per successful Open
+     */
+    virtual void Close() = 0;
+};
+
+/**
+ * @brief Factory creating one ReadSource per transfer
+ */
+using ReadSourceFactory = std::function<std::unique_ptr<ReadSource>()>;
+
+/**
+ * @brief Destination of file contents for a write request (WRQ)
+ *
+ * A new sink is created for every transfer. Each in-order DATA block is passed to Write before
+ * it is acknowledged, so the upload never has to be buffered in full. The final block is
+ * followed by Commit, which must make the file visible; any other exit ends with Abort.
+ */
+class TFTP_EXPORT WriteSink {
+public:
+    virtual ~WriteSink() = default;
+
+    /**
+     * @brief Prepare to receive a file
+     * @param path Resolved file path (root directory already applied)
+     * @param size_hint Size announced with the tsize option, 0 if unknown
+     * @return true if successful, false if the file cannot be written
+     */
+    virtual bool Open(const std::string& path, uint64_t size_hint) = 0;
+
+    /**
+     * @brief Store one block of data
+     * @param offset Byte offset of the block; blocks arrive in increasing order without gaps
+     * @param data Block payload
+     * @param length Payload length (may be 0 for the terminating block)
+     * @return true if successful, false on I/O error
+     */
+    virtual bool Write(uint64_t offset, const uint8_t* data, size_t length) = 0;
+
+    /**
+     * @brief Finish the transfer and publish the file
+     * @return true if successful, false if the file could not be stored
+     */
+    virtual bool Commit() = 0;
+
+    /**
+     * @brief Discard a partial transfer
+     */
+    virtual void Abort() = 0;
+};
+
+/**
+ * @brief Factory creating one WriteSink per transfer
+ */
+using WriteSinkFactory = std::function<std::unique_ptr<WriteSink>()>;
+
+} // namespace tftpserver
+
+#endif // TFTP_FILE_IO_H_
@@ -7,8 +7,13 @@
 #define TFTP_LOGGER_H_
 
 #include "tftp/tftp_common.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <mutex>
 
 #ifdef _WIN32
@@ -43,6 +48,11 @@ enum LogLevel {
 // Compile-time log filtering to eliminate overhead in production
 #define TFTP_LOG_ENABLED(level) (level >= TFTP_LOG_LEVEL)
 
+// Messages each logging thread can queue for the asynchronous writer before new ones are dropped
+constexpr size_t kDefaultLogRingSlots = 128;
+// Longest formatted message; longer ones are truncated
+constexpr size_t kMaxLogMessageLength = 1023;
+
 /**
  * @class TftpLogger
  * @brief Class that provides TFTP server logging functionality
@@ -72,6 +82,34 @@ public:
      */
     void SetLogLevel(int level);
 
+    /**
+     * @brief Switch between synchronous output and the asynchronous writer
+     *
+     * In asynchronous mode each logging thread appends to its own lock-free ring buffer,
+     * and a background thread drains all rings in timestamp order and writes them in
+     * batches. A message that finds its thread's ring full is dropped and counted.
+     * @param enable true to start the background writer, false to drain and stop it
+     * @param ring_slots Capacity of the rings created from now on
+     */
+    void SetAsync(bool enable, size_t ring_slots = kDefaultLogRingSlots);
+
+    /**
+     * @brief Check whether messages go through the background writer
+     * @return true in asynchronous mode
+     */
+    bool IsAsync() const;
+
+    /**
+     * @brief Wait until every message queued so far has been written
+     */
+    void Flush();
+
+    /**
+     * @brief Get the number of messages dropped because a ring buffer was full
+     * @return Dropped message count since startup
+     */
+    uint64_t GetDroppedCount() const;
+
     /**
      * @brief Output log message
      * @param level Log level
@@ -79,13 +117,30 @@ public:
      */
     void Log(int level, const std::string& message);
 
+    /**
+     * @brief Output log message without copying it
+     * @param level Log level
+     * @param message Log message (need not be NUL-terminated)
+     * @param length Message length in bytes
+     */
+    void Log(int level, const char* message, size_t length);
+
+    /**
+     * @brief Output a hex dump of a buffer; nothing is formatted unless the level is enabled
+     * @param level Log level
+     * @param label Text printed before the dump
+     * @param data Bytes to dump (only the first 256 are shown)
+     * @param size Number of bytes
+     */
+    void LogHexDump(int level, const char* label, const uint8_t* data, size_t size);
+
     /**
      * @brief Check if log should be output for given level
      * @param level Log level to check
      * @return true if logging should occur for this level
      */
     bool ShouldLog(int level) const {
-        return level >= log_level_;
+        return level >= log_level_.load(std::memory_order_relaxed);
     }
 
     /**
@@ -93,7 +148,7 @@ public:
      * @return Current log level
      */
     int GetLogLevel() const {
-        return log_level_;
+        return log_level_.load(std::memory_order_relaxed);
     }
 
     /**
@@ -104,10 +159,13 @@ public:
      */
     template<typename... Args>
     void LogFormat(int level, const char* format, Args... args) {
-        if (level >= log_level_) {  // Changed from <= to >= for correct comparison
-            char buffer[1024];
-            snprintf(buffer, sizeof(buffer), format, args...);
-            Log(level, buffer);
+        if (ShouldLog(level)) {
+            char buffer[kMaxLogMessageLength + 1];
+            int length = snprintf(buffer, sizeof(buffer), format, args...);
+            if (length < 0) {
+                return;
+            }
+            Log(level, buffer, std::min(static_cast<size_t>(length), kMaxLogMessageLength));
 
 #ifdef _WIN32
             // Windows-specific debug output (using OutputDebugStringA)
@@ -128,13 +186,23 @@ public:
     }
 
 private:
-    TftpLogger() : log_level_(TFTP_LOG_LEVEL) {}  // Use build-time log level as default
+    class AsyncWriter;
+
+    TftpLogger();  // Uses the build-time log level as default
     TftpLogger(const TftpLogger&) = delete;
     TftpLogger& operator=(const TftpLogger&) = delete;
 
-    int log_level_;
+    // Formats one line and writes it to the log file or stderr; mutex_ must be held
+    void WriteLine(int level, int64_t timestamp_us, const char* message, size_t length, std::string& out);
+    void WriteOutput(const std::string& text);
+
+    std::atomic<int> log_level_;
     std::ofstream log_file_;
     std::mutex mutex_;
+    std::unique_ptr<AsyncWriter> async_;  // Created once, so producers never race its lifetime
+    std::string line_;                    // Reused line buffer of the synchronous path (guarded by mutex_)
+    int64_t cached_second_;               // Second of cached_time_ (guarded by mutex_)
+    char cached_time_[32];                // "YYYY-mm-dd HH:MM:SS" of cached_second_
 };
 
 
@@ -186,6 +254,12 @@ private:
         tftpserver::TftpLogger::GetInstance().LogFormat(level, __VA_ARGS__); \
     } } while(0)
 
+// Hex dump that costs nothing (not even formatting) unless the level is enabled
+#define TFTP_LOG_HEX(level, label, data, size) \
+    do { if (TFTP_LOG_ENABLED(level)) { \
+        tftpserver::TftpLogger::GetInstance().LogHexDump(level, label, data, size); \
+    } } while(0)
+
 // Convenience macro for runtime log level checking (for dynamic log levels)
 #define TFTP_LOG_RUNTIME(level, ...) \
     do { if (tftpserver::TftpLogger::GetInstance().ShouldLog(level)) { \
@@ -0,0 +1,83 @@
+/**
+ * @file tftp_metrics.h
+ * @brief Server-wide transfer counters and latency histograms
+ */
+
+#ifndef TFTP_METRICS_H_
+#define TFTP_METRICS_H_
+
+#include "tftp/tftp_common.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tftpserver {
+
+// Number of defined ErrorCode values, used to index per-code counters
+constexpr size_t kErrorCodeCount = 8;
+
+/**
+ * @brief Snapshot of a latency histogram with log-linear buckets (about 12% resolution)
+ */
+struct TFTP_EXPORT HistogramStats {
+    uint64_t count = 0;    ///< Recorded samples
+    uint64_t sum_us = 0;   ///< Sum of all samples
+    uint64_t min_us = 0;   ///< Smallest sample (0 when empty)
+    uint64_t max_us = 0;   ///< Largest sample
+    std::vector<std::pair<uint64_t, uint64_t>> buckets;  ///< (upper bound, samples) of non-empty buckets, ascending
+
+    /**
+     * @brief Estimate a percentile
+     * @param percentile Value in [0, 100]
+     * @return Upper bound of the bucket holding the percentile, clamped to max_us (0 when empty)
+     */
+    uint64_t Percentile(double percentile) const;
+};
+
+/**
+ * @brief Recycling counters of block buffers and session objects, shared by every server in the process
+ */
+struct BufferPoolStats {
+    uint64_t allocations = 0;   ///< Buffers and session objects handed out
+    uint64_t reused = 0;        ///< Allocations served from a free list rather than the heap
+    uint64_t discarded = 0;     ///< Returned to the heap: free lists full, or too large to pool
+    uint64_t cached_bytes = 0;  ///< Bytes currently held by the free lists
+};
+
+/**
+ * @brief Server metrics (see TftpServer::GetStats)
+ *
+ * Byte counters count DATA payload, packet counters count every datagram of a transfer.
+ */
+struct ServerStats {
+    uint64_t bytes_sent = 0;           ///< DATA payload bytes sent (RRQ)
+    uint64_t bytes_received = 0;       ///< DATA payload bytes received and accepted (WRQ)
+    uint64_t packets_sent = 0;         ///< Datagrams sent by transfers, retransmissions included
+    uint64_t packets_received = 0;     ///< Valid datagrams received from transfer peers
+    uint64_t retransmits = 0;          ///< Packets sent again after a timeout
+    uint64_t timeouts = 0;             ///< Retransmission timer expirations
+    uint64_t errors[kErrorCodeCount] = {};  ///< ERROR packets sent, indexed by ErrorCode
+    uint64_t transfers_started = 0;    ///< Accepted RRQ/WRQ
+    uint64_t transfers_completed = 0;  ///< Transfers that finished successfully
+    uint64_t transfers_failed = 0;     ///< Transfers that ended with an error, a timeout or shutdown
+    uint64_t active_sessions = 0;      ///< Transfers currently in flight
+    uint64_t pool_active_tasks = 0;    ///< Thread-pool workers busy with a transfer
+    uint64_t pool_queued_tasks = 0;    ///< Requests waiting for a thread-pool worker
+    BufferPoolStats buffer_pool;       ///< Block buffer and session object recycling
+
+    HistogramStats time_to_first_byte;  ///< Request accepted until the first DATA is sent or received
+    HistogramStats ack_rtt;             ///< Packet sent until the peer answers it (DATA window to ACK, or ACK to DATA); retransmitted rounds excluded
+    HistogramStats transfer_duration;   ///< Request accepted until the transfer ends
+};
+
+/**
+ * @brief Render a snapshot in the Prometheus text exposition format (version 0.0.4)
+ * @param stats Snapshot from TftpServer::GetStats
+ * @return Metric families prefixed with "tftp_"; histograms are exported as summaries
+ */
+TFTP_EXPORT std::string FormatPrometheusMetrics(const ServerStats& stats);
+
+} // namespace tftpserver
+
+#endif // TFTP_METRICS_H_
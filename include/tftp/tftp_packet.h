@@ -42,6 +42,8 @@ public:
     // NOTE: TFTP packets use network byte order (big-endian) for all multi-byte fields
     std::vector<uint8_t> Serialize() const;
     bool Deserialize(const std::vector<uint8_t>& data);
+    // max_data_size is the negotiated block size (RFC 2348); DATA payloads larger than it are rejected
+    bool Deserialize(const uint8_t* data, size_t size, size_t max_data_size = kMaxDataSize);
 
     // Packet creation
     static TftpPacket CreateReadRequest(const std::string& filename, TransferMode mode);
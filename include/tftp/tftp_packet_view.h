@@ -0,0 +1,89 @@
+/**
+ * @file tftp_packet_view.h
+ * @brief Allocation-free TFTP packet codec working on caller-provided buffers
+ */
+
+#ifndef TFTP_PACKET_VIEW_H_
+#define TFTP_PACKET_VIEW_H_
+
+#include "tftp/tftp_common.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace tftpserver {
+
+/**
+ * @class PacketView
+ * @brief Non-owning parse result of a TFTP datagram
+ *
+ * Parse applies the same validation as TftpPacket::Deserialize, but the payload,
+ * filename, mode, error message and options point into the parsed buffer, so the
+ * view is only valid while that buffer is neither modified nor released.
+ */
+class TFTP_EXPORT PacketView {
+public:
+    using Option = std::pair<std::string_view, std::string_view>;
+
+    PacketView() = default;
+
+    // max_data_size is the negotiated block size (RFC 2348); DATA payloads larger than it are rejected
+    bool Parse(const uint8_t* data, size_t size, size_t max_data_size = kMaxDataSize);
+
+    OpCode GetOpCode() const { return op_code_; }
+    uint16_t GetBlockNumber() const { return block_number_; }
+    ErrorCode GetErrorCode() const { return error_code_; }
+    const uint8_t* GetPayload() const { return payload_; }
+    size_t GetPayloadSize() const { return payload_size_; }
+    std::string_view GetFilename() const { return filename_; }
+    TransferMode GetMode() const { return mode_; }
+    std::string_view GetErrorMessage() const { return error_message_; }
+
+    // Options of an RRQ/WRQ/OACK in packet order
+    size_t GetOptionCount() const { return option_count_; }
+    const Option& GetOption(size_t index) const { return options_[index]; }
+    // Exact-match lookup; a repeated option resolves to its last occurrence, as in TftpPacket
+    bool HasOption(std::string_view name) const;
+    std::string_view GetOption(std::string_view name) const;
+
+private:
+    void Reset();
+    bool ParseOptions(const uint8_t* data, size_t size, size_t offset);
+
+    OpCode op_code_ = OpCode::kReadRequest;
+    uint16_t block_number_ = 0;
+    ErrorCode error_code_ = ErrorCode::kNotDefined;
+    const uint8_t* payload_ = nullptr;
+    size_t payload_size_ = 0;
+    std::string_view filename_;
+    TransferMode mode_ = TransferMode::kOctet;
+    std::string_view error_message_;
+    std::array<Option, kMaxOptionsCount> options_;
+    size_t option_count_ = 0;
+};
+
+namespace codec {
+
+// Opcode + block number (or error code)
+constexpr size_t kHeaderSize = 4;
+
+// Writes the 4-byte DATA header in front of a payload already placed at buffer + kHeaderSize
+TFTP_EXPORT void EncodeDataHeader(uint8_t* buffer, uint16_t block_number);
+
+// The DATA header of block_number in a static table that is never written after it is built,
+// so it can be sent with MSG_ZEROCOPY while the kernel may still be reading an earlier send
+TFTP_EXPORT const uint8_t* DataHeader(uint16_t block_number);
+
+// Writes an ACK into buffer (at least kHeaderSize bytes); returns the packet size
+TFTP_EXPORT size_t EncodeAck(uint8_t* buffer, uint16_t block_number);
+
+// Writes an ERROR into buffer; returns the packet size, or 0 if capacity is too small
+TFTP_EXPORT size_t EncodeError(uint8_t* buffer, size_t capacity, ErrorCode code, std::string_view message);
+
+} // namespace codec
+
+} // namespace tftpserver
+
+#endif // TFTP_PACKET_VIEW_H_
@@ -7,6 +7,8 @@
 #define TFTP_SERVER_H_
 
 #include "tftp/tftp_common.h"
+#include "tftp/tftp_file_io.h"
+#include "tftp/tftp_metrics.h"
 #include <string>
 #include <functional>
 #include <memory>
@@ -60,12 +62,107 @@ class TFTP_EXPORT TftpServer {
    */
   void SetReadCallback(std::function<bool(const std::string&, std::vector<uint8_t>&)> callback);
 
+  /**
+   * @brief Keep read callback results for reuse
+   * @param ttl_ms Milliseconds a result is served after the callback produced it
+   *               (0 = keep nothing, default; at most one day)
+   * @param max_bytes Total bytes of results kept; the least recently used go first
+   * @note Concurrent requests for one path always share a single callback call. Results are
+   *       keyed by the resolved path the callback receives; failed calls are never kept.
+   *       SetReadCallback drops every kept result, and requests received afterwards never
+   *       share a call of the previous callback, which transfers in flight keep using
+   */
+  void SetReadCallbackCache(int ttl_ms, size_t max_bytes);
+
+  /**
+   * @brief Drop the kept read callback result of a file
+   * @param filename Name as a client would request it (empty = drop every result)
+   * @note A call in flight for the file still answers the requests waiting for it, but its
+   *       result is not kept
+   */
+  void InvalidateReadCallbackCache(const std::string& filename = "");
+
+  /**
+   * @brief Get read callback cache counters
+   * @return Hit, miss and coalesced request counts and current cache usage
+   */
+  CallbackCacheStats GetReadCallbackCacheStats() const;
+
+  /**
+   * @brief Drop every cached request path resolution
+   * @note Resolutions are kept for a few seconds; call this after moving files or changing
+   *       symlinks under the root directory so that the next requests see the change
+   */
+  void InvalidatePathCache();
+
+  /**
+   * @brief Set streaming read source factory
+   * @param factory Factory creating one ReadSource per read request; replaces any read callback
+   */
+  void SetReadSourceFactory(ReadSourceFactory factory);
+
   /**
    * @brief Set file write callback
    * @param callback File write callback function
    */
   void SetWriteCallback(std::function<bool(const std::string&, const std::vector<uint8_t>&)> callback);
 
+  /**
+   * @brief Set streaming write sink factory
+   * @param factory Factory creating one WriteSink per write request; replaces any write callback
+   */
+  void SetWriteSinkFactory(WriteSinkFactory factory);
+
+  /**
+   * @brief Set memory limit of the shared read cache
+   * @param max_bytes Bytes of file data kept mapped for the default read source (0 disables the cache)
+   */
+  void SetFileCacheSize(size_t max_bytes);
+
+  /**
+   * @brief Get read cache counters
+   * @return Hit, miss and eviction counts and current cache usage
+   */
+  FileCacheStats GetFileCacheStats() const;
+
+  /**
+   * @brief Move disk I/O of the built-in file sources and sinks off the network path
+   * @param read_ahead_windows Send windows each RRQ keeps read ahead on the I/O threads
+   *                           (0 = read on demand, default; at most 64)
+   * @param write_behind_bytes Bytes of each WRQ that may be acknowledged before they are
+   *                           written (0 = write every block before its ACK, default)
+   * @note Applies to requests received afterwards; custom sources and sinks are not affected.
+   *       A window whose read-ahead is still in flight is sent once it completes; the ACK of
+   *       an upload further behind than write_behind_bytes waits for the disk, and the final
+   *       ACK for the commit on the I/O threads. A write that fails in the background fails
+   *       the upload at the next block or at the final block
+   */
+  void SetAsyncFileIo(size_t read_ahead_windows, size_t write_behind_bytes);
+
+  /**
+   * @brief Set when uploaded files are flushed to stable storage
+   * @param policy kOnCommit (default), kEveryWrite or kNever
+   * @note Applies to uploads received afterwards through the built-in file sink
+   */
+  void SetFsyncPolicy(FsyncPolicy policy);
+
+  /**
+   * @brief Serve read requests from a pack file built by the tftp_pack tool
+   * @param path Pack file to map (empty = serve reads from the root directory, default)
+   * @note Takes effect at the next Start() or ReloadPackFile(); Start() fails if the pack cannot
+   *       be mapped. Requested names are looked up in the pack index without touching the
+   *       filesystem, and names it does not hold are answered "File not found". Write requests
+   *       and custom read sources are not affected
+   */
+  void SetPackFile(const std::string& path);
+
+  /**
+   * @brief Map the pack file again and swap it in for requests received afterwards
+   * @return true if successful; on failure the current pack keeps serving
+   * @note Transfers in flight finish from the pack they started with
+   */
+  bool ReloadPackFile();
+
   /**
    * @brief Set security mode
    * @param secure true to enable secure mode
@@ -80,18 +177,168 @@ class TFTP_EXPORT TftpServer {
 
   /**
    * @brief Set timeout value
-   * @param seconds Timeout (seconds)
+   * @param seconds Longest wait before a retransmission (seconds); the timeout adapts to the
+   *                measured round-trip time below this, starting from 1 second
+   * @note A timeout option negotiated by the client (RFC 2349) replaces it for that transfer
    */
   void SetTimeout(int seconds);
 
+  /**
+   * @brief Set lower bound of the adaptive retransmission timeout
+   * @param milliseconds Floor (default kDefaultRetransmitFloorMs)
+   */
+  void SetRetransmitFloor(int milliseconds);
+
+  /**
+   * @brief Set transfer engine
+   * @param engine kThreadPool (default) or kEventDriven
+   * @param reactor_threads Event loop threads for kEventDriven (0 = one per hardware thread)
+   * @note Takes effect at the next Start()
+   */
+  void SetTransferEngine(TransferEngine engine, size_t reactor_threads = 0);
+
+  /**
+   * @brief Set I/O backend
+   * @param backend kPortable (default) or kIoUring
+   * @note Takes effect at the next Start(). kIoUring needs Linux 6.0 or later; elsewhere the
+   *       server logs a warning and starts with kPortable. Listeners and file reads use it with
+   *       both engines; session sockets only with kEventDriven
+   */
+  void SetIoBackend(IoBackend backend);
+
+  /**
+   * @brief Check whether an I/O backend can be used on this system
+   * @param backend Backend to check
+   * @return true if Start() would use it
+   */
+  static bool IsIoBackendAvailable(IoBackend backend);
+
+  /**
+   * @brief Set number of worker threads of the kThreadPool engine
+   * @param count Worker threads (0 = one per hardware thread, default; at most 64)
+   * @note Takes effect immediately on a running server: workers above the new count finish
+   *       their current transfer and the requests already queued to them, then exit
+   */
+  void SetThreadPoolSize(size_t count);
+
+  /**
+   * @brief Pin each worker thread of the kThreadPool engine to one core
+   * @param pin_to_cores Worker i runs on core i modulo the core count (false = default)
+   * @note Takes effect at the next Start(); ignored on platforms other than Linux
+   */
+  void SetWorkerAffinity(bool pin_to_cores);
+
+  /**
+   * @brief Set number of listening sockets
+   * @param count Sockets bound to the port with SO_REUSEPORT, each with its own receive thread
+   *              (1 = single listener, default; 0 = one per hardware thread)
+   * @note Takes effect at the next Start(); platforms without SO_REUSEPORT always use one listener
+   */
+  void SetListenerCount(size_t count);
+
+  /**
+   * @brief Serve transfers from a fixed range of UDP ports
+   * @param first_port First transfer port (0 with last_port 0 = ephemeral ports, default)
+   * @param last_port Last transfer port, inclusive
+   * @note Takes effect at the next Start(). The ports are bound once and reused by every
+   *       transfer; a request finding all of them in use is refused with an ERROR
+   * @throws TftpException if the range is invalid
+   */
+  void SetTransferPortRange(uint16_t first_port, uint16_t last_port);
+
+  /**
+   * @brief Set kernel buffer sizes of the transfer sockets
+   * @param receive_bytes SO_RCVBUF in bytes (0 = system default)
+   * @param send_bytes SO_SNDBUF in bytes (0 = system default)
+   * @note Takes effect at the next Start(); the kernel may round or cap the sizes
+   * @throws TftpException if a size is negative or too large
+   */
+  void SetSocketBufferSizes(int receive_bytes, int send_bytes);
+
+  /**
+   * @brief Bound the requests waiting to be served
+   * @param count Requests accepted but not yet picked up by a worker or event loop
+   *              (kDefaultMaxQueuedRequests by default; 0 = unbounded)
+   * @note A request arriving at the bound is refused with ERROR "Server busy" instead of queued;
+   *       takes effect immediately
+   */
+  void SetMaxQueuedRequests(size_t count);
+
+  /**
+   * @brief Limit transfer bandwidth with token buckets
+   * @param global_bytes_per_second DATA payload of all transfers together (0 = unlimited, default)
+   * @param client_bytes_per_second DATA payload of all transfers of one client address
+   *                                (0 = unlimited, default)
+   * @note Reads hold back their next window and writes their next ACK until the limits allow it;
+   *       applies to running transfers as well. Multicast transfers are not limited
+   */
+  void SetBandwidthLimits(uint64_t global_bytes_per_second, uint64_t client_bytes_per_second);
+
+  /**
+   * @brief Enable multicast reads (RFC 2090 "multicast" option)
+   * @param address IPv4 multicast group address, e.g. "239.255.0.69"
+   * @param first_port First UDP port of the groups; each file being multicast uses its own port
+   * @param port_count Files that can be multicast at once (0 = multicast disabled, default)
+   * @note Requires the kEventDriven engine; otherwise, or when every port is in use, the option
+   *       is ignored and the client reads by unicast
+   * @throws TftpException if the address is not a multicast address or the port range is invalid
+   */
+  void SetMulticastGroup(const std::string& address, uint16_t first_port, size_t port_count = 1);
+
+  /**
+   * @brief Get per-listener counters
+   * @return One entry per listening socket of the running server
+   */
+  std::vector<ListenerStats> GetListenerStats() const;
+
+  /**
+   * @brief Get server-wide counters and latency histograms
+   * @return Totals since construction; counters survive Stop() and Start()
+   */
+  ServerStats GetStats() const;
+
+  /**
+   * @brief Get GetStats() in the Prometheus text exposition format
+   * @return Metrics text as served by the metrics endpoint
+   */
+  std::string GetPrometheusMetrics() const;
+
+  /**
+   * @brief Set TCP port of the Prometheus metrics endpoint
+   * @param port Port serving GetPrometheusMetrics() over HTTP (0 = disabled, default)
+   * @note Takes effect at the next Start()
+   */
+  void SetMetricsPort(uint16_t port);
+
  private:
   friend class internal::TftpServerImpl;
   std::unique_ptr<internal::TftpServerImpl> impl_;
 };
 
+/**
+ * @brief One transfer of a TftpClient::RunTransfers batch
+ */
+struct ClientTransfer {
+  std::string filename;             ///< Remote filename
+  bool upload = false;              ///< true = write request, false = read request
+  std::vector<uint8_t> data;        ///< Contents to upload, or contents downloaded (without a sink)
+  WriteSink* sink = nullptr;        ///< Streams a download instead of filling data (not owned)
+  ReadSource* source = nullptr;     ///< Streams an upload instead of sending data (not owned)
+  bool success = false;             ///< Result (output)
+  std::string error;                ///< Failure reason (output)
+  uint64_t bytes = 0;               ///< Bytes transferred (output)
+  uint64_t elapsed_us = 0;          ///< Request to completion (output)
+  uint64_t first_byte_us = 0;       ///< Request to the first DATA received, or acknowledged for uploads (output)
+};
+
 /**
  * @class TftpClient
- * @brief Class that provides TFTP client functionality (libcurl-based)
+ * @brief Class that provides TFTP client functionality
+ *
+ * Transfers run on one non-blocking event loop on the calling thread: single transfers as
+ * well as batches, whose transfers proceed concurrently. Each transfer asks for the block
+ * size, window size and tsize options configured; servers that ignore options are served
+ * in plain RFC 1350 lock-step.
  */
 class TFTP_EXPORT TftpClient {
  public:
@@ -116,6 +363,17 @@ class TFTP_EXPORT TftpClient {
   bool DownloadFile(const std::string& host, const std::string& filename, 
                     std::vector<uint8_t>& output_buffer, uint16_t port = kDefaultTftpPort);
 
+  /**
+   * @brief Download a file block by block
+   * @param host Hostname or IP address
+   * @param filename Filename
+   * @param sink Receives the file; opened with filename and the size from the OACK (0 if unknown)
+   * @param port Port number (default is 69)
+   * @return true if successful and committed, false if failed (the sink is aborted)
+   */
+  bool DownloadFile(const std::string& host, const std::string& filename,
+                    WriteSink& sink, uint16_t port = kDefaultTftpPort);
+
   /**
    * @brief Upload a file
    * @param host Hostname or IP address
@@ -127,6 +385,29 @@ class TFTP_EXPORT TftpClient {
   bool UploadFile(const std::string& host, const std::string& filename, 
                   const std::vector<uint8_t>& data, uint16_t port = kDefaultTftpPort);
 
+  /**
+   * @brief Upload a file block by block
+   * @param host Hostname or IP address
+   * @param filename Filename
+   * @param source Provides the file; opened with filename, read with positioned reads
+   * @param port Port number (default is 69)
+   * @return true if successful, false if failed
+   */
+  bool UploadFile(const std::string& host, const std::string& filename,
+                  ReadSource& source, uint16_t port = kDefaultTftpPort);
+
+  /**
+   * @brief Run many transfers concurrently over one event loop
+   * @param host Hostname or IP address
+   * @param transfers Transfers to run; results are stored in each entry
+   * @param port Port number (default is 69)
+   * @return true if every transfer succeeded
+   * @note At most SetMaxParallelTransfers() transfers are in flight; the rest start in order
+   *       as earlier ones finish
+   */
+  bool RunTransfers(const std::string& host, std::vector<ClientTransfer>& transfers,
+                    uint16_t port = kDefaultTftpPort);
+
   /**
    * @brief Set timeout value
    * @param seconds Timeout (seconds)
@@ -135,10 +416,38 @@ class TFTP_EXPORT TftpClient {
 
   /**
    * @brief Set transfer mode
-   * @param mode Transfer mode
+   * @param mode Transfer mode; with kNetAscii, line ends are translated to and from CR LF
+   *             on the wire while the caller's buffers, sources and sinks keep bare LF
    */
   void SetTransferMode(TransferMode mode);
 
+  /**
+   * @brief Set block size to request (RFC 2348 "blksize" option)
+   * @param block_size Bytes per DATA packet (default 512, which sends no option)
+   * @throws TftpException if block_size is outside 8-65464
+   */
+  void SetBlockSize(size_t block_size);
+
+  /**
+   * @brief Set window size to request (RFC 7440 "windowsize" option)
+   * @param window_size DATA packets in flight per ACK (default 1, which sends no option)
+   * @throws TftpException if window_size is outside 1-65535
+   */
+  void SetWindowSize(size_t window_size);
+
+  /**
+   * @brief Enable the RFC 2349 "tsize" option
+   * @param enable true (default) to ask for the size on downloads and announce it on uploads
+   */
+  void SetTransferSizeOption(bool enable);
+
+  /**
+   * @brief Set how many transfers of a RunTransfers batch run at once
+   * @param count Transfers in flight (default 16)
+   * @throws TftpException if count is 0
+   */
+  void SetMaxParallelTransfers(size_t count);
+
   /**
    * @brief Get last error message
    * @return Error message
@@ -114,6 +114,33 @@ private:
     std::unique_ptr<sockaddr_in> addr_;
 };
 
+/**
+ * @brief One datagram of a batch send
+ *
+ * The datagram is data followed by payload, gathered by the kernel (sendmsg iovec), so a
+ * header and a block borrowed from a file mapping go out without being joined first.
+ */
+struct OutgoingDatagram {
+    const uint8_t* data = nullptr;     // Payload, or the header when payload is set
+    size_t size = 0;                   // Length of data
+    sockaddr_in addr = {};             // Destination
+    const uint8_t* payload = nullptr;  // Bytes sent after data in the same datagram (optional)
+    size_t payload_size = 0;           // Length of payload
+    bool immutable = false;            // data and payload never change afterwards (allows MSG_ZEROCOPY)
+
+    size_t Length() const { return size + payload_size; }
+};
+
+/**
+ * @brief One receive buffer of a batch receive
+ */
+struct IncomingDatagram {
+    uint8_t* buffer = nullptr;  // Receive buffer
+    size_t capacity = 0;        // Buffer size
+    size_t length = 0;          // Bytes received (output)
+    sockaddr_in addr = {};      // Sender (output)
+};
+
 /**
  * @brief Cross-platform UDP socket RAII wrapper
  * 
@@ -195,6 +222,37 @@ public:
      */
     int ReceiveFromTimeout(void* buffer, size_t buffer_size, SocketAddress& sender_addr, int timeout_ms);
     
+    /**
+     * @brief Send several datagrams with as few system calls as possible (sendmmsg, UDP GSO)
+     * @param datagrams Datagrams to send, in order; each may be gathered from two buffers
+     * @param count Number of datagrams
+     * @return Number of datagrams sent (a prefix of the batch), or -1 on error
+     */
+    int SendBatch(const OutgoingDatagram* datagrams, size_t count);
+    
+    /**
+     * @brief Receive up to count datagrams with as few system calls as possible (recvmmsg, UDP GRO)
+     * @param datagrams Receive buffers; length and addr are filled for each datagram received
+     * @param count Number of buffers
+     * @param timeout_ms Time to wait for the first datagram (0 = do not wait, -1 = wait forever)
+     * @return Number of datagrams received, 0 on timeout, or -1 on error
+     */
+    int ReceiveBatch(IncomingDatagram* datagrams, size_t count, int timeout_ms);
+    
+    /**
+     * @brief Coalesce equal-sized datagrams to one destination into UDP_SEGMENT sends
+     * @param enable true to enable
+     * @return true if the setting is supported on this platform
+     */
+    bool SetSegmentationOffload(bool enable = true);
+    
+    /**
+     * @brief Accept coalesced UDP_GRO receives; ReceiveBatch splits them into the following buffers
+     * @param enable true to enable
+     * @return true if the setting is supported on this platform
+     */
+    bool SetReceiveOffload(bool enable = true);
+    
     /**
      * @brief Close the socket
      */
@@ -18,8 +18,13 @@ namespace validation {
 // Validation constants
 constexpr int kMinTimeout = 1;              // Minimum timeout in seconds
 constexpr int kMaxTimeout = 3600;           // Maximum timeout in seconds (1 hour)
+constexpr int kMinRetransmitFloorMs = 1;    // Minimum retransmission timeout floor in milliseconds
+constexpr int kMaxRetransmitFloorMs = kMaxTimeout * 1000;  // Maximum retransmission timeout floor
 constexpr uint16_t kMinPort = 1;            // Minimum valid port number
 constexpr uint16_t kMaxPort = 65535;        // Maximum valid port number
+constexpr int kMaxSocketBufferSize = 64 * 1024 * 1024;  // Maximum SO_RCVBUF/SO_SNDBUF request in bytes
+constexpr size_t kMaxReadAheadWindows = 64; // Maximum send windows an RRQ reads ahead
+constexpr int kMaxCallbackCacheTtlMs = 24 * 3600 * 1000;  // Maximum read callback result lifetime (1 day)
 constexpr size_t kMinTransferSize = 512;    // Minimum transfer size (one TFTP block)
 constexpr size_t kMaxTransferSize = 1024 * 1024 * 1024; // Maximum transfer size (1GB)
 constexpr size_t kMaxPathLength = 4096;     // Maximum path length
@@ -39,6 +44,35 @@ TFTP_EXPORT bool ValidateRootDirectory(const std::string& root_dir);
  */
 TFTP_EXPORT bool ValidatePort(uint16_t port);
 
+/**
+ * @brief Validates transfer port range
+ * @param first_port First port of the range (0 together with last_port 0: ephemeral ports)
+ * @param last_port Last port of the range, inclusive
+ * @return true if valid, false otherwise
+ */
+TFTP_EXPORT bool ValidatePortRange(uint16_t first_port, uint16_t last_port);
+
+/**
+ * @brief Validates socket buffer size
+ * @param bytes Buffer size in bytes to validate (0 = system default)
+ * @return true if valid, false otherwise
+ */
+TFTP_EXPORT bool ValidateSocketBufferSize(int bytes);
+
+/**
+ * @brief Validates read-ahead depth
+ * @param windows Send windows read ahead per transfer (0 = disabled)
+ * @return true if valid, false otherwise
+ */
+TFTP_EXPORT bool ValidateReadAheadWindows(size_t windows);
+
+/**
+ * @brief Validates the lifetime of memoized read callback results
+ * @param milliseconds TTL in milliseconds (0 = keep nothing)
+ * @return true if valid, false otherwise
+ */
+TFTP_EXPORT bool ValidateCallbackCacheTtl(int milliseconds);
+
 /**
  * @brief Validates timeout value
  * @param timeout_seconds Timeout in seconds to validate
@@ -46,6 +80,13 @@ TFTP_EXPORT bool ValidatePort(uint16_t port);
  */
 TFTP_EXPORT bool ValidateTimeout(int timeout_seconds);
 
+/**
+ * @brief Validates retransmission timeout floor
+ * @param milliseconds Floor in milliseconds to validate
+ * @return true if valid, false otherwise
+ */
+TFTP_EXPORT bool ValidateRetransmitFloor(int milliseconds);
+
 /**
  * @brief Validates transfer size
  * @param size Transfer size to validate
@@ -0,0 +1,261 @@
+/**
+ * @file tftp_buffer_pool.cpp
+ * @brief Per-thread free lists for block buffers and session objects
+ */
+
+#include "internal/tftp_buffer_pool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr size_t kClassCount = 13;
+static_assert((BufferPool::kMinClassSize << (kClassCount - 1)) == BufferPool::kMaxClassSize,
+              "classes must cover kMinClassSize to kMaxClassSize");
+
+size_t ClassIndex(size_t size) {
+    size_t index = 0;
+    for (size_t class_size = BufferPool::kMinClassSize; class_size < size; class_size <<= 1) {
+        ++index;
+    }
+    return index;
+}
+
+size_t ClassSize(size_t index) {
+    return BufferPool::kMinClassSize << index;
+}
+
+size_t CacheLimit(size_t index) {
+    return std::max(BufferPool::kMinCachedBlocks, BufferPool::kThreadCacheBytes / ClassSize(index));
+}
+
+size_t DepotLimit(size_t index) {
+    return BufferPool::kDepotBytes / ClassSize(index);
+}
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_reused{0};
+std::atomic<uint64_t> g_discarded{0};
+std::atomic<uint64_t> g_cached_bytes{0};
+
+void* HeapAllocate(size_t size) {
+    return ::operator new(size, std::align_val_t(BufferPool::kAlignment));
+}
+
+void HeapFree(void* block) {
+    ::operator delete(block, std::align_val_t(BufferPool::kAlignment));
+}
+
+struct Depot {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+};
+
+// Never destroyed: threads may still free blocks while static objects are being destroyed
+Depot* Depots() {
+    static Depot* depots = new Depot[kClassCount];
+    return depots;
+}
+
+// Moves the last count blocks of list to the depot, or to the heap once the depot is full
+void Spill(size_t index, std::vector<void*>& list, size_t count) {
+    Depot& depot = Depots()[index];
+    size_t kept = 0;
+    {
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        size_t room = DepotLimit(index) > depot.blocks.size() ? DepotLimit(index) - depot.blocks.size() : 0;
+        kept = std::min(count, room);
+        try {
+            depot.blocks.insert(depot.blocks.end(), list.end() - kept, list.end());
+        } catch (const std::bad_alloc&) {
+            kept = 0;
+        }
+    }
+    list.resize(list.size() - kept);
+    for (size_t i = kept; i < count; ++i) {
+        HeapFree(list.back());
+        list.pop_back();
+        g_cached_bytes -= ClassSize(index);
+        g_discarded++;
+    }
+}
+
+// Takes up to half a list's worth of blocks from the depot
+void Refill(size_t index, std::vector<void*>& list) {
+    Depot& depot = Depots()[index];
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    size_t count = std::min(std::max<size_t>(1, CacheLimit(index) / 2), depot.blocks.size());
+    list.insert(list.end(), depot.blocks.end() - count, depot.blocks.end());
+    depot.blocks.resize(depot.blocks.size() - count);
+}
+
+struct ThreadCache {
+    ~ThreadCache();
+
+    std::array<std::vector<void*>, kClassCount> lists;
+};
+
+thread_local ThreadCache* tls_cache = nullptr;
+thread_local bool tls_cache_destroyed = false;
+
+// nullptr once the thread's cache has been destroyed (a block freed by a later destructor)
+ThreadCache* ThisThreadCache() {
+    if (tls_cache == nullptr && !tls_cache_destroyed) {
+        thread_local ThreadCache cache;
+        tls_cache = &cache;
+    }
+    return tls_cache;
+}
+
+ThreadCache::~ThreadCache() {
+    // An exiting thread (a retired pool worker) leaves its blocks to the others
+    for (size_t index = 0; index < kClassCount; ++index) {
+        Spill(index, lists[index], lists[index].size());
+    }
+    tls_cache = nullptr;
+    tls_cache_destroyed = true;
+}
+
+} // namespace
+
+size_t BufferPool::BlockSize(size_t size) {
+    return size > kMaxClassSize ? size : ClassSize(ClassIndex(size));
+}
+
+void* BufferPool::Allocate(size_t size) {
+    g_allocations++;
+    if (size > kMaxClassSize) {
+        return HeapAllocate(size);
+    }
+    size_t index = ClassIndex(size);
+    ThreadCache* cache = ThisThreadCache();
+    if (cache) {
+        std::vector<void*>& list = cache->lists[index];
+        if (list.empty()) {
+            Refill(index, list);
+        }
+        if (!list.empty()) {
+            void* block = list.back();
+            list.pop_back();
+            g_cached_bytes -= ClassSize(index);
+            g_reused++;
+            return block;
+        }
+    }
+    return HeapAllocate(ClassSize(index));
+}
+
+void BufferPool::Free(void* block, size_t size) {
+    if (block == nullptr) {
+        return;
+    }
+    ThreadCache* cache = size > kMaxClassSize ? nullptr : ThisThreadCache();
+    if (cache == nullptr) {
+        HeapFree(block);
+        g_discarded++;
+        return;
+    }
+    size_t index = ClassIndex(size);
+    std::vector<void*>& list = cache->lists[index];
+    try {
+        // Sized once, so that recycling never allocates
+        list.reserve(CacheLimit(index));
+    } catch (const std::bad_alloc&) {
+        HeapFree(block);
+        g_discarded++;
+        return;
+    }
+    if (list.size() >= CacheLimit(index)) {
+        Spill(index, list, list.size() / 2);
+    }
+    list.push_back(block);
+    g_cached_bytes += ClassSize(index);
+}
+
+void BufferPool::TrimThisThread() {
+    ThreadCache* cache = ThisThreadCache();
+    if (cache == nullptr) {
+        return;
+    }
+    for (size_t index = 0; index < kClassCount; ++index) {
+        for (void* block : cache->lists[index]) {
+            HeapFree(block);
+            g_cached_bytes -= ClassSize(index);
+            g_discarded++;
+        }
+        cache->lists[index].clear();
+    }
+}
+
+BufferPoolStats BufferPool::GetStats() {
+    BufferPoolStats stats;
+    stats.allocations = g_allocations.load(std::memory_order_relaxed);
+    stats.reused = g_reused.load(std::memory_order_relaxed);
+    stats.discarded = g_discarded.load(std::memory_order_relaxed);
+    stats.cached_bytes = g_cached_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// PooledBuffer
+// ---------------------------------------------------------------------------
+
+PooledBuffer::PooledBuffer(size_t size) {
+    Resize(size);
+}
+
+PooledBuffer::PooledBuffer(const uint8_t* data, size_t size) : PooledBuffer(size) {
+    if (size > 0) {
+        std::memcpy(data_, data, size);
+    }
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.capacity_ = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+    return *this;
+}
+
+void PooledBuffer::Resize(size_t size) {
+    if (size > capacity_) {
+        Reset();
+        size_t capacity = BufferPool::BlockSize(size);
+        data_ = static_cast<uint8_t*>(BufferPool::Allocate(capacity));
+        capacity_ = capacity;
+    }
+    size_ = size;
+}
+
+void PooledBuffer::Reset() {
+    if (data_ != nullptr) {
+        BufferPool::Free(data_, capacity_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    capacity_ = 0;
+}
+
+} // namespace internal
+} // namespace tftpserver
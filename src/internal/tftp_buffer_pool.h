@@ -0,0 +1,97 @@
+/**
+ * @file tftp_buffer_pool.h
+ * @brief Per-thread free lists for block buffers and session objects
+ */
+
+#ifndef TFTP_BUFFER_POOL_H_
+#define TFTP_BUFFER_POOL_H_
+
+#include "tftp/tftp_metrics.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Fixed-size blocks recycled through per-thread free lists
+ *
+ * Sizes are rounded up to a power-of-two class between kMinClassSize and kMaxClassSize, so
+ * the buffers of one blksize and the objects of one kind always share a class. Each thread
+ * allocates from and frees to its own lists without locking. A list holds at most
+ * kThreadCacheBytes (and at least kMinCachedBlocks); past that, half of it moves to a shared
+ * depot, which the other threads refill from in the same batches. This matters because a
+ * block is allocated by a listener and freed by a worker, for example. The depot holds at
+ * most kDepotBytes per class. Blocks past every bound, and blocks larger than the largest
+ * class, go back to the heap. Blocks are aligned to kAlignment bytes.
+ */
+class BufferPool {
+public:
+    static constexpr size_t kAlignment = 64;
+    static constexpr size_t kMinClassSize = 64;
+    static constexpr size_t kMaxClassSize = 256 * 1024;
+    static constexpr size_t kThreadCacheBytes = 256 * 1024;  // Per class and thread
+    static constexpr size_t kMinCachedBlocks = 4;
+    static constexpr size_t kDepotBytes = 4 * 1024 * 1024;   // Per class
+
+    // Bytes of the block serving size: its class, or size itself past the largest class
+    static size_t BlockSize(size_t size);
+    // Throws std::bad_alloc when the heap is exhausted, like operator new
+    static void* Allocate(size_t size);
+    // size must be the size the block was allocated with, or its BlockSize
+    static void Free(void* block, size_t size);
+    // Hands the calling thread's free blocks back to the heap
+    static void TrimThisThread();
+
+    // Counters of every thread since the process started
+    static BufferPoolStats GetStats();
+};
+
+/**
+ * @brief Base class allocating its subclasses from BufferPool
+ *
+ * Objects deleted through a base pointer need a virtual destructor, so that delete passes
+ * the size of the object that was allocated.
+ */
+class PoolAllocated {
+public:
+    static void* operator new(size_t size) { return BufferPool::Allocate(size); }
+    static void operator delete(void* block, size_t size) { BufferPool::Free(block, size); }
+};
+
+/**
+ * @brief Byte buffer taken from BufferPool, returned to it when destroyed
+ */
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    explicit PooledBuffer(size_t size);
+    PooledBuffer(const uint8_t* data, size_t size);
+    ~PooledBuffer() { Reset(); }
+
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+    // Disable copy
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    uint8_t* Data() { return data_; }
+    const uint8_t* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+
+    // Contents are kept only while size fits the block already held
+    void Resize(size_t size);
+    void Reset();
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;  // BlockSize of the size the block was allocated with
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_BUFFER_POOL_H_
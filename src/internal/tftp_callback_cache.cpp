@@ -0,0 +1,152 @@
+/**
+ * @file tftp_callback_cache.cpp
+ * @brief Single-flight memoization of the legacy read callback
+ */
+
+#include "internal/tftp_callback_cache.h"
+#include "tftp/tftp_logger.h"
+#include <exception>
+
+namespace tftpserver {
+namespace internal {
+
+CallbackCache::Generation CallbackCache::NewGeneration(ReadCallback callback) {
+    Generation generation;
+    generation.callback = std::make_shared<const ReadCallback>(std::move(callback));
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation.id = ++generation_;
+    ClearLocked();
+    return generation;
+}
+
+void CallbackCache::SetLimits(Clock::duration ttl, size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttl_ = ttl;
+    max_bytes_ = max_bytes;
+    if (ttl_ <= Clock::duration::zero()) {
+        ClearLocked();
+    } else {
+        EvictLocked(0);
+    }
+}
+
+CallbackCache::Content CallbackCache::Get(const Generation& generation, const std::string& path) {
+    if (!generation.callback || !*generation.callback) {
+        return nullptr;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool current = generation.id == generation_;
+
+    auto it = current ? entries_.find(path) : entries_.end();
+    if (it != entries_.end()) {
+        if (Clock::now() < it->second.expires) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+            hits_++;
+            return it->second.content;
+        }
+        EraseLocked(it);
+    }
+
+    FlightKey key(generation.id, path);
+    auto flight = flights_.find(key);
+    if (flight != flights_.end()) {
+        // Keeps the flight alive after its owner has removed it from the table
+        std::shared_ptr<Flight> waited = flight->second;
+        coalesced_++;
+        waited->finished_cv.wait(lock, [&waited]() { return waited->finished; });
+        return waited->result;
+    }
+
+    auto own = std::make_shared<Flight>();
+    own->keep = current;
+    flights_.emplace(key, own);
+    misses_++;
+    lock.unlock();
+    Content result = Generate(*generation.callback, path);
+    lock.lock();
+
+    flights_.erase(key);
+    if (result && own->keep && ttl_ > Clock::duration::zero() && result->size() <= max_bytes_) {
+        EvictLocked(result->size());
+        lru_.push_front(path);
+        entries_[path] = Entry{result, Clock::now() + ttl_, lru_.begin()};
+        cached_bytes_ += result->size();
+    }
+    own->result = result;
+    own->finished = true;
+    own->finished_cv.notify_all();
+    return result;
+}
+
+void CallbackCache::Invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+        EraseLocked(it);
+    }
+    auto flight = flights_.find(FlightKey(generation_, path));
+    if (flight != flights_.end()) {
+        flight->second->keep = false;
+    }
+}
+
+void CallbackCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClearLocked();
+}
+
+CallbackCacheStats CallbackCache::GetStats() const {
+    CallbackCacheStats stats;
+    stats.hits = hits_.load();
+    stats.misses = misses_.load();
+    stats.coalesced = coalesced_.load();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.entries = entries_.size();
+    stats.cached_bytes = cached_bytes_;
+    return stats;
+}
+
+CallbackCache::Content CallbackCache::Generate(const ReadCallback& callback, const std::string& path) {
+    // An exception must not leave the requests waiting for this call stranded
+    try {
+        auto data = std::make_shared<std::vector<uint8_t>>();
+        if (!callback(path, *data)) {
+            return nullptr;
+        }
+        return data;
+    } catch (const std::exception& e) {
+        TFTP_ERROR("Read callback failed for %s: %s", path.c_str(), e.what());
+    } catch (...) {
+        TFTP_ERROR("Read callback failed for %s", path.c_str());
+    }
+    return nullptr;
+}
+
+void CallbackCache::ClearLocked() {
+    entries_.clear();
+    lru_.clear();
+    cached_bytes_ = 0;
+    for (auto& flight : flights_) {
+        flight.second->keep = false;
+    }
+}
+
+void CallbackCache::EvictLocked(size_t needed) {
+    while (!lru_.empty() && cached_bytes_ + needed > max_bytes_) {
+        auto it = entries_.find(lru_.back());
+        if (it == entries_.end()) {
+            lru_.pop_back();
+            continue;
+        }
+        EraseLocked(it);
+    }
+}
+
+void CallbackCache::EraseLocked(std::unordered_map<std::string, Entry>::iterator it) {
+    cached_bytes_ -= it->second.content->size();
+    lru_.erase(it->second.lru_position);
+    entries_.erase(it);
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,112 @@
+/**
+ * @file tftp_callback_cache.h
+ * @brief Single-flight memoization of the legacy read callback
+ */
+
+#ifndef TFTP_CALLBACK_CACHE_H_
+#define TFTP_CALLBACK_CACHE_H_
+
+#include "tftp/tftp_file_io.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Calls the read callback once per path and shares the result
+ *
+ * Requests for a path whose content is being generated wait for that call instead of making
+ * their own, however the cache is configured. With a TTL, results are kept for that long after
+ * they were generated, keyed by the resolved path the callback receives, and evicted in LRU order
+ * once they exceed the byte limit; a result larger than the limit is only shared with the
+ * requests that waited for it. Failed calls are never kept. A TTL of 0 (the default) keeps
+ * nothing, so every request that does not find a call in flight makes its own.
+ *
+ * Each callback set is a Generation, which the request configuration snapshot holds: a request
+ * always calls the callback of its own snapshot, and only shares calls and results of that
+ * generation. Results of older generations are never kept.
+ */
+class CallbackCache {
+public:
+    using ReadCallback = std::function<bool(const std::string&, std::vector<uint8_t>&)>;
+    using Clock = std::chrono::steady_clock;
+    using Content = std::shared_ptr<const std::vector<uint8_t>>;
+
+    struct Generation {
+        std::shared_ptr<const ReadCallback> callback;
+        uint64_t id = 0;
+    };
+
+    CallbackCache() = default;
+
+    // Disable copy
+    CallbackCache(const CallbackCache&) = delete;
+    CallbackCache& operator=(const CallbackCache&) = delete;
+
+    // Starts a generation for callback and drops every kept result; calls in flight for older
+    // generations still answer their own requests
+    Generation NewGeneration(ReadCallback callback);
+    void SetLimits(Clock::duration ttl, size_t max_bytes);
+
+    // Content of path from the callback of generation, or nullptr if it failed (or threw)
+    Content Get(const Generation& generation, const std::string& path);
+
+    // Drops the result kept for path; a call in flight for it is not kept either
+    void Invalidate(const std::string& path);
+    // Drops every kept result, and keeps none of the calls in flight
+    void Clear();
+
+    CallbackCacheStats GetStats() const;
+
+private:
+    struct Flight {
+        std::condition_variable finished_cv;
+        bool finished = false;
+        bool keep = true;
+        Content result;
+    };
+
+    using FlightKey = std::pair<uint64_t, std::string>;  // Generation id and path
+
+    struct Entry {
+        Content content;
+        Clock::time_point expires;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    static Content Generate(const ReadCallback& callback, const std::string& path);
+    void ClearLocked();
+    void EvictLocked(size_t needed);
+    void EraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+
+    mutable std::mutex mutex_;
+    uint64_t generation_ = 0;  // Entries all belong to this generation
+    Clock::duration ttl_ = Clock::duration::zero();
+    size_t max_bytes_ = 0;
+    size_t cached_bytes_ = 0;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;  // Most recently used first
+    std::map<FlightKey, std::shared_ptr<Flight>> flights_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> coalesced_{0};
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_CALLBACK_CACHE_H_
@@ -0,0 +1,696 @@
+/**
+ * @file tftp_client_session.cpp
+ * @brief Client side of one TFTP transfer and the event loop running many of them
+ */
+
+#include "internal/tftp_client_session.h"
+#include "internal/tftp_poller.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+#include <unordered_map>
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr int kMaxRetries = 5;
+constexpr std::chrono::seconds kInitialRto(1);  // RFC 6298 starting point until the first RTT sample
+constexpr size_t kSendBatch = 16;               // DATA packets per batched send of a window
+constexpr size_t kReceiveBatch = 8;             // Datagrams per batched receive
+constexpr size_t kReceiveSlotSize = kMaxBlockPacketSize;
+constexpr int kMaxDatagramsPerWakeup = 64;      // Keeps one busy session from starving the others
+
+bool EqualsIgnoreCase(std::string_view value, std::string_view lower) {
+    if (value.size() != lower.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(value[i])) != lower[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseNumber(std::string_view text, uint64_t& value) {
+    if (text.empty() || text.size() > 20) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+} // namespace
+
+ClientSession::ClientSession(const sockaddr_in& server, const std::string& filename,
+                             const ClientOptions& options, WriteSink& sink)
+    : ClientSession(server, filename, options, static_cast<ReadSource*>(nullptr)) {
+    upload_ = false;
+    sink_ = &sink;
+}
+
+ClientSession::ClientSession(const sockaddr_in& server, const std::string& filename,
+                             const ClientOptions& options, ReadSource& source)
+    : ClientSession(server, filename, options, &source) {
+    upload_ = true;
+}
+
+ClientSession::ClientSession(const sockaddr_in& server, const std::string& filename,
+                             const ClientOptions& options, ReadSource* source)
+    : server_(server),
+      filename_(filename),
+      options_(options),
+      upload_(source != nullptr),
+      sink_(nullptr),
+      source_(source),
+      state_(State::kIdle),
+      block_size_(options.block_size),
+      window_size_(std::max<size_t>(options.window_size, 1)),
+      rtt_(std::chrono::seconds(std::min<int>(options.timeout_secs, kInitialRto.count())),
+           std::chrono::milliseconds(kDefaultRetransmitFloorMs),
+           std::chrono::seconds(options.timeout_secs)),
+      deadline_(Clock::time_point::max()),
+      round_open_(false),
+      round_retransmitted_(false),
+      retries_(0),
+      sink_open_(false),
+      expected_block_(1),
+      received_in_window_(0),
+      gap_acked_(false),
+      duplicate_acked_(false),
+      has_expected_size_(false),
+      expected_size_(0),
+      last_ack_(0),
+      source_open_(false),
+      file_size_(0),
+      total_blocks_(0),
+      window_start_(1),
+      window_end_(0),
+      window_restarted_(false),
+      bytes_(0),
+      finished_(false),
+      succeeded_(false),
+      first_byte_seen_(false) {}
+
+ClientSession::~ClientSession() {
+    if (!finished_) {
+        Fail("Transfer abandoned");
+    }
+}
+
+bool ClientSession::Start(Clock::time_point now) {
+    started_at_ = now;
+    if (!socket_.Create() || !SetNonBlocking(socket_.GetNativeHandle())) {
+        Fail("Socket creation failed: " + socket_.GetLastError());
+        return false;
+    }
+    // Windows of equal-sized DATA go out as UDP_SEGMENT sends where the kernel allows it
+    socket_.SetSegmentationOffload(true);
+
+    if (upload_) {
+        if (!source_->Open(filename_)) {
+            Fail("Cannot open upload source for " + filename_);
+            return false;
+        }
+        source_open_ = true;
+        file_size_ = source_->Size();
+    }
+
+    state_ = State::kRequested;
+    if (!SendRequest()) {
+        Fail("Request send failed: " + socket_.GetLastError());
+        return false;
+    }
+    StartRound(now);
+    TFTP_INFO("%s %s requested (blksize %zu, windowsize %zu)", upload_ ? "Upload of" : "Download of",
+             filename_.c_str(), options_.block_size, window_size_);
+    return true;
+}
+
+TftpPacket ClientSession::BuildRequest() const {
+    TftpPacket request = upload_ ? TftpPacket::CreateWriteRequest(filename_, options_.mode)
+                                 : TftpPacket::CreateReadRequest(filename_, options_.mode);
+    if (options_.block_size != kMaxDataSize) {
+        request.SetOption("blksize", std::to_string(options_.block_size));
+    }
+    if (window_size_ > 1) {
+        request.SetOption("windowsize", std::to_string(window_size_));
+    }
+    if (options_.transfer_size) {
+        // RFC 2349: a reader asks with 0, a writer announces the size it is about to send
+        request.SetOption("tsize", upload_ ? std::to_string(file_size_) : "0");
+    }
+    return request;
+}
+
+void ClientSession::HandlePacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) {
+    if (finished_) {
+        return;
+    }
+
+    if (state_ == State::kRequested) {
+        // The server answers from a new port, its transfer ID (RFC 1350)
+        if (from.sin_addr.s_addr != server_.sin_addr.s_addr) {
+            TFTP_WARN("Ignoring answer from unexpected host");
+            return;
+        }
+        peer_ = from;
+    } else if (from.sin_addr.s_addr != peer_.sin_addr.s_addr || from.sin_port != peer_.sin_port) {
+        TFTP_WARN("Packet from unknown transfer ID, sending error");
+        SendError(from, ErrorCode::kUnknownTransferId, "Unknown transfer ID");
+        return;
+    }
+
+    if (packet.GetOpCode() == OpCode::kError) {
+        Fail("Server error " + std::to_string(static_cast<int>(packet.GetErrorCode())) + ": " +
+             std::string(packet.GetErrorMessage()));
+        return;
+    }
+
+    if (upload_) {
+        HandleUpload(packet, now);
+    } else {
+        HandleDownload(packet, now);
+    }
+}
+
+bool ClientSession::AcceptOack(const PacketView& packet) {
+    block_size_ = kMaxDataSize;
+    window_size_ = 1;
+    for (size_t i = 0; i < packet.GetOptionCount(); ++i) {
+        const PacketView::Option& option = packet.GetOption(i);
+        uint64_t value = 0;
+        if (!ParseNumber(option.second, value)) {
+            return false;
+        }
+        // RFC 2347: the server may only answer options that were asked, and never raise a value
+        if (EqualsIgnoreCase(option.first, "blksize") && options_.block_size != kMaxDataSize &&
+            value >= kMinBlockSize && value <= options_.block_size) {
+            block_size_ = static_cast<size_t>(value);
+        } else if (EqualsIgnoreCase(option.first, "windowsize") && options_.window_size > 1 &&
+                   value >= kMinWindowSize && value <= options_.window_size) {
+            window_size_ = static_cast<size_t>(value);
+        } else if (EqualsIgnoreCase(option.first, "tsize") && options_.transfer_size) {
+            if (!upload_) {
+                has_expected_size_ = true;
+                expected_size_ = value;
+            }
+        } else {
+            TFTP_ERROR("Unacceptable option in OACK: %.*s = %.*s", static_cast<int>(option.first.size()),
+                       option.first.data(), static_cast<int>(option.second.size()), option.second.data());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ClientSession::OpenSink(uint64_t size_hint) {
+    if (!sink_->Open(filename_, size_hint)) {
+        SendError(peer_, ErrorCode::kDiskFull, "Cannot store file");
+        Fail("Cannot open download sink for " + filename_);
+        return false;
+    }
+    sink_open_ = true;
+    return true;
+}
+
+void ClientSession::HandleDownload(const PacketView& packet, Clock::time_point now) {
+    if (packet.GetOpCode() == OpCode::kOACK) {
+        if (state_ == State::kTransferring) {
+            // Our ACK 0 was lost
+            if (expected_block_ == 1 && bytes_ == 0 && SendAck(0)) {
+                round_retransmitted_ = true;
+            }
+            return;
+        }
+        if (!AcceptOack(packet)) {
+            SendError(peer_, ErrorCode::kNotDefined, "Option negotiation failed");
+            Fail("Option negotiation failed");
+            return;
+        }
+        SampleRound(now);
+        state_ = State::kTransferring;
+        if (!OpenSink(has_expected_size_ ? expected_size_ : 0)) {
+            return;
+        }
+        if (!SendAck(0)) {
+            Fail("ACK send failed: " + socket_.GetLastError());
+            return;
+        }
+        StartRound(now);
+        return;
+    }
+
+    if (packet.GetOpCode() != OpCode::kData) {
+        SendError(peer_, ErrorCode::kIllegalOperation, "Illegal operation");
+        Fail("Unexpected packet from server: OpCode=" + std::to_string(static_cast<int>(packet.GetOpCode())));
+        return;
+    }
+
+    if (state_ == State::kRequested) {
+        // No OACK: the server ignored our options, so the transfer runs in lock-step with 512-byte blocks
+        block_size_ = kMaxDataSize;
+        window_size_ = 1;
+        state_ = State::kTransferring;
+        if (!OpenSink(0)) {
+            return;
+        }
+        // A block larger than what we now expect could only come from a confused server
+        if (packet.GetPayloadSize() > block_size_) {
+            SendError(peer_, ErrorCode::kIllegalOperation, "Block larger than blksize");
+            Fail("DATA block larger than the block size");
+            return;
+        }
+    }
+    HandleData(packet, now);
+}
+
+void ClientSession::HandleData(const PacketView& packet, Clock::time_point now) {
+    uint16_t block = packet.GetBlockNumber();
+    // Distance from the expected block modulo 2^16, so block numbers may wrap past 65535
+    uint16_t ahead = static_cast<uint16_t>(block - expected_block_);
+    if (ahead >= 0x8000) {
+        // Already stored: the server missed our ACK. A resent window is re-ACKed once
+        if (window_size_ == 1 || !duplicate_acked_) {
+            duplicate_acked_ = true;
+            received_in_window_ = 0;
+            SendAck(static_cast<uint16_t>(expected_block_ - 1));
+        }
+        return;
+    }
+    if (ahead != 0) {
+        // A block of the window was lost: ACK the last in-order block once to restart it (RFC 7440)
+        if (window_size_ > 1 && ahead < window_size_ && !gap_acked_) {
+            gap_acked_ = true;
+            received_in_window_ = 0;
+            SendAck(static_cast<uint16_t>(expected_block_ - 1));
+        }
+        return;
+    }
+
+    const size_t length = packet.GetPayloadSize();
+    if (!sink_->Write(bytes_, packet.GetPayload(), length)) {
+        SendError(peer_, ErrorCode::kDiskFull, "Write failed");
+        Fail("Download sink write failed for " + filename_);
+        return;
+    }
+    bytes_ += length;
+    if (!first_byte_seen_) {
+        first_byte_seen_ = true;
+        first_byte_at_ = now;
+    }
+    SampleRound(now);
+    ArmTimer(now);
+    gap_acked_ = false;
+    duplicate_acked_ = false;
+    expected_block_++;
+
+    // RFC 1350: a block shorter than the block size ends the transfer
+    if (length < block_size_) {
+        sink_open_ = false;
+        if (!sink_->Commit()) {
+            SendError(peer_, ErrorCode::kDiskFull, "Write failed");
+            Fail("Download sink commit failed for " + filename_);
+            return;
+        }
+        SendAck(block);
+        TFTP_INFO("Download of %s completed (%llu bytes)", filename_.c_str(),
+                 static_cast<unsigned long long>(bytes_));
+        Succeed();
+        return;
+    }
+
+    if (++received_in_window_ >= window_size_) {
+        received_in_window_ = 0;
+        if (!SendAck(block)) {
+            Fail("ACK send failed: " + socket_.GetLastError());
+            return;
+        }
+        StartRound(now);
+    }
+}
+
+void ClientSession::HandleUpload(const PacketView& packet, Clock::time_point now) {
+    if (packet.GetOpCode() == OpCode::kOACK) {
+        if (state_ == State::kTransferring) {
+            // The server did not see the first window; the OACK is its retransmission
+            if (window_start_ == 1 && SendWindow()) {
+                round_retransmitted_ = true;
+            }
+            return;
+        }
+        if (!AcceptOack(packet)) {
+            SendError(peer_, ErrorCode::kNotDefined, "Option negotiation failed");
+            Fail("Option negotiation failed");
+            return;
+        }
+        SampleRound(now);
+        BeginUpload(now);
+        return;
+    }
+
+    if (packet.GetOpCode() != OpCode::kAcknowledge) {
+        SendError(peer_, ErrorCode::kIllegalOperation, "Illegal operation");
+        Fail("Unexpected packet from server: OpCode=" + std::to_string(static_cast<int>(packet.GetOpCode())));
+        return;
+    }
+
+    if (state_ == State::kRequested) {
+        if (packet.GetBlockNumber() != 0) {
+            SendError(peer_, ErrorCode::kIllegalOperation, "Illegal operation");
+            Fail("Unexpected ACK #" + std::to_string(packet.GetBlockNumber()) + " to the request");
+            return;
+        }
+        // Plain ACK 0: options were ignored
+        block_size_ = kMaxDataSize;
+        window_size_ = 1;
+        SampleRound(now);
+        BeginUpload(now);
+        return;
+    }
+    HandleAck(packet, now);
+}
+
+void ClientSession::BeginUpload(Clock::time_point now) {
+    state_ = State::kTransferring;
+    // A file that is a multiple of the block size ends with an empty block
+    total_blocks_ = file_size_ / block_size_ + 1;
+    window_start_ = 1;
+    window_buffer_.resize(std::min(window_size_, kSendBatch) * (block_size_ + codec::kHeaderSize));
+    if (!SendWindow()) {
+        return;
+    }
+    StartRound(now);
+}
+
+void ClientSession::HandleAck(const PacketView& packet, Clock::time_point now) {
+    // Number of blocks newly acknowledged, computed modulo 2^16 so block numbers may wrap
+    size_t window_length = static_cast<size_t>(window_end_ - window_start_ + 1);
+    size_t acked = static_cast<uint16_t>(packet.GetBlockNumber() - static_cast<uint16_t>(window_start_ - 1));
+    if (acked > window_length) {
+        // A delayed ACK of an earlier round
+        return;
+    }
+    if (acked == 0) {
+        // RFC 1123: resending on a duplicate ACK would double the traffic (Sorcerer's Apprentice).
+        // With a window the server reports a lost first block this way, so the window restarts once
+        if (window_size_ == 1 || window_restarted_) {
+            return;
+        }
+        window_restarted_ = true;
+        round_retransmitted_ = true;
+        SendWindow();
+        return;
+    }
+
+    SampleRound(now);
+    if (!first_byte_seen_) {
+        first_byte_seen_ = true;
+        first_byte_at_ = now;
+    }
+    window_start_ += acked;
+    bytes_ = std::min(file_size_, (window_start_ - 1) * block_size_);
+    if (window_start_ > total_blocks_) {
+        TFTP_INFO("Upload of %s completed (%llu bytes)", filename_.c_str(),
+                 static_cast<unsigned long long>(file_size_));
+        Succeed();
+        return;
+    }
+    window_restarted_ = false;
+    if (!SendWindow()) {
+        return;
+    }
+    StartRound(now);
+}
+
+void ClientSession::OnTimeout(Clock::time_point now) {
+    if (finished_ || now < deadline_) {
+        return;
+    }
+    if (!ConsumeRetry(now)) {
+        SendError(peer_, ErrorCode::kNotDefined, "Transfer timed out");
+        Fail(state_ == State::kRequested ? "No answer from server" : "Transfer timed out");
+        return;
+    }
+
+    if (state_ == State::kRequested) {
+        TFTP_WARN("No answer to the request for %s, resending (%d)", filename_.c_str(), retries_);
+        SendRequest();
+    } else if (upload_) {
+        TFTP_WARN("ACK timeout, resending from block %llu (%d)",
+                 static_cast<unsigned long long>(window_start_), retries_);
+        SendWindow();
+    } else {
+        // RFC 7440: the ACK of the last in-order block makes the server resend what follows
+        TFTP_WARN("DATA timeout, re-sending ACK #%d (%d)", last_ack_, retries_);
+        received_in_window_ = 0;
+        SendAck(last_ack_);
+    }
+}
+
+void ClientSession::Abort(const std::string& reason) {
+    if (finished_) {
+        return;
+    }
+    SendError(peer_, ErrorCode::kNotDefined, reason);
+    Fail(reason);
+}
+
+bool ClientSession::SendRequest() {
+    std::vector<uint8_t> request = BuildRequest().Serialize();
+    return socket_.SendTo(request.data(), request.size(), net::SocketAddress(server_)) ==
+           static_cast<int>(request.size());
+}
+
+bool ClientSession::SendAck(uint16_t block_number) {
+    uint8_t buffer[codec::kHeaderSize];
+    size_t size = codec::EncodeAck(buffer, block_number);
+    last_ack_ = block_number;
+    return socket_.SendTo(buffer, size, net::SocketAddress(peer_)) == static_cast<int>(size);
+}
+
+bool ClientSession::SendWindow() {
+    window_end_ = std::min<uint64_t>(window_start_ + window_size_ - 1, total_blocks_);
+    const size_t slot_size = block_size_ + codec::kHeaderSize;
+    net::OutgoingDatagram datagrams[kSendBatch];
+    uint64_t block = window_start_;
+    while (block <= window_end_) {
+        size_t count = 0;
+        for (; count < kSendBatch && block <= window_end_; ++count, ++block) {
+            uint8_t* slot = window_buffer_.data() + count * slot_size;
+            uint64_t offset = (block - 1) * block_size_;
+            size_t length = offset >= file_size_ ? 0 : static_cast<size_t>(std::min<uint64_t>(block_size_, file_size_ - offset));
+            size_t bytes_read = 0;
+            if (length > 0 && (!source_->ReadAt(offset, slot + codec::kHeaderSize, length, bytes_read) ||
+                               bytes_read != length)) {
+                SendError(peer_, ErrorCode::kNotDefined, "Read failed");
+                Fail("Upload source read failed for " + filename_);
+                return false;
+            }
+            codec::EncodeDataHeader(slot, static_cast<uint16_t>(block));
+            datagrams[count].data = slot;
+            datagrams[count].size = codec::kHeaderSize + length;
+            datagrams[count].addr = peer_;
+        }
+        // Datagrams a full socket buffer did not take count as lost; the timer recovers them
+        if (socket_.SendBatch(datagrams, count) < 0) {
+            Fail("DATA send failed: " + socket_.GetLastError());
+            return false;
+        }
+    }
+    return true;
+}
+
+void ClientSession::SendError(const sockaddr_in& to, ErrorCode code, const std::string& message) {
+    if (to.sin_port == 0) {
+        return;  // The server has not answered yet, so there is nobody to tell
+    }
+    uint8_t buffer[codec::kHeaderSize + kMaxErrorMessageLength + 1];
+    size_t size = codec::EncodeError(buffer, sizeof(buffer), code, message);
+    if (size > 0) {
+        socket_.SendTo(buffer, size, net::SocketAddress(to));
+    }
+}
+
+void ClientSession::ArmTimer(Clock::time_point now) {
+    retries_ = 0;
+    deadline_ = now + rtt_.Rto();
+}
+
+void ClientSession::StartRound(Clock::time_point now) {
+    ArmTimer(now);
+    round_sent_at_ = now;
+    round_open_ = true;
+    round_retransmitted_ = false;
+}
+
+void ClientSession::SampleRound(Clock::time_point now) {
+    if (!round_open_) {
+        return;
+    }
+    round_open_ = false;
+    if (!round_retransmitted_) {
+        rtt_.Sample(std::chrono::duration_cast<RttEstimator::Duration>(now - round_sent_at_));
+    }
+}
+
+bool ClientSession::ConsumeRetry(Clock::time_point now) {
+    if (++retries_ > kMaxRetries) {
+        return false;
+    }
+    round_retransmitted_ = true;
+    rtt_.Backoff();
+    deadline_ = now + rtt_.Rto();
+    return true;
+}
+
+void ClientSession::Fail(const std::string& reason) {
+    if (finished_) {
+        return;
+    }
+    TFTP_ERROR("%s %s failed: %s", upload_ ? "Upload of" : "Download of", filename_.c_str(), reason.c_str());
+    error_ = reason;
+    if (sink_open_) {
+        sink_open_ = false;
+        sink_->Abort();
+    }
+    Finish();
+}
+
+void ClientSession::Succeed() {
+    succeeded_ = true;
+    Finish();
+}
+
+void ClientSession::Finish() {
+    if (source_open_) {
+        source_open_ = false;
+        source_->Close();
+    }
+    state_ = State::kDone;
+    finished_ = true;
+    finished_at_ = Clock::now();
+    deadline_ = Clock::time_point::max();
+}
+
+void RunClientSessions(const std::vector<ClientSession*>& sessions, size_t max_parallel) {
+    using Clock = ClientSession::Clock;
+    max_parallel = std::max<size_t>(max_parallel, 1);
+
+    Poller poller;
+    if (!poller.IsValid()) {
+        for (ClientSession* session : sessions) {
+            session->Abort("Poller creation failed");
+        }
+        return;
+    }
+
+    std::vector<uint8_t> recv_buffer(kReceiveBatch * kReceiveSlotSize);
+    std::vector<net::IncomingDatagram> incoming(kReceiveBatch);
+    for (size_t i = 0; i < kReceiveBatch; ++i) {
+        incoming[i].buffer = recv_buffer.data() + i * kReceiveSlotSize;
+        incoming[i].capacity = kReceiveSlotSize;
+    }
+
+    // Sessions are identified to the poller by their index
+    std::unordered_map<uint64_t, ClientSession*> active;
+    size_t next = 0;
+    std::vector<uint64_t> ready;
+    std::vector<uint64_t> finished;
+
+    auto start_sessions = [&](Clock::time_point now) {
+        while (active.size() < max_parallel && next < sessions.size()) {
+            uint64_t id = next++;
+            ClientSession* session = sessions[id];
+            if (!session->Start(now)) {
+                continue;
+            }
+            if (!poller.Add(session->GetSocket().GetNativeHandle(), id)) {
+                session->Abort("Poller registration failed");
+                session->GetSocket().Close();
+                continue;
+            }
+            active.emplace(id, session);
+        }
+    };
+
+    start_sessions(Clock::now());
+    while (!active.empty()) {
+        Clock::time_point deadline = Clock::time_point::max();
+        for (const auto& entry : active) {
+            deadline = std::min(deadline, entry.second->Deadline());
+        }
+        Clock::time_point now = Clock::now();
+        int timeout_ms = -1;
+        if (deadline != Clock::time_point::max()) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+            // Rounded up, so the loop does not wake just before the deadline and spin
+            timeout_ms = deadline <= now ? 0 : static_cast<int>(wait.count()) + 1;
+        }
+
+        ready.clear();
+        poller.Wait(timeout_ms, ready);
+        now = Clock::now();
+        for (uint64_t id : ready) {
+            auto it = active.find(id);
+            if (it == active.end()) {
+                continue;
+            }
+            ClientSession& session = *it->second;
+            int handled = 0;
+            while (handled < kMaxDatagramsPerWakeup && !session.IsFinished()) {
+                int received = session.GetSocket().ReceiveBatch(incoming.data(), incoming.size(), 0);
+                if (received <= 0) {
+                    break;
+                }
+                for (int i = 0; i < received && !session.IsFinished(); ++i) {
+                    PacketView packet;
+                    if (!packet.Parse(incoming[i].buffer, incoming[i].length, session.BlockSize())) {
+                        TFTP_WARN("Ignoring malformed packet");
+                        continue;
+                    }
+                    session.HandlePacket(packet, incoming[i].addr, now);
+                }
+                handled += received;
+                if (static_cast<size_t>(received) < incoming.size()) {
+                    break;
+                }
+            }
+        }
+
+        finished.clear();
+        for (const auto& entry : active) {
+            ClientSession& session = *entry.second;
+            if (!session.IsFinished() && now >= session.Deadline()) {
+                session.OnTimeout(now);
+            }
+            if (session.IsFinished()) {
+                finished.push_back(entry.first);
+            }
+        }
+        // Finished sockets are closed at once, so a large batch never holds more than max_parallel
+        for (uint64_t id : finished) {
+            ClientSession& session = *active[id];
+            poller.Remove(session.GetSocket().GetNativeHandle());
+            session.GetSocket().Close();
+            active.erase(id);
+        }
+        start_sessions(now);
+    }
+}
+
+} // namespace internal
+} // namespace tftpserver
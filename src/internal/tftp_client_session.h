@@ -0,0 +1,171 @@
+/**
+ * @file tftp_client_session.h
+ * @brief Client side of one TFTP transfer and the event loop running many of them
+ */
+
+#ifndef TFTP_CLIENT_SESSION_H_
+#define TFTP_CLIENT_SESSION_H_
+
+#include "tftp/tftp_common.h"
+#include "tftp/tftp_file_io.h"
+#include "tftp/tftp_packet.h"
+#include "tftp/tftp_packet_view.h"
+#include "tftp/tftp_socket.h"
+#include "internal/tftp_rtt_estimator.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief What a client asks the server for; the OACK may lower blksize and windowsize
+ */
+struct ClientOptions {
+    size_t block_size = kMaxDataSize;    // blksize (RFC 2348); sent when not 512
+    size_t window_size = 1;              // windowsize (RFC 7440); sent when above 1
+    bool transfer_size = true;           // tsize (RFC 2349): asked on downloads, announced on uploads
+    int timeout_secs = kDefaultTimeout;  // Ceiling of the adaptive retransmission timeout
+    TransferMode mode = TransferMode::kOctet;
+};
+
+/**
+ * @brief Non-blocking client transfer: a download into a WriteSink or an upload from a ReadSource
+ *
+ * The session owns its UDP socket (its transfer ID) but never waits on it: the event loop
+ * feeds it the datagrams that arrive and calls OnTimeout once Deadline has passed. Downloads
+ * acknowledge every window; uploads keep a window of DATA in flight and restart it after the
+ * last acknowledged block, as the server does.
+ */
+class ClientSession {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Download of filename into sink; the sink is opened with the size from the OACK, if any
+    ClientSession(const sockaddr_in& server, const std::string& filename, const ClientOptions& options,
+                  WriteSink& sink);
+    // Upload of source as filename; the source is opened with filename
+    ClientSession(const sockaddr_in& server, const std::string& filename, const ClientOptions& options,
+                  ReadSource& source);
+    ~ClientSession();
+
+    // Disable copy
+    ClientSession(const ClientSession&) = delete;
+    ClientSession& operator=(const ClientSession&) = delete;
+
+    // Creates the socket and sends the request; false if the session failed at once
+    bool Start(Clock::time_point now);
+    void HandlePacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now);
+    void OnTimeout(Clock::time_point now);
+    // Ends the transfer with an error, telling the server when it is already talking to us
+    void Abort(const std::string& reason);
+
+    Clock::time_point Deadline() const { return deadline_; }
+    bool IsFinished() const { return finished_; }
+    bool Succeeded() const { return succeeded_; }
+    const std::string& GetError() const { return error_; }
+
+    net::UdpSocket& GetSocket() { return socket_; }
+    // Largest DATA payload to accept: the requested size until the server has answered
+    size_t BlockSize() const { return block_size_; }
+    uint64_t GetBytesTransferred() const { return bytes_; }
+    Clock::duration GetElapsed() const { return finished_at_ - started_at_; }
+    // Request until the first DATA was received (download) or acknowledged (upload); zero if none
+    Clock::duration GetTimeToFirstByte() const {
+        return first_byte_seen_ ? first_byte_at_ - started_at_ : Clock::duration::zero();
+    }
+
+private:
+    enum class State {
+        kIdle,
+        kRequested,     // Waiting for the first answer (OACK, DATA 1, ACK 0 or ERROR)
+        kTransferring,
+        kDone
+    };
+
+    ClientSession(const sockaddr_in& server, const std::string& filename, const ClientOptions& options,
+                  ReadSource* source);
+
+    TftpPacket BuildRequest() const;
+    bool AcceptOack(const PacketView& packet);
+    bool OpenSink(uint64_t size_hint);
+
+    void HandleDownload(const PacketView& packet, Clock::time_point now);
+    void HandleData(const PacketView& packet, Clock::time_point now);
+    void HandleUpload(const PacketView& packet, Clock::time_point now);
+    void HandleAck(const PacketView& packet, Clock::time_point now);
+    void BeginUpload(Clock::time_point now);
+
+    bool SendRequest();
+    bool SendAck(uint16_t block_number);
+    bool SendWindow();
+    void SendError(const sockaddr_in& to, ErrorCode code, const std::string& message);
+
+    // Retransmission timer, as in Transfer: a round is sampled unless it was resent (Karn)
+    void StartRound(Clock::time_point now);
+    void SampleRound(Clock::time_point now);
+    void ArmTimer(Clock::time_point now);
+    bool ConsumeRetry(Clock::time_point now);
+
+    void Fail(const std::string& reason);
+    void Succeed();
+    void Finish();
+
+    sockaddr_in server_;
+    sockaddr_in peer_ = {};  // Server transfer ID, learned from its first answer
+    std::string filename_;
+    ClientOptions options_;
+    bool upload_;
+    WriteSink* sink_;
+    ReadSource* source_;
+    net::UdpSocket socket_;
+    State state_;
+
+    size_t block_size_;
+    size_t window_size_;
+    RttEstimator rtt_;
+    Clock::time_point deadline_;
+    Clock::time_point round_sent_at_;
+    bool round_open_;
+    bool round_retransmitted_;
+    int retries_;
+
+    // Download
+    bool sink_open_;
+    uint16_t expected_block_;
+    size_t received_in_window_;
+    bool gap_acked_;
+    bool duplicate_acked_;
+    bool has_expected_size_;
+    uint64_t expected_size_;
+    uint16_t last_ack_;
+
+    // Upload
+    bool source_open_;
+    uint64_t file_size_;
+    uint64_t total_blocks_;
+    uint64_t window_start_;  // First unacknowledged block, counted from 1 without wrapping
+    uint64_t window_end_;    // Last block of the window in flight
+    bool window_restarted_;
+    std::vector<uint8_t> window_buffer_;
+
+    uint64_t bytes_;
+    bool finished_;
+    bool succeeded_;
+    std::string error_;
+    bool first_byte_seen_;
+    Clock::time_point started_at_;
+    Clock::time_point first_byte_at_;
+    Clock::time_point finished_at_;
+};
+
+// Runs the sessions to completion on the calling thread, at most max_parallel at a time,
+// in the order given; every session is finished on return
+void RunClientSessions(const std::vector<ClientSession*>& sessions, size_t max_parallel);
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_CLIENT_SESSION_H_
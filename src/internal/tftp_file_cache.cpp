@@ -0,0 +1,302 @@
+/**
+ * @file tftp_file_cache.cpp
+ * @brief Shared memory-mapped read cache for frequently requested files
+ */
+
+#include "internal/tftp_file_cache.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+#ifndef _WIN32
+int64_t ModifiedTimeNs(const struct stat& st) {
+#ifdef __APPLE__
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+#endif
+
+// Current size and modification time of a regular file
+bool StatFile(const std::string& path, uint64_t& size, int64_t& mtime) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info) ||
+        (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    mtime = static_cast<int64_t>((static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                                 info.ftLastWriteTime.dwLowDateTime);
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = ModifiedTimeNs(st);
+#endif
+    return true;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// MappedFile
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<const MappedFile> MappedFile::Map(const std::string& path) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(handle, &info)) {
+        CloseHandle(handle);
+        return nullptr;
+    }
+    file->size_ = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    file->mtime_ = static_cast<int64_t>((static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                                        info.ftLastWriteTime.dwLowDateTime);
+    if (file->size_ > 0) {
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            TFTP_ERROR("CreateFileMapping failed: %s (error %lu)", path.c_str(), GetLastError());
+            CloseHandle(handle);
+            return nullptr;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            TFTP_ERROR("MapViewOfFile failed: %s (error %lu)", path.c_str(), GetLastError());
+            CloseHandle(mapping);
+            CloseHandle(handle);
+            return nullptr;
+        }
+        file->mapping_ = mapping;
+        file->data_ = static_cast<const uint8_t*>(view);
+    }
+    CloseHandle(handle);
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    file->size_ = static_cast<uint64_t>(st.st_size);
+    file->mtime_ = ModifiedTimeNs(st);
+    if (file->size_ > 0) {
+        void* addr = mmap(nullptr, static_cast<size_t>(file->size_), PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            TFTP_ERROR("mmap failed: %s (%s)", path.c_str(), strerror(errno));
+            close(fd);
+            return nullptr;
+        }
+        file->data_ = static_cast<const uint8_t*>(addr);
+    }
+    // The mapping keeps the file contents alive on its own
+    close(fd);
+#endif
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (data_ == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+#else
+    munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// FileCache
+// ---------------------------------------------------------------------------
+
+FileCache::FileCache(size_t max_bytes)
+    : max_bytes_(max_bytes),
+      cached_bytes_(0),
+      hits_(0),
+      misses_(0),
+      evictions_(0) {
+}
+
+std::shared_ptr<const MappedFile> FileCache::Acquire(const std::string& path) {
+    std::error_code ec;
+    std::string key = std::filesystem::weakly_canonical(path, ec).string();
+    if (ec) {
+        key = path;
+    }
+
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (!StatFile(key, size, mtime)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (max_bytes_ == 0 || size > max_bytes_) {
+        return nullptr;
+    }
+
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        const auto& file = it->second.file;
+        if (file->Size() == size && file->ModifiedTime() == mtime) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+            hits_++;
+            return file;
+        }
+        // Changed on disk: transfers still holding the old mapping keep a consistent snapshot
+        TFTP_INFO("File cache entry invalidated: %s", key.c_str());
+        EraseLocked(it);
+    }
+
+    misses_++;
+    std::shared_ptr<const MappedFile> file = MappedFile::Map(key);
+    if (!file || file->Size() > max_bytes_) {
+        return file;
+    }
+
+    EvictLocked(static_cast<size_t>(file->Size()));
+    lru_.push_front(key);
+    entries_[key] = Entry{file, lru_.begin()};
+    cached_bytes_ += static_cast<size_t>(file->Size());
+    return file;
+}
+
+void FileCache::SetMaxBytes(size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_bytes_ = max_bytes;
+    EvictLocked(0);
+}
+
+size_t FileCache::GetMaxBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_bytes_;
+}
+
+void FileCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    cached_bytes_ = 0;
+}
+
+FileCacheStats FileCache::GetStats() const {
+    FileCacheStats stats;
+    stats.hits = hits_.load();
+    stats.misses = misses_.load();
+    stats.evictions = evictions_.load();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.entries = entries_.size();
+    stats.cached_bytes = cached_bytes_;
+    return stats;
+}
+
+void FileCache::EvictLocked(size_t needed) {
+    while (!lru_.empty() && cached_bytes_ + needed > max_bytes_) {
+        auto it = entries_.find(lru_.back());
+        if (it == entries_.end()) {
+            lru_.pop_back();
+            continue;
+        }
+        EraseLocked(it);
+        evictions_++;
+    }
+}
+
+void FileCache::EraseLocked(std::unordered_map<std::string, Entry>::iterator it) {
+    cached_bytes_ -= static_cast<size_t>(it->second.file->Size());
+    lru_.erase(it->second.lru_position);
+    entries_.erase(it);
+}
+
+// ---------------------------------------------------------------------------
+// CachedReadSource
+// ---------------------------------------------------------------------------
+
+CachedReadSource::CachedReadSource(std::shared_ptr<FileCache> cache)
+    : cache_(std::move(cache)) {
+}
+
+bool CachedReadSource::Open(const std::string& path) {
+    Close();
+    file_ = cache_ ? cache_->Acquire(path) : nullptr;
+    return file_ != nullptr || fallback_.Open(path);
+}
+
+bool CachedReadSource::Stat(const std::string& path, uint64_t& size) {
+    return fallback_.Stat(path, size);
+}
+
+uint64_t CachedReadSource::Size() const {
+    return file_ ? file_->Size() : fallback_.Size();
+}
+
+bool CachedReadSource::ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) {
+    if (!file_) {
+        return fallback_.ReadAt(offset, buffer, length, bytes_read);
+    }
+    bytes_read = 0;
+    if (offset < file_->Size()) {
+        bytes_read = static_cast<size_t>(std::min<uint64_t>(length, file_->Size() - offset));
+        std::memcpy(buffer, file_->Data() + offset, bytes_read);
+    }
+    return true;
+}
+
+bool CachedReadSource::ReadBatch(ReadRequest* requests, size_t count) {
+    if (!file_) {
+        return fallback_.ReadBatch(requests, count);
+    }
+    return ReadSource::ReadBatch(requests, count);
+}
+
+void CachedReadSource::Prefetch(uint64_t offset, size_t length) {
+    if (!file_) {
+        fallback_.Prefetch(offset, length);
+    }
+}
+
+const uint8_t* CachedReadSource::PeekAt(uint64_t offset, size_t length) {
+    if (!file_ || offset > file_->Size() || length > file_->Size() - offset) {
+        return nullptr;
+    }
+    return file_->Data() + offset;
+}
+
+void CachedReadSource::Close() {
+    file_.reset();
+    fallback_.Close();
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,127 @@
+/**
+ * @file tftp_file_cache.h
+ * @brief Shared memory-mapped read cache for frequently requested files
+ */
+
+#ifndef TFTP_FILE_CACHE_H_
+#define TFTP_FILE_CACHE_H_
+
+#include "tftp/tftp_file_io.h"
+#include "internal/tftp_file_io_impl.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Immutable read-only mapping of a whole file
+ *
+ * The mapping stays valid for as long as any transfer holds a reference, even after the
+ * cache has evicted or invalidated it.
+ */
+class MappedFile {
+public:
+    ~MappedFile();
+
+    // Disable copy
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps path; returns nullptr on failure
+    static std::shared_ptr<const MappedFile> Map(const std::string& path);
+
+    const uint8_t* Data() const { return data_; }
+    uint64_t Size() const { return size_; }
+    int64_t ModifiedTime() const { return mtime_; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* data_ = nullptr;
+    uint64_t size_ = 0;
+    int64_t mtime_ = 0;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+};
+
+/**
+ * @brief Refcounted cache of mapped files keyed by canonical path
+ *
+ * Entries are revalidated against size and modification time on every lookup and evicted in
+ * LRU order once the mapped bytes exceed the configured limit. Files larger than the limit
+ * are never cached. A limit of 0 disables the cache.
+ */
+class FileCache {
+public:
+    explicit FileCache(size_t max_bytes = 0);
+
+    // Disable copy
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    // Returns a shared mapping of path, or nullptr if it cannot or should not be cached
+    std::shared_ptr<const MappedFile> Acquire(const std::string& path);
+
+    void SetMaxBytes(size_t max_bytes);
+    size_t GetMaxBytes() const;
+    bool IsEnabled() const { return GetMaxBytes() > 0; }
+    void Clear();
+
+    FileCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const MappedFile> file;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    void EvictLocked(size_t needed);
+    void EraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+
+    mutable std::mutex mutex_;
+    size_t max_bytes_;
+    size_t cached_bytes_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;  // Most recently used first
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+};
+
+/**
+ * @brief Read source serving whole files from a FileCache, falling back to positioned reads
+ *        when a file is not cacheable
+ */
+class CachedReadSource : public ReadSource {
+public:
+    explicit CachedReadSource(std::shared_ptr<FileCache> cache);
+
+    bool Open(const std::string& path) override;
+    // A stat, without mapping the file or touching the cache
+    bool Stat(const std::string& path, uint64_t& size) override;
+    uint64_t Size() const override;
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override;
+    bool ReadBatch(ReadRequest* requests, size_t count) override;
+    void Prefetch(uint64_t offset, size_t length) override;
+    // Points into the cached mapping; nullptr when the file is served by positioned reads
+    const uint8_t* PeekAt(uint64_t offset, size_t length) override;
+    void Close() override;
+
+private:
+    std::shared_ptr<FileCache> cache_;
+    std::shared_ptr<const MappedFile> file_;
+    FileReadSource fallback_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_FILE_CACHE_H_
@@ -0,0 +1,458 @@
+/**
+ * @file tftp_file_io_impl.cpp
+ * @brief Built-in read sources and write sinks used by the TFTP server
+ */
+
+#include "internal/tftp_file_io_impl.h"
+#include "internal/tftp_uring.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+// Temporary upload path in the target directory, unique within and across server processes
+std::string MakeTempPath(const std::string& path) {
+    static std::atomic<uint64_t> counter{0};
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+    return path + ".tftp-" + std::to_string(pid) + "-" + std::to_string(counter.fetch_add(1)) + ".tmp";
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// FileReadSource
+// ---------------------------------------------------------------------------
+
+FileReadSource::FileReadSource()
+#ifdef _WIN32
+    : handle_(INVALID_HANDLE_VALUE),
+#else
+    : fd_(-1),
+      ring_slot_(-1),
+#endif
+      size_(0) {
+}
+
+FileReadSource::~FileReadSource() {
+    Close();
+}
+
+bool FileReadSource::Open(const std::string& path) {
+    Close();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        TFTP_ERROR("Cannot open file: %s (error %lu)", path.c_str(), GetLastError());
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(handle, &file_size)) {
+        TFTP_ERROR("Cannot get file size: %s (error %lu)", path.c_str(), GetLastError());
+        CloseHandle(handle);
+        return false;
+    }
+    handle_ = handle;
+    size_ = static_cast<uint64_t>(file_size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        TFTP_ERROR("Cannot open file: %s (%s)", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        TFTP_ERROR("Not a regular file: %s", path.c_str());
+        close(fd);
+        return false;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    fd_ = fd;
+    size_ = static_cast<uint64_t>(st.st_size);
+#ifdef TFTP_HAVE_IO_URING
+    ring_ = FileRing::ForThisThread();
+    if (ring_) {
+        ring_slot_ = ring_->AddFile(fd_);
+    }
+#endif
+#endif
+    return true;
+}
+
+bool FileReadSource::Stat(const std::string& path, uint64_t& size) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes) ||
+        (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        return false;
+    }
+    size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+#endif
+    return true;
+}
+
+uint64_t FileReadSource::Size() const {
+    return size_;
+}
+
+bool FileReadSource::ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) {
+    bytes_read = 0;
+    while (bytes_read < length) {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        uint64_t position = offset + bytes_read;
+        overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(length - bytes_read, 0x40000000));
+        DWORD transferred = 0;
+        if (!ReadFile(static_cast<HANDLE>(handle_), buffer + bytes_read, chunk, &transferred, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            TFTP_ERROR("File read error at offset %llu (error %lu)",
+                      static_cast<unsigned long long>(position), GetLastError());
+            return false;
+        }
+#else
+        ssize_t transferred = pread(fd_, buffer + bytes_read, length - bytes_read,
+                                    static_cast<off_t>(offset + bytes_read));
+        if (transferred < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            TFTP_ERROR("File read error at offset %llu (%s)",
+                      static_cast<unsigned long long>(offset + bytes_read), strerror(errno));
+            return false;
+        }
+#endif
+        if (transferred == 0) {
+            break;  // End of file
+        }
+        bytes_read += static_cast<size_t>(transferred);
+    }
+    return true;
+}
+
+bool FileReadSource::ReadBatch(ReadRequest* requests, size_t count) {
+#ifdef TFTP_HAVE_IO_URING
+    // The ring is single-threaded: a source used by another thread than its opener reads directly
+    if (ring_ && count > 1 && ring_->IsOwnedByThisThread()) {
+        if (!ring_->ReadBatch(fd_, ring_slot_, requests, count)) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            ReadRequest& request = requests[i];
+            size_t rest = 0;
+            // Short reads before end of file are unusual but allowed; finish them directly
+            if (request.bytes_read < request.length && request.offset + request.bytes_read < size_) {
+                if (!ReadAt(request.offset + request.bytes_read, request.buffer + request.bytes_read,
+                            request.length - request.bytes_read, rest)) {
+                    return false;
+                }
+                request.bytes_read += rest;
+            }
+        }
+        return true;
+    }
+#endif
+    return ReadSource::ReadBatch(requests, count);
+}
+
+void FileReadSource::Prefetch(uint64_t offset, size_t length) {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+    if (fd_ >= 0) {
+        posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
+
+void FileReadSource::Close() {
+#ifdef _WIN32
+    if (handle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (ring_) {
+        if (ring_slot_ >= 0) {
+            ring_->RemoveFile(ring_slot_);
+        }
+        ring_.reset();
+        ring_slot_ = -1;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+    size_ = 0;
+}
+
+// ---------------------------------------------------------------------------
+// CallbackReadSource
+// ---------------------------------------------------------------------------
+
+CallbackReadSource::CallbackReadSource(std::shared_ptr<CallbackCache> cache, CallbackCache::Generation generation)
+    : cache_(std::move(cache)), generation_(std::move(generation)) {
+}
+
+bool CallbackReadSource::Open(const std::string& path) {
+    data_ = cache_ ? cache_->Get(generation_, path) : nullptr;
+    return data_ != nullptr;
+}
+
+uint64_t CallbackReadSource::Size() const {
+    return data_ ? data_->size() : 0;
+}
+
+bool CallbackReadSource::ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) {
+    bytes_read = 0;
+    if (!data_ || offset >= data_->size()) {
+        return true;
+    }
+    bytes_read = std::min(length, static_cast<size_t>(data_->size() - offset));
+    std::memcpy(buffer, data_->data() + offset, bytes_read);
+    return true;
+}
+
+void CallbackReadSource::Close() {
+    data_.reset();
+}
+
+// ---------------------------------------------------------------------------
+// FileWriteSink
+// ---------------------------------------------------------------------------
+
+FileWriteSink::FileWriteSink(FsyncPolicy policy)
+    : fsync_policy_(policy),
+#ifdef _WIN32
+      handle_(INVALID_HANDLE_VALUE),
+#else
+      fd_(-1),
+#endif
+      size_(0) {
+}
+
+FileWriteSink::~FileWriteSink() {
+    Abort();
+}
+
+bool FileWriteSink::Open(const std::string& path, uint64_t size_hint) {
+    Abort();
+    
+    // Ensure directory exists
+    std::filesystem::path parent_path = std::filesystem::path(path).parent_path();
+    if (!parent_path.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(parent_path, ec);
+        if (ec) {
+            TFTP_ERROR("Directory creation error: %s (%s)", parent_path.string().c_str(), ec.message().c_str());
+            return false;
+        }
+    }
+    
+    std::string temp_path = MakeTempPath(path);
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(temp_path.c_str(), GENERIC_WRITE, 0, nullptr,
+                                CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        TFTP_ERROR("Cannot create file: %s (error %lu)", temp_path.c_str(), GetLastError());
+        return false;
+    }
+    handle_ = handle;
+    (void)size_hint;
+#else
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        TFTP_ERROR("Cannot create file: %s (%s)", temp_path.c_str(), strerror(errno));
+        return false;
+    }
+#ifdef __linux__
+    // Reserve space up front when the client announced the size; failure only loses the hint
+    if (size_hint > 0) {
+        posix_fallocate(fd, 0, static_cast<off_t>(size_hint));
+    }
+#else
+    (void)size_hint;
+#endif
+    fd_ = fd;
+#endif
+    path_ = path;
+    temp_path_ = temp_path;
+    size_ = 0;
+    return true;
+}
+
+bool FileWriteSink::Write(uint64_t offset, const uint8_t* data, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        uint64_t position = offset + written;
+        overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(length - written, 0x40000000));
+        DWORD transferred = 0;
+        if (!WriteFile(static_cast<HANDLE>(handle_), data + written, chunk, &transferred, &overlapped)) {
+            TFTP_ERROR("File write error: %s (error %lu)", temp_path_.c_str(), GetLastError());
+            return false;
+        }
+#else
+        ssize_t transferred = pwrite(fd_, data + written, length - written,
+                                     static_cast<off_t>(offset + written));
+        if (transferred < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            TFTP_ERROR("File write error: %s (%s)", temp_path_.c_str(), strerror(errno));
+            return false;
+        }
+#endif
+        written += static_cast<size_t>(transferred);
+    }
+    size_ = std::max(size_, offset + length);
+    if (fsync_policy_ == FsyncPolicy::kEveryWrite && length > 0 && !SyncFile()) {
+        TFTP_ERROR("File sync error: %s", temp_path_.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FileWriteSink::Commit() {
+    if (temp_path_.empty()) {
+        return false;
+    }
+    
+#ifdef _WIN32
+    bool flushed = fsync_policy_ == FsyncPolicy::kNever || SyncFile();
+#else
+    // Trim space preallocated from a size hint that turned out larger than the upload
+    bool flushed = ftruncate(fd_, static_cast<off_t>(size_)) == 0 &&
+                   (fsync_policy_ == FsyncPolicy::kNever || SyncFile());
+#endif
+    CloseFile();
+    if (!flushed) {
+        TFTP_ERROR("File flush failed: %s", temp_path_.c_str());
+        Abort();
+        return false;
+    }
+    
+#ifdef _WIN32
+    bool renamed = MoveFileExA(temp_path_.c_str(), path_.c_str(),
+                               MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool renamed = std::rename(temp_path_.c_str(), path_.c_str()) == 0;
+#endif
+    if (!renamed) {
+        TFTP_ERROR("Cannot move %s to %s", temp_path_.c_str(), path_.c_str());
+        Abort();
+        return false;
+    }
+    
+    TFTP_INFO("File written successfully: %s", path_.c_str());
+    temp_path_.clear();
+    path_.clear();
+    return true;
+}
+
+void FileWriteSink::Abort() {
+    CloseFile();
+    if (!temp_path_.empty()) {
+        std::remove(temp_path_.c_str());
+        temp_path_.clear();
+    }
+    path_.clear();
+}
+
+bool FileWriteSink::SyncFile() {
+#ifdef _WIN32
+    return FlushFileBuffers(static_cast<HANDLE>(handle_)) != 0;
+#elif defined(__linux__)
+    return fdatasync(fd_) == 0;
+#else
+    return fsync(fd_) == 0;
+#endif
+}
+
+void FileWriteSink::CloseFile() {
+#ifdef _WIN32
+    if (handle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// CallbackWriteSink
+// ---------------------------------------------------------------------------
+
+CallbackWriteSink::CallbackWriteSink(WriteCallback callback)
+    : callback_(std::move(callback)) {
+}
+
+bool CallbackWriteSink::Open(const std::string& path, uint64_t size_hint) {
+    path_ = path;
+    data_.clear();
+    if (size_hint > 0) {
+        data_.reserve(static_cast<size_t>(size_hint));
+    }
+    return static_cast<bool>(callback_);
+}
+
+bool CallbackWriteSink::Write(uint64_t offset, const uint8_t* data, size_t length) {
+    (void)offset;  // Blocks arrive in order, so appending is enough
+    data_.insert(data_.end(), data, data + length);
+    return true;
+}
+
+bool CallbackWriteSink::Commit() {
+    bool success = callback_(path_, data_);
+    Abort();
+    return success;
+}
+
+void CallbackWriteSink::Abort() {
+    data_.clear();
+    data_.shrink_to_fit();
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,133 @@
+/**
+ * @file tftp_file_io_impl.h
+ * @brief Built-in read sources and write sinks used by the TFTP server
+ */
+
+#ifndef TFTP_FILE_IO_IMPL_H_
+#define TFTP_FILE_IO_IMPL_H_
+
+#include "tftp/tftp_file_io.h"
+#include "internal/tftp_callback_cache.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+class FileRing;
+
+/**
+ * @brief Default filesystem source built on positioned reads (pread / ReadFile with OVERLAPPED)
+ *
+ * When the opening thread has an io_uring file ring (kIoUring backend), the file is registered
+ * in it and ReadBatch reads a whole window with one submission.
+ */
+class FileReadSource : public ReadSource {
+public:
+    FileReadSource();
+    ~FileReadSource() override;
+
+    // Disable copy
+    FileReadSource(const FileReadSource&) = delete;
+    FileReadSource& operator=(const FileReadSource&) = delete;
+
+    bool Open(const std::string& path) override;
+    // One stat call; false for anything but a regular file
+    bool Stat(const std::string& path, uint64_t& size) override;
+    uint64_t Size() const override;
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override;
+    bool ReadBatch(ReadRequest* requests, size_t count) override;
+    // POSIX_FADV_WILLNEED where available
+    void Prefetch(uint64_t offset, size_t length) override;
+    void Close() override;
+
+private:
+#ifdef _WIN32
+    void* handle_;
+#else
+    int fd_;
+    std::shared_ptr<FileRing> ring_;  // Ring of the opening thread, if it has one
+    int ring_slot_;                   // Fixed file slot in ring_, or -1
+#endif
+    uint64_t size_;
+};
+
+
+/**
+ * @brief Adapts a legacy SetReadCallback function: the whole file is loaded on Open, through
+ *        a CallbackCache that shares it with concurrent and later requests of the same generation
+ */
+class CallbackReadSource : public ReadSource {
+public:
+    CallbackReadSource(std::shared_ptr<CallbackCache> cache, CallbackCache::Generation generation);
+
+    bool Open(const std::string& path) override;
+    uint64_t Size() const override;
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override;
+    void Close() override;
+
+private:
+    std::shared_ptr<CallbackCache> cache_;
+    CallbackCache::Generation generation_;  // Callback of the request's configuration snapshot
+    std::shared_ptr<const std::vector<uint8_t>> data_;
+};
+
+/**
+ * @brief Default filesystem sink: writes into a temporary file next to the target and
+ *        renames it over the target on Commit, so readers never see a partial upload
+ */
+class FileWriteSink : public WriteSink {
+public:
+    explicit FileWriteSink(FsyncPolicy policy = FsyncPolicy::kOnCommit);
+    ~FileWriteSink() override;
+
+    // Disable copy
+    FileWriteSink(const FileWriteSink&) = delete;
+    FileWriteSink& operator=(const FileWriteSink&) = delete;
+
+    bool Open(const std::string& path, uint64_t size_hint) override;
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override;
+    bool Commit() override;
+    void Abort() override;
+
+private:
+    void CloseFile();
+    bool SyncFile();
+
+    FsyncPolicy fsync_policy_;
+#ifdef _WIN32
+    void* handle_;
+#else
+    int fd_;
+#endif
+    std::string path_;
+    std::string temp_path_;
+    uint64_t size_;
+};
+
+/**
+ * @brief Adapts a legacy SetWriteCallback function: blocks are buffered and handed over on Commit
+ */
+class CallbackWriteSink : public WriteSink {
+public:
+    using WriteCallback = std::function<bool(const std::string&, const std::vector<uint8_t>&)>;
+
+    explicit CallbackWriteSink(WriteCallback callback);
+
+    bool Open(const std::string& path, uint64_t size_hint) override;
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override;
+    bool Commit() override;
+    void Abort() override;
+
+private:
+    WriteCallback callback_;
+    std::string path_;
+    std::vector<uint8_t> data_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_FILE_IO_IMPL_H_
@@ -0,0 +1,562 @@
+/**
+ * @file tftp_io_stage.cpp
+ * @brief Disk I/O off the network path: read-ahead for RRQ sources, write-behind for WRQ sinks
+ */
+
+#include "internal/tftp_io_stage.h"
+#include "internal/tftp_thread_pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+// Buffers of finished chunks and written blocks kept for reuse, per source or sink
+constexpr size_t kMaxSpareBuffers = 8;
+
+void Recycle(std::vector<std::vector<uint8_t>>& spare, std::vector<uint8_t>& buffer) {
+    if (spare.size() < kMaxSpareBuffers) {
+        spare.push_back(std::move(buffer));
+    }
+}
+
+std::vector<uint8_t> TakeSpare(std::vector<std::vector<uint8_t>>& spare) {
+    if (spare.empty()) {
+        return std::vector<uint8_t>();
+    }
+    std::vector<uint8_t> buffer = std::move(spare.back());
+    spare.pop_back();
+    return buffer;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// IoStage
+// ---------------------------------------------------------------------------
+
+IoStage::IoStage(size_t thread_count)
+    : thread_count_(std::max<size_t>(1, thread_count)) {
+}
+
+IoStage::~IoStage() = default;
+
+bool IoStage::Post(std::function<void()> job) {
+    std::call_once(start_once_, [this]() { pool_ = std::make_unique<TftpThreadPool>(thread_count_); });
+    return pool_->Post(std::move(job));
+}
+
+// ---------------------------------------------------------------------------
+// IoCompletions
+// ---------------------------------------------------------------------------
+
+IoCompletions::IoCompletions(std::function<void()> wake)
+    : wake_(std::move(wake)),
+      closed_(false) {
+}
+
+std::function<void()> IoCompletions::Notifier(const std::shared_ptr<IoCompletions>& completions, uint64_t id) {
+    return [completions, id]() { completions->Mark(id); };
+}
+
+void IoCompletions::Mark(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        return;
+    }
+    ready_.push_back(id);
+    marked_.notify_all();
+    if (wake_) {
+        wake_();
+    }
+}
+
+void IoCompletions::Take(std::vector<uint64_t>& ids) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ids.insert(ids.end(), ready_.begin(), ready_.end());
+    ready_.clear();
+}
+
+bool IoCompletions::Wait(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return marked_.wait_for(lock, timeout, [this]() { return !ready_.empty() || closed_; }) && !ready_.empty();
+}
+
+void IoCompletions::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    ready_.clear();
+    marked_.notify_all();
+}
+
+// ---------------------------------------------------------------------------
+// ReadAheadSource
+// ---------------------------------------------------------------------------
+
+struct ReadAheadSource::State {
+    struct Chunk {
+        uint64_t offset = 0;
+        size_t length = 0;
+        bool ready = false;
+        std::vector<uint8_t> data;
+    };
+
+    explicit State(std::unique_ptr<ReadSource> wrapped) : source(std::move(wrapped)) {}
+
+    // Copies length bytes at offset if one ready chunk holds them all
+    bool Copy(uint64_t offset, uint8_t* buffer, size_t length) const {
+        for (const Chunk& chunk : chunks) {
+            if (chunk.ready && offset >= chunk.offset && offset + length <= chunk.offset + chunk.length) {
+                std::memcpy(buffer, chunk.data.data() + (offset - chunk.offset), length);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::unique_ptr<ReadSource> source;
+    std::mutex mutex;
+    std::condition_variable idle;              // Signalled when a fetch ends
+    std::function<void()> notifier;            // Waiting transfer, woken when the next chunk is read
+    std::deque<Chunk> chunks;                  // In file order; only the last one may be filling
+    std::vector<std::vector<uint8_t>> spare;
+    uint64_t size = 0;
+    uint64_t fetched_end = 0;                  // End of the chunks asked for so far
+    uint64_t target_end = 0;                   // Read ahead up to here
+    size_t chunk_size = 0;                     // One send window, from the first ReadBatch
+    bool open = false;
+    bool fetching = false;                     // A fetch is queued or running
+    bool close_pending = false;                // Closed during a fetch, which closes the source
+};
+
+ReadAheadSource::ReadAheadSource(std::unique_ptr<ReadSource> source, std::shared_ptr<IoStage> stage,
+                                 size_t windows)
+    : state_(std::make_shared<State>(std::move(source))),
+      stage_(std::move(stage)),
+      windows_(std::max<size_t>(1, windows)) {
+}
+
+ReadAheadSource::~ReadAheadSource() {
+    Close();
+}
+
+bool ReadAheadSource::Open(const std::string& path) {
+    Close();
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    // A fetch for the previous file finishes, and closes it, first
+    state_->idle.wait(lock, [this]() { return !state_->fetching && !state_->close_pending; });
+    state_->chunks.clear();
+    state_->fetched_end = 0;
+    state_->target_end = 0;
+    state_->chunk_size = 0;
+    state_->notifier = nullptr;
+    if (!state_->source->Open(path)) {
+        return false;
+    }
+    state_->size = state_->source->Size();
+    state_->open = true;
+    return true;
+}
+
+bool ReadAheadSource::Stat(const std::string& path, uint64_t& size) {
+    return state_->source->Stat(path, size);
+}
+
+uint64_t ReadAheadSource::Size() const {
+    return state_->size;
+}
+
+bool ReadAheadSource::ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) {
+    ReadRequest request;
+    request.offset = offset;
+    request.buffer = buffer;
+    request.length = length;
+    bool ok = ReadBatch(&request, 1);
+    bytes_read = request.bytes_read;
+    return ok;
+}
+
+bool ReadAheadSource::ReadBatch(ReadRequest* requests, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+    misses_.clear();
+    miss_index_.clear();
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        State& state = *state_;
+        uint64_t batch_begin = requests[0].offset;
+        uint64_t batch_end = 0;
+        for (size_t i = 0; i < count; ++i) {
+            ReadRequest& request = requests[i];
+            batch_begin = std::min(batch_begin, request.offset);
+            batch_end = std::max<uint64_t>(batch_end, request.offset + request.length);
+            uint64_t available = request.offset < state.size ? state.size - request.offset : 0;
+            size_t wanted = static_cast<size_t>(std::min<uint64_t>(request.length, available));
+            if (wanted == 0 || state.Copy(request.offset, request.buffer, wanted)) {
+                request.bytes_read = wanted;
+                continue;
+            }
+            misses_.push_back(request);
+            miss_index_.push_back(i);
+        }
+
+        if (state.chunk_size == 0) {
+            state.chunk_size = static_cast<size_t>(
+                std::min<uint64_t>(kMaxChunkSize, std::max<uint64_t>(1, batch_end - batch_begin)));
+        }
+        // Chunks wholly behind this batch are done with
+        while (!state.chunks.empty() && state.chunks.front().ready &&
+               state.chunks.front().offset + state.chunks.front().length <= batch_begin) {
+            Recycle(state.spare, state.chunks.front().data);
+            state.chunks.pop_front();
+        }
+        // A transfer that overtook the read-ahead, or jumped, continues it behind this batch
+        if (!state.fetching && state.fetched_end < batch_end) {
+            state.fetched_end = batch_end;
+        }
+        state.target_end = std::max<uint64_t>(state.target_end, batch_end + windows_ * state.chunk_size);
+        StartFetchLocked();
+    }
+
+    if (misses_.empty()) {
+        return true;
+    }
+    bool ok = state_->source->ReadBatch(misses_.data(), misses_.size());
+    for (size_t i = 0; i < misses_.size(); ++i) {
+        requests[miss_index_[i]].bytes_read = misses_[i].bytes_read;
+    }
+    return ok;
+}
+
+void ReadAheadSource::Prefetch(uint64_t offset, size_t length) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    State& state = *state_;
+    if (!state.open) {
+        return;
+    }
+    if (state.chunk_size == 0) {
+        state.chunk_size = std::min(kMaxChunkSize, std::max<size_t>(1, length));
+    }
+    if (!state.fetching && state.fetched_end < offset) {
+        state.fetched_end = offset;
+    }
+    state.target_end = std::max<uint64_t>(state.target_end, offset + windows_ * state.chunk_size);
+    StartFetchLocked();
+}
+
+bool ReadAheadSource::WhenReady(uint64_t offset, std::function<void()> notifier) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    State& state = *state_;
+    if (!state.fetching || offset >= std::min(state.target_end, state.size)) {
+        return true;
+    }
+    for (const State::Chunk& chunk : state.chunks) {
+        if (chunk.ready && offset >= chunk.offset && offset < chunk.offset + chunk.length) {
+            return true;
+        }
+    }
+    // Only the last chunk may still be filling; what is behind it was skipped or dropped
+    uint64_t unread = !state.chunks.empty() && !state.chunks.back().ready ? state.chunks.back().offset
+                                                                           : state.fetched_end;
+    if (offset < unread) {
+        return true;
+    }
+    state.notifier = std::move(notifier);
+    return false;
+}
+
+void ReadAheadSource::StartFetchLocked() {
+    State& state = *state_;
+    if (state.fetching || state.fetched_end >= std::min(state.target_end, state.size)) {
+        return;
+    }
+    state.fetching = true;
+    std::shared_ptr<State> shared = state_;
+    if (!stage_->Post([shared]() { Fetch(shared); })) {
+        state.fetching = false;
+    }
+}
+
+const uint8_t* ReadAheadSource::PeekAt(uint64_t offset, size_t length) {
+    return state_->source->PeekAt(offset, length);
+}
+
+void ReadAheadSource::Close() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (!state_->open) {
+        return;
+    }
+    state_->open = false;
+    if (state_->fetching) {
+        state_->close_pending = true;
+        return;
+    }
+    state_->chunks.clear();
+    state_->source->Close();
+}
+
+void ReadAheadSource::Fetch(const std::shared_ptr<State>& state) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    uint64_t end = std::min(state->target_end, state->size);
+    if (!state->close_pending && state->fetched_end < end) {
+        // The kernel can start on the whole range while the chunks are read one by one
+        uint64_t offset = state->fetched_end;
+        lock.unlock();
+        state->source->Prefetch(offset, static_cast<size_t>(end - offset));
+        lock.lock();
+    }
+    while (!state->close_pending && state->fetched_end < std::min(state->target_end, state->size)) {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(state->chunk_size, state->size - state->fetched_end));
+        state->chunks.emplace_back();
+        State::Chunk& chunk = state->chunks.back();  // Only this job adds chunks or removes unready ones
+        chunk.offset = state->fetched_end;
+        chunk.data = TakeSpare(state->spare);
+        chunk.data.resize(length);
+        state->fetched_end += length;
+        lock.unlock();
+
+        size_t bytes_read = 0;
+        bool ok = state->source->ReadAt(chunk.offset, chunk.data.data(), length, bytes_read);
+
+        lock.lock();
+        if (!ok || bytes_read < length) {
+            // Left to the transfer's own read, which reports the error
+            state->fetched_end = chunk.offset;
+            state->target_end = chunk.offset;
+            Recycle(state->spare, chunk.data);
+            state->chunks.pop_back();
+            break;
+        }
+        chunk.length = bytes_read;
+        chunk.ready = true;
+        if (state->notifier) {
+            std::function<void()> notifier = std::move(state->notifier);
+            state->notifier = nullptr;
+            notifier();
+        }
+    }
+    state->fetching = false;
+    if (state->close_pending) {
+        state->chunks.clear();
+        lock.unlock();
+        state->source->Close();
+        lock.lock();
+        state->close_pending = false;
+    }
+    // A transfer still waiting reads for itself
+    if (state->notifier) {
+        std::function<void()> notifier = std::move(state->notifier);
+        state->notifier = nullptr;
+        notifier();
+    }
+    state->idle.notify_all();
+}
+
+// ---------------------------------------------------------------------------
+// WriteBehindSink
+// ---------------------------------------------------------------------------
+
+struct WriteBehindSink::State {
+    struct Block {
+        uint64_t offset = 0;
+        std::vector<uint8_t> data;
+    };
+
+    State(std::unique_ptr<WriteSink> wrapped, size_t max_pending)
+        : sink(std::move(wrapped)), max_pending_bytes(max_pending) {}
+
+    bool HasRoom() const { return failed || pending_bytes <= max_pending_bytes; }
+
+    // Calls and clears a notifier; called with the state locked
+    static void Notify(std::function<void()>& notifier) {
+        if (notifier) {
+            std::function<void()> callback = std::move(notifier);
+            notifier = nullptr;
+            callback();
+        }
+    }
+
+    void DropBlocks() {
+        for (Block& block : blocks) {
+            pending_bytes -= block.data.size();
+            Recycle(spare, block.data);
+        }
+        blocks.clear();
+    }
+
+    std::unique_ptr<WriteSink> sink;
+    std::mutex mutex;
+    std::condition_variable changed;           // Signalled after every write and when a drain ends
+    std::deque<Block> blocks;                  // Not written yet, in order
+    std::vector<std::vector<uint8_t>> spare;
+    const size_t max_pending_bytes;
+    size_t pending_bytes = 0;                  // Queued blocks and the block being written
+    bool draining = false;                     // A drain is queued or running
+    bool failed = false;
+    bool abort_pending = false;                // Aborted during a drain, which aborts the sink
+    bool commit_pending = false;               // The drain commits once the blocks are written
+    CommitState commit_state = CommitState::kNone;
+    std::function<void()> room_notifier;       // Transfer holding its ACK until HasRoom
+    std::function<void()> commit_notifier;     // Transfer waiting for the commit
+};
+
+WriteBehindSink::WriteBehindSink(std::unique_ptr<WriteSink> sink, std::shared_ptr<IoStage> stage,
+                                 size_t max_pending_bytes)
+    : state_(std::make_shared<State>(std::move(sink), max_pending_bytes)),
+      stage_(std::move(stage)) {
+}
+
+WriteBehindSink::~WriteBehindSink() {
+    Abort();
+}
+
+bool WriteBehindSink::Open(const std::string& path, uint64_t size_hint) {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->changed.wait(lock, [this]() { return !state_->draining; });
+    state_->DropBlocks();
+    state_->failed = false;
+    state_->commit_state = CommitState::kNone;
+    return state_->sink->Open(path, size_hint);
+}
+
+bool WriteBehindSink::Write(uint64_t offset, const uint8_t* data, size_t length) {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    if (state_->failed) {
+        return false;
+    }
+    State::Block block;
+    block.offset = offset;
+    block.data = TakeSpare(state_->spare);
+    block.data.assign(data, data + length);
+    state_->blocks.push_back(std::move(block));
+    state_->pending_bytes += length;
+    if (state_->draining) {
+        return true;
+    }
+    state_->draining = true;
+    std::shared_ptr<State> shared = state_;
+    if (stage_->Post([shared]() { Drain(shared); })) {
+        return true;
+    }
+    // The stage is shutting down: write in this thread
+    lock.unlock();
+    Drain(state_);
+    lock.lock();
+    return !state_->failed;
+}
+
+bool WriteBehindSink::Commit() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->changed.wait(lock, [this]() { return !state_->draining; });
+    bool failed = state_->failed;
+    lock.unlock();
+    if (failed) {
+        state_->sink->Abort();
+        return false;
+    }
+    return state_->sink->Commit();
+}
+
+bool WriteBehindSink::WaitForRoom(std::function<void()> notifier) {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    if (!notifier) {
+        state_->changed.wait(lock, [this]() { return state_->HasRoom(); });
+        return true;
+    }
+    if (state_->HasRoom()) {
+        return true;
+    }
+    state_->room_notifier = std::move(notifier);
+    return false;
+}
+
+void WriteBehindSink::CommitAsync(std::function<void()> notifier) {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->commit_pending = true;
+    state_->commit_state = CommitState::kPending;
+    state_->commit_notifier = std::move(notifier);
+    if (state_->draining) {
+        return;
+    }
+    state_->draining = true;
+    std::shared_ptr<State> shared = state_;
+    if (!stage_->Post([shared]() { Drain(shared); })) {
+        // The stage is shutting down: commit in this thread
+        lock.unlock();
+        Drain(state_);
+    }
+}
+
+WriteBehindSink::CommitState WriteBehindSink::GetCommitState() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->commit_state;
+}
+
+void WriteBehindSink::Abort() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->DropBlocks();
+    if (state_->draining) {
+        state_->abort_pending = true;
+        return;
+    }
+    state_->sink->Abort();
+}
+
+void WriteBehindSink::Drain(const std::shared_ptr<State>& state) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!state->blocks.empty() && !state->abort_pending) {
+        State::Block block = std::move(state->blocks.front());
+        state->blocks.pop_front();
+        lock.unlock();
+
+        bool ok = state->sink->Write(block.offset, block.data.data(), block.data.size());
+
+        lock.lock();
+        state->pending_bytes -= block.data.size();
+        Recycle(state->spare, block.data);
+        if (!ok) {
+            state->failed = true;
+            state->DropBlocks();
+        }
+        if (state->HasRoom()) {
+            State::Notify(state->room_notifier);
+        }
+        state->changed.notify_all();
+    }
+    if (state->commit_pending && !state->abort_pending) {
+        // Whatever was queued is on disk (or failed); the commit (fsync, rename) also runs here
+        state->commit_pending = false;
+        bool failed = state->failed;
+        lock.unlock();
+        bool ok = false;
+        if (failed) {
+            state->sink->Abort();
+        } else {
+            ok = state->sink->Commit();
+        }
+        lock.lock();
+        state->commit_state = ok ? CommitState::kSucceeded : CommitState::kFailed;
+        State::Notify(state->commit_notifier);
+    }
+    if (state->abort_pending) {
+        lock.unlock();
+        state->sink->Abort();
+        lock.lock();
+        state->abort_pending = false;
+        if (state->commit_pending) {
+            state->commit_pending = false;
+            state->commit_state = CommitState::kFailed;
+            State::Notify(state->commit_notifier);
+        }
+    }
+    state->draining = false;
+    state->changed.notify_all();
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,189 @@
+/**
+ * @file tftp_io_stage.h
+ * @brief Disk I/O off the network path: read-ahead for RRQ sources, write-behind for WRQ sinks
+ */
+
+#ifndef TFTP_IO_STAGE_H_
+#define TFTP_IO_STAGE_H_
+
+#include "tftp/tftp_file_io.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+class TftpThreadPool;
+
+/**
+ * @brief Threads that run the disk reads and writes of ReadAheadSource and WriteBehindSink
+ *
+ * The threads are started by the first Post, so a server that never enables asynchronous file
+ * I/O never creates them. Jobs still queued when the stage is destroyed are dropped; the
+ * sources and sinks they belong to are then released with them.
+ */
+class IoStage {
+public:
+    explicit IoStage(size_t thread_count);
+    ~IoStage();
+
+    // Disable copy
+    IoStage(const IoStage&) = delete;
+    IoStage& operator=(const IoStage&) = delete;
+
+    // Runs job on an I/O thread; false if the stage is shutting down (the job is not run)
+    bool Post(std::function<void()> job);
+
+private:
+    size_t thread_count_;
+    std::once_flag start_once_;
+    std::unique_ptr<TftpThreadPool> pool_;
+};
+
+/**
+ * @brief Hands finished disk work from the I/O stage back to the thread driving the transfers
+ *
+ * A transfer that waits for the I/O stage is woken through a notifier made here: the I/O
+ * thread marks the transfer's id ready and calls wake, and the driving thread takes the ready
+ * ids and resumes those transfers (Transfer::HandleIoReady). A notifier may run after its
+ * transfer, or the engine, has gone away; once Close has returned it does nothing.
+ */
+class IoCompletions {
+public:
+    // wake is called on the I/O thread, with the lock held, after an id is marked (optional)
+    explicit IoCompletions(std::function<void()> wake = nullptr);
+
+    // Disable copy
+    IoCompletions(const IoCompletions&) = delete;
+    IoCompletions& operator=(const IoCompletions&) = delete;
+
+    // Notifier marking id ready, callable from any thread
+    static std::function<void()> Notifier(const std::shared_ptr<IoCompletions>& completions, uint64_t id);
+
+    // Moves the ready ids into ids, in the order they were marked
+    void Take(std::vector<uint64_t>& ids);
+    // Waits up to timeout for an id to be marked; for engines without a wake socket
+    bool Wait(std::chrono::milliseconds timeout);
+    // Notifiers do nothing afterwards
+    void Close();
+
+private:
+    void Mark(uint64_t id);
+
+    std::function<void()> wake_;
+    std::mutex mutex_;
+    std::condition_variable marked_;
+    std::vector<uint64_t> ready_;
+    bool closed_;
+};
+
+/**
+ * @brief ReadSource that keeps the next windows of a transfer read ahead on the I/O stage
+ *
+ * Every ReadBatch serves what it can from chunks filled in the background, one chunk per
+ * send window, reads the rest from the wrapped source itself, then asks for the windows
+ * behind it. So a sequential transfer finds its blocks in memory, and only a transfer that
+ * jumps (a retransmission of a dropped chunk) reads synchronously. A transfer that outruns the
+ * disk asks WhenReady first and is notified once the fetch gets there, and Prefetch right
+ * after Open starts reading the first windows before the first ReadBatch. The wrapped source
+ * is read from two threads at once and must allow it, as the built-in file sources do; blocks
+ * it lends with PeekAt are passed through without reading ahead.
+ */
+class ReadAheadSource : public ReadSource {
+public:
+    static constexpr size_t kMaxChunkSize = 1024 * 1024;
+
+    ReadAheadSource(std::unique_ptr<ReadSource> source, std::shared_ptr<IoStage> stage, size_t windows);
+    ~ReadAheadSource() override;
+
+    // Disable copy
+    ReadAheadSource(const ReadAheadSource&) = delete;
+    ReadAheadSource& operator=(const ReadAheadSource&) = delete;
+
+    bool Open(const std::string& path) override;
+    bool Stat(const std::string& path, uint64_t& size) override;
+    uint64_t Size() const override;
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override;
+    bool ReadBatch(ReadRequest* requests, size_t count) override;
+    // Reads ahead from offset in chunks of length (one send window), without waiting
+    void Prefetch(uint64_t offset, size_t length) override;
+    const uint8_t* PeekAt(uint64_t offset, size_t length) override;
+    // Returns at once: a chunk still being read closes the wrapped source when it completes
+    void Close() override;
+
+    // False while the fetch in flight has yet to read offset; notifier is then called (on an
+    // I/O thread) once it has. True when waiting would not help: the byte is in memory, or it
+    // will only be read by ReadBatch itself
+    bool WhenReady(uint64_t offset, std::function<void()> notifier);
+
+private:
+    struct State;
+
+    // Queues a fetch if the read-ahead is behind its target; called with the state locked
+    void StartFetchLocked();
+    // Fills chunks up to the requested end; runs on the I/O stage
+    static void Fetch(const std::shared_ptr<State>& state);
+
+    std::shared_ptr<State> state_;  // Shared with the queued fetch, which may outlive this source
+    std::shared_ptr<IoStage> stage_;
+    size_t windows_;
+    std::vector<ReadRequest> misses_;
+    std::vector<size_t> miss_index_;
+};
+
+/**
+ * @brief WriteSink that hands blocks to the wrapped sink on the I/O stage
+ *
+ * Write copies the block and returns, so the ACK does not wait for the disk. Write never
+ * blocks: a transfer keeps the backlog within max_pending_bytes by asking WaitForRoom before
+ * each ACK and holding the ACK back until notified, which slows the upload down to the disk's
+ * pace. CommitAsync runs the remaining writes and the commit (fsync, rename) on the I/O stage.
+ * A failed background write fails the next Write or the commit.
+ */
+class WriteBehindSink : public WriteSink {
+public:
+    WriteBehindSink(std::unique_ptr<WriteSink> sink, std::shared_ptr<IoStage> stage, size_t max_pending_bytes);
+    ~WriteBehindSink() override;
+
+    // Disable copy
+    WriteBehindSink(const WriteBehindSink&) = delete;
+    WriteBehindSink& operator=(const WriteBehindSink&) = delete;
+
+    bool Open(const std::string& path, uint64_t size_hint) override;
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override;
+    // Waits for every block to be written, then commits in the calling thread
+    bool Commit() override;
+    // Drops the blocks not written yet; a block being written aborts the wrapped sink when it completes
+    void Abort() override;
+
+    enum class CommitState { kNone, kPending, kSucceeded, kFailed };
+
+    // True if no more than max_pending_bytes wait to be written. Otherwise notifier is called
+    // (on an I/O thread) once the disk has caught up or a write has failed; without a notifier
+    // this waits for it instead
+    bool WaitForRoom(std::function<void()> notifier);
+    // Commits behind the queued blocks on the I/O stage; notifier is called when it is done
+    void CommitAsync(std::function<void()> notifier);
+    CommitState GetCommitState() const;
+
+private:
+    struct State;
+
+    // Writes queued blocks in order until none is left; runs on the I/O stage
+    static void Drain(const std::shared_ptr<State>& state);
+
+    std::shared_ptr<State> state_;  // Shared with the queued drain, which may outlive this sink
+    std::shared_ptr<IoStage> stage_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_IO_STAGE_H_
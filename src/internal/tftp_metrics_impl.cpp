@@ -0,0 +1,310 @@
+/**
+ * @file tftp_metrics_impl.cpp
+ * @brief Lock-free metric recording and the Prometheus scrape endpoint
+ */
+
+#include "internal/tftp_metrics_impl.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define CLOSESOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#define CLOSESOCKET close
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr int kAcceptPollMs = 200;     // Stop() latency of the endpoint thread
+constexpr int kClientTimeoutMs = 1000; // A scraper that does not send its request in time is dropped
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // A scraper hanging up must not raise SIGPIPE
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+int FloorLog2(uint64_t value) {
+    int result = 0;
+    while (value >>= 1) {
+        ++result;
+    }
+    return result;
+}
+
+// Shard of the calling thread: the current CPU where the kernel tells us cheaply,
+// otherwise a per-thread slot handed out round robin
+size_t CurrentShard() {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return static_cast<size_t>(cpu) % Metrics::kShardCount;
+    }
+#endif
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % Metrics::kShardCount;
+    return shard;
+}
+
+void AtomicMin(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void AtomicMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Histogram
+// ---------------------------------------------------------------------------
+
+Histogram::Histogram()
+    : sum_(0), min_(std::numeric_limits<uint64_t>::max()), max_(0) {
+    for (std::atomic<uint64_t>& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t Histogram::BucketIndex(uint64_t value_us) {
+    if (value_us < kSubBuckets) {
+        return static_cast<size_t>(value_us);
+    }
+    size_t exponent = static_cast<size_t>(FloorLog2(value_us));
+    if (exponent > kMaxExponent) {
+        return kBucketCount - 1;
+    }
+    size_t sub_bucket = static_cast<size_t>(value_us >> (exponent - 3)) & (kSubBuckets - 1);
+    return kSubBuckets + (exponent - 3) * kSubBuckets + sub_bucket;
+}
+
+uint64_t Histogram::BucketUpperBound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    size_t shift = (index - kSubBuckets) / kSubBuckets;
+    uint64_t sub_bucket = (index - kSubBuckets) % kSubBuckets;
+    uint64_t lower = (kSubBuckets + sub_bucket) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value_us) {
+    buckets_[BucketIndex(value_us)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value_us, std::memory_order_relaxed);
+    AtomicMin(min_, value_us);
+    AtomicMax(max_, value_us);
+}
+
+HistogramStats Histogram::Snapshot() const {
+    HistogramStats stats;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        uint64_t samples = buckets_[i].load(std::memory_order_relaxed);
+        if (samples > 0) {
+            stats.buckets.emplace_back(BucketUpperBound(i), samples);
+            stats.count += samples;
+        }
+    }
+    // count is summed from the buckets, so it always agrees with them even mid-update
+    stats.sum_us = sum_.load(std::memory_order_relaxed);
+    stats.max_us = max_.load(std::memory_order_relaxed);
+    stats.min_us = stats.count > 0 ? std::min(min_.load(std::memory_order_relaxed), stats.max_us) : 0;
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// Metrics
+// ---------------------------------------------------------------------------
+
+void Metrics::Add(Counter counter, uint64_t value) {
+    shards_[CurrentShard()].values[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Metrics::CountError(ErrorCode code) {
+    size_t index = std::min<size_t>(static_cast<size_t>(code), kErrorCodeCount - 1);
+    Add(static_cast<Counter>(kFirstError + index));
+}
+
+ServerStats Metrics::Snapshot() const {
+    std::array<uint64_t, kCounterCount> totals{};
+    for (const Shard& shard : shards_) {
+        for (size_t i = 0; i < kCounterCount; ++i) {
+            totals[i] += shard.values[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    ServerStats stats;
+    stats.bytes_sent = totals[kBytesSent];
+    stats.bytes_received = totals[kBytesReceived];
+    stats.packets_sent = totals[kPacketsSent];
+    stats.packets_received = totals[kPacketsReceived];
+    stats.retransmits = totals[kRetransmits];
+    stats.timeouts = totals[kTimeouts];
+    for (size_t i = 0; i < kErrorCodeCount; ++i) {
+        stats.errors[i] = totals[kFirstError + i];
+    }
+    stats.transfers_started = totals[kTransfersStarted];
+    stats.transfers_completed = totals[kTransfersCompleted];
+    stats.transfers_failed = totals[kTransfersFailed];
+    uint64_t finished = stats.transfers_completed + stats.transfers_failed;
+    stats.active_sessions = stats.transfers_started > finished ? stats.transfers_started - finished : 0;
+
+    stats.time_to_first_byte = time_to_first_byte_.Snapshot();
+    stats.ack_rtt = ack_rtt_.Snapshot();
+    stats.transfer_duration = transfer_duration_.Snapshot();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// MetricsEndpoint
+// ---------------------------------------------------------------------------
+
+MetricsEndpoint::MetricsEndpoint(Renderer renderer)
+    : renderer_(std::move(renderer)), sock_(kInvalidSocket), port_(0), running_(false) {
+}
+
+MetricsEndpoint::~MetricsEndpoint() {
+    Stop();
+}
+
+bool MetricsEndpoint::Start(uint16_t port) {
+    if (running_) {
+        return true;
+    }
+
+    socket_t sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == kInvalidSocket) {
+        TFTP_ERROR("Metrics endpoint: socket creation failed");
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(sock, 16) != 0) {
+        TFTP_ERROR("Metrics endpoint: cannot listen on TCP port %u", port);
+        CLOSESOCKET(sock);
+        return false;
+    }
+
+#ifdef _WIN32
+    int addr_len = sizeof(addr);
+#else
+    socklen_t addr_len = sizeof(addr);
+#endif
+    getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+    port_ = ntohs(addr.sin_port);
+    sock_ = sock;
+
+    running_ = true;
+    thread_ = std::thread(&MetricsEndpoint::Run, this);
+    TFTP_INFO("Metrics endpoint listening on TCP port %u", port_);
+    return true;
+}
+
+void MetricsEndpoint::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    CLOSESOCKET(sock_);
+    sock_ = kInvalidSocket;
+}
+
+void MetricsEndpoint::Run() {
+    while (running_) {
+#ifdef _WIN32
+        WSAPOLLFD pfd = {};
+        pfd.fd = sock_;
+        pfd.events = POLLRDNORM;
+        int ready = WSAPoll(&pfd, 1, kAcceptPollMs);
+#else
+        pollfd pfd = {};
+        pfd.fd = sock_;
+        pfd.events = POLLIN;
+        int ready = poll(&pfd, 1, kAcceptPollMs);
+#endif
+        if (ready <= 0) {
+            continue;
+        }
+        socket_t client = accept(sock_, nullptr, nullptr);
+        if (client == kInvalidSocket) {
+            continue;
+        }
+        Serve(client);
+        CLOSESOCKET(client);
+    }
+}
+
+void MetricsEndpoint::Serve(socket_t client) {
+    // Read until the end of the request header; its content does not matter
+    char request[1024];
+    size_t received = 0;
+    while (received < sizeof(request)) {
+#ifdef _WIN32
+        WSAPOLLFD pfd = {};
+        pfd.fd = client;
+        pfd.events = POLLRDNORM;
+        if (WSAPoll(&pfd, 1, kClientTimeoutMs) <= 0) {
+            return;
+        }
+#else
+        pollfd pfd = {};
+        pfd.fd = client;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, kClientTimeoutMs) <= 0) {
+            return;
+        }
+#endif
+        int n = recv(client, request + received, static_cast<int>(sizeof(request) - received), 0);
+        if (n <= 0) {
+            return;
+        }
+        received += static_cast<size_t>(n);
+        if (std::string(request, received).find("\r\n\r\n") != std::string::npos) {
+            break;
+        }
+    }
+
+    std::string body = renderer_();
+    std::string response = "HTTP/1.0 200 OK\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int n = send(client, response.data() + sent, static_cast<int>(response.size() - sent), kSendFlags);
+        if (n <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,134 @@
+/**
+ * @file tftp_metrics_impl.h
+ * @brief Lock-free metric recording and the Prometheus scrape endpoint
+ */
+
+#ifndef TFTP_METRICS_IMPL_H_
+#define TFTP_METRICS_IMPL_H_
+
+#include "tftp/tftp_common.h"
+#include "tftp/tftp_metrics.h"
+#include "tftp/tftp_socket.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Latency histogram with log-linear buckets: values below 8 are exact, above that
+ *        every power of two is split into 8 sub-buckets. Recording is a few relaxed atomics.
+ */
+class Histogram {
+public:
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr size_t kMaxExponent = 39;  // Values up to 2^40 us (12 days) are kept apart
+    static constexpr size_t kBucketCount = kSubBuckets + (kMaxExponent - 2) * kSubBuckets;
+
+    Histogram();
+
+    void Record(uint64_t value_us);
+    HistogramStats Snapshot() const;
+
+    static size_t BucketIndex(uint64_t value_us);
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
+
+/**
+ * @brief Server counters and histograms shared by all transfers
+ *
+ * Counters are spread over cache-line sized shards picked per thread, so concurrent
+ * transfers on different cores do not contend on the same line; Snapshot sums them.
+ */
+class Metrics {
+public:
+    enum Counter : size_t {
+        kBytesSent,
+        kBytesReceived,
+        kPacketsSent,
+        kPacketsReceived,
+        kRetransmits,
+        kTimeouts,
+        kTransfersStarted,
+        kTransfersCompleted,
+        kTransfersFailed,
+        kFirstError,  // kErrorCodeCount counters, one per ErrorCode
+        kCounterCount = kFirstError + kErrorCodeCount
+    };
+
+    static constexpr size_t kShardCount = 16;
+
+    Metrics() = default;
+
+    // Disable copy
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void Add(Counter counter, uint64_t value = 1);
+    void CountError(ErrorCode code);
+
+    Histogram& TimeToFirstByte() { return time_to_first_byte_; }
+    Histogram& AckRtt() { return ack_rtt_; }
+    Histogram& TransferDuration() { return transfer_duration_; }
+
+    // Counters and histograms; the pool fields are left for the caller
+    ServerStats Snapshot() const;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kCounterCount> values{};
+    };
+
+    std::array<Shard, kShardCount> shards_;
+    Histogram time_to_first_byte_;
+    Histogram ack_rtt_;
+    Histogram transfer_duration_;
+};
+
+/**
+ * @brief Minimal HTTP/1.0 responder serving one text document to every request
+ *        (Prometheus scrapes); runs a single accept thread
+ */
+class MetricsEndpoint {
+public:
+    using Renderer = std::function<std::string()>;
+
+    explicit MetricsEndpoint(Renderer renderer);
+    ~MetricsEndpoint();
+
+    // Disable copy
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+    // Listens on TCP port (0 picks a free port); false if the socket cannot be bound
+    bool Start(uint16_t port);
+    void Stop();
+
+    uint16_t GetPort() const { return port_; }
+
+private:
+    void Run();
+    void Serve(socket_t client);
+
+    Renderer renderer_;
+    socket_t sock_;
+    uint16_t port_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_METRICS_IMPL_H_
@@ -0,0 +1,357 @@
+/**
+ * @file tftp_multicast.cpp
+ * @brief Multicast TFTP (RFC 2090): one DATA stream per file shared by every client reading it
+ */
+
+#include "internal/tftp_multicast.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+bool IsMulticastOptionName(std::string_view name) {
+    return name.size() == sizeof(kMulticastOptionName) - 1 &&
+           std::equal(name.begin(), name.end(), kMulticastOptionName, [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == b;
+           });
+}
+
+std::string FormatEndpoint(const sockaddr_in& addr) {
+    char host[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &addr.sin_addr, host, sizeof(host));
+    return std::string(host) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+} // namespace
+
+bool IsMulticastRequest(const TftpPacket& request) {
+    for (const auto& option : request.GetOptions()) {
+        if (IsMulticastOptionName(option.first)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IsMulticastRequest(const PacketView& request) {
+    for (size_t i = 0; i < request.GetOptionCount(); ++i) {
+        if (IsMulticastOptionName(request.GetOption(i).first)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// MulticastGroupLease
+// ---------------------------------------------------------------------------
+
+MulticastGroupLease::MulticastGroupLease(MulticastGroupLease&& other) noexcept
+    : pool_(other.pool_), slot_(other.slot_), address_(other.address_) {
+    other.pool_ = nullptr;
+}
+
+MulticastGroupLease& MulticastGroupLease::operator=(MulticastGroupLease&& other) noexcept {
+    if (this != &other) {
+        Release();
+        pool_ = other.pool_;
+        slot_ = other.slot_;
+        address_ = other.address_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+void MulticastGroupLease::Release() {
+    if (pool_) {
+        pool_->Release(slot_);
+        pool_ = nullptr;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// MulticastGroupPool
+// ---------------------------------------------------------------------------
+
+bool MulticastGroupPool::Configure(const std::string& address, uint16_t first_port, size_t port_count) {
+    if (port_count == 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_use_.clear();
+        return true;
+    }
+
+    in_addr group = {};
+    if (inet_pton(AF_INET, address.c_str(), &group) != 1 || (ntohl(group.s_addr) >> 28) != 0xE) {
+        TFTP_ERROR("Not an IPv4 multicast address: %s", address.c_str());
+        return false;
+    }
+    if (first_port == 0 || first_port + port_count - 1 > 65535) {
+        TFTP_ERROR("Invalid multicast port range: %u + %zu", first_port, port_count);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    address_ = group.s_addr;
+    first_port_ = first_port;
+    in_use_.assign(port_count, false);
+    return true;
+}
+
+bool MulticastGroupPool::IsEnabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !in_use_.empty();
+}
+
+MulticastGroupLease MulticastGroupPool::Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto free_slot = std::find(in_use_.begin(), in_use_.end(), false);
+    if (free_slot == in_use_.end()) {
+        return MulticastGroupLease();
+    }
+    *free_slot = true;
+    size_t slot = static_cast<size_t>(free_slot - in_use_.begin());
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = address_;
+    address.sin_port = htons(static_cast<uint16_t>(first_port_ + slot));
+    return MulticastGroupLease(this, slot, address);
+}
+
+void MulticastGroupPool::Release(size_t slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The pool may have been reconfigured since the lease was handed out
+    if (slot < in_use_.size()) {
+        in_use_[slot] = false;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// MulticastTransfer
+// ---------------------------------------------------------------------------
+
+MulticastTransfer::MulticastTransfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config,
+                                     const TftpPacket& request, std::unique_ptr<ReadSource> source,
+                                     MulticastGroupLease group)
+    : Transfer(channel, peer, std::move(config)),
+      source_(std::move(source)),
+      group_(std::move(group)),
+      source_open_(false),
+      file_size_(0),
+      total_blocks_(0),
+      master_block_(0),
+      completed_(0) {
+    NegotiateOptions(request, options_, oack_options_);
+    ApplyNegotiatedTimeout();
+    // RFC 2090 is lock-step: the master acknowledges every block
+    options_.window_size = 1;
+    oack_options_.erase("windowsize");
+    members_.push_back(peer);
+}
+
+MulticastTransfer::~MulticastTransfer() {
+    if (source_open_) {
+        source_->Close();
+    }
+}
+
+void MulticastTransfer::Start(Clock::time_point now) {
+    TFTP_INFO("Multicast read request: %s (group %s)", config_.filepath.c_str(),
+             FormatEndpoint(group_.Address()).c_str());
+
+    if (!source_ || !source_->Open(config_.filepath)) {
+        Fail(ErrorCode::kFileNotFound, "File not found");
+        return;
+    }
+    source_open_ = true;
+
+    file_size_ = source_->Size();
+    if (file_size_ > config_.max_size) {
+        Fail(ErrorCode::kDiskFull, "File size too large");
+        return;
+    }
+    // A promoted master reports the blocks it holds with a bare 16-bit ACK, which is only
+    // unambiguous while block numbers do not wrap
+    uint64_t total_blocks = file_size_ / options_.block_size + 1;
+    if (total_blocks > 0xFFFF) {
+        Fail(ErrorCode::kIllegalOperation, "File too large for multicast");
+        return;
+    }
+    total_blocks_ = static_cast<uint16_t>(total_blocks);
+    send_buffer_.resize(options_.block_size + codec::kHeaderSize);
+    AnswerTransferSize(file_size_);
+
+    if (SendOack(members_.front(), true)) {
+        StartRound(now);
+    }
+}
+
+bool MulticastTransfer::Join(const sockaddr_in& client) {
+    if (IsFinished()) {
+        return false;
+    }
+    auto member = FindMember(client);
+    if (member != members_.end()) {
+        // The client missed its OACK and repeated the request
+        SendOack(client, member == members_.begin());
+        return true;
+    }
+    members_.push_back(client);
+    TFTP_INFO("Client %s joined multicast transfer of %s (%zu members)", FormatEndpoint(client).c_str(),
+             config_.filepath.c_str(), members_.size());
+    SendOack(client, false);
+    return true;
+}
+
+void MulticastTransfer::OnPacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) {
+    if (packet.GetOpCode() != OpCode::kAcknowledge) {
+        TFTP_WARN("Ignoring unexpected packet in multicast transfer: OpCode=%d", static_cast<int>(packet.GetOpCode()));
+        return;
+    }
+    // Only the master acknowledges; anything else comes from a client that was demoted meanwhile
+    if (!SameEndpoint(from, members_.front())) {
+        return;
+    }
+
+    uint16_t acked = packet.GetBlockNumber();
+    if (acked > total_blocks_) {
+        TFTP_WARN("Ignoring ACK #%d beyond the last block", acked);
+        return;
+    }
+    if (acked == total_blocks_) {
+        TFTP_INFO("Multicast client %s completed %s", FormatEndpoint(from).c_str(), config_.filepath.c_str());
+        RemoveMaster(true, now);
+        return;
+    }
+    // RFC 1123: a duplicate ACK is not answered, the retransmission timer recovers
+    if (master_block_ != 0 && static_cast<uint16_t>(acked + 1) == master_block_) {
+        return;
+    }
+
+    SampleRound(now);
+    master_block_ = static_cast<uint16_t>(acked + 1);
+    if (SendBlock(master_block_)) {
+        RecordFirstByte(now);
+        StartRound(now);
+    }
+}
+
+bool MulticastTransfer::IsPeer(const sockaddr_in& from) const {
+    return std::any_of(members_.begin(), members_.end(),
+                       [&from](const sockaddr_in& member) { return SameEndpoint(member, from); });
+}
+
+void MulticastTransfer::OnPeerError(const PacketView& packet, const sockaddr_in& from) {
+    std::string_view message = packet.GetErrorMessage();
+    TFTP_INFO("Client %s left multicast transfer: %.*s", FormatEndpoint(from).c_str(),
+             static_cast<int>(message.size()), message.data());
+    auto member = FindMember(from);
+    if (member == members_.begin()) {
+        RemoveMaster(false, Clock::now());
+    } else if (member != members_.end()) {
+        members_.erase(member);
+    }
+}
+
+void MulticastTransfer::OnTimeout(Clock::time_point now) {
+    if (!ConsumeRetry(now)) {
+        TFTP_WARN("Multicast master %s not responding, dropping it", FormatEndpoint(members_.front()).c_str());
+        RemoveMaster(false, now);
+        return;
+    }
+
+    if (master_block_ == 0) {
+        TFTP_WARN("Multicast OACK acknowledgement timeout, resending OACK (%d)", retries_);
+        if (SendOack(members_.front(), true)) {
+            CountMetric(Metrics::kRetransmits);
+        }
+        return;
+    }
+    TFTP_WARN("Multicast ACK timeout, resending block %d (%d)", master_block_, retries_);
+    if (SendBlock(master_block_)) {
+        CountMetric(Metrics::kRetransmits);
+    }
+}
+
+bool MulticastTransfer::SendOack(const sockaddr_in& client, bool master) {
+    const sockaddr_in& group = group_.Address();
+    char host[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &group.sin_addr, host, sizeof(host));
+
+    // RFC 2090: "multicast=<addr>,<port>,<mc>" with mc = 1 for the master client
+    std::unordered_map<std::string, std::string> options = oack_options_;
+    options[kMulticastOptionName] = std::string(host) + "," + std::to_string(ntohs(group.sin_port)) + (master ? ",1" : ",0");
+    std::vector<uint8_t> data = TftpPacket::CreateOACK(options).Serialize();
+    if (!channel_.SendTo(client, data.data(), data.size())) {
+        TFTP_WARN("Multicast OACK to %s failed", FormatEndpoint(client).c_str());
+        return false;
+    }
+    CountMetric(Metrics::kPacketsSent);
+    return true;
+}
+
+bool MulticastTransfer::SendBlock(uint16_t block) {
+    uint64_t offset = static_cast<uint64_t>(block - 1) * options_.block_size;
+    size_t block_size = static_cast<size_t>(std::min<uint64_t>(options_.block_size, file_size_ - offset));
+    size_t bytes_read = 0;
+    if (!source_->ReadAt(offset, send_buffer_.data() + codec::kHeaderSize, block_size, bytes_read) ||
+        bytes_read != block_size) {
+        TFTP_ERROR("Read source failed at offset %llu: %s",
+                  static_cast<unsigned long long>(offset), config_.filepath.c_str());
+        Fail(ErrorCode::kNotDefined, "File read error");
+        return false;
+    }
+    codec::EncodeDataHeader(send_buffer_.data(), block);
+
+    if (!channel_.SendTo(group_.Address(), send_buffer_.data(), codec::kHeaderSize + block_size)) {
+        TFTP_ERROR("Multicast send to %s failed, aborting transfer: %s",
+                  FormatEndpoint(group_.Address()).c_str(), config_.filepath.c_str());
+        Finish();
+        return false;
+    }
+    CountMetric(Metrics::kPacketsSent);
+    CountMetric(Metrics::kBytesSent, block_size);
+    return true;
+}
+
+void MulticastTransfer::RemoveMaster(bool completed, Clock::time_point now) {
+    members_.erase(members_.begin());
+    if (completed) {
+        completed_++;
+    }
+    if (members_.empty()) {
+        TFTP_INFO("Multicast transfer of %s finished: %zu clients completed", config_.filepath.c_str(), completed_);
+        if (completed_ > 0) {
+            Complete();
+        } else {
+            Finish();
+        }
+        return;
+    }
+    Promote(now);
+}
+
+void MulticastTransfer::Promote(Clock::time_point now) {
+    // The new master answers with the last block it holds in sequence, and continues from there
+    master_block_ = 0;
+    TFTP_INFO("Promoting %s to multicast master", FormatEndpoint(members_.front()).c_str());
+    SendOack(members_.front(), true);
+    StartRound(now);
+}
+
+std::vector<sockaddr_in>::iterator MulticastTransfer::FindMember(const sockaddr_in& client) {
+    return std::find_if(members_.begin(), members_.end(),
+                        [&client](const sockaddr_in& member) { return SameEndpoint(member, client); });
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,149 @@
+/**
+ * @file tftp_multicast.h
+ * @brief Multicast TFTP (RFC 2090): one DATA stream per file shared by every client reading it
+ */
+
+#ifndef TFTP_MULTICAST_H_
+#define TFTP_MULTICAST_H_
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include "tftp/tftp_file_io.h"
+#include "tftp/tftp_packet.h"
+#include "tftp/tftp_packet_view.h"
+#include "internal/tftp_transfer.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+// Whether an RRQ asks for the multicast option (option names are case-insensitive)
+bool IsMulticastRequest(const TftpPacket& request);
+bool IsMulticastRequest(const PacketView& request);
+
+class MulticastGroupPool;
+
+/**
+ * @brief Movable handle on a group address of the pool; the address is returned on release
+ */
+class MulticastGroupLease {
+public:
+    MulticastGroupLease() = default;
+    ~MulticastGroupLease() { Release(); }
+
+    MulticastGroupLease(MulticastGroupLease&& other) noexcept;
+    MulticastGroupLease& operator=(MulticastGroupLease&& other) noexcept;
+
+    // Disable copy
+    MulticastGroupLease(const MulticastGroupLease&) = delete;
+    MulticastGroupLease& operator=(const MulticastGroupLease&) = delete;
+
+    explicit operator bool() const { return pool_ != nullptr; }
+    const sockaddr_in& Address() const { return address_; }
+    void Release();
+
+private:
+    friend class MulticastGroupPool;
+    MulticastGroupLease(MulticastGroupPool* pool, size_t slot, const sockaddr_in& address)
+        : pool_(pool), slot_(slot), address_(address) {}
+
+    MulticastGroupPool* pool_ = nullptr;
+    size_t slot_ = 0;
+    sockaddr_in address_ = {};
+};
+
+/**
+ * @brief Group addresses handed to multicast transfers: one IPv4 multicast address with a
+ *        range of ports, one port per file being multicast
+ *
+ * The pool must outlive every lease it hands out.
+ */
+class MulticastGroupPool {
+public:
+    MulticastGroupPool() = default;
+
+    // Disable copy
+    MulticastGroupPool(const MulticastGroupPool&) = delete;
+    MulticastGroupPool& operator=(const MulticastGroupPool&) = delete;
+
+    // address must be an IPv4 multicast address; port_count 0 disables multicast.
+    // Groups already handed out keep their address
+    bool Configure(const std::string& address, uint16_t first_port, size_t port_count);
+    bool IsEnabled() const;
+
+    // Empty lease when multicast is disabled or every port is in use
+    MulticastGroupLease Acquire();
+
+private:
+    friend class MulticastGroupLease;
+    void Release(size_t slot);
+
+    mutable std::mutex mutex_;
+    uint32_t address_ = 0;  // Network byte order
+    uint16_t first_port_ = 0;
+    std::vector<bool> in_use_;
+};
+
+/**
+ * @brief RRQ served to a group of clients (RFC 2090)
+ *
+ * DATA goes to the group address; only the master client (the oldest member) acknowledges,
+ * and the next block follows its ACK. When the master leaves or finishes, the next member is
+ * promoted with an OACK and requests the blocks it missed, so late joiners catch up from the
+ * same stream. The transfer ends when the last member has left.
+ */
+class MulticastTransfer : public Transfer {
+public:
+    MulticastTransfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config,
+                      const TftpPacket& request, std::unique_ptr<ReadSource> source, MulticastGroupLease group);
+    ~MulticastTransfer() override;
+
+    void Start(Clock::time_point now) override;
+    void OnTimeout(Clock::time_point now) override;
+
+    // Adds a client reading the same file; a member asking again is sent its OACK again.
+    // False once the transfer has finished
+    bool Join(const sockaddr_in& client);
+
+    size_t GetMemberCount() const { return members_.size(); }
+    const sockaddr_in& GetGroupAddress() const { return group_.Address(); }
+
+protected:
+    void OnPacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) override;
+    bool IsPeer(const sockaddr_in& from) const override;
+    void OnPeerError(const PacketView& packet, const sockaddr_in& from) override;
+
+private:
+    // Tells a member its role; the master answers with an ACK
+    bool SendOack(const sockaddr_in& client, bool master);
+    bool SendBlock(uint16_t block);
+    // Drops the master and promotes the next member, or ends the transfer without members
+    void RemoveMaster(bool completed, Clock::time_point now);
+    void Promote(Clock::time_point now);
+    std::vector<sockaddr_in>::iterator FindMember(const sockaddr_in& client);
+
+    std::unique_ptr<ReadSource> source_;
+    MulticastGroupLease group_;
+    std::vector<sockaddr_in> members_;  // Front is the master
+    std::vector<uint8_t> send_buffer_;
+    bool source_open_;
+    uint64_t file_size_;
+    uint16_t total_blocks_;
+    uint16_t master_block_;  // Block sent in answer to the master's last ACK, 0 while awaiting its first ACK
+    size_t completed_;       // Members that received the whole file
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_MULTICAST_H_
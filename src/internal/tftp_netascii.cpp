@@ -0,0 +1,442 @@
+/**
+ * @file tftp_netascii.cpp
+ * @brief Streaming netascii translation (RFC 1350, RFC 764) between files and the wire
+ */
+
+#include "internal/tftp_netascii.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TFTP_NETASCII_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define TFTP_NETASCII_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr uint8_t kCarriageReturn = '\r';
+constexpr uint8_t kLineFeed = '\n';
+
+#if defined(TFTP_NETASCII_SSE2)
+
+unsigned LowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// 0xFF in every byte that is a CR (or, with kWithLineFeed, an LF)
+template <bool kWithLineFeed>
+__m128i MatchBreaks(__m128i block) {
+    __m128i hits = _mm_cmpeq_epi8(block, _mm_set1_epi8(static_cast<char>(kCarriageReturn)));
+    if (kWithLineFeed) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(static_cast<char>(kLineFeed))));
+    }
+    return hits;
+}
+
+#elif defined(TFTP_NETASCII_NEON)
+
+unsigned LowestBit(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+template <bool kWithLineFeed>
+uint8x16_t MatchBreaks(uint8x16_t block) {
+    uint8x16_t hits = vceqq_u8(block, vdupq_n_u8(kCarriageReturn));
+    if (kWithLineFeed) {
+        hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8(kLineFeed)));
+    }
+    return hits;
+}
+
+#endif
+
+template <bool kWithLineFeed>
+bool IsBreak(uint8_t byte) {
+    return byte == kCarriageReturn || (kWithLineFeed && byte == kLineFeed);
+}
+
+// Text is mostly runs of ordinary bytes, so the vector loops only stop at a hit
+template <bool kWithLineFeed>
+size_t FindBreak(const uint8_t* data, size_t length) {
+    size_t i = 0;
+#if defined(TFTP_NETASCII_SSE2)
+    for (; i + 32 <= length; i += 32) {
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(MatchBreaks<kWithLineFeed>(low))) |
+                        (static_cast<uint32_t>(_mm_movemask_epi8(MatchBreaks<kWithLineFeed>(high))) << 16);
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+    }
+#elif defined(TFTP_NETASCII_NEON)
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t hits = MatchBreaks<kWithLineFeed>(vld1q_u8(data + i));
+        // Narrowing shift: four mask bits per byte
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+        if (mask != 0) {
+            return i + (LowestBit(mask) >> 2);
+        }
+    }
+#endif
+    for (; i < length; ++i) {
+        if (IsBreak<kWithLineFeed>(data[i])) {
+            return i;
+        }
+    }
+    return length;
+}
+
+} // namespace
+
+size_t FindLineBreak(const uint8_t* data, size_t length) {
+    return FindBreak<true>(data, length);
+}
+
+size_t FindCarriageReturn(const uint8_t* data, size_t length) {
+    return FindBreak<false>(data, length);
+}
+
+uint64_t CountLineBreaks(const uint8_t* data, size_t length) {
+    uint64_t count = 0;
+    size_t i = 0;
+#if defined(TFTP_NETASCII_SSE2)
+    // Per-byte counters subtract the 0xFF hit masks and are folded before they can overflow
+    while (i + 16 <= length) {
+        __m128i counters = _mm_setzero_si128();
+        for (int round = 0; round < 255 && i + 16 <= length; ++round, i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            counters = _mm_sub_epi8(counters, MatchBreaks<true>(block));
+        }
+        uint64_t sums[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), _mm_sad_epu8(counters, _mm_setzero_si128()));
+        count += sums[0] + sums[1];
+    }
+#elif defined(TFTP_NETASCII_NEON)
+    while (i + 16 <= length) {
+        uint8x16_t counters = vdupq_n_u8(0);
+        for (int round = 0; round < 255 && i + 16 <= length; ++round, i += 16) {
+            counters = vsubq_u8(counters, MatchBreaks<true>(vld1q_u8(data + i)));
+        }
+        count += vaddlvq_u8(counters);
+    }
+#endif
+    for (; i < length; ++i) {
+        count += IsBreak<true>(data[i]) ? 1 : 0;
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// NetAsciiEncoder / NetAsciiDecoder
+// ---------------------------------------------------------------------------
+
+size_t NetAsciiEncoder::Encode(const uint8_t* in, size_t in_length, uint8_t* out, size_t out_capacity,
+                               size_t& consumed) {
+    consumed = 0;
+    size_t produced = 0;
+    if (pending_ >= 0 && out_capacity > 0) {
+        out[produced++] = static_cast<uint8_t>(pending_);
+        pending_ = -1;
+    }
+    while (consumed < in_length && produced < out_capacity && pending_ < 0) {
+        size_t run = FindLineBreak(in + consumed, std::min(in_length - consumed, out_capacity - produced));
+        std::memcpy(out + produced, in + consumed, run);
+        consumed += run;
+        produced += run;
+        if (consumed == in_length || produced == out_capacity) {
+            break;
+        }
+        uint8_t second = in[consumed++] == kLineFeed ? kLineFeed : 0;
+        out[produced++] = kCarriageReturn;
+        if (produced < out_capacity) {
+            out[produced++] = second;
+        } else {
+            pending_ = second;
+        }
+    }
+    return produced;
+}
+
+size_t NetAsciiDecoder::Decode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t produced = 0;
+    size_t i = 0;
+    if (pending_cr_ && length > 0) {
+        pending_cr_ = false;
+        if (in[0] == kLineFeed) {
+            out[produced++] = kLineFeed;
+            i = 1;
+        } else {
+            out[produced++] = kCarriageReturn;
+            i = in[0] == 0 ? 1 : 0;
+        }
+    }
+    while (i < length) {
+        size_t run = FindCarriageReturn(in + i, length - i);
+        std::memcpy(out + produced, in + i, run);
+        i += run;
+        produced += run;
+        if (i == length) {
+            break;
+        }
+        if (i + 1 == length) {
+            pending_cr_ = true;
+            break;
+        }
+        uint8_t next = in[i + 1];
+        if (next == kLineFeed) {
+            out[produced++] = kLineFeed;
+            i += 2;
+        } else {
+            out[produced++] = kCarriageReturn;
+            i += next == 0 ? 2 : 1;
+        }
+    }
+    return produced;
+}
+
+size_t NetAsciiDecoder::Finish(uint8_t* out) {
+    if (!pending_cr_) {
+        return 0;
+    }
+    pending_cr_ = false;
+    out[0] = kCarriageReturn;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// NetAsciiReadSource
+// ---------------------------------------------------------------------------
+
+NetAsciiReadSource::NetAsciiReadSource(std::unique_ptr<ReadSource> source)
+    : NetAsciiReadSource(*source) {
+    owned_ = std::move(source);
+}
+
+NetAsciiReadSource::NetAsciiReadSource(ReadSource& source)
+    : source_(source),
+      raw_size_(0),
+      scanned_(false),
+      scan_failed_(false),
+      translated_size_(0),
+      chunk_offset_(0),
+      chunk_length_(0),
+      cursor_raw_(0),
+      cursor_translated_(0),
+      cursor_valid_(false) {}
+
+bool NetAsciiReadSource::Open(const std::string& path) {
+    scanned_ = false;
+    scan_failed_ = false;
+    chunk_length_ = 0;
+    cursor_valid_ = false;
+    if (!source_.Open(path)) {
+        return false;
+    }
+    raw_size_ = source_.Size();
+    return true;
+}
+
+bool NetAsciiReadSource::Stat(const std::string& path, uint64_t& size) {
+    (void)path;
+    (void)size;
+    return false;
+}
+
+uint64_t NetAsciiReadSource::Size() const {
+    if (!scanned_) {
+        Scan();
+    }
+    return translated_size_;
+}
+
+bool NetAsciiReadSource::Scan() const {
+    scanned_ = true;
+    checkpoints_.clear();
+    checkpoints_.reserve(static_cast<size_t>(raw_size_ / kChunkSize + 1));
+    uint64_t translated = 0;
+    for (uint64_t raw = 0; raw < raw_size_;) {
+        checkpoints_.push_back(translated);
+        size_t length = 0;
+        const uint8_t* bytes = FileBytes(raw, length);
+        if (!bytes) {
+            scan_failed_ = true;
+            translated_size_ = raw_size_;
+            return false;
+        }
+        translated += length + CountLineBreaks(bytes, length);
+        raw += length;
+    }
+    translated_size_ = translated;
+    return true;
+}
+
+const uint8_t* NetAsciiReadSource::FileBytes(uint64_t raw_offset, size_t& length) const {
+    uint64_t chunk_start = raw_offset / kChunkSize * kChunkSize;
+    size_t chunk_length = static_cast<size_t>(std::min<uint64_t>(kChunkSize, raw_size_ - chunk_start));
+    length = static_cast<size_t>(chunk_start + chunk_length - raw_offset);
+    const uint8_t* borrowed = source_.PeekAt(raw_offset, length);
+    if (borrowed) {
+        return borrowed;
+    }
+
+    if (chunk_length_ == 0 || chunk_offset_ != chunk_start) {
+        chunk_.resize(kChunkSize);
+        size_t bytes_read = 0;
+        if (!source_.ReadAt(chunk_start, chunk_.data(), chunk_length, bytes_read) || bytes_read != chunk_length) {
+            chunk_length_ = 0;
+            return nullptr;
+        }
+        chunk_offset_ = chunk_start;
+        chunk_length_ = chunk_length;
+    }
+    return chunk_.data() + (raw_offset - chunk_start);
+}
+
+bool NetAsciiReadSource::ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) {
+    bytes_read = 0;
+    if (!scanned_) {
+        Scan();
+    }
+    if (scan_failed_) {
+        return false;
+    }
+    if (offset >= translated_size_) {
+        return true;
+    }
+    length = static_cast<size_t>(std::min<uint64_t>(length, translated_size_ - offset));
+
+    if (!cursor_valid_ || cursor_translated_ != offset) {
+        // Resume from the nearest checkpoint, unless the cursor is already between it and offset
+        size_t index = static_cast<size_t>(
+            std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset) - checkpoints_.begin() - 1);
+        if (!cursor_valid_ || cursor_translated_ > offset || cursor_translated_ < checkpoints_[index]) {
+            cursor_raw_ = static_cast<uint64_t>(index) * kChunkSize;
+            cursor_translated_ = checkpoints_[index];
+            encoder_.Reset();
+            cursor_valid_ = true;
+        }
+        uint8_t skipped[512];
+        while (cursor_translated_ < offset) {
+            if (!Advance(skipped, static_cast<size_t>(std::min<uint64_t>(sizeof(skipped), offset - cursor_translated_)))) {
+                return false;
+            }
+        }
+    }
+
+    if (!Advance(buffer, length)) {
+        return false;
+    }
+    bytes_read = length;
+    return true;
+}
+
+bool NetAsciiReadSource::Advance(uint8_t* out, size_t length) {
+    size_t produced = 0;
+    while (produced < length) {
+        const uint8_t* bytes = nullptr;
+        size_t available = 0;
+        if (cursor_raw_ < raw_size_) {
+            bytes = FileBytes(cursor_raw_, available);
+            if (!bytes) {
+                cursor_valid_ = false;
+                return false;
+            }
+        }
+        size_t consumed = 0;
+        size_t count = encoder_.Encode(bytes, available, out + produced, length - produced, consumed);
+        if (count == 0) {
+            // The file no longer matches the scan
+            cursor_valid_ = false;
+            return false;
+        }
+        produced += count;
+        cursor_raw_ += consumed;
+        cursor_translated_ += count;
+    }
+    return true;
+}
+
+void NetAsciiReadSource::Close() {
+    source_.Close();
+    chunk_.clear();
+    chunk_.shrink_to_fit();
+    chunk_length_ = 0;
+    cursor_valid_ = false;
+}
+
+// ---------------------------------------------------------------------------
+// NetAsciiWriteSink
+// ---------------------------------------------------------------------------
+
+NetAsciiWriteSink::NetAsciiWriteSink(std::unique_ptr<WriteSink> sink)
+    : NetAsciiWriteSink(*sink) {
+    owned_ = std::move(sink);
+}
+
+NetAsciiWriteSink::NetAsciiWriteSink(WriteSink& sink)
+    : sink_(sink),
+      written_(0) {}
+
+bool NetAsciiWriteSink::Open(const std::string& path, uint64_t size_hint) {
+    decoder_ = NetAsciiDecoder();
+    written_ = 0;
+    return sink_.Open(path, size_hint);
+}
+
+bool NetAsciiWriteSink::Write(uint64_t offset, const uint8_t* data, size_t length) {
+    (void)offset;  // Blocks arrive in order; the file offset is tracked here
+    if (buffer_.size() < length + 1) {
+        buffer_.resize(length + 1);
+    }
+    size_t count = decoder_.Decode(data, length, buffer_.data());
+    if (count == 0) {
+        return true;
+    }
+    if (!sink_.Write(written_, buffer_.data(), count)) {
+        return false;
+    }
+    written_ += count;
+    return true;
+}
+
+bool NetAsciiWriteSink::Commit() {
+    uint8_t last = 0;
+    if (decoder_.Finish(&last) > 0) {
+        if (!sink_.Write(written_, &last, 1)) {
+            sink_.Abort();
+            return false;
+        }
+        written_++;
+    }
+    return sink_.Commit();
+}
+
+void NetAsciiWriteSink::Abort() {
+    sink_.Abort();
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,138 @@
+/**
+ * @file tftp_netascii.h
+ * @brief Streaming netascii translation (RFC 1350, RFC 764) between files and the wire
+ */
+
+#ifndef TFTP_NETASCII_H_
+#define TFTP_NETASCII_H_
+
+#include "tftp/tftp_file_io.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+// Offset of the first CR or LF in data, or length if there is none (SSE2/NEON where available)
+size_t FindLineBreak(const uint8_t* data, size_t length);
+// Offset of the first CR in data, or length if there is none
+size_t FindCarriageReturn(const uint8_t* data, size_t length);
+// Number of CR and LF bytes in data: the growth of the range when it is put on the wire
+uint64_t CountLineBreaks(const uint8_t* data, size_t length);
+
+/**
+ * @brief File bytes to netascii: LF becomes CR LF and CR becomes CR NUL
+ *
+ * Files are taken to end lines with a bare LF. Output may stop in the middle of a pair; the
+ * second byte is then held back and starts the next call, so any split of the stream works.
+ */
+class NetAsciiEncoder {
+public:
+    // Translates until the input is used up or the output is full; consumed reports the input taken
+    size_t Encode(const uint8_t* in, size_t in_length, uint8_t* out, size_t out_capacity, size_t& consumed);
+    // Forgets a held-back byte
+    void Reset() { pending_ = -1; }
+
+private:
+    int pending_ = -1;  // Second byte of a pair that did not fit, or -1
+};
+
+/**
+ * @brief Netascii to file bytes: CR LF becomes LF and CR NUL becomes CR
+ *
+ * A CR that ends one call is resolved by the first byte of the next. A CR followed by any
+ * other byte is not valid netascii; it is kept as is rather than failing the transfer.
+ */
+class NetAsciiDecoder {
+public:
+    // Translates the whole input; out must hold length + 1 bytes
+    size_t Decode(const uint8_t* in, size_t length, uint8_t* out);
+    // Emits a CR that ended the stream; out must hold 1 byte
+    size_t Finish(uint8_t* out);
+
+private:
+    bool pending_cr_ = false;
+};
+
+/**
+ * @brief ReadSource presenting another source in netascii form
+ *
+ * The translated size is counted the first time Size is asked, in one streaming pass that also
+ * notes the translated offset of every kChunkSize bytes of the file. A ReadAt that does not
+ * continue the previous one (a retransmitted window) restarts from the nearest such checkpoint,
+ * so it translates at most one chunk more than it returns. File bytes are borrowed with PeekAt
+ * when the underlying source can lend them.
+ */
+class NetAsciiReadSource : public ReadSource {
+public:
+    static constexpr size_t kChunkSize = 32 * 1024;
+
+    explicit NetAsciiReadSource(std::unique_ptr<ReadSource> source);
+    // The source is not owned and must outlive this one
+    explicit NetAsciiReadSource(ReadSource& source);
+
+    bool Open(const std::string& path) override;
+    // Always false: the translated size needs the file contents, so the server opens the file first
+    bool Stat(const std::string& path, uint64_t& size) override;
+    uint64_t Size() const override;
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override;
+    void Close() override;
+
+private:
+    // Counts the translated size and fills checkpoints_; false on a read error
+    bool Scan() const;
+    // File bytes from raw_offset on, at most up to the end of its chunk; nullptr on a read error
+    const uint8_t* FileBytes(uint64_t raw_offset, size_t& length) const;
+    // Translates the next length bytes from the cursor into out; false on a read error
+    bool Advance(uint8_t* out, size_t length);
+
+    std::unique_ptr<ReadSource> owned_;
+    ReadSource& source_;
+    uint64_t raw_size_;
+
+    mutable bool scanned_;
+    mutable bool scan_failed_;
+    mutable uint64_t translated_size_;
+    mutable std::vector<uint64_t> checkpoints_;  // Translated offset of file offset i * kChunkSize
+    mutable std::vector<uint8_t> chunk_;         // Copy of one chunk when the source cannot lend it
+    mutable uint64_t chunk_offset_;
+    mutable size_t chunk_length_;
+
+    // Where the previous ReadAt stopped
+    NetAsciiEncoder encoder_;
+    uint64_t cursor_raw_;
+    uint64_t cursor_translated_;
+    bool cursor_valid_;
+};
+
+/**
+ * @brief WriteSink storing a netascii upload as file bytes in another sink
+ *
+ * The size hint is passed on unchanged; the file ends up at most that long.
+ */
+class NetAsciiWriteSink : public WriteSink {
+public:
+    explicit NetAsciiWriteSink(std::unique_ptr<WriteSink> sink);
+    // The sink is not owned and must outlive this one
+    explicit NetAsciiWriteSink(WriteSink& sink);
+
+    bool Open(const std::string& path, uint64_t size_hint) override;
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override;
+    bool Commit() override;
+    void Abort() override;
+
+private:
+    std::unique_ptr<WriteSink> owned_;
+    WriteSink& sink_;
+    NetAsciiDecoder decoder_;
+    std::vector<uint8_t> buffer_;
+    uint64_t written_;  // File bytes passed on so far
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_NETASCII_H_
@@ -0,0 +1,317 @@
+/**
+ * @file tftp_pack_file.cpp
+ * @brief Read-only pack of many small files with a hashed index, served from one mapping
+ */
+
+#include "internal/tftp_pack_file.h"
+#include "internal/tftp_path_validator.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr char kPackMagic[8] = {'T', 'F', 'T', 'P', 'P', 'A', 'C', 'K'};
+
+struct PackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t slot_count;  // Power of two, larger than entry_count
+    uint32_t reserved;
+    uint64_t entries_offset;
+    uint64_t slots_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+static_assert(sizeof(PackHeader) == 56, "PackHeader layout");
+
+// Entry table record, sorted by name. Slots hold entry index + 1, 0 marking an empty slot
+struct PackEntryRecord {
+    uint64_t hash;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+static_assert(sizeof(PackEntryRecord) == 32, "PackEntryRecord layout");
+
+// FNV-1a, 64-bit
+uint64_t HashName(std::string_view name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Whether [offset, offset + length) lies within size, without overflowing
+bool InBounds(uint64_t offset, uint64_t length, uint64_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// PackFile
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<const PackFile> PackFile::Open(const std::string& path) {
+    std::shared_ptr<const MappedFile> mapping = MappedFile::Map(path);
+    if (!mapping) {
+        TFTP_ERROR("Cannot map pack file: %s", path.c_str());
+        return nullptr;
+    }
+    PackHeader header;
+    if (mapping->Size() < sizeof(header)) {
+        TFTP_ERROR("Not a pack file: %s", path.c_str());
+        return nullptr;
+    }
+    std::memcpy(&header, mapping->Data(), sizeof(header));
+    if (std::memcmp(header.magic, kPackMagic, sizeof(kPackMagic)) != 0 || header.version != kVersion) {
+        TFTP_ERROR("Not a pack file or unsupported version: %s", path.c_str());
+        return nullptr;
+    }
+    const uint64_t size = mapping->Size();
+    if (header.slot_count == 0 || (header.slot_count & (header.slot_count - 1)) != 0 ||
+        header.slot_count <= header.entry_count ||
+        !InBounds(header.entries_offset, uint64_t{header.entry_count} * sizeof(PackEntryRecord), size) ||
+        !InBounds(header.slots_offset, uint64_t{header.slot_count} * sizeof(uint32_t), size) ||
+        !InBounds(header.names_offset, header.names_size, size)) {
+        TFTP_ERROR("Corrupt pack file index: %s", path.c_str());
+        return nullptr;
+    }
+
+    std::shared_ptr<PackFile> pack(new PackFile());
+    pack->entry_count_ = header.entry_count;
+    pack->slot_mask_ = header.slot_count - 1;
+    pack->entries_ = mapping->Data() + header.entries_offset;
+    pack->slots_ = mapping->Data() + header.slots_offset;
+    pack->names_ = mapping->Data() + header.names_offset;
+    pack->names_size_ = header.names_size;
+    pack->mapping_ = std::move(mapping);
+    return pack;
+}
+
+bool PackFile::Find(std::string_view name, Entry& entry) const {
+    const uint64_t hash = HashName(name);
+    // Linear probing; the table always has an empty slot, the bound only guards corrupt packs
+    for (uint64_t probe = 0; probe <= slot_mask_; ++probe) {
+        uint32_t slot = 0;
+        std::memcpy(&slot, slots_ + ((hash + probe) & slot_mask_) * sizeof(slot), sizeof(slot));
+        if (slot == 0 || slot > entry_count_) {
+            return false;
+        }
+        PackEntryRecord record;
+        std::memcpy(&record, entries_ + (slot - 1) * sizeof(record), sizeof(record));
+        if (record.hash != hash || record.name_length != name.size()) {
+            continue;
+        }
+        if (!InBounds(record.name_offset, record.name_length, names_size_) ||
+            !InBounds(record.data_offset, record.data_size, mapping_->Size())) {
+            return false;
+        }
+        if (std::memcmp(names_ + record.name_offset, name.data(), name.size()) == 0) {
+            entry.data = mapping_->Data() + record.data_offset;
+            entry.size = record.data_size;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PackFile::NormalizeName(const std::string& filename, bool secure, std::string& name) {
+    if (secure && !PathValidator::IsSafeName(filename)) {
+        return false;
+    }
+    name.clear();
+    name.reserve(filename.size());
+    for (char c : filename) {
+        if (c == '\\') {
+            c = '/';
+        }
+        if (c == '/' && !name.empty() && name.back() == '/') {
+            continue;
+        }
+        name.push_back(c);
+    }
+    return !name.empty();
+}
+
+// ---------------------------------------------------------------------------
+// BuildPackFile
+// ---------------------------------------------------------------------------
+
+bool BuildPackFile(const std::string& root_dir, const std::string& output_path, size_t& file_count) {
+    namespace fs = std::filesystem;
+    file_count = 0;
+
+    struct Pending {
+        std::string name;
+        fs::path path;
+        PackEntryRecord record;
+    };
+    std::vector<Pending> files;
+    std::error_code ec;
+    const fs::path root(root_dir);
+    for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_symlink(ec) || !it->is_regular_file(ec)) {
+            continue;
+        }
+        Pending file;
+        file.name = it->path().lexically_relative(root).generic_string();
+        file.path = it->path();
+        file.record = PackEntryRecord();
+        files.push_back(std::move(file));
+    }
+    if (ec) {
+        TFTP_ERROR("Cannot list %s: %s", root_dir.c_str(), ec.message().c_str());
+        return false;
+    }
+    if (files.size() >= UINT32_MAX / 2) {
+        TFTP_ERROR("Too many files for one pack: %zu", files.size());
+        return false;
+    }
+    std::sort(files.begin(), files.end(), [](const Pending& a, const Pending& b) { return a.name < b.name; });
+
+    PackHeader header = {};
+    std::memcpy(header.magic, kPackMagic, sizeof(kPackMagic));
+    header.version = PackFile::kVersion;
+    header.entry_count = static_cast<uint32_t>(files.size());
+    // At most half full, so that probes stay short
+    header.slot_count = 2;
+    while (header.slot_count < 2 * header.entry_count) {
+        header.slot_count *= 2;
+    }
+    header.entries_offset = sizeof(PackHeader);
+    header.slots_offset = header.entries_offset + uint64_t{header.entry_count} * sizeof(PackEntryRecord);
+    header.names_offset = header.slots_offset + uint64_t{header.slot_count} * sizeof(uint32_t);
+
+    std::string names;
+    std::vector<uint32_t> slots(header.slot_count, 0);
+    for (size_t i = 0; i < files.size(); ++i) {
+        PackEntryRecord& record = files[i].record;
+        if (names.size() + files[i].name.size() > UINT32_MAX) {
+            TFTP_ERROR("File names too long for one pack");
+            return false;
+        }
+        record.hash = HashName(files[i].name);
+        record.name_offset = static_cast<uint32_t>(names.size());
+        record.name_length = static_cast<uint32_t>(files[i].name.size());
+        names += files[i].name;
+        uint64_t slot = record.hash & (header.slot_count - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (header.slot_count - 1);
+        }
+        slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+    header.names_size = names.size();
+    const uint64_t data_offset = header.names_offset + header.names_size;
+
+    // Contents go first, behind room for the index: the sizes recorded are the bytes copied
+    const std::string temp_path = output_path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        TFTP_ERROR("Cannot create %s", temp_path.c_str());
+        return false;
+    }
+    std::vector<char> buffer(64 * 1024, 0);
+    for (uint64_t remaining = data_offset; remaining > 0;) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+        out.write(buffer.data(), static_cast<std::streamsize>(chunk));
+        remaining -= chunk;
+    }
+    uint64_t offset = data_offset;
+    for (Pending& file : files) {
+        std::ifstream in(file.path, std::ios::binary);
+        if (!in) {
+            TFTP_ERROR("Cannot read %s", file.path.string().c_str());
+            out.close();
+            fs::remove(temp_path, ec);
+            return false;
+        }
+        file.record.data_offset = offset;
+        while (in) {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            std::streamsize got = in.gcount();
+            out.write(buffer.data(), got);
+            offset += static_cast<uint64_t>(got);
+        }
+        file.record.data_size = offset - file.record.data_offset;
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Pending& file : files) {
+        out.write(reinterpret_cast<const char*>(&file.record), sizeof(file.record));
+    }
+    out.write(reinterpret_cast<const char*>(slots.data()), static_cast<std::streamsize>(slots.size() * sizeof(uint32_t)));
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    out.close();
+    if (!out) {
+        TFTP_ERROR("Cannot write %s", temp_path.c_str());
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    fs::rename(temp_path, output_path, ec);
+    if (ec) {
+        TFTP_ERROR("Cannot replace %s: %s", output_path.c_str(), ec.message().c_str());
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    file_count = files.size();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// PackReadSource
+// ---------------------------------------------------------------------------
+
+PackReadSource::PackReadSource(std::shared_ptr<const PackFile> pack)
+    : pack_(std::move(pack)) {
+}
+
+bool PackReadSource::Open(const std::string& path) {
+    Close();
+    return pack_ && pack_->Find(path, entry_);
+}
+
+bool PackReadSource::Stat(const std::string& path, uint64_t& size) {
+    PackFile::Entry entry;
+    if (!pack_ || !pack_->Find(path, entry)) {
+        return false;
+    }
+    size = entry.size;
+    return true;
+}
+
+bool PackReadSource::ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) {
+    bytes_read = 0;
+    if (offset < entry_.size) {
+        bytes_read = static_cast<size_t>(std::min<uint64_t>(length, entry_.size - offset));
+        std::memcpy(buffer, entry_.data + offset, bytes_read);
+    }
+    return true;
+}
+
+const uint8_t* PackReadSource::PeekAt(uint64_t offset, size_t length) {
+    if (offset > entry_.size || length > entry_.size - offset) {
+        return nullptr;
+    }
+    return entry_.data + offset;
+}
+
+void PackReadSource::Close() {
+    entry_ = PackFile::Entry();
+}
+
+} // namespace internal
+} // namespace tftpserver
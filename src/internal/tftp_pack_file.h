@@ -0,0 +1,102 @@
+/**
+ * @file tftp_pack_file.h
+ * @brief Read-only pack of many small files with a hashed index, served from one mapping
+ */
+
+#ifndef TFTP_PACK_FILE_H_
+#define TFTP_PACK_FILE_H_
+
+#include "tftp/tftp_file_io.h"
+#include "internal/tftp_file_cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Immutable pack file mapped whole, with its files looked up by name
+ *
+ * A pack holds a header, a table of entries sorted by name, an open-addressing hash table
+ * over the entries, the names, and then the file contents. Open checks only the header and
+ * the bounds of the tables, so it takes the same time whatever the number of files; each
+ * entry is bounds-checked when a lookup reaches it. Lookups read the mapping and nothing
+ * else. Packs are written by BuildPackFile (the tftp_pack tool), in host byte order.
+ */
+class PackFile {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    struct Entry {
+        const uint8_t* data = nullptr;
+        uint64_t size = 0;
+    };
+
+    // Disable copy
+    PackFile(const PackFile&) = delete;
+    PackFile& operator=(const PackFile&) = delete;
+
+    // Maps path and checks its header; returns nullptr (and logs why) if it is not a valid pack
+    static std::shared_ptr<const PackFile> Open(const std::string& path);
+
+    // Looks name up in the index; name is a normalized relative path such as "pxelinux.cfg/default"
+    bool Find(std::string_view name, Entry& entry) const;
+
+    size_t GetFileCount() const { return entry_count_; }
+
+    // Turns a requested filename into its name in the pack: backslashes become slashes and
+    // repeated slashes are folded. In secure mode the name must pass PathValidator::IsSafeName
+    static bool NormalizeName(const std::string& filename, bool secure, std::string& name);
+
+private:
+    PackFile() = default;
+
+    std::shared_ptr<const MappedFile> mapping_;
+    uint32_t entry_count_ = 0;
+    uint32_t slot_mask_ = 0;
+    const uint8_t* entries_ = nullptr;
+    const uint8_t* slots_ = nullptr;
+    const uint8_t* names_ = nullptr;
+    uint64_t names_size_ = 0;
+};
+
+/**
+ * @brief Packs every regular file under root_dir into output_path
+ *
+ * Names are the paths relative to root_dir with '/' separators; symbolic links are skipped.
+ * The pack is written next to output_path and renamed over it, so a server can map the new
+ * pack while transfers still read the old one. Returns false (and logs why) on failure;
+ * file_count receives the number of files packed.
+ */
+bool BuildPackFile(const std::string& root_dir, const std::string& output_path, size_t& file_count);
+
+/**
+ * @brief ReadSource serving one file of a pack; blocks are lent from the mapping
+ *
+ * The source holds a reference to its pack, so a transfer keeps reading the pack it started
+ * with after a new one has been swapped in.
+ */
+class PackReadSource : public ReadSource {
+public:
+    explicit PackReadSource(std::shared_ptr<const PackFile> pack);
+
+    // path is the name in the pack, as normalized by PackFile::NormalizeName
+    bool Open(const std::string& path) override;
+    bool Stat(const std::string& path, uint64_t& size) override;
+    uint64_t Size() const override { return entry_.size; }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override;
+    const uint8_t* PeekAt(uint64_t offset, size_t length) override;
+    void Close() override;
+
+private:
+    std::shared_ptr<const PackFile> pack_;
+    PackFile::Entry entry_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_PACK_FILE_H_
@@ -0,0 +1,226 @@
+/**
+ * @file tftp_path_validator.cpp
+ * @brief Request filename validation and resolution against the server root, with a cache
+ */
+
+#include "internal/tftp_path_validator.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <functional>
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+// Characters that are never part of a served name; '.' is only rejected before '.', '/' or '\'
+constexpr std::array<bool, 256> MakeRejectedTable() {
+    std::array<bool, 256> table = {};
+    for (char c : {'\0', '~', '$', '%', '<', '>', '|', '?', '*'}) {
+        table[static_cast<unsigned char>(c)] = true;
+    }
+    return table;
+}
+
+constexpr std::array<bool, 256> kRejected = MakeRejectedTable();
+
+bool IsAbsoluteName(std::string_view name) {
+#ifdef _WIN32
+    if (name.size() >= 2 && name[1] == ':') {
+        return true;
+    }
+    return name.size() >= 3 && (name.substr(0, 2) == "\\\\" || name.substr(0, 2) == "//");
+#else
+    return name[0] == '/';
+#endif
+}
+
+} // namespace
+
+PathValidator::PathValidator(size_t cache_entries, Clock::duration ttl)
+    : shard_count_(std::clamp<size_t>(cache_entries / kMinShardEntries, 1, kMaxShards)),
+      shard_capacity_((cache_entries + shard_count_ - 1) / shard_count_),
+      ttl_(ttl),
+      shards_(new Shard[shard_count_]) {}
+
+PathValidator::Shard& PathValidator::ShardOf(const std::string& filename) const {
+    if (shard_count_ == 1) {
+        return shards_[0];
+    }
+    return shards_[std::hash<std::string>()(filename) % shard_count_];
+}
+
+bool PathValidator::SetRoot(const std::string& root_dir) {
+    if (root_dir.empty()) {
+        TFTP_ERROR("Security violation: Empty root directory");
+        return false;
+    }
+    std::string prefix;
+    try {
+        prefix = std::filesystem::weakly_canonical(std::filesystem::absolute(root_dir)).string();
+    } catch (const std::exception& e) {
+        TFTP_ERROR("Root directory cannot be resolved: %s (%s)", root_dir.c_str(), e.what());
+        return false;
+    }
+    if (prefix.empty() || prefix.back() != std::filesystem::path::preferred_separator) {
+        prefix += std::filesystem::path::preferred_separator;
+    }
+
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Shard& shard = shards_[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.root_prefix = prefix;
+        shard.entries.clear();
+        shard.lru.clear();
+    }
+    return true;
+}
+
+bool PathValidator::IsSafeName(std::string_view name) {
+    if (name.empty()) {
+        TFTP_ERROR("Security violation: Empty path");
+        return false;
+    }
+    if (IsAbsoluteName(name)) {
+        TFTP_ERROR("Security violation: Absolute path specified: %.*s", static_cast<int>(name.size()), name.data());
+        return false;
+    }
+    // One pass with a table lookup per byte, instead of one search per pattern
+    for (size_t i = 0; i < name.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(name[i]);
+        bool rejected = kRejected[c];
+        if (c == '.' && i + 1 < name.size()) {
+            char next = name[i + 1];
+            rejected = next == '.' || next == '/' || next == '\\';
+        }
+        if (rejected) {
+            TFTP_ERROR("Security violation: Dangerous pattern at offset %zu in path: %.*s", i,
+                      static_cast<int>(name.size()), name.data());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PathValidator::Resolve(const std::string& filename, bool secure, std::string& resolved) {
+    if (secure && !IsSafeName(filename)) {
+        return false;
+    }
+
+    Shard& shard = ShardOf(filename);
+    std::string root_prefix;
+    bool within_root = false;
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.root_prefix.empty()) {
+            TFTP_ERROR("Path validator has no root directory");
+            return false;
+        }
+        auto it = shard.entries.find(filename);
+        if (it != shard.entries.end()) {
+            if (Clock::now() < it->second.expires) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru_position);
+                resolved = it->second.resolved;
+                within_root = it->second.within_root;
+                cached = true;
+            } else {
+                shard.Erase(it);
+            }
+        }
+        if (cached) {
+            shard.hits++;
+            // Only a rejection needs the root, to log it
+            if (secure && !within_root) {
+                root_prefix = shard.root_prefix;
+            }
+        } else {
+            shard.misses++;
+            root_prefix = shard.root_prefix;
+        }
+    }
+
+    if (!cached) {
+        if (!ResolveUncached(root_prefix, filename, resolved, within_root)) {
+            return false;
+        }
+        if (shard_capacity_ > 0) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            // A concurrent miss on the same name or a root change may have got here first
+            if (shard.root_prefix == root_prefix && shard.entries.find(filename) == shard.entries.end()) {
+                while (shard.entries.size() >= shard_capacity_) {
+                    shard.Erase(shard.entries.find(shard.lru.back()));
+                }
+                shard.lru.push_front(filename);
+                shard.entries.emplace(filename, Entry{resolved, within_root, Clock::now() + ttl_, shard.lru.begin()});
+            }
+        }
+    }
+
+    if (secure && !within_root) {
+        TFTP_ERROR("Security violation: Access outside root directory. Root: %s, Target: %s",
+                  root_prefix.c_str(), resolved.c_str());
+        return false;
+    }
+    return true;
+}
+
+void PathValidator::Invalidate() {
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Shard& shard = shards_[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+        shard.lru.clear();
+    }
+}
+
+size_t PathValidator::GetCacheSize() const {
+    size_t size = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        size += shards_[i].entries.size();
+    }
+    return size;
+}
+
+uint64_t PathValidator::GetCacheHits() const {
+    uint64_t hits = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        hits += shards_[i].hits;
+    }
+    return hits;
+}
+
+uint64_t PathValidator::GetCacheMisses() const {
+    uint64_t misses = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        misses += shards_[i].misses;
+    }
+    return misses;
+}
+
+bool PathValidator::ResolveUncached(const std::string& root_prefix, const std::string& filename,
+                                    std::string& resolved, bool& within_root) {
+    try {
+        // Concatenated rather than joined, so that an absolute name stays under the root
+        resolved = std::filesystem::weakly_canonical(std::filesystem::path(root_prefix + filename)).string();
+    } catch (const std::exception& e) {
+        TFTP_ERROR("Filesystem error in path resolution: %s (path: %s)", e.what(), filename.c_str());
+        return false;
+    }
+    // The root itself is not a file that can be served
+    within_root = resolved.size() > root_prefix.size() && resolved.compare(0, root_prefix.size(), root_prefix) == 0;
+    return true;
+}
+
+void PathValidator::Shard::Erase(std::unordered_map<std::string, Entry>::iterator it) {
+    lru.erase(it->second.lru_position);
+    entries.erase(it);
+}
+
+} // namespace internal
+} // namespace tftpserver
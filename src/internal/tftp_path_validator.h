@@ -0,0 +1,101 @@
+/**
+ * @file tftp_path_validator.h
+ * @brief Request filename validation and resolution against the server root, with a cache
+ */
+
+#ifndef TFTP_PATH_VALIDATOR_H_
+#define TFTP_PATH_VALIDATOR_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Resolves requested filenames to canonical paths under the root directory
+ *
+ * The root is canonicalized once by SetRoot. A name is screened in a single table-driven
+ * pass, and only then resolved on the filesystem (weakly_canonical, which follows symlinks).
+ * Resolutions are kept in an LRU keyed by filename for a short time, so that many clients
+ * asking for the same file do not each cost a round of stat/readlink calls; the expiry bounds
+ * how long a symlink changed under the root can go unnoticed. A capacity of 0 disables the cache.
+ *
+ * Large caches are split into shards by filename hash, each with its own lock, copy of the root
+ * and counters, so that listeners resolving different names do not serialize on one mutex; a
+ * hit takes its shard's lock once.
+ */
+class PathValidator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kDefaultCacheEntries = 4096;
+    static constexpr Clock::duration kDefaultCacheTtl = std::chrono::seconds(10);
+    static constexpr size_t kMaxShards = 16;
+    static constexpr size_t kMinShardEntries = 256;  // Smaller caches keep one exact LRU
+
+    explicit PathValidator(size_t cache_entries = kDefaultCacheEntries, Clock::duration ttl = kDefaultCacheTtl);
+
+    // Disable copy
+    PathValidator(const PathValidator&) = delete;
+    PathValidator& operator=(const PathValidator&) = delete;
+
+    // Canonicalizes root_dir and empties the cache; false if the root cannot be resolved
+    bool SetRoot(const std::string& root_dir);
+
+    // Stores the canonical path of filename under the root in resolved. In secure mode the
+    // name must pass IsSafeName and resolve to a file within the root; failures are logged
+    bool Resolve(const std::string& filename, bool secure, std::string& resolved);
+
+    // Drops every cached resolution
+    void Invalidate();
+
+    size_t GetCacheSize() const;
+    uint64_t GetCacheHits() const;
+    uint64_t GetCacheMisses() const;
+
+    // Rejects empty and absolute names, NUL bytes, "..", "./", ".\" and the characters ~ $ % < > | ? *
+    static bool IsSafeName(std::string_view name);
+
+private:
+    struct Entry {
+        std::string resolved;
+        bool within_root;
+        Clock::time_point expires;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    // One lock's worth of the cache, on its own cache line
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::string root_prefix;  // Canonical root with a trailing separator
+        std::unordered_map<std::string, Entry> entries;
+        std::list<std::string> lru;  // Most recently used first
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+        void Erase(std::unordered_map<std::string, Entry>::iterator it);
+    };
+
+    // Resolves on the filesystem; false on a filesystem error
+    static bool ResolveUncached(const std::string& root_prefix, const std::string& filename, std::string& resolved,
+                                bool& within_root);
+    Shard& ShardOf(const std::string& filename) const;
+
+    const size_t shard_count_;
+    const size_t shard_capacity_;
+    const Clock::duration ttl_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_PATH_VALIDATOR_H_
@@ -0,0 +1,146 @@
+/**
+ * @file tftp_poller.cpp
+ * @brief Socket readiness notification shared by the reactor and the client event loop
+ */
+
+#include "internal/tftp_poller.h"
+#include <cerrno>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(TFTP_POLLER_EPOLL)
+#include <sys/epoll.h>
+#elif defined(TFTP_POLLER_KQUEUE)
+#include <sys/event.h>
+#endif
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr int kMaxEventsPerWait = 256;
+
+} // namespace
+
+bool SetNonBlocking(socket_t sock) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool WouldBlock() {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    // ICMP port unreachable from an earlier send is reported on the next receive
+    return error == WSAEWOULDBLOCK || error == WSAECONNRESET;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+Poller::Poller() {
+#if defined(TFTP_POLLER_EPOLL)
+    fd_ = epoll_create1(EPOLL_CLOEXEC);
+#elif defined(TFTP_POLLER_KQUEUE)
+    fd_ = kqueue();
+#endif
+}
+
+Poller::~Poller() {
+#if defined(TFTP_POLLER_EPOLL) || defined(TFTP_POLLER_KQUEUE)
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+#endif
+}
+
+bool Poller::IsValid() const {
+#if defined(TFTP_POLLER_EPOLL) || defined(TFTP_POLLER_KQUEUE)
+    return fd_ >= 0;
+#else
+    return true;
+#endif
+}
+
+bool Poller::Add(socket_t sock, uint64_t id) {
+#if defined(TFTP_POLLER_EPOLL)
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    return epoll_ctl(fd_, EPOLL_CTL_ADD, sock, &event) == 0;
+#elif defined(TFTP_POLLER_KQUEUE)
+    struct kevent change;
+    EV_SET(&change, sock, EVFILT_READ, EV_ADD, 0, 0, reinterpret_cast<void*>(static_cast<uintptr_t>(id)));
+    return kevent(fd_, &change, 1, nullptr, 0, nullptr) == 0;
+#else
+    pollfd_type entry = {};
+    entry.fd = sock;
+    entry.events = POLLIN;
+    fds_.push_back(entry);
+    ids_.push_back(id);
+    return true;
+#endif
+}
+
+void Poller::Remove(socket_t sock) {
+#if defined(TFTP_POLLER_EPOLL)
+    epoll_ctl(fd_, EPOLL_CTL_DEL, sock, nullptr);
+#elif defined(TFTP_POLLER_KQUEUE)
+    struct kevent change;
+    EV_SET(&change, sock, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    kevent(fd_, &change, 1, nullptr, 0, nullptr);
+#else
+    for (size_t i = 0; i < fds_.size(); ++i) {
+        if (fds_[i].fd == sock) {
+            fds_[i] = fds_.back();
+            fds_.pop_back();
+            ids_[i] = ids_.back();
+            ids_.pop_back();
+            break;
+        }
+    }
+#endif
+}
+
+void Poller::Wait(int timeout_ms, std::vector<uint64_t>& ready) {
+#if defined(TFTP_POLLER_EPOLL)
+    epoll_event events[kMaxEventsPerWait];
+    int count = epoll_wait(fd_, events, kMaxEventsPerWait, timeout_ms);
+    for (int i = 0; i < count; ++i) {
+        ready.push_back(events[i].data.u64);
+    }
+#elif defined(TFTP_POLLER_KQUEUE)
+    struct kevent events[kMaxEventsPerWait];
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+    int count = kevent(fd_, nullptr, 0, events, kMaxEventsPerWait, timeout_ms < 0 ? nullptr : &timeout);
+    for (int i = 0; i < count; ++i) {
+        ready.push_back(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(events[i].udata)));
+    }
+#else
+#ifdef _WIN32
+    int count = WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms);
+#else
+    int count = poll(fds_.data(), static_cast<nfds_t>(fds_.size()), timeout_ms);
+#endif
+    for (size_t i = 0; i < fds_.size() && count > 0; ++i) {
+        if (fds_[i].revents != 0) {
+            ready.push_back(ids_[i]);
+            count--;
+        }
+    }
+#endif
+}
+
+} // namespace internal
+} // namespace tftpserver
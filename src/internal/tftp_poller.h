@@ -0,0 +1,69 @@
+/**
+ * @file tftp_poller.h
+ * @brief Socket readiness notification shared by the reactor and the client event loop
+ */
+
+#ifndef TFTP_POLLER_H_
+#define TFTP_POLLER_H_
+
+#include "tftp/tftp_socket.h"
+#include <cstdint>
+#include <vector>
+
+#if !defined(_WIN32)
+#if defined(__linux__)
+#define TFTP_POLLER_EPOLL 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#define TFTP_POLLER_KQUEUE 1
+#else
+#include <poll.h>
+#endif
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+bool SetNonBlocking(socket_t sock);
+
+// True when a failed non-blocking send or receive only means "try again later"
+bool WouldBlock();
+
+/**
+ * @brief Readiness notification for a set of sockets, identified by 64-bit tokens
+ *        (epoll on Linux, kqueue on BSD/macOS, poll/WSAPoll elsewhere)
+ */
+class Poller {
+public:
+    Poller();
+    ~Poller();
+
+    // Disable copy
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    bool IsValid() const;
+
+    bool Add(socket_t sock, uint64_t id);
+    void Remove(socket_t sock);
+
+    // Waits up to timeout_ms (-1 waits indefinitely) and appends the tokens of readable sockets
+    void Wait(int timeout_ms, std::vector<uint64_t>& ready);
+
+private:
+#if defined(TFTP_POLLER_EPOLL) || defined(TFTP_POLLER_KQUEUE)
+    int fd_;
+#else
+#ifdef _WIN32
+    using pollfd_type = WSAPOLLFD;
+#else
+    using pollfd_type = pollfd;
+#endif
+    std::vector<pollfd_type> fds_;
+    std::vector<uint64_t> ids_;
+#endif
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_POLLER_H_
@@ -0,0 +1,88 @@
+/**
+ * @file tftp_rate_limiter.cpp
+ * @brief Token-bucket bandwidth limits shared by all transfers of a server
+ */
+
+#include "internal/tftp_rate_limiter.h"
+#include <algorithm>
+
+namespace tftpserver {
+namespace internal {
+
+void TokenBucket::SetRate(uint64_t bytes_per_second, Clock::time_point now) {
+    rate_ = bytes_per_second;
+    burst_ = std::max(static_cast<double>(bytes_per_second) * kBurstTime.count() / 1000.0,
+                      static_cast<double>(kMinBurstBytes));
+    tokens_ = burst_;
+    updated_ = now;
+}
+
+TokenBucket::Clock::duration TokenBucket::Reserve(uint64_t bytes, Clock::time_point now) {
+    if (rate_ == 0) {
+        return Clock::duration::zero();
+    }
+    if (now > updated_) {
+        double elapsed = std::chrono::duration<double>(now - updated_).count();
+        tokens_ = std::min(burst_, tokens_ + elapsed * static_cast<double>(rate_));
+        updated_ = now;
+    }
+    tokens_ -= static_cast<double>(bytes);
+    if (tokens_ >= 0) {
+        return Clock::duration::zero();
+    }
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(-tokens_ / static_cast<double>(rate_)));
+}
+
+RateLimiter::RateLimiter()
+    : limited_(false),
+      client_rate_(0) {}
+
+void RateLimiter::SetLimits(uint64_t global_bytes_per_second, uint64_t client_bytes_per_second) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    global_.SetRate(global_bytes_per_second, now);
+    client_rate_ = client_bytes_per_second;
+    for (auto& entry : clients_) {
+        entry.second.bucket.SetRate(client_bytes_per_second, now);
+    }
+    limited_ = global_bytes_per_second != 0 || client_bytes_per_second != 0;
+}
+
+void RateLimiter::AddClient(const sockaddr_in& client_addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Client& client = clients_[client_addr.sin_addr.s_addr];
+    if (client.transfers++ == 0) {
+        client.bucket.SetRate(client_rate_, Clock::now());
+    }
+}
+
+void RateLimiter::RemoveClient(const sockaddr_in& client_addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = clients_.find(client_addr.sin_addr.s_addr);
+    if (it != clients_.end() && --it->second.transfers == 0) {
+        clients_.erase(it);
+    }
+}
+
+RateLimiter::Clock::duration RateLimiter::Reserve(const sockaddr_in& client_addr, uint64_t bytes,
+                                                  Clock::time_point now) {
+    if (!limited_.load(std::memory_order_relaxed)) {
+        return Clock::duration::zero();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clock::duration delay = global_.Reserve(bytes, now);
+    auto it = clients_.find(client_addr.sin_addr.s_addr);
+    if (it != clients_.end()) {
+        delay = std::max(delay, it->second.bucket.Reserve(bytes, now));
+    }
+    return delay;
+}
+
+size_t RateLimiter::GetClientCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clients_.size();
+}
+
+} // namespace internal
+} // namespace tftpserver
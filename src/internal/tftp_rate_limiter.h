@@ -0,0 +1,101 @@
+/**
+ * @file tftp_rate_limiter.h
+ * @brief Token-bucket bandwidth limits shared by all transfers of a server
+ */
+
+#ifndef TFTP_RATE_LIMITER_H_
+#define TFTP_RATE_LIMITER_H_
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Token bucket that hands out reservations rather than refusals
+ *
+ * Reserve always takes the bytes, letting the balance go negative, and returns how long the
+ * caller has to wait before the debt is repaid. A sender that waits that long before sending
+ * stays at the configured rate on average, whatever the size of its bursts. Not thread-safe.
+ */
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // The bucket holds this much sending time, but never less than kMinBurstBytes
+    static constexpr std::chrono::milliseconds kBurstTime{100};
+    static constexpr uint64_t kMinBurstBytes = 64 * 1024;
+
+    TokenBucket() = default;
+
+    // 0 = unlimited; the bucket starts full
+    void SetRate(uint64_t bytes_per_second, Clock::time_point now);
+    uint64_t GetRate() const { return rate_; }
+
+    Clock::duration Reserve(uint64_t bytes, Clock::time_point now);
+
+private:
+    uint64_t rate_ = 0;
+    double burst_ = 0;
+    double tokens_ = 0;
+    Clock::time_point updated_;
+};
+
+/**
+ * @brief Global and per-client bandwidth limits of the transfers of one server
+ *
+ * Clients are told apart by IPv4 address, so that a host cannot escape its limit by opening
+ * more transfers from other ports; its buckets exist while it has a transfer registered.
+ * Limits can be changed while transfers run. Thread-safe.
+ */
+class RateLimiter {
+public:
+    using Clock = TokenBucket::Clock;
+
+    RateLimiter();
+
+    // Disable copy
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // Bytes per second for all transfers together and for each client address (0 = unlimited)
+    void SetLimits(uint64_t global_bytes_per_second, uint64_t client_bytes_per_second);
+
+    // Called by each transfer when it starts and ends
+    void AddClient(const sockaddr_in& client_addr);
+    void RemoveClient(const sockaddr_in& client_addr);
+
+    // Charges bytes sent to or received from client_addr to both limits; returns how long the
+    // transfer should hold back its next packet (zero when it may send at once)
+    Clock::duration Reserve(const sockaddr_in& client_addr, uint64_t bytes, Clock::time_point now);
+
+    size_t GetClientCount() const;
+
+private:
+    struct Client {
+        TokenBucket bucket;
+        size_t transfers = 0;
+    };
+
+    mutable std::mutex mutex_;
+    std::atomic<bool> limited_;  // Lets Reserve skip the lock while both limits are off
+    uint64_t client_rate_;
+    TokenBucket global_;
+    std::unordered_map<uint32_t, Client> clients_;  // Keyed by IPv4 address
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_RATE_LIMITER_H_
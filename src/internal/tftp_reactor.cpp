@@ -0,0 +1,1081 @@
+/**
+ * @file tftp_reactor.cpp
+ * @brief Event-driven transfer engine multiplexing many sessions on a few threads
+ */
+
+#include "internal/tftp_reactor.h"
+#include "internal/tftp_io_stage.h"
+#include "internal/tftp_poller.h"
+#include "internal/tftp_socket_impl.h"
+#include "internal/tftp_timer_wheel.h"
+#include "internal/tftp_multicast.h"
+#include "internal/tftp_uring.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define CLOSESOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define CLOSESOCKET close
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr uint64_t kWakeId = 0;
+constexpr int kMaxDatagramsPerWakeup = 64;  // Keeps one busy session from starving the others
+constexpr size_t kReceiveBatch = 8;         // Datagrams per batched receive
+constexpr size_t kReceiveSlotSize = 65536;  // Room for a UDP_GRO coalesced receive
+
+#ifdef _WIN32
+using socklen_type = int;
+#else
+using socklen_type = socklen_t;
+#endif
+
+#ifdef TFTP_HAVE_IO_URING
+// Completion kinds, in the low byte of the user data; the session id is above them (the send
+// slot index for sends)
+enum UringOp : uint8_t {
+    kOpIgnore = 0,     // Cancellations and completions already handled
+    kOpWake = 1,       // Receive on the wake socket (small buffers)
+    kOpRecvSmall = 2,  // Session receive into the small buffer group
+    kOpRecvLarge = 3,  // Session receive into the large buffer group
+    kOpSend = 4        // Session send described by a send slot
+};
+
+constexpr unsigned kRingEntries = 256;
+constexpr unsigned kFixedFiles = 4096;         // Sessions beyond this use their plain descriptor
+constexpr uint16_t kSmallGroup = 0;
+constexpr uint16_t kLargeGroup = 1;
+constexpr unsigned kSmallBufferCount = 256;
+constexpr size_t kSmallBufferSize = 2048;      // ACKs and DATA up to a blksize of about 2000
+constexpr unsigned kLargeBufferCount = 64;     // Allocated by the first session with a larger blksize
+constexpr size_t kLargeBufferSize = 65536;
+// io_uring_recvmsg_out and the sender address precede the payload in a receive buffer
+constexpr size_t kRecvMsgOverhead = sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in);
+constexpr unsigned kSendSlabCount = 16;         // Allocated by the first session that reads a block
+constexpr size_t kSendSlabSize = 256 * 1024;    // The largest batch of a read transfer
+constexpr size_t kZeroCopySendMinBytes = 4096;  // Smaller datagrams cost less to copy than to notify
+
+uint64_t UringData(uint64_t id, UringOp op) {
+    return (id << 8) | op;
+}
+#endif
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// EventLoop
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief One reactor thread with its own poller, timer wheel and session table
+ */
+class TftpReactor::EventLoop {
+public:
+    EventLoop(const TransferFactory& factory, bool use_io_uring)
+        : factory_(factory),
+          use_uring_(use_io_uring),
+          wake_sock_(kInvalidSocket),
+          running_(false),
+          session_count_(0),
+          next_session_id_(kWakeId + 1),
+          recv_buffer_(kReceiveBatch * kReceiveSlotSize),
+          incoming_(kReceiveBatch) {
+        for (size_t i = 0; i < kReceiveBatch; ++i) {
+            incoming_[i].buffer = recv_buffer_.data() + i * kReceiveSlotSize;
+            incoming_[i].capacity = kReceiveSlotSize;
+        }
+#ifdef TFTP_HAVE_IO_URING
+        recv_pattern_.msg_namelen = sizeof(sockaddr_in);
+#endif
+    }
+
+    ~EventLoop() {
+        Stop();
+    }
+
+    bool Start() {
+        if (!poller_.IsValid()) {
+            TFTP_ERROR("Reactor poller creation failed");
+            return false;
+        }
+#ifdef TFTP_HAVE_IO_URING
+        if (use_uring_ && !StartUring()) {
+            TFTP_ERROR("Reactor io_uring setup failed");
+            return false;
+        }
+#endif
+
+        // A loopback datagram socket wakes the loop when requests are posted or on Stop
+        wake_sock_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (wake_sock_ == kInvalidSocket) {
+            TFTP_ERROR("Reactor wake socket creation failed");
+            return false;
+        }
+        wake_addr_ = {};
+        wake_addr_.sin_family = AF_INET;
+        wake_addr_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        wake_addr_.sin_port = 0;
+        socklen_type addrlen = sizeof(wake_addr_);
+        if (bind(wake_sock_, reinterpret_cast<sockaddr*>(&wake_addr_), sizeof(wake_addr_)) != 0 ||
+            getsockname(wake_sock_, reinterpret_cast<sockaddr*>(&wake_addr_), &addrlen) != 0 ||
+            !SetNonBlocking(wake_sock_) || (!use_uring_ && !poller_.Add(wake_sock_, kWakeId))) {
+            TFTP_ERROR("Reactor wake socket setup failed");
+            CLOSESOCKET(wake_sock_);
+            wake_sock_ = kInvalidSocket;
+            return false;
+        }
+
+#ifdef TFTP_HAVE_IO_URING
+        if (use_uring_) {
+            ArmWake();
+        }
+#endif
+
+        // Disk work of the read-ahead and write-behind stages finishes on their threads
+        io_completions_ = std::make_shared<IoCompletions>([this]() { Wake(); });
+        running_ = true;
+        thread_ = std::thread(&EventLoop::Run, this);
+        return true;
+    }
+
+    void Stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        Wake();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+
+        // Unfinished transfers are dropped; their destructors discard partial uploads
+        while (!sessions_.empty()) {
+            sessions_.begin()->second->transfer->Abort("server stopping");
+            CloseSession(sessions_.begin()->first);
+        }
+#ifdef TFTP_HAVE_IO_URING
+        if (use_uring_) {
+            DrainSends();
+        }
+#endif
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.clear();
+        }
+        // Jobs of the dropped sessions may still complete; they must not wake a closed socket
+        io_completions_->Close();
+        if (!use_uring_) {
+            poller_.Remove(wake_sock_);
+        }
+        CLOSESOCKET(wake_sock_);
+        wake_sock_ = kInvalidSocket;
+    }
+
+    void Post(PooledBuffer request, const sockaddr_in& client_addr, TransferSocketLease socket,
+              SessionLease lease) {
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.push_back(PendingRequest{std::move(request), client_addr, std::move(socket), std::move(lease)});
+        }
+        Wake();
+    }
+
+    size_t GetSessionCount() const { return session_count_.load(); }
+    size_t GetPendingCount() const {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        return pending_.size();
+    }
+
+private:
+    using Clock = Transfer::Clock;
+
+    struct PendingRequest {
+        PooledBuffer data;
+        sockaddr_in client_addr;
+        TransferSocketLease socket_lease;
+        SessionLease lease;
+    };
+
+    // Session socket and transfer; the session is the transfer's output channel. Sessions come
+    // from the buffer pool, as their transfers do, and go back to it when they end
+    struct Session : public TransferChannel, public PoolAllocated {
+        TransferSocketLease socket_lease;
+        socket_t sock = kInvalidSocket;  // Handle held by socket_lease
+        sockaddr_in peer = {};
+        std::unique_ptr<Transfer> transfer;
+        Clock::time_point scheduled = Clock::time_point::max();  // Deadline of the live wheel timer
+        SessionLease lease;
+        net::internal::ReceiveOffloadState receive_offload;  // UDP_GRO, with segments kept between receives
+        net::internal::ZeroCopyState zero_copy;  // MSG_ZEROCOPY for blocks lent by a mapped file
+        MulticastTransfer* multicast = nullptr;  // Set when transfer serves a multicast group
+        std::string group_key;                   // Requested filename of the multicast group
+#ifdef TFTP_HAVE_IO_URING
+        // io_uring state; loop is set once the session is registered, and its sends then go
+        // through the ring, one submission per batch
+        EventLoop* loop = nullptr;
+        uint64_t id = 0;
+        int fixed_slot = -1;                 // Registered file slot, or -1 for the plain descriptor
+        UringOp recv_op = kOpRecvSmall;      // Buffer group of the multishot receive
+        bool recv_armed = false;
+        int send_slab = -1;                  // Slab lent for the batch being encoded, until it is queued
+        uint32_t pinned_sends = 0;           // Queued sends reading blocks the transfer's source lent
+#endif
+
+        bool Send(const uint8_t* data, size_t size) override {
+#ifdef TFTP_HAVE_IO_URING
+            if (loop) {
+                return loop->QueueSend(*this, peer, data, size);
+            }
+#endif
+            return SendTo(peer, data, size);
+        }
+
+        bool SendBatch(const net::OutgoingDatagram* datagrams, size_t count) override {
+#ifdef TFTP_HAVE_IO_URING
+            if (loop) {
+                return loop->QueueSends(*this, datagrams, count);
+            }
+#endif
+            int sent = net::internal::SocketImpl::SendDatagrams(sock, datagrams, count, true, &zero_copy);
+            // Datagrams left over by a full socket buffer count as lost; the retransmit timer recovers
+            return sent >= 0 || WouldBlock();
+        }
+
+        uint8_t* BatchBuffer(size_t size) override {
+#ifdef TFTP_HAVE_IO_URING
+            if (loop) {
+                return loop->LendSendSlab(*this, size);
+            }
+#endif
+            return nullptr;
+        }
+
+        bool SendTo(const sockaddr_in& addr, const uint8_t* data, size_t size) override {
+            int sent = sendto(sock, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+                              reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+            if (sent == static_cast<int>(size)) {
+                return true;
+            }
+            // A full socket buffer is indistinguishable from loss on the wire; the retransmit timer recovers
+            return sent < 0 && WouldBlock();
+        }
+    };
+
+#ifdef TFTP_HAVE_IO_URING
+    // One queued send. The kernel reads the header and the data when it performs the send,
+    // which may be after the call that queued it, so a slot is only reused once its last
+    // completion has arrived. A datagram encoded into a send slab, or lent by the transfer's
+    // source, is sent in place and keeps the slab or the session until then; any other
+    // datagram is copied into the slot
+    struct SendSlot : public PoolAllocated {
+        msghdr header = {};
+        iovec iov[2] = {};
+        sockaddr_in addr = {};
+        PooledBuffer data;     // Copy of a datagram whose buffer is reused at once
+        int slab = -1;         // Send slab holding the datagram
+        uint64_t session = 0;  // Session whose source lent the payload
+    };
+
+    // Send storage lent to transfers for their batches (BatchBuffer); free again once it is
+    // neither lent nor read by a queued send
+    struct SendSlab {
+        uint32_t sends = 0;
+        bool lent = false;
+    };
+#endif
+
+    void Run() {
+#ifdef TFTP_HAVE_IO_URING
+        if (use_uring_) {
+            RunUring();
+            return;
+        }
+#endif
+        std::vector<uint64_t> ready;
+        while (running_) {
+            ready.clear();
+            poller_.Wait(timers_.NextTimeoutMs(Clock::now()), ready);
+
+            Clock::time_point now = Clock::now();
+            for (uint64_t id : ready) {
+                if (id == kWakeId) {
+                    DrainWakeSocket();
+                } else {
+                    ServiceSession(id, now);
+                }
+            }
+            StartPendingSessions(now);
+            ResumeIoWaiters(now);
+            ExpireTimers(now);
+        }
+    }
+
+    void ExpireTimers(Clock::time_point now) {
+        expired_.clear();
+        timers_.Advance(now, expired_);
+        for (uint64_t id : expired_) {
+            auto it = sessions_.find(id);
+            // Finished sessions and timers replaced by an earlier one still pending are ignored
+            if (it == sessions_.end() || now < it->second->scheduled) {
+                continue;
+            }
+            Session& session = *it->second;
+            session.scheduled = Clock::time_point::max();
+            // A deadline that moved later is re-armed at its real time
+            if (now >= session.transfer->Deadline()) {
+                session.transfer->OnTimeout(now);
+            }
+            UpdateSession(id, session);
+        }
+    }
+
+    // Resumes the transfers whose disk work has finished
+    void ResumeIoWaiters(Clock::time_point now) {
+        io_ready_.clear();
+        io_completions_->Take(io_ready_);
+        for (uint64_t id : io_ready_) {
+            auto it = sessions_.find(id);
+            if (it != sessions_.end()) {
+                it->second->transfer->HandleIoReady(now);
+                UpdateSession(id, *it->second);
+            }
+        }
+    }
+
+    void Wake() {
+        char byte = 0;
+        sendto(wake_sock_, &byte, 1, 0, reinterpret_cast<const sockaddr*>(&wake_addr_), sizeof(wake_addr_));
+    }
+
+    void DrainWakeSocket() {
+        char buffer[64];
+        while (recv(wake_sock_, buffer, sizeof(buffer), 0) > 0) {
+        }
+    }
+
+    void StartPendingSessions(Clock::time_point now) {
+        std::vector<PendingRequest> requests;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            requests.swap(pending_);
+        }
+        for (PendingRequest& request : requests) {
+            StartSession(request, now);
+        }
+    }
+
+    void StartSession(PendingRequest& request, Clock::time_point now) {
+        TftpPacket packet;
+        if (!packet.Deserialize(request.data.Data(), request.data.Size())) {
+            TFTP_ERROR("Invalid packet received");
+            return;
+        }
+
+        // A multicast RRQ for a file already being multicast joins that group. Requests for the
+        // same file are always posted to the same loop, so the group is found here. The joiner's
+        // lease is dropped, so that a repeated RRQ (lost OACK) reaches the group again.
+        bool multicast = packet.GetOpCode() == OpCode::kReadRequest && IsMulticastRequest(packet);
+        if (multicast) {
+            auto group = groups_.find(packet.GetFilename());
+            if (group != groups_.end()) {
+                auto it = sessions_.find(group->second);
+                if (it != sessions_.end() && it->second->multicast->Join(request.client_addr)) {
+                    UpdateSession(group->second, *it->second);
+                    return;
+                }
+            }
+        }
+
+        auto session = std::make_unique<Session>();
+        session->peer = request.client_addr;
+        session->socket_lease = std::move(request.socket_lease);
+        session->sock = session->socket_lease.Get();
+        if (!use_uring_) {
+            // Lets a peer's GSO bursts arrive as single receives; split again in ReceiveDatagrams
+            session->receive_offload.enabled = net::internal::SocketImpl::EnableReceiveOffload(session->sock, true);
+            net::internal::SocketImpl::EnableZeroCopy(session->sock, session->zero_copy);
+        } else {
+            // Provided buffers hold one datagram each; a pooled socket may still coalesce
+            net::internal::SocketImpl::EnableReceiveOffload(session->sock, false);
+        }
+
+        // Returning drops the session and hands its socket back to the pool
+        session->transfer = factory_(packet, request.client_addr, *session);
+        if (!session->transfer) {
+            return;
+        }
+        // Taken before Start, which may already leave disk work to the I/O stage
+        uint64_t id = next_session_id_++;
+        session->transfer->SetIoNotifier(IoCompletions::Notifier(io_completions_, id));
+        session->transfer->Start(now);
+        if (session->transfer->IsFinished()) {
+            return;
+        }
+
+        if (!use_uring_ && !poller_.Add(session->sock, id)) {
+            TFTP_ERROR("Reactor registration failed");
+            return;
+        }
+        session->lease = std::move(request.lease);
+        if (multicast) {
+            session->multicast = dynamic_cast<MulticastTransfer*>(session->transfer.get());
+        }
+        if (session->multicast) {
+            session->group_key = packet.GetFilename();
+            groups_[session->group_key] = id;
+        }
+        Session& registered = *session;
+        sessions_.emplace(id, std::move(session));
+        session_count_++;
+#ifdef TFTP_HAVE_IO_URING
+        if (use_uring_ && !ArmSession(id, registered)) {
+            TFTP_ERROR("Reactor registration failed");
+            registered.transfer->Abort("registration failed");
+        }
+#endif
+        UpdateSession(id, registered);
+    }
+
+    void ServiceSession(uint64_t id, Clock::time_point now) {
+        auto it = sessions_.find(id);
+        if (it == sessions_.end()) {
+            return;
+        }
+        Session& session = *it->second;
+        int handled = 0;
+        // Kept segments are drained past the cap: the socket may not poll as ready again for them
+        while ((handled < kMaxDatagramsPerWakeup || session.receive_offload.HasPending()) &&
+               !session.transfer->IsFinished()) {
+            int received = net::internal::SocketImpl::ReceiveDatagrams(session.sock, incoming_.data(),
+                                                                        incoming_.size(), &session.receive_offload);
+            if (received <= 0) {
+                break;
+            }
+            for (int i = 0; i < received && !session.transfer->IsFinished(); ++i) {
+                const net::IncomingDatagram& datagram = incoming_[i];
+                // The view points into recv_buffer_, which is not reused before HandlePacket returns
+                PacketView packet;
+                if (!packet.Parse(datagram.buffer, datagram.length, session.transfer->BlockSize())) {
+                    TFTP_ERROR("Invalid packet format");
+                    continue;
+                }
+                session.transfer->HandlePacket(packet, datagram.addr, now);
+            }
+            handled += received;
+            if (static_cast<size_t>(received) < incoming_.size()) {
+                break;
+            }
+        }
+        // Completions wake the session too (the error queue polls as ready) and are consumed
+        // here, including those left on a pooled socket by its previous session
+        if (session.zero_copy.enabled && (handled == 0 || session.zero_copy.Pending() > 0)) {
+            net::internal::SocketImpl::ReapZeroCopy(session.sock, session.zero_copy);
+        }
+        UpdateSession(id, session);
+    }
+
+    // Closes finished sessions and keeps the timer wheel in step with the transfer deadline. A
+    // deadline that moves later keeps the armed timer, which re-arms itself when it fires, so the
+    // wheel holds one timer per session instead of one per packet
+    void UpdateSession(uint64_t id, Session& session) {
+        if (session.transfer->IsFinished()) {
+            CloseSession(id);
+            return;
+        }
+        Clock::time_point deadline = session.transfer->Deadline();
+        if (deadline < session.scheduled) {
+            timers_.Schedule(id, deadline);
+            session.scheduled = deadline;
+        }
+    }
+
+    void CloseSession(uint64_t id) {
+        auto it = sessions_.find(id);
+        if (it == sessions_.end()) {
+            return;
+        }
+        if (it->second->multicast) {
+            auto group = groups_.find(it->second->group_key);
+            if (group != groups_.end() && group->second == id) {
+                groups_.erase(group);
+            }
+        }
+#ifdef TFTP_HAVE_IO_URING
+        if (use_uring_) {
+            ReleaseSession(*it->second);
+            // Sends still reading blocks lent by the transfer's source keep the session alive
+            if (it->second->pinned_sends > 0) {
+                closing_.emplace(id, std::move(it->second));
+            }
+        }
+#endif
+        if (!use_uring_) {
+            poller_.Remove(it->second->sock);
+        }
+        sessions_.erase(it);
+        session_count_--;
+    }
+
+#ifdef TFTP_HAVE_IO_URING
+    // io_uring mode: session sockets sit in the ring's fixed file table and receive through
+    // multishot recvmsg into provided buffers; sends of a loop iteration are queued and go to
+    // the kernel in the same io_uring_enter that waits for the next completions
+
+    bool StartUring() {
+        if (!ring_.Init(kRingEntries) || !ring_.RegisterFileTable(kFixedFiles) ||
+            !small_buffers_.Init(ring_, kSmallGroup, kSmallBufferCount, kSmallBufferSize)) {
+            return false;
+        }
+        for (unsigned slot = kFixedFiles; slot > 0; --slot) {
+            free_slots_.push_back(static_cast<int>(slot - 1));
+        }
+#ifdef TFTP_HAVE_IO_URING_SEND_ZC
+        zero_copy_sends_ = ring_.Supports(IORING_OP_SEND_ZC) && ring_.Supports(IORING_OP_SENDMSG_ZC);
+#endif
+        return true;
+    }
+
+    void RunUring() {
+        FileRing::EnableForThisThread(true);
+        while (running_) {
+            int timeout_ms = deferred_.empty() && rearm_.empty() ? timers_.NextTimeoutMs(Clock::now()) : 0;
+            if (ring_.SubmitAndWait(1, timeout_ms) < 0) {
+                TFTP_ERROR("Reactor io_uring wait failed: %s", strerror(errno));
+            }
+
+            Clock::time_point now = Clock::now();
+            // Completions reaped while flushing submissions come first; the handlers may reap more
+            completions_.swap(deferred_);
+            ring_.Reap(completions_);
+            for (const io_uring_cqe& cqe : completions_) {
+                HandleCompletion(cqe, now);
+            }
+            completions_.clear();
+            RearmReceives();
+            StartPendingSessions(now);
+            ResumeIoWaiters(now);
+            ExpireTimers(now);
+        }
+        FileRing::EnableForThisThread(false);
+    }
+
+    void HandleCompletion(const io_uring_cqe& cqe, Clock::time_point now) {
+        UringOp op = static_cast<UringOp>(cqe.user_data & 0xFF);
+        uint64_t id = cqe.user_data >> 8;
+        uint16_t buffer_id = 0;
+        bool has_buffer = CompletionBuffer(cqe, buffer_id);
+        BufferRing& buffers = op == kOpRecvLarge ? large_buffers_ : small_buffers_;
+
+        // A send completion only frees its slot, once no notification follows: a failed send (a
+        // full socket buffer) counts as lost, as on the portable path
+        if (op == kOpSend) {
+            if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+                ReleaseSendSlot(static_cast<uint32_t>(id));
+            }
+        } else if (op == kOpWake) {
+            if ((cqe.flags & IORING_CQE_F_MORE) == 0 && running_) {
+                ArmWake();
+            }
+        } else if (op == kOpRecvSmall || op == kOpRecvLarge) {
+            HandleReceive(id, cqe, has_buffer ? buffers.Buffer(buffer_id) : nullptr, now);
+        }
+        // Receives of sessions closed meanwhile only give their buffer back
+        if (has_buffer) {
+            buffers.Recycle(buffer_id);
+        }
+    }
+
+    void HandleReceive(uint64_t id, const io_uring_cqe& cqe, const uint8_t* buffer, Clock::time_point now) {
+        auto it = sessions_.find(id);
+        if (it == sessions_.end()) {
+            return;
+        }
+        Session& session = *it->second;
+        if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+            // The multishot receive ended: out of buffers (-ENOBUFS) for a moment, or an error
+            session.recv_armed = false;
+            if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+                TFTP_ERROR("Session receive failed: %s", strerror(-cqe.res));
+                session.transfer->Abort("receive failed");
+                UpdateSession(id, session);
+                return;
+            }
+            rearm_.push_back(id);
+        }
+        if (cqe.res <= 0 || buffer == nullptr || session.transfer->IsFinished()) {
+            return;
+        }
+
+        sockaddr_in from;
+        const uint8_t* payload = nullptr;
+        size_t length = 0;
+        PacketView packet;
+        // The view points into the provided buffer, which is recycled after HandlePacket returns
+        if (!ParseRecvMsg(buffer, static_cast<size_t>(cqe.res), recv_pattern_, from, payload, length) ||
+            !packet.Parse(payload, length, session.transfer->BlockSize())) {
+            TFTP_ERROR("Invalid packet format");
+            return;
+        }
+        session.transfer->HandlePacket(packet, from, now);
+        UpdateSession(id, session);
+    }
+
+    void ArmWake() {
+        io_uring_sqe* sqe = ring_.GetSqe();
+        if (sqe != nullptr) {
+            PrepareRecvMsgMultishot(sqe, wake_sock_, false, &recv_pattern_, kSmallGroup, UringData(kWakeId, kOpWake));
+        }
+    }
+
+    bool ArmSession(uint64_t id, Session& session) {
+        session.id = id;
+        session.loop = this;
+        if (!free_slots_.empty() && ring_.UpdateFile(static_cast<unsigned>(free_slots_.back()), session.sock)) {
+            session.fixed_slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        if (kRecvMsgOverhead + codec::kHeaderSize + session.transfer->BlockSize() <= kSmallBufferSize) {
+            session.recv_op = kOpRecvSmall;
+        } else {
+            if (!large_buffers_.IsValid() &&
+                !large_buffers_.Init(ring_, kLargeGroup, kLargeBufferCount, kLargeBufferSize)) {
+                return false;
+            }
+            session.recv_op = kOpRecvLarge;
+        }
+        return ArmReceive(session);
+    }
+
+    bool ArmReceive(Session& session) {
+        io_uring_sqe* sqe = ring_.GetSqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+        bool fixed = session.fixed_slot >= 0;
+        PrepareRecvMsgMultishot(sqe, fixed ? session.fixed_slot : session.sock, fixed, &recv_pattern_,
+                                session.recv_op == kOpRecvLarge ? kLargeGroup : kSmallGroup,
+                                UringData(session.id, session.recv_op));
+        session.recv_armed = true;
+        return true;
+    }
+
+    void RearmReceives() {
+        std::vector<uint64_t> ids;
+        ids.swap(rearm_);
+        for (uint64_t id : ids) {
+            auto it = sessions_.find(id);
+            if (it == sessions_.end() || it->second->recv_armed || it->second->transfer->IsFinished()) {
+                continue;
+            }
+            if (!ArmReceive(*it->second)) {
+                rearm_.push_back(id);  // Submission queue full; retried next iteration
+            }
+        }
+    }
+
+    bool QueueSend(Session& session, const sockaddr_in& addr, const uint8_t* data, size_t size) {
+        net::OutgoingDatagram datagram;
+        datagram.data = data;
+        datagram.size = size;
+        datagram.addr = addr;
+        return QueueSends(session, &datagram, 1);
+    }
+
+    bool QueueSends(Session& session, const net::OutgoingDatagram* datagrams, size_t count) {
+        bool fixed = session.fixed_slot >= 0;
+        int fd = fixed ? session.fixed_slot : session.sock;
+        bool queued = true;
+        for (size_t i = 0; i < count; ++i) {
+            io_uring_sqe* sqe = ring_.GetSqe();
+            if (sqe == nullptr) {
+                // Submission queue full: hand the queued entries over first, so the batch stays in order
+                FlushSubmissions();
+                sqe = ring_.GetSqe();
+            }
+            if (sqe == nullptr) {
+                int sent = net::internal::SocketImpl::SendDatagrams(session.sock, datagrams + i, count - i, true,
+                                                                     nullptr);
+                queued = sent >= 0 || WouldBlock();
+                break;
+            }
+            const net::OutgoingDatagram& datagram = datagrams[i];
+            uint32_t index = AcquireSendSlot();
+            SendSlot& slot = *send_slots_[index];
+            slot.addr = datagram.addr;
+            slot.header = msghdr();
+            slot.header.msg_name = &slot.addr;
+            slot.header.msg_namelen = sizeof(sockaddr_in);
+            slot.header.msg_iov = slot.iov;
+            slot.header.msg_iovlen = 1;
+            uint64_t user_data = UringData(index, kOpSend);
+            bool zero_copy = zero_copy_sends_ && datagram.Length() >= kZeroCopySendMinBytes;
+
+            if (InSendSlab(session.send_slab, datagram)) {
+                // Encoded into the lent slab, which the transfer leaves alone until it gets another
+                slot.slab = session.send_slab;
+                send_slabs_[slot.slab].sends++;
+#ifdef TFTP_HAVE_IO_URING_SEND_ZC
+                if (zero_copy) {
+                    PrepareSendZeroCopy(sqe, fd, fixed, datagram.data, datagram.size, &slot.addr,
+                                        send_buffer_index_, user_data);
+                    continue;
+                }
+#endif
+                slot.iov[0].iov_base = const_cast<uint8_t*>(datagram.data);
+                slot.iov[0].iov_len = datagram.size;
+            } else if (datagram.immutable) {
+                // A header from the static table and a block lent by the source, which lives as
+                // long as the session: the session outlives the send
+                slot.session = session.id;
+                session.pinned_sends++;
+                slot.iov[0].iov_base = const_cast<uint8_t*>(datagram.data);
+                slot.iov[0].iov_len = datagram.size;
+                slot.iov[1].iov_base = const_cast<uint8_t*>(datagram.payload);
+                slot.iov[1].iov_len = datagram.payload_size;
+                slot.header.msg_iovlen = datagram.payload_size > 0 ? 2 : 1;
+            } else {
+                // Any other buffer is rewritten as soon as this returns: the slot keeps its own copy
+                slot.data.Resize(datagram.Length());
+                std::memcpy(slot.data.Data(), datagram.data, datagram.size);
+                if (datagram.payload_size > 0) {
+                    std::memcpy(slot.data.Data() + datagram.size, datagram.payload, datagram.payload_size);
+                }
+                slot.iov[0].iov_base = slot.data.Data();
+                slot.iov[0].iov_len = slot.data.Size();
+                zero_copy = false;
+            }
+#ifdef TFTP_HAVE_IO_URING_SEND_ZC
+            if (zero_copy) {
+                PrepareSendMsgZeroCopy(sqe, fd, fixed, &slot.header, user_data);
+                continue;
+            }
+#endif
+            PrepareSendMsg(sqe, fd, fixed, &slot.header, user_data);
+        }
+        // The batch is queued; its sends free the slab once they complete
+        ReturnSendSlab(session);
+        // Submitted now rather than with the next wait, so that a later batch falling back to
+        // synchronous sends cannot overtake this one
+        FlushSubmissions();
+        return queued;
+    }
+
+    uint32_t AcquireSendSlot() {
+        if (free_send_slots_.empty()) {
+            free_send_slots_.push_back(static_cast<uint32_t>(send_slots_.size()));
+            send_slots_.push_back(std::make_unique<SendSlot>());
+        }
+        uint32_t index = free_send_slots_.back();
+        free_send_slots_.pop_back();
+        return index;
+    }
+
+    void ReleaseSendSlot(uint32_t index) {
+        if (index >= send_slots_.size()) {
+            return;
+        }
+        SendSlot& slot = *send_slots_[index];
+        if (slot.slab >= 0) {
+            send_slabs_[slot.slab].sends--;
+            FreeSendSlabIfIdle(slot.slab);
+            slot.slab = -1;
+        }
+        if (slot.session != 0) {
+            UnpinSession(slot.session);
+            slot.session = 0;
+        }
+        free_send_slots_.push_back(index);
+    }
+
+    // Lends a slab for the session's next batch; nullptr when the batch does not fit one or
+    // every slab is still being sent from, and the batch is then copied
+    uint8_t* LendSendSlab(Session& session, size_t size) {
+        if (size > kSendSlabSize) {
+            return nullptr;
+        }
+        if (session.send_slab < 0) {
+            if (send_arena_.empty()) {
+                InitSendSlabs();
+            }
+            if (free_send_slabs_.empty()) {
+                ReclaimSends();
+            }
+            if (free_send_slabs_.empty()) {
+                return nullptr;
+            }
+            session.send_slab = static_cast<int>(free_send_slabs_.back());
+            free_send_slabs_.pop_back();
+            send_slabs_[session.send_slab].lent = true;
+        }
+        return SendSlabData(session.send_slab);
+    }
+
+    void InitSendSlabs() {
+        send_arena_.resize(kSendSlabCount * kSendSlabSize);
+        send_slabs_.resize(kSendSlabCount);
+        for (unsigned slab = kSendSlabCount; slab > 0; --slab) {
+            free_send_slabs_.push_back(slab - 1);
+        }
+#ifdef TFTP_HAVE_IO_URING_SEND_ZC
+        // Registered once, so that zero-copy sends from the slabs do not pin their pages each time
+        iovec arena = {send_arena_.data(), send_arena_.size()};
+        if (zero_copy_sends_ && ring_.RegisterBuffers(&arena, 1)) {
+            send_buffer_index_ = 0;
+        } else if (zero_copy_sends_) {
+            TFTP_DEBUG("Cannot register io_uring send buffers: %s", strerror(errno));
+        }
+#endif
+    }
+
+    uint8_t* SendSlabData(int slab) {
+        return send_arena_.data() + static_cast<size_t>(slab) * kSendSlabSize;
+    }
+
+    bool InSendSlab(int slab, const net::OutgoingDatagram& datagram) {
+        if (slab < 0 || datagram.payload_size > 0) {
+            return false;
+        }
+        const uint8_t* begin = SendSlabData(slab);
+        return datagram.data >= begin && datagram.data + datagram.size <= begin + kSendSlabSize;
+    }
+
+    // Ends the session's lend; a slab no send reads from is free at once
+    void ReturnSendSlab(Session& session) {
+        if (session.send_slab >= 0) {
+            send_slabs_[session.send_slab].lent = false;
+            FreeSendSlabIfIdle(session.send_slab);
+            session.send_slab = -1;
+        }
+    }
+
+    void FreeSendSlabIfIdle(int slab) {
+        if (!send_slabs_[slab].lent && send_slabs_[slab].sends == 0) {
+            free_send_slabs_.push_back(static_cast<uint32_t>(slab));
+        }
+    }
+
+    void UnpinSession(uint64_t id) {
+        auto it = sessions_.find(id);
+        if (it != sessions_.end()) {
+            it->second->pinned_sends--;
+            return;
+        }
+        auto closing = closing_.find(id);
+        if (closing != closing_.end() && --closing->second->pinned_sends == 0) {
+            closing_.erase(closing);
+        }
+    }
+
+    // Frees what completed sends held before the loop gets to their completions; sends are
+    // performed within the submission, so their completions are usually ready by now
+    void ReclaimSends() {
+        ring_.Reap(deferred_);
+        for (io_uring_cqe& cqe : deferred_) {
+            if (static_cast<UringOp>(cqe.user_data & 0xFF) == kOpSend) {
+                if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+                    ReleaseSendSlot(static_cast<uint32_t>(cqe.user_data >> 8));
+                }
+                cqe.user_data = UringData(0, kOpIgnore);
+            }
+        }
+    }
+
+    // Waits (boundedly) for the sends still in flight once the loop has stopped; receive
+    // completions are dropped, their buffers go away with the ring
+    void DrainSends() {
+        FlushSubmissions();
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(1);
+        while (free_send_slots_.size() < send_slots_.size() && Clock::now() < deadline) {
+            completions_.swap(deferred_);
+            if (completions_.empty()) {
+                ring_.SubmitAndWait(1, 10);
+            }
+            ring_.Reap(completions_);
+            for (const io_uring_cqe& cqe : completions_) {
+                if (static_cast<UringOp>(cqe.user_data & 0xFF) == kOpSend && (cqe.flags & IORING_CQE_F_MORE) == 0) {
+                    ReleaseSendSlot(static_cast<uint32_t>(cqe.user_data >> 8));
+                }
+            }
+            completions_.clear();
+        }
+        closing_.clear();
+    }
+
+    // Hands every queued entry to the kernel; completions reaped to make room are kept for the loop
+    void FlushSubmissions() {
+        while (ring_.Unsubmitted() > 0) {
+            if (ring_.Submit() >= 0) {
+                continue;
+            }
+            if (errno != EBUSY && errno != EAGAIN) {
+                TFTP_ERROR("Reactor io_uring submit failed: %s", strerror(errno));
+                return;
+            }
+            // The completion queue is full: reap to make room, waiting briefly if nothing is ready
+            if (ring_.Reap(deferred_) == 0) {
+                ring_.SubmitAndWait(1, 1);
+            }
+        }
+    }
+
+    // Stops the ring from touching the session's socket and storage before it is destroyed and
+    // the socket goes back to the pool
+    void ReleaseSession(Session& session) {
+        if (session.loop == nullptr) {
+            return;
+        }
+        if (session.recv_armed) {
+            io_uring_sqe* sqe = ring_.GetSqe();
+            if (sqe != nullptr) {
+                PrepareCancel(sqe, UringData(session.id, session.recv_op), UringData(0, kOpIgnore));
+            }
+            // A receive waiting on the socket is cancelled within the submission
+            FlushSubmissions();
+        }
+        if (session.fixed_slot >= 0) {
+            ring_.UpdateFile(static_cast<unsigned>(session.fixed_slot), -1);
+            free_slots_.push_back(session.fixed_slot);
+        }
+        ReturnSendSlab(session);
+        session.loop = nullptr;
+    }
+#endif
+
+    const TransferFactory& factory_;
+    bool use_uring_;
+    Poller poller_;
+    TimerWheel timers_;
+    socket_t wake_sock_;
+    sockaddr_in wake_addr_ = {};
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> session_count_;
+
+    mutable std::mutex pending_mutex_;
+    std::vector<PendingRequest> pending_;
+
+    // Loop-thread state
+    std::unordered_map<uint64_t, std::unique_ptr<Session>> sessions_;
+    std::unordered_map<std::string, uint64_t> groups_;  // Multicast sessions by requested filename
+    uint64_t next_session_id_;
+    std::vector<uint8_t> recv_buffer_;                 // kReceiveBatch slots of kReceiveSlotSize
+    std::vector<net::IncomingDatagram> incoming_;
+    std::vector<uint64_t> expired_;
+    std::shared_ptr<IoCompletions> io_completions_;  // Created by Start, closed by Stop
+    std::vector<uint64_t> io_ready_;
+#ifdef TFTP_HAVE_IO_URING
+    // Declared before the ring, so that they outlive every send it may still perform. Slots are
+    // held by pointer and never move; the table only grows, to the most sends ever in flight
+    std::vector<std::unique_ptr<SendSlot>> send_slots_;
+    std::vector<uint32_t> free_send_slots_;
+    std::vector<uint8_t> send_arena_;      // kSendSlabCount slabs of kSendSlabSize
+    std::vector<SendSlab> send_slabs_;
+    std::vector<uint32_t> free_send_slabs_;
+    int send_buffer_index_ = -1;           // Registered buffer holding the arena, or -1
+    bool zero_copy_sends_ = false;         // The kernel offers SEND_ZC and SENDMSG_ZC
+    std::unordered_map<uint64_t, std::unique_ptr<Session>> closing_;  // Closed, with pinned sends
+    IoUring ring_;                          // Declared before the buffer rings it registers
+    BufferRing small_buffers_;
+    BufferRing large_buffers_;
+    msghdr recv_pattern_ = {};              // Name area only: the sender address
+    std::vector<int> free_slots_;           // Unused fixed file slots
+    std::vector<io_uring_cqe> completions_;
+    std::vector<io_uring_cqe> deferred_;    // Reaped by FlushSubmissions, handled by the loop
+    std::vector<uint64_t> rearm_;           // Sessions whose multishot receive ended
+#endif
+};
+
+// ---------------------------------------------------------------------------
+// TftpReactor
+// ---------------------------------------------------------------------------
+
+TftpReactor::TftpReactor(size_t thread_count, TransferFactory factory, bool use_io_uring)
+    : factory_(std::move(factory)),
+      next_loop_(0),
+      running_(false) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        loops_.push_back(std::make_unique<EventLoop>(factory_, use_io_uring));
+    }
+}
+
+TftpReactor::~TftpReactor() {
+    Stop();
+}
+
+bool TftpReactor::Start() {
+    for (auto& loop : loops_) {
+        if (!loop->Start()) {
+            Stop();
+            return false;
+        }
+    }
+    running_ = true;
+    TFTP_INFO("Reactor started with %zu event loop threads", loops_.size());
+    return true;
+}
+
+void TftpReactor::Stop() {
+    running_ = false;
+    for (auto& loop : loops_) {
+        loop->Stop();
+    }
+}
+
+bool TftpReactor::Submit(PooledBuffer request, const sockaddr_in& client_addr, TransferSocketLease socket,
+                         SessionLease lease) {
+    if (!running_) {
+        return false;
+    }
+    // Multicast requests for one file go to one loop, where they join the same group
+    size_t index;
+    PacketView packet;
+    if (packet.Parse(request.Data(), request.Size(), kMaxBlockSize) && packet.GetOpCode() == OpCode::kReadRequest &&
+        IsMulticastRequest(packet)) {
+        index = std::hash<std::string_view>()(packet.GetFilename()) % loops_.size();
+    } else {
+        index = next_loop_++ % loops_.size();
+    }
+    loops_[index]->Post(std::move(request), client_addr, std::move(socket), std::move(lease));
+    return true;
+}
+
+size_t TftpReactor::GetPendingCount() const {
+    size_t count = 0;
+    for (const auto& loop : loops_) {
+        count += loop->GetPendingCount();
+    }
+    return count;
+}
+
+size_t TftpReactor::GetActiveSessionCount() const {
+    size_t count = 0;
+    for (const auto& loop : loops_) {
+        count += loop->GetSessionCount();
+    }
+    return count;
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,69 @@
+/**
+ * @file tftp_reactor.h
+ * @brief Event-driven transfer engine multiplexing many sessions on a few threads
+ */
+
+#ifndef TFTP_REACTOR_H_
+#define TFTP_REACTOR_H_
+
+#include "tftp/tftp_socket.h"
+#include "internal/tftp_buffer_pool.h"
+#include "internal/tftp_session_table.h"
+#include "internal/tftp_socket_pool.h"
+#include "internal/tftp_transfer.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Reactor engine: every transfer gets its own non-blocking socket, registered with
+ *        one of a fixed set of event loop threads (epoll on Linux, kqueue on BSD/macOS,
+ *        poll/WSAPoll elsewhere). Retransmissions are driven by a per-loop timer wheel,
+ *        so no thread ever blocks on a single transfer. With io_uring the loops wait on a
+ *        ring instead: receives are multishot and each batch of sends is one submission.
+ */
+class TftpReactor {
+public:
+    // Builds the transfer for a new request; returns nullptr if the request was rejected
+    using TransferFactory = std::function<std::unique_ptr<Transfer>(
+        const TftpPacket& request, const sockaddr_in& client_addr, TransferChannel& channel)>;
+
+    // use_io_uring requires IoUringAvailable()
+    TftpReactor(size_t thread_count, TransferFactory factory, bool use_io_uring = false);
+    ~TftpReactor();
+
+    // Disable copy
+    TftpReactor(const TftpReactor&) = delete;
+    TftpReactor& operator=(const TftpReactor&) = delete;
+
+    bool Start();
+    void Stop();
+
+    // Hands an initial RRQ/WRQ datagram to one of the loops; false if the reactor is not running.
+    // The session serves it on the non-blocking socket; both leases are held until it ends.
+    bool Submit(PooledBuffer request, const sockaddr_in& client_addr, TransferSocketLease socket,
+                SessionLease lease = SessionLease());
+
+    size_t GetThreadCount() const { return loops_.size(); }
+    size_t GetActiveSessionCount() const;
+    // Requests handed over by Submit that no loop has started yet
+    size_t GetPendingCount() const;
+
+private:
+    class EventLoop;
+
+    TransferFactory factory_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::atomic<size_t> next_loop_;
+    std::atomic<bool> running_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_REACTOR_H_
@@ -0,0 +1,53 @@
+/**
+ * @file tftp_rtt_estimator.cpp
+ * @brief Per-session round-trip estimation driving the retransmission timeout
+ */
+
+#include "internal/tftp_rtt_estimator.h"
+#include <algorithm>
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+// Clock granularity G of RFC 6298: the variance term never drops below one timer wheel tick
+constexpr RttEstimator::Duration kGranularity = std::chrono::milliseconds(10);
+
+} // namespace
+
+RttEstimator::RttEstimator(Duration initial, Duration floor, Duration ceiling)
+    : floor_(floor),
+      ceiling_(std::max(floor, ceiling)),
+      srtt_(0),
+      rttvar_(0),
+      rto_(0),
+      has_sample_(false) {
+    rto_ = Clamp(initial);
+}
+
+void RttEstimator::Sample(Duration rtt) {
+    rtt = std::max(rtt, Duration(0));
+    if (!has_sample_) {
+        srtt_ = rtt;
+        rttvar_ = rtt / 2;
+        has_sample_ = true;
+    } else {
+        // alpha = 1/8, beta = 1/4
+        Duration error = srtt_ > rtt ? srtt_ - rtt : rtt - srtt_;
+        rttvar_ = (rttvar_ * 3 + error) / 4;
+        srtt_ = (srtt_ * 7 + rtt) / 8;
+    }
+    rto_ = Clamp(srtt_ + std::max(kGranularity, rttvar_ * 4));
+}
+
+void RttEstimator::Backoff() {
+    rto_ = Clamp(rto_ * 2);
+}
+
+RttEstimator::Duration RttEstimator::Clamp(Duration rto) const {
+    return std::min(ceiling_, std::max(floor_, rto));
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,50 @@
+/**
+ * @file tftp_rtt_estimator.h
+ * @brief Per-session round-trip estimation driving the retransmission timeout
+ */
+
+#ifndef TFTP_RTT_ESTIMATOR_H_
+#define TFTP_RTT_ESTIMATOR_H_
+
+#include <chrono>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Retransmission timeout from smoothed RTT and RTT variance (RFC 6298)
+ *
+ * Callers apply Karn's rule: a round that was retransmitted must not be sampled, since its
+ * answer cannot be matched to one transmission. Each timeout doubles the RTO up to the
+ * ceiling; the next valid sample recomputes it from the estimate.
+ */
+class RttEstimator {
+public:
+    using Duration = std::chrono::microseconds;
+
+    // initial is used until the first sample; every RTO is clamped to [floor, ceiling]
+    RttEstimator(Duration initial, Duration floor, Duration ceiling);
+
+    void Sample(Duration rtt);
+    void Backoff();
+
+    Duration Rto() const { return rto_; }
+    Duration Srtt() const { return srtt_; }
+    Duration RttVar() const { return rttvar_; }
+    bool HasSample() const { return has_sample_; }
+
+private:
+    Duration Clamp(Duration rto) const;
+
+    Duration floor_;
+    Duration ceiling_;
+    Duration srtt_;
+    Duration rttvar_;
+    Duration rto_;
+    bool has_sample_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_RTT_ESTIMATOR_H_
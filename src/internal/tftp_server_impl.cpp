@@ -9,7 +9,10 @@
 #include "internal/tftp_server_impl.h"
 #include "tftp/tftp_packet.h"
 #include "tftp/tftp_logger.h"
-#include "tftp/tftp_util.h"
+#include "internal/tftp_file_io_impl.h"
+#include "internal/tftp_netascii.h"
+#include "internal/tftp_socket_impl.h"
+#include "internal/tftp_uring.h"
 #include <fstream>
 #include <sstream>
 #include <cstring>
@@ -21,6 +24,8 @@
 #include <chrono>
 #include <mutex>
 #include <unordered_map>
+#include <algorithm>
+#include <cctype>
 
 #ifdef _WIN32
 #include <process.h>
@@ -33,43 +38,208 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 #define CLOSESOCKET close
 #endif
 
 namespace tftpserver {
 namespace internal {
 
-constexpr int kMaxRetries = 5;
-constexpr int kRetryTimeoutMs = 1000;
+constexpr int kStopPollMs = 1000;  // Longest blocking receive, so that Stop() is noticed while a peer is silent
+constexpr size_t kIoStageThreads = 4;  // Disk reads and writes of different transfers in flight at once
 // kMaxPacketSize and kMaxDataSize are already defined in tftp_common.h, so not redefined here
 
-TftpServerImpl::TftpServerImpl(const std::string& root_dir, uint16_t port)
-    : root_dir_(root_dir),
-      port_(port),
+namespace {
+
+// Keeps a listener on one core so that its socket's receive queue stays cache-local
+void PinCurrentThread(size_t index) {
+#ifdef __linux__
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(index % cores, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        TFTP_WARN("Could not pin listener %zu to a core", index);
+    }
+#else
+    (void)index;
+#endif
+}
+
+bool SendInterrupted() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEINTR;
+#else
+    return errno == EINTR;
+#endif
+}
+
+bool SendBufferFull() {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAENOBUFS;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+#endif
+}
+
+// Rejects a request before its transfer exists
+void SendError(Metrics& metrics, TransferChannel& channel, ErrorCode code, const std::string& message) {
+    uint8_t buffer[codec::kHeaderSize + kMaxErrorMessageLength + 1];
+    size_t size = codec::EncodeError(buffer, sizeof(buffer), code, message);
+    if (size > 0 && channel.Send(buffer, size)) {
+        metrics.CountError(code);
+        metrics.Add(Metrics::kPacketsSent);
+    }
+}
+
+// Netascii requests get the line-end translation stage; octet ones use the source as created
+std::unique_ptr<ReadSource> ForMode(TransferMode mode, std::unique_ptr<ReadSource> source) {
+    if (mode != TransferMode::kNetAscii || !source) {
+        return source;
+    }
+    return std::make_unique<NetAsciiReadSource>(std::move(source));
+}
+
+std::unique_ptr<WriteSink> ForMode(TransferMode mode, std::unique_ptr<WriteSink> sink) {
+    if (mode != TransferMode::kNetAscii || !sink) {
+        return sink;
+    }
+    return std::make_unique<NetAsciiWriteSink>(std::move(sink));
+}
+
+} // namespace
+
+// Channel of the thread-pool engine: blocking sends on the transfer's own socket
+class TftpServerImpl::BlockingChannel : public TransferChannel {
+public:
+    BlockingChannel(TftpServerImpl& server,
+#ifdef _WIN32
+                    SOCKET sock,
+#else
+                    int sock,
+#endif
+                    const sockaddr_in& peer)
+        : server_(server), sock_(sock), peer_(peer) {}
+
+    bool Send(const uint8_t* data, size_t size) override { return server_.SendPacket(sock_, peer_, data, size); }
+    bool SendTo(const sockaddr_in& addr, const uint8_t* data, size_t size) override {
+        return server_.SendPacket(sock_, addr, data, size);
+    }
+
+    bool SendBatch(const net::OutgoingDatagram* datagrams, size_t count) override {
+        int sent = net::internal::SocketImpl::SendDatagrams(sock_, datagrams, count, true);
+        // Whatever the batch could not take goes through the blocking send one by one
+        size_t first_unsent = static_cast<size_t>(std::max(sent, 0));
+        return first_unsent == count || TransferChannel::SendBatch(datagrams + first_unsent, count - first_unsent);
+    }
+
+private:
+    TftpServerImpl& server_;
 #ifdef _WIN32
-      sockfd_(INVALID_SOCKET),
+    SOCKET sock_;
 #else
-      sockfd_(-1),
+    int sock_;
 #endif
+    sockaddr_in peer_;
+};
+
+TftpServerImpl::TftpServerImpl(const std::string& root_dir, uint16_t port)
+    : root_dir_(root_dir),
+      port_(port),
       running_(false),
       thread_pool_(nullptr),
-      secure_mode_(true),
-      max_transfer_size_(1024 * 1024 * 1024),  // 1MB
-      timeout_seconds_(5),
-      thread_pool_size_(std::thread::hardware_concurrency()) {
+      thread_pool_size_(std::thread::hardware_concurrency()),
+      pin_workers_(false),
+      engine_(TransferEngine::kThreadPool),
+      io_backend_(IoBackend::kPortable),
+      active_io_backend_(IoBackend::kPortable),
+      reactor_threads_(0),
+      listener_count_(1),
+      max_queued_requests_(kDefaultMaxQueuedRequests),
+      metrics_port_(0),
+      file_cache_(std::make_shared<FileCache>()),
+      callback_cache_(std::make_shared<CallbackCache>()),
+      io_stage_(std::make_shared<IoStage>(kIoStageThreads)) {
     if (!root_dir_.empty() && root_dir_.back() != '/' && root_dir_.back() != '\\') {
         root_dir_ += '/';
     }
     
-    // Set default callbacks
-    read_callback_ = TftpServerImpl::DefaultReadHandler;
-    write_callback_ = TftpServerImpl::DefaultWriteHandler;
+    // Default settings: empty factories select the built-in file source and sink
+    request_config_ = std::make_shared<RequestConfig>();
 }
 
 TftpServerImpl::~TftpServerImpl() {
     Stop();
 }
 
+void TftpServerImpl::SetReadCallback(std::function<bool(const std::string&, std::vector<uint8_t>&)> callback) {
+    // The generation goes into the snapshot with its factory: transfers that started earlier keep
+    // calling (and sharing the results of) the callback they were configured with
+    UpdateRequestConfig([&](RequestConfig& config) {
+        CallbackCache::Generation generation = callback_cache_->NewGeneration(std::move(callback));
+        config.read_source_factory = [cache = callback_cache_, generation]() -> std::unique_ptr<ReadSource> {
+            return std::make_unique<CallbackReadSource>(cache, generation);
+        };
+    });
+}
+
+void TftpServerImpl::InvalidateReadCallbackCache(const std::string& filename) {
+    if (filename.empty()) {
+        callback_cache_->Clear();
+        return;
+    }
+    // Same key the request handler passes to the callback
+    std::string path;
+    if (!path_validator_.Resolve(filename, LoadRequestConfig()->secure_mode, path)) {
+        return;
+    }
+    callback_cache_->Invalidate(path);
+}
+
+void TftpServerImpl::SetWriteCallback(std::function<bool(const std::string&, const std::vector<uint8_t>&)> callback) {
+    SetWriteSinkFactory([callback = std::move(callback)]() -> std::unique_ptr<WriteSink> {
+        return std::make_unique<CallbackWriteSink>(callback);
+    });
+}
+
+bool TftpServerImpl::ReloadPackFile() {
+    std::string path;
+    {
+        std::shared_lock<std::shared_mutex> lock(config_mutex_);
+        path = pack_path_;
+    }
+    std::shared_ptr<const PackFile> pack;
+    if (!path.empty()) {
+        pack = PackFile::Open(path);
+        if (!pack) {
+            return false;
+        }
+        TFTP_INFO("Serving reads from pack %s (%zu files)", path.c_str(), pack->GetFileCount());
+    }
+    // Transfers in flight keep reading the pack they opened
+    std::atomic_store(&pack_, std::move(pack));
+    return true;
+}
+
+void TftpServerImpl::SetThreadPoolSize(size_t size) {
+    if (size == 0) {
+        size = std::max(1u, std::thread::hardware_concurrency());
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(config_mutex_);
+        thread_pool_size_ = size;
+    }
+    // Workers are started or retired in place, without dropping the transfers they serve
+    std::lock_guard<std::mutex> lock(thread_pool_mutex_);
+    if (thread_pool_) {
+        thread_pool_->Resize(size);
+    }
+}
+
 bool TftpServerImpl::Start() {
     if (running_) {
         TFTP_INFO("TFTP server is already running");
@@ -82,43 +252,151 @@ bool TftpServerImpl::Start() {
         return false;
     }
 #endif
-    sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    TransferEngine engine;
+    IoBackend io_backend;
+    size_t reactor_threads;
+    size_t listener_count;
+    TransferSocketConfig transfer_socket_config;
+    uint16_t metrics_port;
+    size_t thread_pool_size;
+    bool pin_workers;
+    {
+        std::shared_lock<std::shared_mutex> lock(config_mutex_);
+        engine = engine_;
+        io_backend = io_backend_;
+        thread_pool_size = thread_pool_size_;
+        pin_workers = pin_workers_;
+        reactor_threads = reactor_threads_;
+        listener_count = listener_count_;
+        transfer_socket_config = transfer_socket_config_;
+        metrics_port = metrics_port_;
+    }
+    if (listener_count == 0) {
+        listener_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (!path_validator_.SetRoot(root_dir_)) {
+        return false;
+    }
+    if (!ReloadPackFile()) {
+        return false;
+    }
+    if (io_backend == IoBackend::kIoUring && !IoUringAvailable()) {
+        TFTP_WARN("io_uring backend not available, using the portable backend");
+        io_backend = IoBackend::kPortable;
+    }
+    active_io_backend_ = io_backend;
+#ifndef SO_REUSEPORT
+    if (listener_count > 1) {
+        TFTP_WARN("SO_REUSEPORT not supported, using a single listener");
+        listener_count = 1;
+    }
+#endif
+    
+    // With several listeners the kernel spreads incoming requests across the sockets
+    std::vector<std::unique_ptr<ListenerShard>> shards;
+    for (size_t i = 0; i < listener_count; ++i) {
+        auto shard = std::make_unique<ListenerShard>(i);
+        if (!OpenListenSocket(*shard, listener_count > 1)) {
+            for (auto& opened : shards) {
+                CLOSESOCKET(opened->sock);
+            }
+            return false;
+        }
+        shards.push_back(std::move(shard));
+    }
+    if (!transfer_sockets_.Open(transfer_socket_config)) {
+        for (auto& shard : shards) {
+            CLOSESOCKET(shard->sock);
+        }
+        return false;
+    }
+    
+    if (engine == TransferEngine::kEventDriven) {
+        // Sessions are multiplexed on reactor threads instead of occupying a pool worker each
+        reactor_ = std::make_unique<TftpReactor>(reactor_threads,
+            [this](const TftpPacket& request, const sockaddr_in& client_addr, TransferChannel& channel) {
+                return CreateTransfer(request, client_addr, channel, true);
+            }, io_backend == IoBackend::kIoUring);
+        if (!reactor_->Start()) {
+            TFTP_ERROR("Reactor start failed");
+            reactor_.reset();
+            transfer_sockets_.Close();
+            for (auto& shard : shards) {
+                CLOSESOCKET(shard->sock);
+            }
+            return false;
+        }
+    } else {
+        // Initialize thread pool with mutex protection
+        std::lock_guard<std::mutex> lock(thread_pool_mutex_);
+        thread_pool_ = std::make_unique<TftpThreadPool>(thread_pool_size, pin_workers);
+    }
+    
+    running_ = true;
+    {
+        std::lock_guard<std::mutex> lock(listener_mutex_);
+        shards_ = std::move(shards);
+        for (auto& shard : shards_) {
+            shard->thread = std::thread(&TftpServerImpl::ServerLoop, this, std::ref(*shard), shards_.size() > 1);
+        }
+    }
+    if (metrics_port != 0) {
+        // The scrape endpoint is optional: the server keeps serving TFTP if it cannot listen
+        metrics_endpoint_ = std::make_unique<MetricsEndpoint>([this]() { return FormatPrometheusMetrics(GetStats()); });
+        if (!metrics_endpoint_->Start(metrics_port)) {
+            TFTP_WARN("Metrics endpoint disabled");
+            metrics_endpoint_.reset();
+        }
+    }
+    const char* backend_name = io_backend == IoBackend::kIoUring ? "io_uring" : "portable";
+    if (reactor_) {
+        TFTP_INFO("TFTP server started on port %d with %zu listeners and %zu event loop threads (%s I/O)",
+                 port_, listener_count, reactor_->GetThreadCount(), backend_name);
+    } else {
+        TFTP_INFO("TFTP server started on port %d with %zu listeners and %zu worker threads (%s I/O)",
+                 port_, listener_count, thread_pool_size, backend_name);
+    }
+    return true;
+}
+
+bool TftpServerImpl::OpenListenSocket(ListenerShard& shard, bool reuse_port) {
+    shard.sock = socket(AF_INET, SOCK_DGRAM, 0);
 #ifdef _WIN32
-    if (sockfd_ == INVALID_SOCKET) {
+    if (shard.sock == INVALID_SOCKET) {
 #else
-    if (sockfd_ < 0) {
+    if (shard.sock < 0) {
 #endif
         TFTP_ERROR("UDP socket creation failed");
         return false;
     }
     int opt = 1;
 #ifdef _WIN32
-    if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt)) < 0) {
+    if (setsockopt(shard.sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt)) < 0) {
 #else
-    if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    if (setsockopt(shard.sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
 #endif
         TFTP_ERROR("Socket option setting failed");
-        CLOSESOCKET(sockfd_);
+        CLOSESOCKET(shard.sock);
+        return false;
+    }
+#ifdef SO_REUSEPORT
+    if (reuse_port && setsockopt(shard.sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        TFTP_ERROR("SO_REUSEPORT setting failed");
+        CLOSESOCKET(shard.sock);
         return false;
     }
+#else
+    (void)reuse_port;
+#endif
     sockaddr_in addr = {};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(port_);
-    if (bind(sockfd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    if (bind(shard.sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         TFTP_ERROR("UDP socket bind failed");
-        CLOSESOCKET(sockfd_);
+        CLOSESOCKET(shard.sock);
         return false;
     }
-    // Initialize thread pool with mutex protection
-    {
-        std::lock_guard<std::mutex> lock(thread_pool_mutex_);
-        thread_pool_ = std::make_unique<TftpThreadPool>(thread_pool_size_);
-    }
-    
-    running_ = true;
-    server_thread_ = std::thread(&TftpServerImpl::ServerLoop, this);
-    TFTP_INFO("TFTP server started on port %d with %zu worker threads", port_, thread_pool_size_);
     return true;
 }
 
@@ -128,7 +406,29 @@ void TftpServerImpl::Stop() {
     // Set flag first so ServerLoop exits early
     running_ = false;
     
-    // Shutdown thread pool first to stop accepting new tasks
+    if (metrics_endpoint_) {
+        metrics_endpoint_->Stop();
+        metrics_endpoint_.reset();
+    }
+    
+    // Close sockets to wake the receive threads, then wait for them
+    {
+        std::lock_guard<std::mutex> lock(listener_mutex_);
+        for (auto& shard : shards_) {
+#ifndef _WIN32
+            // close() alone does not wake a recvfrom() blocked in ServerLoop on Linux
+            shutdown(shard->sock, SHUT_RDWR);
+#endif
+            CLOSESOCKET(shard->sock);
+        }
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+    
+    // No listener submits any more; unfinished transfers see running_ cleared and abort
     {
         std::lock_guard<std::mutex> lock(thread_pool_mutex_);
         if (thread_pool_) {
@@ -136,26 +436,16 @@ void TftpServerImpl::Stop() {
             thread_pool_.reset();
         }
     }
-    
-    // Close socket
-    if (
-#ifdef _WIN32
-        sockfd_ != INVALID_SOCKET
-#else
-        sockfd_ >= 0
-#endif
-    ) {
-        CLOSESOCKET(sockfd_);
-#ifdef _WIN32
-        sockfd_ = INVALID_SOCKET;
-#else
-        sockfd_ = -1;
-#endif
+    if (reactor_) {
+        reactor_->Stop();
+        reactor_.reset();
     }
+    transfer_sockets_.Close();
     
-    // Wait for thread to finish
-    if (server_thread_.joinable()) {
-        server_thread_.join();
+    // Every session lease has been released with its transfer
+    {
+        std::lock_guard<std::mutex> lock(listener_mutex_);
+        shards_.clear();
     }
     
 #ifdef _WIN32
@@ -172,28 +462,50 @@ bool TftpServerImpl::IsRunning() const {
         return false;
     }
     
-    // Also check if socket is valid
-#ifdef _WIN32
-    if (sockfd_ == INVALID_SOCKET) {
-#else
-    if (sockfd_ < 0) {
-#endif
-        // If socket is invalid, server is not running
-        return false;
-    }
-    
-    // Also check if thread is joinable
-    if (!server_thread_.joinable()) {
-        // If thread is not joinable, server is not running
-        return false;
-    }
-    
-    // If all conditions are met, server is running
-    return true;
+    // Also check that the listeners are up
+    std::lock_guard<std::mutex> lock(listener_mutex_);
+    return !shards_.empty();
+}
+
+std::vector<ListenerStats> TftpServerImpl::GetListenerStats() const {
+    std::lock_guard<std::mutex> lock(listener_mutex_);
+    std::vector<ListenerStats> stats;
+    stats.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        ListenerStats shard_stats;
+        shard_stats.requests = shard->requests.load();
+        shard_stats.duplicates = shard->duplicates.load();
+        shard_stats.dropped = shard->dropped.load();
+        shard_stats.rejected = shard->rejected.load();
+        shard_stats.active_sessions = shard->sessions.Size();
+        stats.push_back(shard_stats);
+    }
+    return stats;
+}
+
+ServerStats TftpServerImpl::GetStats() const {
+    ServerStats stats = metrics_.Snapshot();
+    std::lock_guard<std::mutex> lock(thread_pool_mutex_);
+    if (thread_pool_) {
+        stats.pool_active_tasks = thread_pool_->GetActiveTaskCount();
+        stats.pool_queued_tasks = thread_pool_->GetQueuedTaskCount();
+    }
+    stats.buffer_pool = BufferPool::GetStats();
+    return stats;
 }
 
-void TftpServerImpl::ServerLoop() {
+void TftpServerImpl::ServerLoop(ListenerShard& shard, bool pin_to_core) {
+    if (pin_to_core) {
+        PinCurrentThread(shard.index);
+    }
+#ifdef TFTP_HAVE_IO_URING
+    if (active_io_backend_ == IoBackend::kIoUring && UringServerLoop(shard)) {
+        return;
+    }
+#endif
     while (running_) {
+        // Only RRQ/WRQ arrive here; RFC 2347 caps a request with options at 512 octets,
+        // so the negotiated block size never affects this buffer
         uint8_t buffer[kMaxPacketSize];
         sockaddr_in client_addr = {};
 #ifdef _WIN32
@@ -201,437 +513,274 @@ void TftpServerImpl::ServerLoop() {
 #else
         socklen_t addrlen = sizeof(client_addr);
 #endif
-        int recvlen = recvfrom(sockfd_, (char*)buffer, sizeof(buffer), 0,
+        int recvlen = recvfrom(shard.sock, (char*)buffer, sizeof(buffer), 0,
                              (struct sockaddr*)&client_addr, &addrlen);
-        if (recvlen > 0) {
-            TFTP_INFO("Received packet from client: %zu bytes", static_cast<size_t>(recvlen));
-            // Submit client handling to thread pool with proper synchronization
-            {
-                std::lock_guard<std::mutex> lock(thread_pool_mutex_);
-                if (thread_pool_ && !thread_pool_->IsShuttingDown()) {
-                    try {
-                        // Create vector once and move it to avoid copy
-                        std::vector<uint8_t> packet_data;
-                        packet_data.reserve(recvlen);
-                        packet_data.assign(buffer, buffer + recvlen);
-                        
-                        thread_pool_->Submit([this, packet_data = std::move(packet_data), client_addr]() {
-                            this->HandleClient(packet_data, client_addr);
-                        });
-                    } catch (const std::exception& e) {
-                        TFTP_ERROR("Failed to submit client task to thread pool: %s", e.what());
-                    }
-                } else {
-                    TFTP_WARN("Thread pool not available, dropping client request");
-                }
-            }
+        if (recvlen <= 0) {
+            continue;
         }
+        DispatchRequest(shard, buffer, static_cast<size_t>(recvlen), client_addr);
     }
 }
 
-void TftpServerImpl::HandleClient(const std::vector<uint8_t>& initial_packet,
-                                   const sockaddr_in& client_addr) {
-    try {
-        TFTP_INFO("HandleClient called with packet size: %zu", initial_packet.size());
-        
-        // Debug: dump packet contents in hex
-        std::string hex_dump;
-        for (size_t i = 0; i < std::min(initial_packet.size(), size_t(100)); ++i) {
-            char buf[4];
-            snprintf(buf, sizeof(buf), "%02x ", initial_packet[i]);
-            hex_dump += buf;
+#ifdef TFTP_HAVE_IO_URING
+bool TftpServerImpl::UringServerLoop(ListenerShard& shard) {
+    // Requests land in provided buffers; the multishot receive is re-armed only when the
+    // buffers ran out. The wait times out so that Stop is noticed without a wakeup
+    constexpr int kStopCheckMs = 100;
+    IoUring ring;
+    BufferRing buffers;
+    if (!ring.Init(8) || !buffers.Init(ring, 0, 64, sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + 2048)) {
+        TFTP_WARN("Listener io_uring setup failed, using recvfrom");
+        return false;
+    }
+    msghdr pattern = {};
+    pattern.msg_namelen = sizeof(sockaddr_in);
+    std::vector<io_uring_cqe> completions;
+    bool armed = false;
+    while (running_) {
+        if (!armed) {
+            io_uring_sqe* sqe = ring.GetSqe();
+            if (sqe == nullptr) {
+                return false;
+            }
+            PrepareRecvMsgMultishot(sqe, shard.sock, false, &pattern, buffers.Group(), 0);
+            armed = true;
         }
-        TFTP_INFO("Packet hex dump (first 100 bytes): %s", hex_dump.c_str());
-        
-        TftpPacket packet;
-        if (!packet.Deserialize(initial_packet)) {
-            TFTP_ERROR("Invalid packet received");
-            return;
+        ring.SubmitAndWait(1, kStopCheckMs);
+        completions.clear();
+        ring.Reap(completions);
+        for (const io_uring_cqe& cqe : completions) {
+            if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+                armed = false;
+            }
+            uint16_t id = 0;
+            if (!CompletionBuffer(cqe, id)) {
+                continue;
+            }
+            sockaddr_in client_addr;
+            const uint8_t* payload = nullptr;
+            size_t length = 0;
+            if (cqe.res > 0 &&
+                ParseRecvMsg(buffers.Buffer(id), static_cast<size_t>(cqe.res), pattern, client_addr, payload, length) &&
+                length > 0) {
+                DispatchRequest(shard, payload, length, client_addr);
+            }
+            buffers.Recycle(id);
         }
-        TFTP_INFO("Packet deserialized successfully, OpCode: %d", static_cast<int>(packet.GetOpCode()));
-#ifdef _WIN32
-    SOCKET client_sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (client_sock == INVALID_SOCKET) {
-#else
-    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (client_sock < 0) {
+    }
+    return true;
+}
 #endif
-        TFTP_ERROR("Client socket creation failed");
+
+void TftpServerImpl::DispatchRequest(ListenerShard& shard, const uint8_t* data, size_t size,
+                                     const sockaddr_in& client_addr) {
+    TFTP_INFO("Received packet from client: %zu bytes", size);
+    shard.requests++;
+    
+    // A client retransmitting its request before our first reply must not get a second session
+    SessionLease lease = shard.sessions.TryAcquire(client_addr, data, size);
+    if (!lease) {
+        TFTP_INFO("Duplicate request from port %d ignored", ntohs(client_addr.sin_port));
+        shard.duplicates++;
         return;
     }
-    TFTP_INFO("Client socket created successfully");
     
-    sockaddr_in client = client_addr;
-    client.sin_port = htons(0);
-    if (bind(client_sock, (struct sockaddr*)&client, sizeof(client)) < 0) {
-        TFTP_ERROR("Client socket bind failed");
-        CLOSESOCKET(client_sock);
+    // Backpressure: past the queue bound a new request is refused instead of waiting
+    // behind requests whose clients may already have given up
+    size_t max_queued = max_queued_requests_.load(std::memory_order_relaxed);
+    if (max_queued > 0 && GetQueuedRequestCount() >= max_queued) {
+        TFTP_WARN("Request queue full (%zu), rejecting request from port %d", max_queued,
+                  ntohs(client_addr.sin_port));
+        RejectBusy(shard, client_addr);
         return;
     }
-    TFTP_INFO("Client socket bound successfully");
-    TransferMode mode = packet.GetMode();
-    std::string filename = packet.GetFilename();
     
-    // Read configuration with shared lock to avoid race conditions
-    bool is_secure_mode;
-    {
-        std::shared_lock<std::shared_mutex> lock(config_mutex_);
-        is_secure_mode = secure_mode_;
+    // With a port range every port may be taken; the client is told rather than left to time out
+    TransferSocketLease socket = transfer_sockets_.Acquire(reactor_ != nullptr);
+    if (!socket) {
+        TFTP_WARN("No transfer socket available, rejecting request from port %d", ntohs(client_addr.sin_port));
+        RejectBusy(shard, client_addr);
+        return;
     }
     
-    TFTP_INFO("Processing packet - OpCode: %d, filename: %s, secure_mode: %s", 
-             static_cast<int>(packet.GetOpCode()), filename.c_str(), is_secure_mode ? "true" : "false");
-    if (is_secure_mode && !util::IsPathSecure(filename, root_dir_)) {
-        TFTP_INFO("Path security check failed for: %s", filename.c_str());
-        SendError(client_sock, client_addr, ErrorCode::kAccessViolation,
-                 "Access denied");
-        CLOSESOCKET(client_sock);
+    if (reactor_) {
+        if (!reactor_->Submit(PooledBuffer(data, size), client_addr, std::move(socket),
+                              std::move(lease))) {
+            TFTP_WARN("Reactor not available, dropping client request");
+            shard.dropped++;
+        }
         return;
     }
-    std::string filepath = util::NormalizePath(root_dir_ + filename);
-    switch (packet.GetOpCode()) {
-        case OpCode::kReadRequest:
-            TFTP_INFO("Processing Read Request for file: %s", filename.c_str());
-            HandleReadRequest(client_sock, client_addr, filepath, mode);
-            break;
-        case OpCode::kWriteRequest:
-            TFTP_INFO("Processing Write Request for file: %s (options: %zu)", filename.c_str(), packet.GetOptions().size());
-            HandleWriteRequest(client_sock, client_addr, filepath, mode, packet);
-            break;
-        default:
-            TFTP_ERROR("Unknown operation code: %d", static_cast<int>(packet.GetOpCode()));
-            SendError(client_sock, client_addr, ErrorCode::kIllegalOperation,
-                     "Illegal operation");
-            break;
-    }
-    CLOSESOCKET(client_sock);
-    } catch (const std::exception& e) {
-        TFTP_ERROR("Exception in HandleClient: %s", e.what());
-    } catch (...) {
-        TFTP_ERROR("Unknown exception in HandleClient");
+    
+    // Stop joins the listeners before releasing the pool, so it is used here without locking
+    if (thread_pool_ && !thread_pool_->IsShuttingDown()) {
+        // A refused job is destroyed with its socket and session leases
+        PooledBuffer packet_data(data, size);
+        if (!thread_pool_->Post([this, packet_data = std::move(packet_data), client_addr,
+                                 socket = std::move(socket), lease = std::move(lease)]() mutable {
+                this->HandleClient(packet_data, client_addr, std::move(socket));
+                lease.Release();
+            })) {
+            TFTP_ERROR("Failed to post client task to thread pool");
+            shard.dropped++;
+        }
+    } else {
+        TFTP_WARN("Thread pool not available, dropping client request");
+        shard.dropped++;
     }
 }
 
-void TftpServerImpl::HandleReadRequest(
-#ifdef _WIN32
-    SOCKET sock,
-#else
-    int sock,
-#endif
-    const sockaddr_in& client_addr,
-    const std::string& filepath, TransferMode mode) {
-    TFTP_INFO("File read request: %s", filepath.c_str());
+size_t TftpServerImpl::GetQueuedRequestCount() const {
+    // Stop joins the listeners before releasing the engines, so they are used here without locking
+    if (reactor_) {
+        return reactor_->GetPendingCount();
+    }
+    return thread_pool_ ? thread_pool_->GetQueuedTaskCount() : 0;
+}
 
-    (void)mode; // Suppress unused parameter warning
+void TftpServerImpl::RejectBusy(ListenerShard& shard, const sockaddr_in& client_addr) {
+    uint8_t error[codec::kHeaderSize + kMaxErrorMessageLength + 1];
+    size_t size = codec::EncodeError(error, sizeof(error), ErrorCode::kNotDefined, "Server busy");
+    if (size > 0 && SendPacket(shard.sock, client_addr, error, size)) {
+        metrics_.CountError(ErrorCode::kNotDefined);
+        metrics_.Add(Metrics::kPacketsSent);
+    }
+    shard.rejected++;
+}
 
-    // Read data with callback protection
-    std::vector<uint8_t> file_data;
-    bool success;
-    size_t max_size;
-    int timeout_secs;
-    {
-        std::shared_lock<std::shared_mutex> lock(config_mutex_);
-        success = read_callback_(filepath, file_data);
-        max_size = max_transfer_size_;
-        timeout_secs = timeout_seconds_;
-    }
-    
-    if (!success) {
-        SendError(sock, client_addr, ErrorCode::kFileNotFound, "File not found");
-        return;
-    }
-    
-    if (file_data.size() > max_size) {
-        SendError(sock, client_addr, ErrorCode::kDiskFull, "File size too large");
-        return;
-    }
-    
-    // Send data in blocks
-    uint16_t block_number = 1;
-    size_t offset = 0;
-    bool last_packet = false;
-    
-    do {
-        // Prepare next data block
-        size_t remaining = file_data.size() - offset;
-        size_t block_size = (remaining > kMaxDataSize) ? kMaxDataSize : remaining;
+void TftpServerImpl::HandleClient(const PooledBuffer& initial_packet,
+                                   const sockaddr_in& client_addr, TransferSocketLease socket) {
+    try {
+        TFTP_INFO("HandleClient called with packet size: %zu", initial_packet.Size());
         
-        // Create and send data packet with optimized vector creation
-        std::vector<uint8_t> block_data;
-        block_data.reserve(block_size);
-        block_data.assign(file_data.begin() + offset, file_data.begin() + offset + block_size);
+        TFTP_LOG_HEX(kLogInfo, "Packet hex dump", initial_packet.Data(), std::min(initial_packet.Size(), size_t(100)));
         
-        TftpPacket data_packet = TftpPacket::CreateData(block_number, std::move(block_data));
-        if (!SendPacket(sock, client_addr, data_packet)) {
-            TFTP_ERROR("Data packet send failed");
+        TftpPacket packet;
+        if (!packet.Deserialize(initial_packet.Data(), initial_packet.Size())) {
+            TFTP_ERROR("Invalid packet received");
             return;
         }
-        
-        // Wait for ACK
-        TftpPacket ack_packet;
-        sockaddr_in ack_addr = {};
-        if (!ReceivePacket(sock, ack_addr, ack_packet, timeout_secs * 1000)) {
-            TFTP_ERROR("ACK timeout");
-            return;
+#ifdef TFTP_HAVE_IO_URING
+        // Sources opened by this worker read their windows through its own ring
+        if (active_io_backend_ == IoBackend::kIoUring) {
+            FileRing::EnableForThisThread(true);
         }
-        
-        // Validate ACK
-        if (ack_packet.GetOpCode() != OpCode::kAcknowledge || ack_packet.GetBlockNumber() != block_number) {
-            TFTP_ERROR("Invalid ACK");
-            return;
+#endif
+        TFTP_INFO("Packet deserialized successfully, OpCode: %d", static_cast<int>(packet.GetOpCode()));
+        // The pooled socket is the transfer's TID; it goes back to the pool when socket is destroyed
+        BlockingChannel channel(*this, socket.Get(), client_addr);
+        std::unique_ptr<Transfer> transfer = CreateTransfer(packet, client_addr, channel, false);
+        if (transfer) {
+            RunTransfer(socket.Get(), *transfer);
         }
-        
-        // Prepare next block
-        offset += block_size;
-        block_number++;
-        
-        // Check if it's the last packet
-        last_packet = (block_size < kMaxDataSize);
-        
-    } while (!last_packet);
-    
-    TFTP_INFO("File transfer completed: %s (%zu bytes)", filepath.c_str(), file_data.size());
+    } catch (const std::exception& e) {
+        TFTP_ERROR("Exception in HandleClient: %s", e.what());
+    } catch (...) {
+        TFTP_ERROR("Unknown exception in HandleClient");
+    }
 }
 
-void TftpServerImpl::HandleWriteRequest(
-#ifdef _WIN32
-    SOCKET sock,
-#else
-    int sock,
-#endif
-    const sockaddr_in& client_addr,
-    const std::string& filepath, TransferMode mode, const TftpPacket& packet) {
-    TFTP_INFO("File write request: %s", filepath.c_str());
+std::unique_ptr<Transfer> TftpServerImpl::CreateTransfer(const TftpPacket& packet, const sockaddr_in& client_addr,
+                                                         TransferChannel& channel, bool allow_multicast) {
+    std::string filename = packet.GetFilename();
     
-    (void)mode; // Suppress unused parameter warning
+    // One snapshot for the whole request, loaded without a lock; it stays alive (and unchanged)
+    // while the factories run, whatever setters are called meanwhile
+    std::shared_ptr<const RequestConfig> settings = LoadRequestConfig();
+    bool is_secure_mode = settings->secure_mode;
+    TransferConfig config;
+    config.max_size = settings->max_transfer_size;
+    config.timeout_secs = settings->timeout_seconds;
+    config.retransmit_floor_ms = settings->retransmit_floor_ms;
+    config.metrics = &metrics_;
+    config.rate_limiter = &rate_limiter_;
     
-    // Read configuration once to avoid multiple locks
-    size_t max_size;
-    int timeout_secs;
-    {
-        std::shared_lock<std::shared_mutex> lock(config_mutex_);
-        max_size = max_transfer_size_;
-        timeout_secs = timeout_seconds_;
-    }
-    
-    // Get expected file size from tsize option
-    size_t expected_file_size = 0;
-    bool has_expected_size = false;
-    if (packet.HasOption("tsize")) {
-        std::string tsize_str = packet.GetOption("tsize");
-        try {
-            expected_file_size = std::stoull(tsize_str);
-            has_expected_size = true;
-            TFTP_INFO("Expected file size from tsize option: %zu bytes", expected_file_size);
-        } catch (const std::exception& e) {
-            TFTP_WARN("Invalid tsize option value: %s, error: %s", tsize_str.c_str(), e.what());
-        }
+    TFTP_INFO("Processing packet - OpCode: %d, filename: %s, secure_mode: %s", 
+             static_cast<int>(packet.GetOpCode()), filename.c_str(), is_secure_mode ? "true" : "false");
+    // Reads served from a pack look the name up in its index: no filesystem access at all
+    std::shared_ptr<const PackFile> pack;
+    if (packet.GetOpCode() == OpCode::kReadRequest && !settings->read_source_factory) {
+        pack = std::atomic_load(&pack_);
+    }
+    if (pack ? !PackFile::NormalizeName(filename, is_secure_mode, config.filepath)
+             : !path_validator_.Resolve(filename, is_secure_mode, config.filepath)) {
+        TFTP_INFO("Path security check failed for: %s", filename.c_str());
+        SendError(metrics_, channel, ErrorCode::kAccessViolation, "Access denied");
+        return nullptr;
     }
     
-    // If options are present, send OACK, otherwise send normal ACK
-    if (!packet.GetOptions().empty()) {
-        TFTP_INFO("WRQ contains options, sending OACK");
-        
-        // Create OACK packet (manually serialize)
-        std::vector<uint8_t> oack_data;
-        
-        // Add OpCode::kOACK (6) (network byte order)
-        uint16_t oack_opcode_network = htons(6);
-        oack_data.resize(2);
-        std::memcpy(&oack_data[0], &oack_opcode_network, sizeof(uint16_t));
-        
-        // Add corresponding options
-        for (const auto& option : packet.GetOptions()) {
-            TFTP_INFO("Processing option: %s = %s", option.first.c_str(), option.second.c_str());
-            
-            // Add option name
-            for (char c : option.first) {
-                oack_data.push_back(static_cast<uint8_t>(c));
-            }
-            oack_data.push_back(0); // null-terminated
-            
-            // Add option value
-            std::string value = option.second;
-            
-            // Process tsize option
-            if (option.first == "tsize") {
-                // If client sent actual file size, echo it back
-                // If client sent 0, echo 0 back
-                value = option.second;
-                TFTP_INFO("Echoing back tsize value: %s", value.c_str());
-            }
-            // Process blksize option (support default 512 bytes)
-            else if (option.first == "blksize") {
-                try {
-                    int blksize = std::stoi(option.second);
-                    if (blksize >= 8 && blksize <= 65464) {
-                        // Accept if requested block size is within valid range
-                        value = option.second;
-                    } else {
-                        // Use default 512 if invalid
-                        value = "512";
-                    }
-                    TFTP_INFO("Block size negotiated: %s", value.c_str());
-                } catch (const std::exception& e) {
-                    TFTP_WARN("Invalid blksize option: %s, using default 512", option.second.c_str());
-                    value = "512";
-                }
-            }
-            // Process timeout option (accept 1-255 seconds range)
-            else if (option.first == "timeout") {
-                try {
-                    int timeout_val = std::stoi(option.second);
-                    if (timeout_val >= 1 && timeout_val <= 255) {
-                        value = option.second;
-                    } else {
-                        value = "6"; // Default value
-                    }
-                    TFTP_INFO("Timeout negotiated: %s seconds", value.c_str());
-                } catch (const std::exception& e) {
-                    TFTP_WARN("Invalid timeout option: %s, using default 6", option.second.c_str());
-                    value = "6";
+    switch (packet.GetOpCode()) {
+        case OpCode::kReadRequest:
+            TFTP_INFO("Processing Read Request for file: %s", filename.c_str());
+            // Without a free group the option is left out of the OACK and the client reads by unicast
+            if (allow_multicast && IsMulticastRequest(packet)) {
+                MulticastGroupLease group = multicast_groups_.Acquire();
+                if (group) {
+                    return std::make_unique<MulticastTransfer>(
+                        channel, client_addr, std::move(config), packet,
+                        ForMode(packet.GetMode(), MakeReadSource(*settings, pack)), std::move(group));
                 }
+                TFTP_WARN("No multicast group available, serving %s by unicast", filename.c_str());
             }
-            
-            for (char c : value) {
-                oack_data.push_back(static_cast<uint8_t>(c));
-            }
-            oack_data.push_back(0); // null-terminated
-        }
-        
-        // Send OACK (manual sendto)
-        TFTP_INFO("Sending OACK packet with %zu bytes", oack_data.size());
-        
-        // OACK hex dump
-        std::string hex_dump;
-        for (size_t i = 0; i < oack_data.size(); ++i) {
-            char buf[4];
-            snprintf(buf, sizeof(buf), "%02x ", oack_data[i]);
-            hex_dump += buf;
-        }
-        TFTP_INFO("OACK hex dump: %s", hex_dump.c_str());
-        
-        // Send OACK directly using sendto
-        int sent_bytes = sendto(sock, (const char*)oack_data.data(), static_cast<int>(oack_data.size()), 0,
-                              (struct sockaddr*)&client_addr, sizeof(client_addr));
-        if (sent_bytes != static_cast<int>(oack_data.size())) {
-            TFTP_ERROR("OACK send failed: sent=%d, expected=%zu", sent_bytes, oack_data.size());
-            return;
-        }
-        TFTP_INFO("OACK sent successfully (%d bytes)", sent_bytes);
-    } else {
-        // If no options, send normal ACK 0
-        TFTP_INFO("WRQ without options, sending ACK 0");
-        TftpPacket ack_packet = TftpPacket::CreateAck(0);
-        if (!SendPacket(sock, client_addr, ack_packet)) {
-            TFTP_ERROR("ACK 0 send failed");
-            return;
-        }
-        TFTP_INFO("ACK 0 sent successfully");
+            return std::make_unique<ReadTransfer>(channel, client_addr, std::move(config), packet,
+                                                  ForMode(packet.GetMode(), MakeReadSource(*settings, pack)));
+        case OpCode::kWriteRequest:
+            TFTP_INFO("Processing Write Request for file: %s (options: %zu)", filename.c_str(), packet.GetOptions().size());
+            return std::make_unique<WriteTransfer>(channel, client_addr, std::move(config), packet,
+                                                   MakeWriteSink(*settings, packet.GetMode()));
+        default:
+            TFTP_ERROR("Unknown operation code: %d", static_cast<int>(packet.GetOpCode()));
+            SendError(metrics_, channel, ErrorCode::kIllegalOperation, "Illegal operation");
+            return nullptr;
     }
-    
-    // Receive data
-    std::vector<uint8_t> file_data;
-    uint16_t expected_block = 1;
-    bool last_packet = false;
-    
-    // If OACK was sent, the first data packet starts from block 1
-    // If normal ACK was sent, the first data packet also starts from block 1
-    
-    do {
-        // Receive data packet (using client-specific socket)
-        TftpPacket data_packet;
-        sockaddr_in data_addr = {};
-        TFTP_INFO("Waiting for data packet #%d on client socket", expected_block);
-        
-        TFTP_INFO("Starting ReceivePacket call with timeout %d ms", timeout_secs * 1000);
-        if (!ReceivePacket(sock, data_addr, data_packet, timeout_secs * 1000)) {
-            TFTP_ERROR("Data packet receive timeout for block #%d", expected_block);
-            return;
-        }
-        TFTP_INFO("ReceivePacket completed successfully");
-        
-        // Validate data packet
-        TFTP_INFO("Checking packet opcode: %d", static_cast<int>(data_packet.GetOpCode()));
-        if (data_packet.GetOpCode() != OpCode::kData) {
-            TFTP_ERROR("Invalid packet (not a data packet): OpCode=%d", static_cast<int>(data_packet.GetOpCode()));
-            SendError(sock, client_addr, ErrorCode::kIllegalOperation, "Illegal operation");
-            return;
-        }
-        TFTP_INFO("Packet opcode validation passed");
-        
-        TFTP_INFO("Checking block number: received=%d, expected=%d", data_packet.GetBlockNumber(), expected_block);
-        if (data_packet.GetBlockNumber() != expected_block) {
-            TFTP_ERROR("Invalid block number: %d (expected: %d)", data_packet.GetBlockNumber(), expected_block);
-            return;
+}
+
+void TftpServerImpl::RunTransfer(
+#ifdef _WIN32
+    SOCKET sock,
+#else
+    int sock,
+#endif
+    Transfer& transfer) {
+    // Receive buffer sized for the negotiated block size, reused for every datagram; each
+    // PacketView points into it and is consumed before the next receive
+    PooledBuffer recv_buffer(std::max(kMaxPacketSize, transfer.BlockSize() + codec::kHeaderSize));
+    PacketView packet;
+    // Disk work on the I/O stage is waited for here, between packets, instead of inside the transfer
+    auto io_completions = std::make_shared<IoCompletions>();
+    transfer.SetIoNotifier(IoCompletions::Notifier(io_completions, 0));
+    transfer.Start(Transfer::Clock::now());
+    
+    std::vector<uint64_t> io_ready;
+    while (!transfer.IsFinished()) {
+        if (!running_) {
+            transfer.Abort("server stopping");
+            break;
         }
-        TFTP_INFO("Block number validation passed");
-        
-        // Add data
-        const std::vector<uint8_t>& block_data = data_packet.GetData();
-        size_t prev_size = file_data.size();
-        file_data.insert(file_data.end(), block_data.begin(), block_data.end());
-        TFTP_INFO("Received data block #%d, prev_size=%zu, block_size=%zu bytes, total=%zu bytes", 
-                 expected_block, prev_size, block_data.size(), file_data.size());
         
-        // Send ACK (from client-specific socket to source address)
-        TFTP_INFO("Creating ACK packet for block #%d", expected_block);
-        TftpPacket ack_packet = TftpPacket::CreateAck(expected_block);
-        TFTP_INFO("ACK packet created, attempting to send to data source");
-        
-        if (!SendPacket(sock, data_addr, ack_packet)) {
-            TFTP_ERROR("ACK send failed for block #%d", expected_block);
-            return;
+        // Datagrams arriving meanwhile wait in the socket; the transfer would ignore them anyway
+        if (transfer.AwaitingIo()) {
+            if (io_completions->Wait(std::chrono::milliseconds(kStopPollMs))) {
+                io_ready.clear();
+                io_completions->Take(io_ready);
+                transfer.HandleIoReady(Transfer::Clock::now());
+            }
+            continue;
         }
-        TFTP_INFO("Sent ACK for block #%d successfully", expected_block);
-        
-        // Prepare next block
-        expected_block++;
-        
-        // Check if it's the last packet
-        // RFC 1350: Transfer ends when data packet size < 512 bytes
-        // When using tsize option, still need to wait for termination packet if file size is multiple of 512
-        bool size_based_completion = (block_data.size() < kMaxDataSize);
-        last_packet = size_based_completion;
         
-        TFTP_INFO("Block #%d completion check: size_based=%s (%zu<%zu), is_last=%s", 
-                 expected_block-1, 
-                 size_based_completion ? "true" : "false", block_data.size(), kMaxDataSize,
-                 last_packet ? "YES" : "NO");
+        // Wait in slices so that Stop() is noticed while a peer is silent
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            transfer.Deadline() - Transfer::Clock::now()).count();
+        int wait_ms = static_cast<int>(std::max<long long>(0, std::min<long long>(remaining, kStopPollMs)));
         
-        // File size limit check
-        if (file_data.size() > max_size) {
-            TFTP_ERROR("File size exceeded limit: %zu > %zu", file_data.size(), max_size);
-            SendError(sock, client_addr, ErrorCode::kDiskFull, "File size too large");
-            return;
-        }
-        
-        // Additional safety check: if using tsize option and received data exceeds expected size significantly
-        if (has_expected_size && file_data.size() > expected_file_size + kMaxDataSize) {
-            TFTP_ERROR("Received data significantly exceeds tsize: %zu > %zu + %zu", 
-                      file_data.size(), expected_file_size, kMaxDataSize);
-            SendError(sock, client_addr, ErrorCode::kDiskFull, "File size exceeds tsize");
-            return;
+        sockaddr_in from = {};
+        if (ReceivePacket(sock, from, packet, wait_ms, recv_buffer, transfer.BlockSize())) {
+            transfer.HandlePacket(packet, from, Transfer::Clock::now());
+        } else if (Transfer::Clock::now() >= transfer.Deadline()) {
+            transfer.OnTimeout(Transfer::Clock::now());
         }
-        
-    } while (!last_packet);
-    
-    TFTP_INFO("All data received: %zu bytes, %d blocks. Writing to file...", file_data.size(), expected_block - 1);
-    
-    // Write file with callback protection
-    TFTP_INFO("Calling write_callback_ for path: %s", filepath.c_str());
-    bool success;
-    {
-        std::shared_lock<std::shared_mutex> lock(config_mutex_);
-        success = write_callback_(filepath, file_data);
-    }
-    if (!success) {
-        TFTP_ERROR("File write failed: %s", filepath.c_str());
-        SendError(sock, client_addr, ErrorCode::kAccessViolation, "File write failed");
-        return;
     }
-    
-    TFTP_INFO("File receive completed: %s (%zu bytes)", filepath.c_str(), file_data.size());
+    io_completions->Close();
 }
 
 bool TftpServerImpl::SendPacket(
@@ -640,33 +789,29 @@ bool TftpServerImpl::SendPacket(
 #else
     int sock,
 #endif
-    const sockaddr_in& addr, const TftpPacket& packet) {
-    std::vector<uint8_t> data = packet.Serialize();
-    
+    const sockaddr_in& addr, const uint8_t* data, size_t size) {
     // Send packet hex dump (for ACK packets)
-    if (packet.GetOpCode() == OpCode::kAcknowledge) {
-        std::string hex_dump;
-        for (size_t i = 0; i < data.size(); ++i) {
-            char buf[4];
-            snprintf(buf, sizeof(buf), "%02x ", data[i]);
-            hex_dump += buf;
-        }
-        TFTP_INFO("Sending ACK packet (block %d): %s", packet.GetBlockNumber(), hex_dump.c_str());
+    if (size == codec::kHeaderSize && data[1] == static_cast<uint8_t>(OpCode::kAcknowledge)) {
+        TFTP_LOG_HEX(kLogInfo, "Sending ACK packet", data, size);
     }
     
-    int retries = 0;
-    while (retries < kMaxRetries) {
-        int sent_bytes = sendto(sock, (const char*)data.data(), static_cast<int>(data.size()), 0,
+    while (true) {
+        int sent_bytes = sendto(sock, (const char*)data, static_cast<int>(size), 0,
                               (struct sockaddr*)&addr, sizeof(addr));
-        if (sent_bytes == static_cast<int>(data.size())) {
+        if (sent_bytes == static_cast<int>(size)) {
+            return true;
+        }
+        if (sent_bytes < 0 && SendInterrupted()) {
+            continue;
+        }
+        // A full socket buffer is indistinguishable from loss on the wire; the retransmit timer recovers
+        if (sent_bytes < 0 && SendBufferFull()) {
+            TFTP_WARN("Socket buffer full, packet dropped");
             return true;
         }
-        TFTP_WARN("Packet send failed, retrying... (%d/%d)", retries + 1, kMaxRetries);
-        std::this_thread::sleep_for(std::chrono::milliseconds(kRetryTimeoutMs));
-        retries++;
+        TFTP_ERROR("Packet send failed");
+        return false;
     }
-    TFTP_ERROR("Packet send failed, max retries reached");
-    return false;
 }
 
 bool TftpServerImpl::ReceivePacket(
@@ -675,8 +820,8 @@ bool TftpServerImpl::ReceivePacket(
 #else
     int sock,
 #endif
-    sockaddr_in& addr, TftpPacket& packet,
-    int timeout_ms) {
+    sockaddr_in& addr, PacketView& packet,
+    int timeout_ms, PooledBuffer& buffer, size_t block_size) {
     TFTP_INFO("ReceivePacket: Starting with timeout %d ms", timeout_ms);
     
     fd_set readfds;
@@ -701,7 +846,7 @@ bool TftpServerImpl::ReceivePacket(
     
     if (result <= 0) {
         if (result == 0) {
-            TFTP_WARN("Packet receive timeout");
+            TFTP_INFO("Packet receive timeout");
         } else {
             TFTP_ERROR("select() error");
         }
@@ -710,7 +855,6 @@ bool TftpServerImpl::ReceivePacket(
     
     TFTP_INFO("ReceivePacket: Socket is ready for reading");
     
-    uint8_t buffer[kMaxPacketSize] = {0};
 #ifdef _WIN32
     int addrlen = sizeof(addr);
 #else
@@ -718,7 +862,7 @@ bool TftpServerImpl::ReceivePacket(
 #endif
     
     TFTP_INFO("ReceivePacket: Calling recvfrom()");
-    int recv_bytes = recvfrom(sock, (char*)buffer, sizeof(buffer), 0,
+    int recv_bytes = recvfrom(sock, (char*)buffer.Data(), static_cast<int>(buffer.Size()), 0,
                              (struct sockaddr*)&addr, &addrlen);
     
     TFTP_INFO("ReceivePacket: recvfrom() returned %d bytes", recv_bytes);
@@ -728,129 +872,46 @@ bool TftpServerImpl::ReceivePacket(
         return false;
     }
     
-    TFTP_INFO("ReceivePacket: Attempting to deserialize %d bytes", recv_bytes);
-    if (!packet.Deserialize(std::vector<uint8_t>(buffer, buffer + recv_bytes))) {
+    TFTP_INFO("ReceivePacket: Attempting to parse %d bytes", recv_bytes);
+    if (!packet.Parse(buffer.Data(), static_cast<size_t>(recv_bytes), block_size)) {
         TFTP_ERROR("Invalid packet format");
         return false;
     }
     
-    TFTP_INFO("ReceivePacket: Packet deserialized successfully");
+    TFTP_INFO("ReceivePacket: Packet parsed successfully");
     return true;
 }
 
-void TftpServerImpl::SendError(
-#ifdef _WIN32
-    SOCKET sock,
-#else
-    int sock,
-#endif
-    const sockaddr_in& addr, ErrorCode code,
-    const std::string& message) {
-    TFTP_INFO("SendError called - code: %d, message: %s", static_cast<int>(code), message.c_str());
-    TftpPacket error_packet = TftpPacket::CreateError(code, message);
-    
-    // Attempt to send error packet multiple times
-    bool sent = false;
-    for (int retry = 0; retry < kMaxRetries && !sent; retry++) {
-        TFTP_INFO("Attempting to send error packet, retry: %d", retry);
-        sent = SendPacket(sock, addr, error_packet);
-        if (!sent) {
-            TFTP_WARN("Error packet send failed, retry: %d", retry);
-            // Wait a bit before retrying
-            std::this_thread::sleep_for(std::chrono::milliseconds(kRetryTimeoutMs / 2));
-        }
-    }
-    
-    if (sent) {
-        TFTP_ERROR("Error sent: %s (code: %d)", message.c_str(), static_cast<int>(code));
+std::unique_ptr<ReadSource> TftpServerImpl::MakeReadSource(const RequestConfig& settings,
+                                                          const std::shared_ptr<const PackFile>& pack) const {
+    if (settings.read_source_factory) {
+        return settings.read_source_factory();
+    }
+    if (pack) {
+        // Blocks are lent from the mapping, so there is nothing to read ahead
+        return std::make_unique<PackReadSource>(pack);
+    }
+    std::unique_ptr<ReadSource> source;
+    if (file_cache_->IsEnabled()) {
+        source = std::make_unique<CachedReadSource>(file_cache_);
     } else {
-        TFTP_ERROR("Failed to send error after %d retries: %s (code: %d)", 
-                  kMaxRetries, message.c_str(), static_cast<int>(code));
+        source = std::make_unique<FileReadSource>();
     }
-}
-
-bool TftpServerImpl::DefaultReadHandler(const std::string& path, std::vector<uint8_t>& data) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
-        TFTP_ERROR("Cannot open file: %s", path.c_str());
-        return false;
+    if (settings.read_ahead_windows > 0) {
+        source = std::make_unique<ReadAheadSource>(std::move(source), io_stage_, settings.read_ahead_windows);
     }
-    
-    // Get file size
-    file.seekg(0, std::ios::end);
-    std::streamsize file_size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    // Prepare buffer with reserve first to avoid potential reallocation
-    data.clear();
-    data.reserve(static_cast<size_t>(file_size));
-    data.resize(static_cast<size_t>(file_size));
-    
-    // Read file
-    if (!file.read(reinterpret_cast<char*>(data.data()), file_size)) {
-        TFTP_ERROR("File read error: %s", path.c_str());
-        data.clear();
-        return false;
-    }
-    
-    return true;
+    return source;
 }
 
-bool TftpServerImpl::DefaultWriteHandler(const std::string& path, const std::vector<uint8_t>& data) {
-    TFTP_INFO("DefaultWriteHandler called: path=%s, data_size=%zu", path.c_str(), data.size());
-    
-    // Ensure directory exists 
-    std::filesystem::path file_path(path);
-    std::filesystem::path parent_path = file_path.parent_path();
-    
-    TFTP_INFO("Parent directory: %s", parent_path.string().c_str());
-    
-    if (!parent_path.empty() && !std::filesystem::exists(parent_path)) {
-        TFTP_INFO("Creating parent directory: %s", parent_path.string().c_str());
-        try {
-            std::filesystem::create_directories(parent_path);
-            TFTP_INFO("Parent directory created successfully");
-        } catch (const std::exception& e) {
-            TFTP_ERROR("Directory creation error: %s (%s)", parent_path.string().c_str(), e.what());
-            return false;
-        }
-    } else {
-        TFTP_INFO("Parent directory already exists or is empty");
+std::unique_ptr<WriteSink> TftpServerImpl::MakeWriteSink(const RequestConfig& settings, TransferMode mode) const {
+    if (settings.write_sink_factory) {
+        return ForMode(mode, settings.write_sink_factory());
     }
-    
-    // Open file
-    TFTP_INFO("Opening file for writing: %s", path.c_str());
-    std::ofstream file(path, std::ios::binary);
-    if (!file) {
-        TFTP_ERROR("Cannot open file: %s", path.c_str());
-        return false;
+    std::unique_ptr<WriteSink> sink = ForMode(mode, std::make_unique<FileWriteSink>(settings.fsync_policy));
+    if (settings.write_behind_bytes > 0) {
+        sink = std::make_unique<WriteBehindSink>(std::move(sink), io_stage_, settings.write_behind_bytes);
     }
-    TFTP_INFO("File opened successfully");
-    
-    // Write data as is
-    TFTP_INFO("Writing %zu bytes to file", data.size());
-    if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
-        TFTP_ERROR("File write error: %s", path.c_str());
-        return false;
-    }
-    TFTP_INFO("Data written successfully");
-    
-    // Flush and explicitly close
-    file.flush();
-    file.close();
-    TFTP_INFO("File flushed and closed");
-    
-    // Verify file was created
-    if (!std::filesystem::exists(path)) {
-        TFTP_ERROR("File verification failed after write: %s", path.c_str());
-        return false;
-    }
-    TFTP_INFO("File verification successful");
-    
-    // Log success and size
-    TFTP_INFO("File written successfully: %s (%zu bytes)", path.c_str(), data.size());
-    
-    return true;
+    return sink;
 }
 
 } // namespace internal
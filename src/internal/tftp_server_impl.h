@@ -18,8 +18,23 @@
 
 #include "tftp/tftp_common.h"
 #include "tftp/tftp_packet.h"
+#include "tftp/tftp_packet_view.h"
 #include "tftp/tftp_logger.h"
+#include "tftp/tftp_file_io.h"
 #include "internal/tftp_thread_pool.h"
+#include "internal/tftp_buffer_pool.h"
+#include "internal/tftp_callback_cache.h"
+#include "internal/tftp_file_cache.h"
+#include "internal/tftp_io_stage.h"
+#include "internal/tftp_reactor.h"
+#include "internal/tftp_session_table.h"
+#include "internal/tftp_socket_pool.h"
+#include "internal/tftp_transfer.h"
+#include "internal/tftp_metrics_impl.h"
+#include "internal/tftp_multicast.h"
+#include "internal/tftp_pack_file.h"
+#include "internal/tftp_path_validator.h"
+#include "internal/tftp_rate_limiter.h"
 #include <string>
 #include <thread>
 #include <atomic>
@@ -28,6 +43,8 @@
 #include <filesystem>
 #include <mutex>
 #include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace tftpserver {
 namespace internal {
@@ -41,54 +58,188 @@ public:
     void Stop();
     bool IsRunning() const;
 
-    void SetReadCallback(std::function<bool(const std::string&, std::vector<uint8_t>&)> callback) {
-        std::unique_lock<std::shared_mutex> lock(config_mutex_);
-        read_callback_ = std::move(callback);
+    // A legacy read callback is served through a CallbackReadSource; the last setter wins
+    void SetReadCallback(std::function<bool(const std::string&, std::vector<uint8_t>&)> callback);
+    void SetReadCallbackCache(int ttl_ms, size_t max_bytes) {
+        callback_cache_->SetLimits(std::chrono::milliseconds(ttl_ms), max_bytes);
+    }
+    // filename is resolved as a request for it would be; empty drops every kept result
+    void InvalidateReadCallbackCache(const std::string& filename);
+    CallbackCacheStats GetReadCallbackCacheStats() const { return callback_cache_->GetStats(); }
+    void InvalidatePathCache() { path_validator_.Invalidate(); }
+
+    void SetReadSourceFactory(ReadSourceFactory factory) {
+        UpdateRequestConfig([&](RequestConfig& config) { config.read_source_factory = std::move(factory); });
+    }
+
+    // A legacy write callback is served through a CallbackWriteSink; the last setter wins
+    void SetWriteCallback(std::function<bool(const std::string&, const std::vector<uint8_t>&)> callback);
+
+    void SetWriteSinkFactory(WriteSinkFactory factory) {
+        UpdateRequestConfig([&](RequestConfig& config) { config.write_sink_factory = std::move(factory); });
     }
 
-    void SetWriteCallback(std::function<bool(const std::string&, const std::vector<uint8_t>&)> callback) {
+    // Memory limit of the shared read cache used by the default read source; 0 disables it
+    void SetFileCacheSize(size_t max_bytes) { file_cache_->SetMaxBytes(max_bytes); }
+    FileCacheStats GetFileCacheStats() const { return file_cache_->GetStats(); }
+    // Applies to requests received afterwards, through the built-in sources and sinks only
+    void SetAsyncFileIo(size_t read_ahead_windows, size_t write_behind_bytes) {
+        UpdateRequestConfig([&](RequestConfig& config) {
+            config.read_ahead_windows = read_ahead_windows;
+            config.write_behind_bytes = write_behind_bytes;
+        });
+    }
+    void SetFsyncPolicy(FsyncPolicy policy) {
+        UpdateRequestConfig([&](RequestConfig& config) { config.fsync_policy = policy; });
+    }
+    // Takes effect at the next Start() or ReloadPackFile(); an empty path serves reads from the root
+    void SetPackFile(const std::string& path) {
         std::unique_lock<std::shared_mutex> lock(config_mutex_);
-        write_callback_ = std::move(callback);
+        pack_path_ = path;
     }
+    // Maps the configured pack and swaps it in; on failure the current pack stays in use
+    bool ReloadPackFile();
 
-    void SetSecureMode(bool secure) { 
+    // Request settings apply to requests received afterwards; transfers in flight keep
+    // the snapshot they started with
+    void SetSecureMode(bool secure) {
+        UpdateRequestConfig([&](RequestConfig& config) { config.secure_mode = secure; });
+    }
+    void SetMaxTransferSize(size_t size) {
+        UpdateRequestConfig([&](RequestConfig& config) { config.max_transfer_size = size; });
+    }
+    void SetTimeout(int seconds) {
+        UpdateRequestConfig([&](RequestConfig& config) { config.timeout_seconds = seconds; });
+    }
+    void SetRetransmitFloor(int milliseconds) {
+        UpdateRequestConfig([&](RequestConfig& config) { config.retransmit_floor_ms = milliseconds; });
+    }
+    // Takes effect at the next Start(); reactor_threads 0 means one per hardware thread
+    void SetTransferEngine(TransferEngine engine, size_t reactor_threads) {
+        std::unique_lock<std::shared_mutex> lock(config_mutex_);
+        engine_ = engine;
+        reactor_threads_ = reactor_threads;
+    }
+    // Takes effect at the next Start()
+    void SetIoBackend(IoBackend backend) {
+        std::unique_lock<std::shared_mutex> lock(config_mutex_);
+        io_backend_ = backend;
+    }
+    // Takes effect at the next Start(); 0 means one listener per hardware thread
+    void SetListenerCount(size_t count) {
         std::unique_lock<std::shared_mutex> lock(config_mutex_);
-        secure_mode_ = secure; 
+        listener_count_ = count;
     }
-    void SetMaxTransferSize(size_t size) { 
+    std::vector<ListenerStats> GetListenerStats() const;
+    // Takes effect at the next Start(); 0 disables the endpoint
+    void SetMetricsPort(uint16_t port) {
         std::unique_lock<std::shared_mutex> lock(config_mutex_);
-        max_transfer_size_ = size; 
+        metrics_port_ = port;
     }
-    void SetTimeout(int seconds) { 
+    ServerStats GetStats() const;
+    // Applies to groups created afterwards; port_count 0 disables multicast
+    bool SetMulticastGroup(const std::string& address, uint16_t first_port, size_t port_count) {
+        return multicast_groups_.Configure(address, first_port, port_count);
+    }
+    // Takes effect at the next Start(); 0, 0 uses ephemeral ports
+    void SetTransferPortRange(uint16_t first_port, uint16_t last_port) {
         std::unique_lock<std::shared_mutex> lock(config_mutex_);
-        timeout_seconds_ = seconds; 
+        transfer_socket_config_.first_port = first_port;
+        transfer_socket_config_.last_port = last_port;
     }
-    void SetThreadPoolSize(size_t size) { 
+    // Takes effect at the next Start(); 0 keeps the system default
+    void SetSocketBufferSizes(int receive_bytes, int send_bytes) {
         std::unique_lock<std::shared_mutex> lock(config_mutex_);
-        thread_pool_size_ = size; 
+        transfer_socket_config_.receive_buffer = receive_bytes;
+        transfer_socket_config_.send_buffer = send_bytes;
+    }
+    // Resizes a running pool in place; 0 = one worker per hardware thread
+    void SetThreadPoolSize(size_t size);
+    // Applies to requests received afterwards; 0 = unbounded
+    void SetMaxQueuedRequests(size_t count) { max_queued_requests_ = count; }
+    // Applies to running transfers as well; 0 = unlimited
+    void SetBandwidthLimits(uint64_t global_bytes_per_second, uint64_t client_bytes_per_second) {
+        rate_limiter_.SetLimits(global_bytes_per_second, client_bytes_per_second);
+    }
+    // Takes effect at the next Start()
+    void SetWorkerAffinity(bool pin_to_cores) {
+        std::unique_lock<std::shared_mutex> lock(config_mutex_);
+        pin_workers_ = pin_to_cores;
     }
 
 private:
-    void ServerLoop();
-    void HandleClient(const std::vector<uint8_t>& initial_packet, const sockaddr_in& client_addr);
+    class BlockingChannel;
+    
+    // Settings every request reads. A snapshot is never modified once published: setters copy
+    // it, change the copy and swap the pointer, so requests read it without taking a lock and
+    // the factories run with no lock held
+    struct RequestConfig {
+        bool secure_mode = true;
+        size_t max_transfer_size = 1024 * 1024 * 1024;  // 1GB
+        int timeout_seconds = 5;
+        int retransmit_floor_ms = kDefaultRetransmitFloorMs;
+        size_t read_ahead_windows = 0;
+        size_t write_behind_bytes = 0;
+        FsyncPolicy fsync_policy = FsyncPolicy::kOnCommit;
+        ReadSourceFactory read_source_factory;  // Empty for the built-in file source
+        WriteSinkFactory write_sink_factory;    // Empty for the built-in file sink
+    };
     
-    void HandleReadRequest(
+    std::shared_ptr<const RequestConfig> LoadRequestConfig() const { return std::atomic_load(&request_config_); }
+    
+    template <typename Update>
+    void UpdateRequestConfig(Update update) {
+        // Writers are serialized so that no update is lost; readers never wait for them
+        std::unique_lock<std::shared_mutex> lock(config_mutex_);
+        auto next = std::make_shared<RequestConfig>(*LoadRequestConfig());
+        update(*next);
+        std::atomic_store(&request_config_, std::shared_ptr<const RequestConfig>(std::move(next)));
+    }
+    
+    // One listening socket with its receive thread; several share the port with SO_REUSEPORT
+    struct ListenerShard {
+        explicit ListenerShard(size_t shard_index) : index(shard_index) {}
+        
+        size_t index;
 #ifdef _WIN32
-        SOCKET sock,
+        SOCKET sock = INVALID_SOCKET;
 #else
-        int sock,
+        int sock = -1;
 #endif
-        const sockaddr_in& client_addr,
-        const std::string& filepath, TransferMode mode);
-        
-    void HandleWriteRequest(
+        std::thread thread;
+        SessionTable sessions;
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> duplicates{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> rejected{0};
+    };
+    
+    bool OpenListenSocket(ListenerShard& shard, bool reuse_port);
+    void ServerLoop(ListenerShard& shard, bool pin_to_core);
+    // Receives requests with a multishot recvmsg; false if the ring cannot be set up
+    bool UringServerLoop(ListenerShard& shard);
+    // Hands one received request to the engine, or rejects it
+    void DispatchRequest(ListenerShard& shard, const uint8_t* data, size_t size, const sockaddr_in& client_addr);
+    // Requests accepted by the engine but not served yet
+    size_t GetQueuedRequestCount() const;
+    // Answers a request that cannot be served with ERROR "Server busy" from the listening socket
+    void RejectBusy(ListenerShard& shard, const sockaddr_in& client_addr);
+    void HandleClient(const PooledBuffer& initial_packet, const sockaddr_in& client_addr,
+                      TransferSocketLease socket);
+    
+    // Validates the request and builds its transfer; sends the ERROR and returns nullptr on rejection.
+    // Multicast RRQs get a MulticastTransfer only from engines that route joins to it
+    std::unique_ptr<Transfer> CreateTransfer(const TftpPacket& packet, const sockaddr_in& client_addr,
+                                             TransferChannel& channel, bool allow_multicast);
+    
+    // Drives a transfer to completion with blocking I/O on its socket (thread-pool engine)
+    void RunTransfer(
 #ifdef _WIN32
         SOCKET sock,
 #else
         int sock,
 #endif
-        const sockaddr_in& client_addr,
-        const std::string& filepath, TransferMode mode, const TftpPacket& packet);
+        Transfer& transfer);
         
     bool SendPacket(
 #ifdef _WIN32
@@ -96,7 +247,7 @@ private:
 #else
         int sock,
 #endif
-        const sockaddr_in& addr, const TftpPacket& packet);
+        const sockaddr_in& addr, const uint8_t* data, size_t size);
         
     bool ReceivePacket(
 #ifdef _WIN32
@@ -104,41 +255,52 @@ private:
 #else
         int sock,
 #endif
-        sockaddr_in& addr, TftpPacket& packet, int timeout_ms);
+        // On success packet points into buffer until the next receive
+        sockaddr_in& addr, PacketView& packet, int timeout_ms,
+        PooledBuffer& buffer, size_t block_size);
         
-    void SendError(
-#ifdef _WIN32
-        SOCKET sock,
-#else
-        int sock,
-#endif
-        const sockaddr_in& addr, ErrorCode code, const std::string& message);
-    
-    // File I/O processing callback handlers
-    static bool DefaultReadHandler(const std::string& path, std::vector<uint8_t>& data);
-    static bool DefaultWriteHandler(const std::string& path, const std::vector<uint8_t>& data);
+    // Source or sink of one request: the configured factory's, or the built-in one with the
+    // request's read-ahead, write-behind and fsync settings
+    // RRQs are served from pack instead when one is given (it is only with no read factory set)
+    std::unique_ptr<ReadSource> MakeReadSource(const RequestConfig& settings,
+                                               const std::shared_ptr<const PackFile>& pack) const;
+    // A netascii upload is decoded behind the write-behind, which the transfer then drives directly
+    std::unique_ptr<WriteSink> MakeWriteSink(const RequestConfig& settings, TransferMode mode) const;
 
     std::string root_dir_;
+    PathValidator path_validator_;  // Root canonicalized at Start()
     uint16_t port_;
-#ifdef _WIN32
-    SOCKET sockfd_;
-#else
-    int sockfd_;
-#endif
     std::atomic<bool> running_;
-    std::thread server_thread_;
+    Metrics metrics_;  // Declared before the engines so it outlives every transfer
+    RateLimiter rate_limiter_;  // Outlives every transfer registered with it
+    MulticastGroupPool multicast_groups_;  // Outlives the multicast transfers holding its leases
+    TransferSocketPool transfer_sockets_;  // Outlives the sessions holding its sockets
+    std::vector<std::unique_ptr<ListenerShard>> shards_;
     std::unique_ptr<TftpThreadPool> thread_pool_;
-    bool secure_mode_;
-    size_t max_transfer_size_;
-    int timeout_seconds_;
+    std::shared_ptr<const RequestConfig> request_config_;  // Accessed with std::atomic_load/atomic_store
     size_t thread_pool_size_;
+    bool pin_workers_;
+    TransferEngine engine_;
+    IoBackend io_backend_;
+    IoBackend active_io_backend_;  // Backend of the running server, set before the listeners start
+    size_t reactor_threads_;
+    std::unique_ptr<TftpReactor> reactor_;
+    size_t listener_count_;
+    std::atomic<size_t> max_queued_requests_;  // Read by the listeners without the config lock
+    TransferSocketConfig transfer_socket_config_;
+    uint16_t metrics_port_;
+    std::unique_ptr<MetricsEndpoint> metrics_endpoint_;
 
-    std::function<bool(const std::string&, std::vector<uint8_t>&)> read_callback_;
-    std::function<bool(const std::string&, const std::vector<uint8_t>&)> write_callback_;
+    std::shared_ptr<FileCache> file_cache_;  // Shared with the sources it creates
+    std::shared_ptr<CallbackCache> callback_cache_;  // Shared with the callback sources it serves
+    std::shared_ptr<IoStage> io_stage_;      // Shared with the read-ahead sources and write-behind sinks
+    std::string pack_path_;
+    std::shared_ptr<const PackFile> pack_;   // Accessed with std::atomic_load/atomic_store; held by its sources
     
     // Thread synchronization
-    mutable std::shared_mutex config_mutex_;  // Protects configuration and callbacks
+    mutable std::shared_mutex config_mutex_;  // Protects start-time configuration; serializes request config updates
     mutable std::mutex thread_pool_mutex_;    // Protects thread pool access
+    mutable std::mutex listener_mutex_;       // Protects the listener list
 };
 
 } // namespace internal
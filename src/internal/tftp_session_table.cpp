@@ -0,0 +1,60 @@
+/**
+ * @file tftp_session_table.cpp
+ * @brief Table of in-flight sessions of one listener shard
+ */
+
+#include "internal/tftp_session_table.h"
+#include <functional>
+#include <string_view>
+
+namespace tftpserver {
+namespace internal {
+
+SessionLease::SessionLease(SessionLease&& other) noexcept
+    : table_(other.table_), key_(other.key_) {
+    other.table_ = nullptr;
+}
+
+SessionLease& SessionLease::operator=(SessionLease&& other) noexcept {
+    if (this != &other) {
+        Release();
+        table_ = other.table_;
+        key_ = other.key_;
+        other.table_ = nullptr;
+    }
+    return *this;
+}
+
+void SessionLease::Release() {
+    if (table_) {
+        table_->Remove(key_);
+        table_ = nullptr;
+    }
+}
+
+SessionLease SessionTable::TryAcquire(const sockaddr_in& client_addr, const uint8_t* request, size_t length) {
+    // Endpoint and request hash folded into one key; a collision only drops a request the client will retry
+    uint64_t endpoint = (static_cast<uint64_t>(ntohl(client_addr.sin_addr.s_addr)) << 16) | ntohs(client_addr.sin_port);
+    size_t request_hash = std::hash<std::string_view>()(
+        std::string_view(reinterpret_cast<const char*>(request), length));
+    uint64_t key = endpoint ^ (static_cast<uint64_t>(request_hash) * 0x9E3779B97F4A7C15ull);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!sessions_.insert(key).second) {
+        return SessionLease();
+    }
+    return SessionLease(this, key);
+}
+
+size_t SessionTable::Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sessions_.size();
+}
+
+void SessionTable::Remove(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.erase(key);
+}
+
+} // namespace internal
+} // namespace tftpserver
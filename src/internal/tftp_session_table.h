@@ -0,0 +1,82 @@
+/**
+ * @file tftp_session_table.h
+ * @brief Table of in-flight sessions of one listener shard
+ */
+
+#ifndef TFTP_SESSION_TABLE_H_
+#define TFTP_SESSION_TABLE_H_
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+
+namespace tftpserver {
+namespace internal {
+
+class SessionTable;
+
+/**
+ * @brief Movable handle on a session table entry; the entry is removed when the lease is released
+ */
+class SessionLease {
+public:
+    SessionLease() = default;
+    ~SessionLease() { Release(); }
+
+    SessionLease(SessionLease&& other) noexcept;
+    SessionLease& operator=(SessionLease&& other) noexcept;
+
+    // Disable copy
+    SessionLease(const SessionLease&) = delete;
+    SessionLease& operator=(const SessionLease&) = delete;
+
+    explicit operator bool() const { return table_ != nullptr; }
+    void Release();
+
+private:
+    friend class SessionTable;
+    SessionLease(SessionTable* table, uint64_t key) : table_(table), key_(key) {}
+
+    SessionTable* table_ = nullptr;
+    uint64_t key_ = 0;
+};
+
+/**
+ * @brief Sessions keyed by client endpoint and request, so that a retransmitted RRQ/WRQ
+ *        does not start a second transfer while the first one is still running
+ *
+ * Each listener shard owns its table, so the lock is only shared by that shard's sessions.
+ * The table must outlive every lease it hands out.
+ */
+class SessionTable {
+public:
+    SessionTable() = default;
+
+    // Disable copy
+    SessionTable(const SessionTable&) = delete;
+    SessionTable& operator=(const SessionTable&) = delete;
+
+    // Registers a session; returns an empty lease if the same request from the same endpoint is in flight
+    SessionLease TryAcquire(const sockaddr_in& client_addr, const uint8_t* request, size_t length);
+
+    size_t Size() const;
+
+private:
+    friend class SessionLease;
+    void Remove(uint64_t key);
+
+    mutable std::mutex mutex_;
+    std::unordered_set<uint64_t> sessions_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_SESSION_TABLE_H_
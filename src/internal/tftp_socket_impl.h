@@ -8,7 +8,9 @@
 
 #include "tftp/tftp_socket.h"
 #include "tftp/tftp_logger.h"
+#include <cstdint>
 #include <string>
+#include <vector>
 
 // Platform-specific includes are now in separate implementation files
 
@@ -16,6 +18,42 @@ namespace tftpserver {
 namespace net {
 namespace internal {
 
+/**
+ * @brief MSG_ZEROCOPY state of one socket (Linux)
+ *
+ * The kernel numbers zero-copy send calls per socket and reports finished ranges on the
+ * socket error queue; ReapZeroCopy consumes them, which must happen regularly because a
+ * non-empty error queue makes the socket poll as ready. When the kernel reports that it
+ * copied the data anyway (loopback, devices without scatter-gather), zero-copy is turned
+ * off for the socket, since it then only adds the notification cost.
+ */
+struct ZeroCopyState {
+    bool enabled = false;
+    uint32_t issued = 0;     // Zero-copy send calls made
+    uint32_t completed = 0;  // Calls the kernel has reported done
+    bool copied = false;     // The kernel fell back to copying
+
+    bool IsActive() const { return enabled && !copied; }
+    uint32_t Pending() const { return issued > completed ? issued - completed : 0; }
+};
+
+/**
+ * @brief UDP_GRO state of one socket (Linux)
+ *
+ * One receive can return up to 64 coalesced segments, more than the caller's batch may have
+ * room for. The segments that do not fit are kept here, and the next receive hands them out
+ * before it reads the socket again, so a peer's burst arrives whole and in order.
+ */
+struct ReceiveOffloadState {
+    bool enabled = false;
+    std::vector<uint8_t> pending;  // Coalesced segments not handed out yet
+    size_t offset = 0;             // Start of the next segment in pending
+    size_t segment = 0;            // Segment size of pending
+    sockaddr_in addr = {};         // Sender of pending
+
+    bool HasPending() const { return offset < pending.size(); }
+};
+
 /**
  * @brief Platform-specific socket implementation
  */
@@ -38,13 +76,37 @@ public:
     int SendTo(const void* data, size_t size, const SocketAddress& addr);
     int ReceiveFrom(void* buffer, size_t buffer_size, SocketAddress& sender_addr);
     int ReceiveFromTimeout(void* buffer, size_t buffer_size, SocketAddress& sender_addr, int timeout_ms);
+    int SendBatch(const OutgoingDatagram* datagrams, size_t count);
+    int ReceiveBatch(IncomingDatagram* datagrams, size_t count, int timeout_ms);
+    bool SetSegmentationOffload(bool enable);
+    bool SetReceiveOffload(bool enable);
     void Close();
     bool IsValid() const;
     std::string GetLastError() const;
     socket_t GetNativeHandle() const;
+    
+    // Batch I/O on a native handle, shared with engines that manage their own sockets.
+    // Neither call blocks on a non-blocking socket; a full socket buffer ends the send early.
+    // An enabled receive_offload state splits coalesced receives, see ReceiveOffloadState.
+    // With an active zero_copy state, send calls of at least kZeroCopyMinBytes whose
+    // datagrams are all immutable go out with MSG_ZEROCOPY.
+    static int SendDatagrams(socket_t sock, const OutgoingDatagram* datagrams, size_t count,
+                             bool segmentation_offload, ZeroCopyState* zero_copy = nullptr);
+    static int ReceiveDatagrams(socket_t sock, IncomingDatagram* datagrams, size_t count,
+                                ReceiveOffloadState* receive_offload = nullptr);
+    static bool EnableReceiveOffload(socket_t sock, bool enable);
+    // Sets SO_ZEROCOPY; false (state left disabled) where the platform or kernel lacks it
+    static bool EnableZeroCopy(socket_t sock, ZeroCopyState& state);
+    // Consumes the completions queued so far without blocking
+    static void ReapZeroCopy(socket_t sock, ZeroCopyState& state);
+
+    // Smaller sends are cheaper to copy than to pin and report (kernel guidance: ~10 KB)
+    static constexpr size_t kZeroCopyMinBytes = 16384;
 
 private:
     socket_t socket_;
+    bool segmentation_offload_;
+    ReceiveOffloadState receive_offload_;
     mutable std::string last_error_;
     
     void SetLastError(const std::string& error);
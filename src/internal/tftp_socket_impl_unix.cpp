@@ -11,12 +11,258 @@
 #include <unistd.h>
 #include <errno.h>
 #include <cstring>
+#include <atomic>
+#include <limits>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <netinet/udp.h>
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#endif
 
 namespace tftpserver {
 namespace net {
 namespace internal {
 
-SocketImpl::SocketImpl() : socket_(kInvalidSocket) {
+namespace {
+
+bool IsWouldBlock(int error) {
+    return error == EAGAIN || error == EWOULDBLOCK;
+}
+
+// Points iov at the one or two buffers of a datagram; returns the number of entries used
+size_t FillIov(const OutgoingDatagram& datagram, iovec* iov) {
+    iov[0].iov_base = const_cast<uint8_t*>(datagram.data);
+    iov[0].iov_len = datagram.size;
+    if (datagram.payload_size == 0) {
+        return 1;
+    }
+    iov[1].iov_base = const_cast<uint8_t*>(datagram.payload);
+    iov[1].iov_len = datagram.payload_size;
+    return 2;
+}
+
+#ifdef __linux__
+constexpr size_t kMaxBatch = 64;          // Datagrams per sendmmsg/recvmmsg call
+constexpr size_t kMaxGsoSegments = 64;    // UDP_MAX_SEGMENTS of older kernels
+constexpr size_t kMaxUdpPayload = 65507;  // IPv4 datagram limit
+
+// Cleared once the kernel or device rejects UDP_SEGMENT, so later sends go straight to sendmmsg
+std::atomic<bool> g_gso_supported{true};
+// Smallest segment size rejected so far (larger than the path MTU allows)
+std::atomic<size_t> g_gso_segment_limit{std::numeric_limits<size_t>::max()};
+
+bool SameDestination(const sockaddr_in& lhs, const sockaddr_in& rhs) {
+    return lhs.sin_addr.s_addr == rhs.sin_addr.s_addr && lhs.sin_port == rhs.sin_port;
+}
+
+// Length of the run starting at datagrams[0] that UDP_SEGMENT can send as one buffer:
+// equal-sized datagrams to one destination, optionally ended by a shorter one
+size_t SegmentRun(const OutgoingDatagram* datagrams, size_t count) {
+    size_t segment = datagrams[0].Length();
+    if (segment == 0 || segment * 2 > kMaxUdpPayload || segment >= g_gso_segment_limit.load()) {
+        return 1;
+    }
+    size_t total = segment;
+    size_t run = 1;
+    while (run < count && run < kMaxGsoSegments) {
+        const OutgoingDatagram& next = datagrams[run];
+        size_t length = next.Length();
+        if (!SameDestination(next.addr, datagrams[0].addr) || length == 0 || length > segment ||
+            total + length > kMaxUdpPayload) {
+            break;
+        }
+        total += length;
+        run++;
+        if (length < segment) {
+            break;
+        }
+    }
+    return run;
+}
+
+// True when MSG_ZEROCOPY may be used for these datagrams: none of them is ever rewritten
+// and the call moves enough bytes to pay for pinning the pages and the completion
+bool WorthZeroCopy(const OutgoingDatagram* datagrams, size_t count, size_t min_bytes) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!datagrams[i].immutable) {
+            return false;
+        }
+        total += datagrams[i].Length();
+    }
+    return total >= min_bytes;
+}
+
+// Sends a run as one GSO buffer; 1 on success, 0 if the run must be sent without GSO, -1 on error
+int SendSegmented(socket_t sock, const OutgoingDatagram* datagrams, size_t count, int flags) {
+    iovec iov[kMaxGsoSegments * 2];
+    size_t iov_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        iov_count += FillIov(datagrams[i], iov + iov_count);
+    }
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+    msghdr msg = {};
+    msg.msg_name = const_cast<sockaddr_in*>(&datagrams[0].addr);
+    msg.msg_namelen = sizeof(sockaddr_in);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t segment = static_cast<uint16_t>(datagrams[0].Length());
+    std::memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+
+    if (sendmsg(sock, &msg, flags) >= 0) {
+        return 1;
+    }
+    if (errno == EINVAL) {
+        // Segments larger than the path MTU; smaller ones may still be offloaded
+        size_t limit = g_gso_segment_limit.load();
+        while (segment < limit && !g_gso_segment_limit.compare_exchange_weak(limit, segment)) {
+        }
+        return 0;
+    }
+    if (errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+        if (g_gso_supported.exchange(false)) {
+            TFTP_INFO("UDP segmentation offload unavailable (%s), using sendmmsg", std::strerror(errno));
+        }
+        return 0;
+    }
+    return -1;
+}
+
+// Returns the number of datagrams sent, or -1 if none could be sent
+int SendMultiple(socket_t sock, const OutgoingDatagram* datagrams, size_t count, int flags) {
+    count = std::min(count, kMaxBatch);
+    mmsghdr msgs[kMaxBatch];
+    iovec iov[kMaxBatch * 2];
+    std::memset(msgs, 0, sizeof(mmsghdr) * count);
+    for (size_t i = 0; i < count; ++i) {
+        msgs[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&datagrams[i].addr);
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iov[i * 2];
+        msgs[i].msg_hdr.msg_iovlen = FillIov(datagrams[i], &iov[i * 2]);
+    }
+    return sendmmsg(sock, msgs, static_cast<unsigned int>(count), flags);
+}
+
+// Returns the number of datagrams received, or -1 if none was available
+int ReceiveMultiple(socket_t sock, IncomingDatagram* datagrams, size_t count) {
+    count = std::min(count, kMaxBatch);
+    mmsghdr msgs[kMaxBatch];
+    iovec iov[kMaxBatch];
+    std::memset(msgs, 0, sizeof(mmsghdr) * count);
+    for (size_t i = 0; i < count; ++i) {
+        iov[i].iov_base = datagrams[i].buffer;
+        iov[i].iov_len = datagrams[i].capacity;
+        msgs[i].msg_hdr.msg_name = &datagrams[i].addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int result = recvmmsg(sock, msgs, static_cast<unsigned int>(count), MSG_DONTWAIT, nullptr);
+    for (int i = 0; i < result; ++i) {
+        datagrams[i].length = msgs[i].msg_len;
+    }
+    return result;
+}
+
+// Hands out the segments kept from an earlier coalesced receive; returns the buffers filled
+size_t TakePending(ReceiveOffloadState& state, IncomingDatagram* datagrams, size_t count) {
+    size_t taken = 0;
+    while (taken < count && state.HasPending()) {
+        size_t piece = std::min(state.segment, state.pending.size() - state.offset);
+        IncomingDatagram& next = datagrams[taken];
+        if (next.capacity < piece) {
+            TFTP_WARN("Receive buffer too small, dropping %zu coalesced bytes", state.pending.size() - state.offset);
+            state.offset = state.pending.size();
+            break;
+        }
+        std::memcpy(next.buffer, state.pending.data() + state.offset, piece);
+        next.length = piece;
+        next.addr = state.addr;
+        state.offset += piece;
+        taken++;
+    }
+    if (!state.HasPending()) {
+        state.pending.clear();
+        state.offset = 0;
+    }
+    return taken;
+}
+
+// Receives one possibly coalesced datagram and splits it into consecutive buffers; the
+// segments past the last buffer are kept in state for the next call
+int ReceiveCoalesced(socket_t sock, IncomingDatagram* datagrams, size_t count, ReceiveOffloadState& state) {
+    IncomingDatagram& first = datagrams[0];
+    iovec iov = {first.buffer, first.capacity};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg = {};
+    msg.msg_name = &first.addr;
+    msg.msg_namelen = sizeof(sockaddr_in);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t result = recvmsg(sock, &msg, MSG_DONTWAIT);
+    if (result < 0) {
+        return -1;
+    }
+    size_t length = static_cast<size_t>(result);
+    size_t segment = length;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int gso_size = 0;
+            std::memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+            if (gso_size > 0) {
+                segment = std::min(length, static_cast<size_t>(gso_size));
+            }
+        }
+    }
+
+    first.length = segment;
+    if (segment < length) {
+        state.pending.assign(first.buffer + segment, first.buffer + length);
+        state.offset = 0;
+        state.segment = segment;
+        state.addr = first.addr;
+    }
+    return static_cast<int>(1 + TakePending(state, datagrams + 1, count - 1));
+}
+#endif
+
+} // namespace
+
+SocketImpl::SocketImpl()
+    : socket_(kInvalidSocket), segmentation_offload_(false) {
 }
 
 SocketImpl::~SocketImpl() {
@@ -24,7 +270,10 @@ SocketImpl::~SocketImpl() {
 }
 
 SocketImpl::SocketImpl(SocketImpl&& other) noexcept 
-    : socket_(other.socket_), last_error_(std::move(other.last_error_)) {
+    : socket_(other.socket_),
+      segmentation_offload_(other.segmentation_offload_),
+      receive_offload_(std::move(other.receive_offload_)),
+      last_error_(std::move(other.last_error_)) {
     other.socket_ = kInvalidSocket;
 }
 
@@ -32,6 +281,8 @@ SocketImpl& SocketImpl::operator=(SocketImpl&& other) noexcept {
     if (this != &other) {
         Close();
         socket_ = other.socket_;
+        segmentation_offload_ = other.segmentation_offload_;
+        receive_offload_ = std::move(other.receive_offload_);
         last_error_ = std::move(other.last_error_);
         other.socket_ = kInvalidSocket;
     }
@@ -185,6 +436,274 @@ int SocketImpl::ReceiveFromTimeout(void* buffer, size_t buffer_size, SocketAddre
     return ReceiveFrom(buffer, buffer_size, sender_addr);
 }
 
+int SocketImpl::SendBatch(const OutgoingDatagram* datagrams, size_t count) {
+    if (socket_ == kInvalidSocket) {
+        SetLastError("Cannot send on invalid socket");
+        return -1;
+    }
+    
+    if (datagrams == nullptr || count == 0) {
+        SetLastError("Invalid send parameters");
+        return -1;
+    }
+    
+    int sent = SendDatagrams(socket_, datagrams, count, segmentation_offload_);
+    if (sent < 0) {
+        SetLastError("Failed to send data: " + GetSystemErrorMessage());
+        TFTP_ERROR("Failed to send batch of %zu datagrams - %s", count, last_error_.c_str());
+    } else if (static_cast<size_t>(sent) != count) {
+        TFTP_WARN("Partial batch send: %d datagrams sent out of %zu", sent, count);
+    }
+    return sent;
+}
+
+int SocketImpl::ReceiveBatch(IncomingDatagram* datagrams, size_t count, int timeout_ms) {
+    if (socket_ == kInvalidSocket) {
+        SetLastError("Cannot receive on invalid socket");
+        return -1;
+    }
+    
+    if (datagrams == nullptr || count == 0) {
+        SetLastError("Invalid receive parameters");
+        return -1;
+    }
+    
+    // Segments kept from a coalesced receive are ready without waiting
+    if (timeout_ms != 0 && !receive_offload_.HasPending()) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(socket_, &readfds);
+        
+        struct timeval timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+        
+        int result = select(socket_ + 1, &readfds, nullptr, nullptr, timeout_ms < 0 ? nullptr : &timeout);
+        if (result < 0) {
+            SetLastError("Select failed: " + GetSystemErrorMessage());
+            TFTP_ERROR("Select failed: %s", last_error_.c_str());
+            return -1;
+        }
+        if (result == 0) {
+            SetLastError("Receive timeout");
+            TFTP_DEBUG("Receive timeout after %d ms", timeout_ms);
+            return 0;
+        }
+    }
+    
+    int received = ReceiveDatagrams(socket_, datagrams, count, &receive_offload_);
+    if (received < 0) {
+        SetLastError("Failed to receive data: " + GetSystemErrorMessage());
+        TFTP_ERROR("Failed to receive data: %s", last_error_.c_str());
+    }
+    return received;
+}
+
+bool SocketImpl::SetSegmentationOffload(bool enable) {
+#ifdef __linux__
+    segmentation_offload_ = enable;
+    return true;
+#else
+    segmentation_offload_ = false;
+    return !enable;
+#endif
+}
+
+bool SocketImpl::SetReceiveOffload(bool enable) {
+    if (socket_ == kInvalidSocket) {
+        SetLastError("Cannot set option on invalid socket");
+        return false;
+    }
+    
+    if (!EnableReceiveOffload(socket_, enable)) {
+        SetLastError("Failed to set UDP_GRO: " + GetSystemErrorMessage());
+        TFTP_DEBUG("Failed to set UDP_GRO: %s", last_error_.c_str());
+        return !enable;
+    }
+    receive_offload_ = ReceiveOffloadState();
+    receive_offload_.enabled = enable;
+    return true;
+}
+
+int SocketImpl::SendDatagrams(socket_t sock, const OutgoingDatagram* datagrams, size_t count,
+                              bool segmentation_offload, ZeroCopyState* zero_copy) {
+    size_t sent = 0;
+#ifdef __linux__
+    const bool zero_copy_active = zero_copy != nullptr && zero_copy->IsActive();
+    if (zero_copy_active && zero_copy->Pending() > 0) {
+        ReapZeroCopy(sock, *zero_copy);
+    }
+    while (sent < count) {
+        bool use_gso = segmentation_offload && g_gso_supported.load();
+        size_t run = use_gso ? SegmentRun(datagrams + sent, count - sent) : count - sent;
+        if (use_gso && run > 1) {
+            int flags = zero_copy_active && WorthZeroCopy(datagrams + sent, run, kZeroCopyMinBytes) ? MSG_ZEROCOPY : 0;
+            int result = SendSegmented(sock, datagrams + sent, run, flags);
+            if (result < 0 && flags != 0 && errno == ENOBUFS) {
+                // No option memory left for another notification; this call is copied instead
+                flags = 0;
+                result = SendSegmented(sock, datagrams + sent, run, flags);
+            }
+            if (result > 0) {
+                if (flags != 0) {
+                    zero_copy->issued++;
+                }
+                sent += run;
+                continue;
+            }
+            if (result < 0) {
+                break;
+            }
+        }
+        // Without GSO every datagram is its own send, so each one must be large enough
+        size_t batch = std::min(run, kMaxBatch);
+        bool large = true;
+        for (size_t i = 0; i < batch && large; ++i) {
+            large = datagrams[sent + i].Length() >= kZeroCopyMinBytes;
+        }
+        int flags = zero_copy_active && large && WorthZeroCopy(datagrams + sent, batch, 0) ? MSG_ZEROCOPY : 0;
+        int result = SendMultiple(sock, datagrams + sent, batch, flags);
+        if (result < 0 && flags != 0 && errno == ENOBUFS) {
+            flags = 0;
+            result = SendMultiple(sock, datagrams + sent, batch, flags);
+        }
+        if (result <= 0) {
+            break;
+        }
+        if (flags != 0) {
+            zero_copy->issued += static_cast<uint32_t>(result);
+        }
+        sent += static_cast<size_t>(result);
+        if (static_cast<size_t>(result) < batch) {
+            break;  // Socket buffer full
+        }
+    }
+#else
+    (void)segmentation_offload;
+    (void)zero_copy;
+    for (; sent < count; ++sent) {
+        iovec iov[2];
+        msghdr msg = {};
+        msg.msg_name = const_cast<sockaddr_in*>(&datagrams[sent].addr);
+        msg.msg_namelen = sizeof(sockaddr_in);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = FillIov(datagrams[sent], iov);
+        if (sendmsg(sock, &msg, 0) < 0) {
+            break;
+        }
+    }
+#endif
+    if (sent == 0 && count > 0 && !IsWouldBlock(errno)) {
+        return -1;
+    }
+    return static_cast<int>(sent);
+}
+
+int SocketImpl::ReceiveDatagrams(socket_t sock, IncomingDatagram* datagrams, size_t count,
+                                 ReceiveOffloadState* receive_offload) {
+    size_t received = 0;
+#ifdef __linux__
+    bool coalesced = receive_offload != nullptr && receive_offload->enabled;
+    if (receive_offload != nullptr) {
+        // Kept segments arrived before anything still queued on the socket
+        received = TakePending(*receive_offload, datagrams, count);
+    }
+#endif
+    while (received < count) {
+#ifdef __linux__
+        if (coalesced) {
+            int result = ReceiveCoalesced(sock, datagrams + received, count - received, *receive_offload);
+            if (result <= 0) {
+                break;
+            }
+            received += static_cast<size_t>(result);
+            continue;
+        }
+        size_t requested = std::min(count - received, kMaxBatch);
+        int result = ReceiveMultiple(sock, datagrams + received, requested);
+        if (result <= 0) {
+            break;
+        }
+        received += static_cast<size_t>(result);
+        if (static_cast<size_t>(result) < requested) {
+            break;  // Queue drained
+        }
+#else
+        (void)receive_offload;
+        IncomingDatagram& datagram = datagrams[received];
+        socklen_t addr_len = sizeof(datagram.addr);
+        ssize_t result = recvfrom(sock, datagram.buffer, datagram.capacity, MSG_DONTWAIT,
+                                  reinterpret_cast<sockaddr*>(&datagram.addr), &addr_len);
+        if (result < 0) {
+            break;
+        }
+        datagram.length = static_cast<size_t>(result);
+        received++;
+#endif
+    }
+    if (received == 0 && count > 0 && !IsWouldBlock(errno)) {
+        return -1;
+    }
+    return static_cast<int>(received);
+}
+
+bool SocketImpl::EnableReceiveOffload(socket_t sock, bool enable) {
+#ifdef __linux__
+    int value = enable ? 1 : 0;
+    return setsockopt(sock, SOL_UDP, UDP_GRO, &value, sizeof(value)) == 0;
+#else
+    (void)sock;
+    return !enable;
+#endif
+}
+
+bool SocketImpl::EnableZeroCopy(socket_t sock, ZeroCopyState& state) {
+    state = ZeroCopyState();
+#ifdef __linux__
+    int value = 1;
+    state.enabled = setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) == 0;
+#else
+    (void)sock;
+#endif
+    return state.enabled;
+}
+
+void SocketImpl::ReapZeroCopy(socket_t sock, ZeroCopyState& state) {
+#ifdef __linux__
+    if (!state.enabled) {
+        return;
+    }
+    while (true) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in))] = {};
+        msghdr msg = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            return;  // Queue empty
+        }
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR) {
+                continue;
+            }
+            sock_extended_err error = {};
+            std::memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+            if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0) {
+                continue;
+            }
+            // [ee_info, ee_data] is the range of send calls that completed
+            state.completed += error.ee_data - error.ee_info + 1;
+            if ((error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0 && !state.copied) {
+                state.copied = true;
+                TFTP_DEBUG("MSG_ZEROCOPY sends were copied by the kernel, using plain sends");
+            }
+        }
+    }
+#else
+    (void)sock;
+    (void)state;
+#endif
+}
+
 void SocketImpl::Close() {
     if (socket_ != kInvalidSocket) {
         TFTP_DEBUG("Closing Unix socket (fd: %d)", socket_);
@@ -12,7 +12,8 @@ namespace tftpserver {
 namespace net {
 namespace internal {
 
-SocketImpl::SocketImpl() : socket_(kInvalidSocket) {
+SocketImpl::SocketImpl()
+    : socket_(kInvalidSocket), segmentation_offload_(false) {
 }
 
 SocketImpl::~SocketImpl() {
@@ -20,7 +21,10 @@ SocketImpl::~SocketImpl() {
 }
 
 SocketImpl::SocketImpl(SocketImpl&& other) noexcept 
-    : socket_(other.socket_), last_error_(std::move(other.last_error_)) {
+    : socket_(other.socket_),
+      segmentation_offload_(other.segmentation_offload_),
+      receive_offload_(std::move(other.receive_offload_)),
+      last_error_(std::move(other.last_error_)) {
     other.socket_ = kInvalidSocket;
 }
 
@@ -28,6 +32,8 @@ SocketImpl& SocketImpl::operator=(SocketImpl&& other) noexcept {
     if (this != &other) {
         Close();
         socket_ = other.socket_;
+        segmentation_offload_ = other.segmentation_offload_;
+        receive_offload_ = std::move(other.receive_offload_);
         last_error_ = std::move(other.last_error_);
         other.socket_ = kInvalidSocket;
     }
@@ -182,6 +188,163 @@ int SocketImpl::ReceiveFromTimeout(void* buffer, size_t buffer_size, SocketAddre
     return ReceiveFrom(buffer, buffer_size, sender_addr);
 }
 
+int SocketImpl::SendBatch(const OutgoingDatagram* datagrams, size_t count) {
+    if (socket_ == kInvalidSocket) {
+        SetLastError("Cannot send on invalid socket");
+        return -1;
+    }
+    
+    if (datagrams == nullptr || count == 0) {
+        SetLastError("Invalid send parameters");
+        return -1;
+    }
+    
+    int sent = SendDatagrams(socket_, datagrams, count, segmentation_offload_);
+    if (sent < 0) {
+        SetLastError("Failed to send data: " + GetSystemErrorMessage());
+        TFTP_ERROR("Failed to send batch of %zu datagrams - %s", count, last_error_.c_str());
+    } else if (static_cast<size_t>(sent) != count) {
+        TFTP_WARN("Partial batch send: %d datagrams sent out of %zu", sent, count);
+    }
+    return sent;
+}
+
+int SocketImpl::ReceiveBatch(IncomingDatagram* datagrams, size_t count, int timeout_ms) {
+    if (socket_ == kInvalidSocket) {
+        SetLastError("Cannot receive on invalid socket");
+        return -1;
+    }
+    
+    if (datagrams == nullptr || count == 0) {
+        SetLastError("Invalid receive parameters");
+        return -1;
+    }
+    
+    if (timeout_ms != 0) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(socket_, &readfds);
+        
+        struct timeval timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+        
+        // On Windows, the first parameter to select is ignored
+        int result = select(0, &readfds, nullptr, nullptr, timeout_ms < 0 ? nullptr : &timeout);
+        if (result < 0) {
+            SetLastError("Select failed: " + GetSystemErrorMessage());
+            TFTP_ERROR("Select failed: %s", last_error_.c_str());
+            return -1;
+        }
+        if (result == 0) {
+            SetLastError("Receive timeout");
+            TFTP_DEBUG("Receive timeout after %d ms", timeout_ms);
+            return 0;
+        }
+    }
+    
+    int received = ReceiveDatagrams(socket_, datagrams, count, &receive_offload_);
+    if (received < 0) {
+        SetLastError("Failed to receive data: " + GetSystemErrorMessage());
+        TFTP_ERROR("Failed to receive data: %s", last_error_.c_str());
+    }
+    return received;
+}
+
+bool SocketImpl::SetSegmentationOffload(bool enable) {
+    // Winsock has no UDP_SEGMENT; batches are sent one datagram at a time
+    segmentation_offload_ = false;
+    return !enable;
+}
+
+bool SocketImpl::SetReceiveOffload(bool enable) {
+    receive_offload_ = ReceiveOffloadState();
+    return !enable;
+}
+
+int SocketImpl::SendDatagrams(socket_t sock, const OutgoingDatagram* datagrams, size_t count,
+                              bool segmentation_offload, ZeroCopyState* zero_copy) {
+    (void)segmentation_offload;
+    (void)zero_copy;
+    size_t sent = 0;
+    for (; sent < count; ++sent) {
+        // Header and payload are gathered by Winsock, as sendmsg does elsewhere
+        const OutgoingDatagram& datagram = datagrams[sent];
+        WSABUF buffers[2];
+        DWORD buffer_count = 1;
+        buffers[0].buf = const_cast<char*>(reinterpret_cast<const char*>(datagram.data));
+        buffers[0].len = static_cast<ULONG>(datagram.size);
+        if (datagram.payload_size > 0) {
+            buffers[1].buf = const_cast<char*>(reinterpret_cast<const char*>(datagram.payload));
+            buffers[1].len = static_cast<ULONG>(datagram.payload_size);
+            buffer_count = 2;
+        }
+        DWORD bytes_sent = 0;
+        if (WSASendTo(sock, buffers, buffer_count, &bytes_sent, 0, reinterpret_cast<const sockaddr*>(&datagram.addr),
+                      sizeof(datagram.addr), nullptr, nullptr) == SOCKET_ERROR) {
+            break;
+        }
+    }
+    if (sent == 0 && count > 0 && WSAGetLastError() != WSAEWOULDBLOCK) {
+        return -1;
+    }
+    return static_cast<int>(sent);
+}
+
+int SocketImpl::ReceiveDatagrams(socket_t sock, IncomingDatagram* datagrams, size_t count,
+                                 ReceiveOffloadState* receive_offload) {
+    (void)receive_offload;
+    size_t received = 0;
+    bool failed = false;
+    while (received < count) {
+        // Poll without waiting so that a blocking socket does not block after the first datagram
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(sock, &readfds);
+        struct timeval no_wait = {0, 0};
+        int ready = select(0, &readfds, nullptr, nullptr, &no_wait);
+        if (ready <= 0) {
+            failed = ready < 0;
+            break;
+        }
+        
+        IncomingDatagram& datagram = datagrams[received];
+        int addr_len = sizeof(datagram.addr);
+        int result = recvfrom(sock, reinterpret_cast<char*>(datagram.buffer), static_cast<int>(datagram.capacity), 0,
+                              reinterpret_cast<sockaddr*>(&datagram.addr), &addr_len);
+        if (result == SOCKET_ERROR) {
+            if (WSAGetLastError() != WSAEMSGSIZE) {
+                failed = WSAGetLastError() != WSAEWOULDBLOCK;
+                break;
+            }
+            result = static_cast<int>(datagram.capacity);  // Truncated datagram
+        }
+        datagram.length = static_cast<size_t>(result);
+        received++;
+    }
+    if (received == 0 && failed) {
+        return -1;
+    }
+    return static_cast<int>(received);
+}
+
+bool SocketImpl::EnableReceiveOffload(socket_t sock, bool enable) {
+    (void)sock;
+    return !enable;
+}
+
+bool SocketImpl::EnableZeroCopy(socket_t sock, ZeroCopyState& state) {
+    // Winsock has no MSG_ZEROCOPY
+    (void)sock;
+    state = ZeroCopyState();
+    return false;
+}
+
+void SocketImpl::ReapZeroCopy(socket_t sock, ZeroCopyState& state) {
+    (void)sock;
+    (void)state;
+}
+
 void SocketImpl::Close() {
     if (socket_ != kInvalidSocket) {
         TFTP_DEBUG("Closing Windows socket (handle: %d)", static_cast<int>(socket_));
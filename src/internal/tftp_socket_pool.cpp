@@ -0,0 +1,229 @@
+/**
+ * @file tftp_socket_pool.cpp
+ * @brief Pre-bound transfer sockets reused across sessions
+ */
+
+#include "internal/tftp_socket_pool.h"
+#include "tftp/tftp_common.h"
+#include "tftp/tftp_logger.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define CLOSESOCKET closesocket
+#else
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define CLOSESOCKET close
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr int kMaxDiscardedDatagrams = 1024;  // Bounds the drain of a socket flooded by a stale peer
+
+bool SetBlockingMode(socket_t sock, bool non_blocking) {
+#ifdef _WIN32
+    u_long mode = non_blocking ? 1 : 0;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    flags = non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(sock, F_SETFL, flags) == 0;
+#endif
+}
+
+bool IsReadable(socket_t sock) {
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(sock, &readfds);
+    timeval tv = {0, 0};
+    return select(static_cast<int>(sock) + 1, &readfds, nullptr, nullptr, &tv) > 0;
+}
+
+// Late packets of the previous session must not reach the next one. Receive errors (ICMP
+// unreachable, truncation) consume the pending item as well, so they just continue the loop
+void DiscardPending(socket_t sock) {
+    uint8_t buffer[kMaxPacketSize];
+    for (int i = 0; i < kMaxDiscardedDatagrams && IsReadable(sock); ++i) {
+        recv(sock, reinterpret_cast<char*>(buffer), static_cast<int>(sizeof(buffer)), 0);
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// TransferSocketLease
+// ---------------------------------------------------------------------------
+
+TransferSocketLease::TransferSocketLease(TransferSocketLease&& other) noexcept
+    : pool_(other.pool_), sock_(other.sock_) {
+    other.pool_ = nullptr;
+    other.sock_ = kInvalidSocket;
+}
+
+TransferSocketLease& TransferSocketLease::operator=(TransferSocketLease&& other) noexcept {
+    if (this != &other) {
+        Release();
+        pool_ = other.pool_;
+        sock_ = other.sock_;
+        other.pool_ = nullptr;
+        other.sock_ = kInvalidSocket;
+    }
+    return *this;
+}
+
+void TransferSocketLease::Release() {
+    if (pool_) {
+        pool_->Release(sock_);
+        pool_ = nullptr;
+        sock_ = kInvalidSocket;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TransferSocketPool
+// ---------------------------------------------------------------------------
+
+TransferSocketPool::TransferSocketPool() : leased_(0), open_(false) {}
+
+TransferSocketPool::~TransferSocketPool() {
+    Close();
+}
+
+bool TransferSocketPool::Open(const TransferSocketConfig& config) {
+    Close();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    open_ = true;
+    if (config_.first_port == 0) {
+        return true;
+    }
+    for (uint32_t port = config_.first_port; port <= config_.last_port; ++port) {
+        socket_t sock = CreateSocket(static_cast<uint16_t>(port));
+        if (sock == kInvalidSocket) {
+            TFTP_WARN("Transfer port %u unavailable", port);
+            continue;
+        }
+        idle_.push_back(sock);
+    }
+    if (idle_.empty()) {
+        TFTP_ERROR("No transfer port of %u-%u could be bound", config_.first_port, config_.last_port);
+        open_ = false;
+        return false;
+    }
+    TFTP_INFO("Bound %zu transfer ports in %u-%u", idle_.size(), config_.first_port, config_.last_port);
+    return true;
+}
+
+void TransferSocketPool::Close() {
+    std::vector<socket_t> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = false;
+        idle.swap(idle_);
+    }
+    for (socket_t sock : idle) {
+        CLOSESOCKET(sock);
+    }
+}
+
+TransferSocketLease TransferSocketPool::Acquire(bool non_blocking) {
+    socket_t sock = kInvalidSocket;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) {
+            return TransferSocketLease();
+        }
+        if (!idle_.empty()) {
+            sock = idle_.back();
+            idle_.pop_back();
+        } else if (config_.first_port != 0) {
+            return TransferSocketLease();
+        }
+        leased_++;
+    }
+
+    if (sock == kInvalidSocket) {
+        sock = CreateSocket(0);
+        if (sock == kInvalidSocket) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            leased_--;
+            return TransferSocketLease();
+        }
+    }
+    if (!SetBlockingMode(sock, non_blocking)) {
+        TFTP_ERROR("Transfer socket mode change failed");
+        Release(sock);
+        return TransferSocketLease();
+    }
+    return TransferSocketLease(this, sock);
+}
+
+size_t TransferSocketPool::GetIdleCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+size_t TransferSocketPool::GetLeasedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return leased_;
+}
+
+void TransferSocketPool::Release(socket_t sock) {
+    DiscardPending(sock);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        leased_--;
+        // Range ports are always kept; ephemeral ones only up to the idle limit
+        if (open_ && (config_.first_port != 0 || idle_.size() < kMaxIdleSockets)) {
+            idle_.push_back(sock);
+            return;
+        }
+    }
+    CLOSESOCKET(sock);
+}
+
+socket_t TransferSocketPool::CreateSocket(uint16_t port) const {
+    socket_t sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == kInvalidSocket) {
+        TFTP_ERROR("Client socket creation failed");
+        return kInvalidSocket;
+    }
+    // The kernel may round or cap the sizes; a refused size leaves the default in place
+    if (config_.receive_buffer > 0 &&
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&config_.receive_buffer),
+                   sizeof(config_.receive_buffer)) != 0) {
+        TFTP_WARN("Could not set SO_RCVBUF to %d", config_.receive_buffer);
+    }
+    if (config_.send_buffer > 0 &&
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&config_.send_buffer),
+                   sizeof(config_.send_buffer)) != 0) {
+        TFTP_WARN("Could not set SO_SNDBUF to %d", config_.send_buffer);
+    }
+
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        if (port == 0) {
+            TFTP_ERROR("Client socket bind failed");
+        }
+        CLOSESOCKET(sock);
+        return kInvalidSocket;
+    }
+    return sock;
+}
+
+} // namespace internal
+} // namespace tftpserver
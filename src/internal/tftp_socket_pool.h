@@ -0,0 +1,106 @@
+/**
+ * @file tftp_socket_pool.h
+ * @brief Pre-bound transfer sockets reused across sessions
+ */
+
+#ifndef TFTP_SOCKET_POOL_H_
+#define TFTP_SOCKET_POOL_H_
+
+#include "tftp/tftp_socket.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Ports and buffer sizes of the per-transfer sockets
+ */
+struct TransferSocketConfig {
+    uint16_t first_port = 0;  // 0 with last_port 0: ephemeral ports chosen by the system
+    uint16_t last_port = 0;
+    int receive_buffer = 0;   // SO_RCVBUF in bytes, 0 keeps the system default
+    int send_buffer = 0;      // SO_SNDBUF in bytes, 0 keeps the system default
+};
+
+class TransferSocketPool;
+
+/**
+ * @brief Movable handle on a pooled socket; the socket goes back to the pool when released
+ */
+class TransferSocketLease {
+public:
+    TransferSocketLease() = default;
+    ~TransferSocketLease() { Release(); }
+
+    TransferSocketLease(TransferSocketLease&& other) noexcept;
+    TransferSocketLease& operator=(TransferSocketLease&& other) noexcept;
+
+    // Disable copy
+    TransferSocketLease(const TransferSocketLease&) = delete;
+    TransferSocketLease& operator=(const TransferSocketLease&) = delete;
+
+    explicit operator bool() const { return pool_ != nullptr; }
+    socket_t Get() const { return sock_; }
+    void Release();
+
+private:
+    friend class TransferSocketPool;
+    TransferSocketLease(TransferSocketPool* pool, socket_t sock) : pool_(pool), sock_(sock) {}
+
+    TransferSocketPool* pool_ = nullptr;
+    socket_t sock_ = kInvalidSocket;
+};
+
+/**
+ * @brief Transfer sockets (TIDs) bound once and handed from session to session
+ *
+ * With a port range every port is bound when the pool opens and a request finding no free
+ * port is refused, so a firewall only has to open that range. Without one, sockets on
+ * ephemeral ports are created on demand and up to kMaxIdleSockets are kept for reuse, so a
+ * burst of requests does not pay a socket() and bind() each. Datagrams still queued for a
+ * finished session are discarded before its socket is handed out again.
+ *
+ * The pool must outlive every lease it hands out.
+ */
+class TransferSocketPool {
+public:
+    static constexpr size_t kMaxIdleSockets = 256;
+
+    TransferSocketPool();
+    ~TransferSocketPool();
+
+    // Disable copy
+    TransferSocketPool(const TransferSocketPool&) = delete;
+    TransferSocketPool& operator=(const TransferSocketPool&) = delete;
+
+    // Binds the port range; false if none of its ports could be bound
+    bool Open(const TransferSocketConfig& config);
+    // Closes idle sockets; sockets still leased are closed as they are released
+    void Close();
+
+    // A socket in the requested blocking mode; empty when every port of the range is in use
+    // or a socket cannot be created
+    TransferSocketLease Acquire(bool non_blocking);
+
+    size_t GetIdleCount() const;
+    size_t GetLeasedCount() const;
+
+private:
+    friend class TransferSocketLease;
+    void Release(socket_t sock);
+    socket_t CreateSocket(uint16_t port) const;
+
+    mutable std::mutex mutex_;
+    TransferSocketConfig config_;
+    std::vector<socket_t> idle_;
+    size_t leased_;
+    bool open_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_SOCKET_POOL_H_
@@ -1,59 +1,226 @@
 #include "internal/tftp_thread_pool.h"
 #include "tftp/tftp_logger.h"
 #include <algorithm>
+#include <deque>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace tftpserver {
 namespace internal {
 
-TftpThreadPool::TftpThreadPool(size_t num_threads)
-    : stopping_(false), active_tasks_(0) {
-    
+namespace {
+
+// The pool and slot of the calling thread when it is a worker, so that jobs posted from a
+// task go to the worker's own deque
+thread_local const TftpThreadPool* current_pool = nullptr;
+thread_local size_t current_slot = 0;
+
+enum WorkerState : int {
+    kNotStarted,
+    kRunning,
+    kRetiring,  // Takes no new jobs, exits once its deque and inbox are empty
+    kExited
+};
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+WorkStealingDeque::Ring::Ring(size_t ring_capacity)
+    : capacity(ring_capacity),
+      slots(new std::atomic<PoolJob*>[ring_capacity]) {}
+
+WorkStealingDeque::WorkStealingDeque(size_t capacity)
+    : top_(0), bottom_(0) {
+    rings_.push_back(std::make_unique<Ring>(RoundUpToPowerOfTwo(std::max(capacity, size_t(2)))));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+}
+
+void WorkStealingDeque::Push(PoolJob* job) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Ring* ring = ring_.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64_t>(ring->capacity) - 1) {
+        ring = Grow(ring, bottom, top);
+    }
+    ring->Put(bottom, job);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+}
+
+PoolJob* WorkStealingDeque::Take() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Ring* ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        // Empty
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    PoolJob* job = ring->Get(bottom);
+    if (top == bottom) {
+        // Last job: race the thieves for it
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+PoolJob* WorkStealingDeque::Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return nullptr;
+    }
+    Ring* ring = ring_.load(std::memory_order_acquire);
+    PoolJob* job = ring->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+size_t WorkStealingDeque::Size() const {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+}
+
+WorkStealingDeque::Ring* WorkStealingDeque::Grow(Ring* ring, int64_t bottom, int64_t top) {
+    auto grown = std::make_unique<Ring>(ring->capacity * 2);
+    for (int64_t i = top; i < bottom; ++i) {
+        grown->Put(i, ring->Get(i));
+    }
+    Ring* result = grown.get();
+    rings_.push_back(std::move(grown));
+    ring_.store(result, std::memory_order_release);
+    return result;
+}
+
+struct TftpThreadPool::Worker {
+    WorkStealingDeque deque;
+    std::mutex inbox_mutex;
+    std::deque<PoolJob*> inbox;  // Jobs posted from outside the pool
+    std::thread thread;
+    std::atomic<int> state{kNotStarted};
+};
+
+TftpThreadPool::TftpThreadPool(size_t num_threads, bool pin_to_cores)
+    : thread_count_(0),
+      slot_count_(0),
+      next_worker_(0),
+      queued_tasks_(0),
+      active_tasks_(0),
+      sleepers_(0),
+      stopping_(false),
+      pin_to_cores_(pin_to_cores) {
+
     if (num_threads == 0) {
         num_threads = std::thread::hardware_concurrency();
         if (num_threads == 0) {
             num_threads = 4; // Fallback to 4 threads
         }
     }
-    
+
     // Clamp thread count to reasonable limits
-    num_threads = std::max(size_t(1), std::min(num_threads, size_t(64)));
-    
-    TFTP_INFO("Creating thread pool with %zu worker threads", num_threads);
-    
-    workers_.reserve(num_threads);
+    num_threads = std::max(size_t(1), std::min(num_threads, kMaxThreads));
+
+    TFTP_INFO("Creating thread pool with %zu worker threads%s", num_threads,
+              pin_to_cores ? " pinned to cores" : "");
+
+    for (auto& worker : workers_) {
+        worker = std::make_unique<Worker>();
+    }
     for (size_t i = 0; i < num_threads; ++i) {
-        workers_.emplace_back(&TftpThreadPool::WorkerThread, this);
+        StartWorker(i);
     }
+    slot_count_ = num_threads;
+    thread_count_ = num_threads;
 }
 
 TftpThreadPool::~TftpThreadPool() {
     Shutdown();
 }
 
+void TftpThreadPool::Resize(size_t num_threads) {
+    num_threads = std::max(size_t(1), std::min(num_threads, kMaxThreads));
+
+    std::lock_guard<std::mutex> lock(resize_mutex_);
+    if (stopping_ || num_threads == thread_count_) {
+        return;
+    }
+    TFTP_INFO("Resizing thread pool from %zu to %zu workers", thread_count_.load(), num_threads);
+
+    for (size_t i = 0; i < kMaxThreads; ++i) {
+        Worker& worker = *workers_[i];
+        if (i < num_threads) {
+            // A retiring worker that has not exited yet is simply kept
+            int expected = kRetiring;
+            if (worker.state.compare_exchange_strong(expected, kRunning) || expected == kRunning) {
+                continue;
+            }
+            if (worker.thread.joinable()) {
+                worker.thread.join();
+            }
+            StartWorker(i);
+        } else {
+            int expected = kRunning;
+            worker.state.compare_exchange_strong(expected, kRetiring);
+        }
+    }
+    if (num_threads > slot_count_) {
+        slot_count_ = num_threads;
+    }
+    thread_count_ = num_threads;
+    WakeAll();
+}
+
 void TftpThreadPool::Shutdown() {
+    std::lock_guard<std::mutex> lock(resize_mutex_);
     if (stopping_.exchange(true)) {
         return; // Already shutting down
     }
-    
-    TFTP_INFO("Shutting down thread pool with %zu workers", workers_.size());
-    
+
+    TFTP_INFO("Shutting down thread pool with %zu workers", thread_count_.load());
+
     // Notify all workers to wake up and check stopping flag
-    condition_.notify_all();
-    
+    WakeAll();
+
     // Wait for all workers to finish
-    for (std::thread& worker : workers_) {
-        if (worker.joinable()) {
-            worker.join();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
         }
     }
-    
-    // Clear any remaining tasks
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        std::queue<std::function<void()>> empty;
-        tasks_.swap(empty);
+
+    // Discard any remaining tasks; every worker has been joined, so this thread may own the deques
+    for (auto& worker : workers_) {
+        while (PoolJob* job = worker->deque.Take()) {
+            delete job;
+        }
+        std::lock_guard<std::mutex> inbox_lock(worker->inbox_mutex);
+        for (PoolJob* job : worker->inbox) {
+            delete job;
+        }
+        worker->inbox.clear();
     }
-    
+    queued_tasks_ = 0;
+
     TFTP_INFO("Thread pool shutdown completed");
 }
 
@@ -66,49 +233,163 @@ size_t TftpThreadPool::GetActiveTaskCount() const {
 }
 
 size_t TftpThreadPool::GetQueuedTaskCount() const {
-    std::unique_lock<std::mutex> lock(queue_mutex_);
-    return tasks_.size();
+    return queued_tasks_.load();
 }
 
 size_t TftpThreadPool::GetThreadCount() const {
-    return workers_.size();
+    return thread_count_.load();
 }
 
-void TftpThreadPool::WorkerThread() {
-    TFTP_INFO("Worker thread started");
-    
-    while (!stopping_) {
-        std::function<void()> task;
-        
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
-            
-            if (stopping_ && tasks_.empty()) {
+bool TftpThreadPool::Enqueue(PoolJob* job) {
+    // Counted before the job becomes visible, so that a worker that finds it never sees zero
+    queued_tasks_.fetch_add(1);
+
+    if (current_pool == this) {
+        workers_[current_slot]->deque.Push(job);
+    } else {
+        for (;;) {
+            size_t index = next_worker_.fetch_add(1, std::memory_order_relaxed) % thread_count_.load();
+            Worker& worker = *workers_[index];
+            std::lock_guard<std::mutex> lock(worker.inbox_mutex);
+            // Checked under the inbox lock, so that Shutdown either sees the job or it is refused
+            if (stopping_) {
+                queued_tasks_.fetch_sub(1);
+                return false;
+            }
+            // A worker being retired by Resize takes no new jobs
+            if (worker.state.load() == kRunning) {
+                worker.inbox.push_back(job);
                 break;
             }
-            
-            if (!tasks_.empty()) {
-                task = std::move(tasks_.front());
-                tasks_.pop();
+        }
+    }
+    WakeOne();
+    return true;
+}
+
+void TftpThreadPool::WakeOne() {
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        wake_.notify_one();
+    }
+}
+
+void TftpThreadPool::WakeAll() {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    wake_.notify_all();
+}
+
+void TftpThreadPool::StartWorker(size_t index) {
+    Worker& worker = *workers_[index];
+    worker.state = kRunning;
+    worker.thread = std::thread(&TftpThreadPool::WorkerThread, this, index);
+
+#ifdef __linux__
+    if (pin_to_cores_) {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % cores, &cpus);
+        int result = pthread_setaffinity_np(worker.thread.native_handle(), sizeof(cpus), &cpus);
+        if (result != 0) {
+            TFTP_WARN("Failed to pin worker %zu to core %zu: error %d", index, index % cores, result);
+        }
+    }
+#endif
+}
+
+PoolJob* TftpThreadPool::FindJob(Worker& self, size_t index) {
+    PoolJob* job = self.deque.Take();
+
+    if (job == nullptr) {
+        // Move posted jobs to the deque, where idle workers can steal them without a lock
+        std::lock_guard<std::mutex> lock(self.inbox_mutex);
+        if (!self.inbox.empty()) {
+            job = self.inbox.front();
+            self.inbox.pop_front();
+            for (PoolJob* posted : self.inbox) {
+                self.deque.Push(posted);
+            }
+            self.inbox.clear();
+        }
+    }
+
+    // A retiring worker only drains its own queues
+    if (job == nullptr && self.state.load() == kRunning) {
+        size_t slots = slot_count_.load();
+        for (size_t offset = 1; offset < slots && job == nullptr; ++offset) {
+            job = workers_[(index + offset) % slots]->deque.Steal();
+        }
+        // A worker busy with a long transfer has not moved its inbox yet
+        for (size_t offset = 1; offset < slots && job == nullptr; ++offset) {
+            Worker& victim = *workers_[(index + offset) % slots];
+            std::unique_lock<std::mutex> lock(victim.inbox_mutex, std::try_to_lock);
+            if (lock.owns_lock() && !victim.inbox.empty()) {
+                job = victim.inbox.front();
+                victim.inbox.pop_front();
             }
         }
-        
-        if (task) {
-            active_tasks_.fetch_add(1);
+    }
+
+    if (job != nullptr) {
+        // Active first, so that active + queued never drops below the true count
+        active_tasks_.fetch_add(1);
+        queued_tasks_.fetch_sub(1);
+    }
+    return job;
+}
+
+bool TftpThreadPool::TryRetire(Worker& self) {
+    std::lock_guard<std::mutex> lock(self.inbox_mutex);
+    if (!self.inbox.empty() || self.deque.Size() > 0) {
+        return false;
+    }
+    // Fails if Resize brought the worker back
+    int expected = kRetiring;
+    return self.state.compare_exchange_strong(expected, kExited);
+}
+
+void TftpThreadPool::WorkerThread(size_t index) {
+    current_pool = this;
+    current_slot = index;
+    Worker& self = *workers_[index];
+    TFTP_INFO("Worker thread %zu started", index);
+
+    while (!stopping_) {
+        PoolJob* job = FindJob(self, index);
+
+        if (job != nullptr) {
             try {
-                task();
+                job->Run();
             } catch (const std::exception& e) {
                 TFTP_ERROR("Exception in worker thread: %s", e.what());
             } catch (...) {
                 TFTP_ERROR("Unknown exception in worker thread");
             }
             active_tasks_.fetch_sub(1);
+            job->Publish();
+            delete job;
+            continue;
         }
+
+        if (self.state.load() != kRunning) {
+            if (TryRetire(self)) {
+                break;
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        wake_.wait(lock, [this, &self] {
+            return stopping_ || queued_tasks_.load() > 0 || self.state.load() != kRunning;
+        });
+        sleepers_.fetch_sub(1);
     }
-    
-    TFTP_INFO("Worker thread finished");
+
+    current_pool = nullptr;
+    TFTP_INFO("Worker thread %zu finished", index);
 }
 
 } // namespace internal
-} // namespace tftpserver
\ No newline at end of file
+} // namespace tftpserver
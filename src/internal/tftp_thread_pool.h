@@ -1,36 +1,171 @@
 /**
  * @file tftp_thread_pool.h
- * @brief Thread pool implementation for TFTP server
+ * @brief Work-stealing thread pool for TFTP server
  */
 
 #ifndef TFTP_THREAD_POOL_H_
 #define TFTP_THREAD_POOL_H_
 
+#include "internal/tftp_buffer_pool.h"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 #include <functional>
 #include <atomic>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <future>
 
 namespace tftpserver {
 namespace internal {
 
+/**
+ * @brief Callable queued on the pool; posting allocates exactly one, from the buffer pool
+ */
+class PoolJob : public PoolAllocated {
+public:
+    virtual ~PoolJob() = default;
+    virtual void Run() = 0;
+    // Called after the job stops counting as active, so that a waiter woken here sees the count
+    virtual void Publish() {}
+};
+
+template<typename F>
+class PoolJobImpl : public PoolJob {
+public:
+    template<typename G>
+    explicit PoolJobImpl(G&& f) : f_(std::forward<G>(f)) {}
+    void Run() override { f_(); }
+
+private:
+    F f_;
+};
+
+// Job of Submit: the result or exception is kept by Run and handed to the future by Publish
+template<typename R, typename F>
+class PoolTaskJob : public PoolJob {
+public:
+    template<typename G>
+    explicit PoolTaskJob(G&& f) : f_(std::forward<G>(f)) {}
+
+    std::future<R> GetFuture() { return promise_.get_future(); }
+
+    void Run() override {
+        try {
+            if constexpr (std::is_void_v<R>) {
+                f_();
+                result_.emplace(true);
+            } else {
+                result_.emplace(f_());
+            }
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+
+    void Publish() override {
+        if (error_) {
+            promise_.set_exception(error_);
+        } else if constexpr (std::is_void_v<R>) {
+            promise_.set_value();
+        } else {
+            promise_.set_value(std::move(*result_));
+        }
+    }
+
+private:
+    F f_;
+    std::promise<R> promise_;
+    std::optional<std::conditional_t<std::is_void_v<R>, bool, R>> result_;
+    std::exception_ptr error_;
+};
+
+/**
+ * @brief Chase-Lev work-stealing deque (Le et al., "Correct and Efficient Work-Stealing
+ *        for Weak Memory Models", PPoPP 2013)
+ *
+ * The owning worker pushes and takes at the bottom without locking; any other thread steals
+ * from the top. The ring doubles when full. Replaced rings are kept until the deque is
+ * destroyed, since a thief may still be reading one.
+ */
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(size_t capacity = 64);
+    ~WorkStealingDeque() = default;
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only
+    void Push(PoolJob* job);
+    // Owner only; nullptr when empty
+    PoolJob* Take();
+    // Any thread; nullptr when empty or when another thread won the race for the job
+    PoolJob* Steal();
+
+    size_t Size() const;
+
+private:
+    struct Ring {
+        explicit Ring(size_t capacity);
+        size_t capacity;
+        std::unique_ptr<std::atomic<PoolJob*>[]> slots;
+
+        PoolJob* Get(int64_t index) const {
+            return slots[static_cast<size_t>(index) & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+        void Put(int64_t index, PoolJob* job) {
+            slots[static_cast<size_t>(index) & (capacity - 1)].store(job, std::memory_order_relaxed);
+        }
+    };
+
+    Ring* Grow(Ring* ring, int64_t bottom, int64_t top);
+
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Ring*> ring_;
+    std::vector<std::unique_ptr<Ring>> rings_;  // Owner only; the current ring is the last
+};
+
+/**
+ * @brief Thread pool with a work-stealing deque per worker
+ *
+ * Jobs posted from outside the pool go to the inbox of one worker, picked round-robin, so
+ * posting threads do not all contend on one lock; a job posted from a worker goes to its own
+ * deque. Idle workers take from their own deque and inbox first, then steal from the others,
+ * so a job queued behind a long-running transfer is picked up by whichever worker is free.
+ * The worker count can be changed while the pool runs.
+ */
 class TftpThreadPool {
 public:
-    explicit TftpThreadPool(size_t num_threads = std::thread::hardware_concurrency());
+    static constexpr size_t kMaxThreads = 64;
+
+    explicit TftpThreadPool(size_t num_threads = std::thread::hardware_concurrency(), bool pin_to_cores = false);
     ~TftpThreadPool();
-    
+
     TftpThreadPool(const TftpThreadPool&) = delete;
     TftpThreadPool& operator=(const TftpThreadPool&) = delete;
     TftpThreadPool(TftpThreadPool&&) = delete;
     TftpThreadPool& operator=(TftpThreadPool&&) = delete;
-    
+
+    // Queues f to run once, without a future; false if the pool is shutting down
+    template<typename F>
+    bool Post(F&& f);
+
     template<typename F, typename... Args>
     auto Submit(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type>;
-    
+
+    // Starts workers or retires the highest-numbered ones; a retiring worker finishes its
+    // current task and the jobs already queued to it first
+    void Resize(size_t num_threads);
+
     void Shutdown();
     bool IsShuttingDown() const;
     size_t GetActiveTaskCount() const;
@@ -38,47 +173,63 @@ public:
     size_t GetThreadCount() const;
 
 private:
-    void WorkerThread();
-    
-    std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    
-    mutable std::mutex queue_mutex_;
-    std::condition_variable condition_;
-    std::atomic<bool> stopping_;
+    struct Worker;
+
+    bool Enqueue(PoolJob* job);
+    void WorkerThread(size_t index);
+    PoolJob* FindJob(Worker& self, size_t index);
+    bool TryRetire(Worker& self);
+    void StartWorker(size_t index);
+    void WakeOne();
+    void WakeAll();
+
+    std::array<std::unique_ptr<Worker>, kMaxThreads> workers_;  // All slots exist for the pool's lifetime
+    std::atomic<size_t> thread_count_;  // Workers taking new jobs: slots [0, thread_count_)
+    std::atomic<size_t> slot_count_;    // Slots ever started, scanned by thieves
+    std::atomic<size_t> next_worker_;
+
+    std::atomic<size_t> queued_tasks_;
     std::atomic<size_t> active_tasks_;
+    std::atomic<size_t> sleepers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+
+    std::mutex resize_mutex_;  // Serializes Resize and Shutdown
+    std::atomic<bool> stopping_;
+    bool pin_to_cores_;
 };
 
+template<typename F>
+bool TftpThreadPool::Post(F&& f) {
+    if (stopping_) {
+        return false;
+    }
+    std::unique_ptr<PoolJob> job(new PoolJobImpl<std::decay_t<F>>(std::forward<F>(f)));
+    if (!Enqueue(job.get())) {
+        return false;
+    }
+    job.release();
+    return true;
+}
+
 template<typename F, typename... Args>
-auto TftpThreadPool::Submit(F&& f, Args&&... args) 
+auto TftpThreadPool::Submit(F&& f, Args&&... args)
     -> std::future<typename std::invoke_result<F, Args...>::type> {
-    
+
     using return_type = typename std::invoke_result<F, Args...>::type;
-    
-    if (stopping_) {
+    using bound_type = decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+    auto job = std::make_unique<PoolTaskJob<return_type, bound_type>>(
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    std::future<return_type> result = job->GetFuture();
+    if (stopping_ || !Enqueue(job.get())) {
         throw std::runtime_error("Cannot submit task to stopped thread pool");
     }
-    
-    auto task = std::make_shared<std::packaged_task<return_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
-    
-    std::future<return_type> result = task->get_future();
-    
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        if (stopping_) {
-            throw std::runtime_error("Cannot submit task to stopped thread pool");
-        }
-        
-        tasks_.emplace([task](){ (*task)(); });
-    }
-    
-    condition_.notify_one();
+    job.release();
     return result;
 }
 
 } // namespace internal
 } // namespace tftpserver
 
-#endif // TFTP_THREAD_POOL_H_
\ No newline at end of file
+#endif // TFTP_THREAD_POOL_H_
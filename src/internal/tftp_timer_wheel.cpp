@@ -0,0 +1,114 @@
+/**
+ * @file tftp_timer_wheel.cpp
+ * @brief Hashed timer wheel for transfer retransmission deadlines
+ */
+
+#include "internal/tftp_timer_wheel.h"
+#include <algorithm>
+#include <limits>
+
+namespace tftpserver {
+namespace internal {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t slot_count, Clock::time_point start)
+    : tick_(std::max(tick, std::chrono::milliseconds(1))),
+      start_(start),
+      current_tick_(0),
+      size_(0),
+      next_expiry_tick_(std::numeric_limits<uint64_t>::max()),
+      slots_(std::max<size_t>(slot_count, 1)) {
+}
+
+uint64_t TimerWheel::TickOf(Clock::time_point time) const {
+    if (time <= start_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((time - start_) / tick_);
+}
+
+void TimerWheel::Schedule(uint64_t id, Clock::time_point deadline) {
+    if (deadline == Clock::time_point::max()) {
+        return;
+    }
+    // Round up so that the timer fires at or after its deadline, and never in the current tick
+    uint64_t expiry_tick = TickOf(deadline);
+    if (start_ + tick_ * expiry_tick < deadline) {
+        expiry_tick++;
+    }
+    expiry_tick = std::max(expiry_tick, current_tick_ + 1);
+
+    slots_[expiry_tick % slots_.size()].push_back(Timer{id, expiry_tick});
+    size_++;
+    next_expiry_tick_ = std::min(next_expiry_tick_, expiry_tick);
+}
+
+void TimerWheel::Advance(Clock::time_point now, std::vector<uint64_t>& expired) {
+    uint64_t target_tick = TickOf(now);
+    if (size_ == 0) {
+        current_tick_ = std::max(current_tick_, target_tick);
+        return;
+    }
+
+    // Visiting more than one full turn cannot find anything new
+    uint64_t steps = target_tick > current_tick_ ? target_tick - current_tick_ : 0;
+    if (steps > slots_.size()) {
+        current_tick_ = target_tick - slots_.size();
+    }
+
+    while (current_tick_ < target_tick && size_ > 0) {
+        current_tick_++;
+        std::vector<Timer>& slot = slots_[current_tick_ % slots_.size()];
+        for (size_t i = 0; i < slot.size();) {
+            if (slot[i].expiry_tick <= target_tick) {
+                expired.push_back(slot[i].id);
+                slot[i] = slot.back();
+                slot.pop_back();
+                size_--;
+            } else {
+                ++i;
+            }
+        }
+    }
+    current_tick_ = std::max(current_tick_, target_tick);
+    if (next_expiry_tick_ <= current_tick_) {
+        FindNextExpiry();
+    }
+}
+
+void TimerWheel::FindNextExpiry() {
+    next_expiry_tick_ = std::numeric_limits<uint64_t>::max();
+    if (size_ == 0) {
+        return;
+    }
+    // A slot only holds timers due on this turn or on later ones, so the first timer that is due
+    // when its slot comes round is the earliest
+    for (uint64_t tick = current_tick_ + 1; tick <= current_tick_ + slots_.size(); ++tick) {
+        for (const Timer& timer : slots_[tick % slots_.size()]) {
+            if (timer.expiry_tick == tick) {
+                next_expiry_tick_ = tick;
+                return;
+            }
+        }
+    }
+    // Everything pending is more than one turn away
+    for (const std::vector<Timer>& slot : slots_) {
+        for (const Timer& timer : slot) {
+            next_expiry_tick_ = std::min(next_expiry_tick_, timer.expiry_tick);
+        }
+    }
+}
+
+int TimerWheel::NextTimeoutMs(Clock::time_point now) const {
+    if (size_ == 0) {
+        return -1;
+    }
+    Clock::time_point next_expiry = start_ + tick_ * next_expiry_tick_;
+    if (next_expiry <= now) {
+        return 0;
+    }
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(next_expiry - now).count();
+    return static_cast<int>(std::min<long long>(wait, std::numeric_limits<int>::max()));
+}
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,63 @@
+/**
+ * @file tftp_timer_wheel.h
+ * @brief Hashed timer wheel for transfer retransmission deadlines
+ */
+
+#ifndef TFTP_TIMER_WHEEL_H_
+#define TFTP_TIMER_WHEEL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+/**
+ * @brief Single-threaded hashed timer wheel
+ *
+ * Schedule and Advance are O(1) amortised regardless of the number of timers. Deadlines are
+ * rounded up to the tick, so a timer never fires early. There is no cancel operation: callers
+ * only add a timer when their deadline moves earlier, and re-arm one that fires before a later
+ * deadline, so each owner keeps a single live timer.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10), size_t slot_count = 512,
+               Clock::time_point start = Clock::now());
+
+    // Adds a timer for id that expires at deadline
+    void Schedule(uint64_t id, Clock::time_point deadline);
+
+    // Moves the wheel forward to now, appending the ids of expired timers
+    void Advance(Clock::time_point now, std::vector<uint64_t>& expired);
+
+    // Milliseconds until the earliest pending timer is due, or -1 if no timer is pending
+    int NextTimeoutMs(Clock::time_point now) const;
+
+    size_t Size() const { return size_; }
+    std::chrono::milliseconds Tick() const { return tick_; }
+
+private:
+    struct Timer {
+        uint64_t id;
+        uint64_t expiry_tick;
+    };
+
+    uint64_t TickOf(Clock::time_point time) const;
+    void FindNextExpiry();
+
+    std::chrono::milliseconds tick_;
+    Clock::time_point start_;
+    uint64_t current_tick_;
+    size_t size_;
+    uint64_t next_expiry_tick_;  // earliest expiry_tick among pending timers
+    std::vector<std::vector<Timer>> slots_;
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_TIMER_WHEEL_H_
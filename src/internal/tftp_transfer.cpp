@@ -0,0 +1,980 @@
+/**
+ * @file tftp_transfer.cpp
+ * @brief Event-driven TFTP transfer state machines shared by all server engines
+ */
+
+#include "internal/tftp_transfer.h"
+#include "internal/tftp_io_stage.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace tftpserver {
+namespace internal {
+
+namespace {
+
+constexpr int kMaxRetries = 5;
+constexpr std::chrono::seconds kInitialRto(1);  // RFC 6298 starting point until the first RTT sample
+constexpr size_t kMaxBatchBytes = 256 * 1024;  // Upper bound of the reusable send buffer of a read
+
+} // namespace
+
+bool SameEndpoint(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+void NegotiateOptions(const TftpPacket& request, TransferOptions& options,
+                      std::unordered_map<std::string, std::string>& oack_options) {
+    const bool is_write = (request.GetOpCode() == OpCode::kWriteRequest);
+
+    for (const auto& option : request.GetOptions()) {
+        TFTP_INFO("Processing option: %s = %s", option.first.c_str(), option.second.c_str());
+
+        // Option names are case-insensitive (RFC 2347)
+        std::string name = option.first;
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        // Process blksize option (support default 512 bytes)
+        if (name == "blksize") {
+            std::string value;
+            try {
+                unsigned long blksize = std::stoul(option.second);
+                if (blksize >= kMinBlockSize && blksize <= kMaxBlockSize) {
+                    // Accept if requested block size is within valid range
+                    options.block_size = static_cast<size_t>(blksize);
+                    value = option.second;
+                } else {
+                    // Use default 512 if invalid
+                    options.block_size = kMaxDataSize;
+                    value = "512";
+                }
+            } catch (const std::exception& e) {
+                TFTP_WARN("Invalid blksize option: %s, using default 512", option.second.c_str());
+                options.block_size = kMaxDataSize;
+                value = "512";
+            }
+            TFTP_INFO("Block size negotiated: %s", value.c_str());
+            oack_options[name] = value;
+        }
+        // Process tsize option (RFC 2349): a WRQ announces the upload size, which is echoed back;
+        // an RRQ asks for the file size, filled in by the transfer once it is known
+        else if (name == "tsize") {
+            if (is_write) {
+                TFTP_INFO("Echoing back tsize value: %s", option.second.c_str());
+                oack_options[name] = option.second;
+            } else {
+                oack_options[name] = "0";
+            }
+        }
+        // Process timeout option (accept 1-255 seconds range)
+        else if (name == "timeout") {
+            std::string value;
+            try {
+                int timeout_val = std::stoi(option.second);
+                if (timeout_val >= 1 && timeout_val <= 255) {
+                    value = option.second;
+                    options.timeout_secs = timeout_val;
+                } else {
+                    value = "6"; // Default value
+                    options.timeout_secs = 6;
+                }
+            } catch (const std::exception& e) {
+                TFTP_WARN("Invalid timeout option: %s, using default 6", option.second.c_str());
+                value = "6";
+                options.timeout_secs = 6;
+            }
+            TFTP_INFO("Timeout negotiated: %s seconds", value.c_str());
+            oack_options[name] = value;
+        }
+        // Process windowsize option (RFC 7440); an invalid value is dropped and lock-step is kept
+        else if (name == "windowsize") {
+            try {
+                unsigned long window_size = std::stoul(option.second);
+                if (window_size >= kMinWindowSize && window_size <= kMaxWindowSize) {
+                    options.window_size = static_cast<size_t>(window_size);
+                    oack_options[name] = option.second;
+                    TFTP_INFO("Window size negotiated: %s", option.second.c_str());
+                } else {
+                    TFTP_WARN("Windowsize out of range: %s, ignoring", option.second.c_str());
+                }
+            } catch (const std::exception& e) {
+                TFTP_WARN("Invalid windowsize option: %s, ignoring", option.second.c_str());
+            }
+        }
+        // Unsupported options are omitted from the OACK (RFC 2347)
+        else {
+            TFTP_INFO("Ignoring unsupported option: %s", option.first.c_str());
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TransferChannel
+// ---------------------------------------------------------------------------
+
+bool TransferChannel::SendBatch(const net::OutgoingDatagram* datagrams, size_t count) {
+    std::vector<uint8_t> joined;
+    for (size_t i = 0; i < count; ++i) {
+        const net::OutgoingDatagram& datagram = datagrams[i];
+        const uint8_t* data = datagram.data;
+        if (datagram.payload_size > 0) {
+            // Send takes one buffer, so a gathered datagram is joined here
+            joined.assign(datagram.data, datagram.data + datagram.size);
+            joined.insert(joined.end(), datagram.payload, datagram.payload + datagram.payload_size);
+            data = joined.data();
+        }
+        if (!Send(data, datagram.Length())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t* TransferChannel::BatchBuffer(size_t) {
+    return nullptr;
+}
+
+// ---------------------------------------------------------------------------
+// Transfer
+// ---------------------------------------------------------------------------
+
+Transfer::Transfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config)
+    : channel_(channel),
+      peer_(peer),
+      config_(std::move(config)),
+      retries_(0),
+      rtt_(std::chrono::seconds(std::min<int>(config_.timeout_secs, kInitialRto.count())),
+           std::chrono::milliseconds(config_.retransmit_floor_ms),
+           std::chrono::seconds(config_.timeout_secs)),
+      state_(State::kActive),
+      awaiting_io_(false),
+      deadline_(Clock::time_point::max()),
+      started_at_(Clock::now()),
+      first_byte_recorded_(false),
+      round_open_(false),
+      round_retransmitted_(false) {
+    CountMetric(Metrics::kTransfersStarted);
+    if (config_.rate_limiter) {
+        config_.rate_limiter->AddClient(peer_);
+    }
+}
+
+Transfer::~Transfer() {
+    // A transfer dropped while active (engine shutdown) still counts as ended
+    End(State::kFailed);
+    if (config_.rate_limiter) {
+        config_.rate_limiter->RemoveClient(peer_);
+    }
+}
+
+void Transfer::HandlePacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) {
+    if (IsFinished()) {
+        return;
+    }
+    // RFC 1350: packets from another TID are rejected without disturbing the transfer
+    if (!IsPeer(from)) {
+        TFTP_WARN("Packet from unknown transfer ID, port %d", ntohs(from.sin_port));
+        uint8_t buffer[64];
+        size_t size = codec::EncodeError(buffer, sizeof(buffer), ErrorCode::kUnknownTransferId, "Unknown transfer ID");
+        channel_.SendTo(from, buffer, size);
+        return;
+    }
+    CountMetric(Metrics::kPacketsReceived);
+    if (packet.GetOpCode() == OpCode::kError) {
+        OnPeerError(packet, from);
+        return;
+    }
+    OnPacket(packet, from, now);
+}
+
+void Transfer::HandleIoReady(Clock::time_point now) {
+    if (IsFinished() || !awaiting_io_) {
+        return;
+    }
+    awaiting_io_ = false;
+    OnIoReady(now);
+}
+
+void Transfer::OnIoReady(Clock::time_point now) {
+    (void)now;
+}
+
+bool Transfer::IsPeer(const sockaddr_in& from) const {
+    return SameEndpoint(from, peer_);
+}
+
+void Transfer::OnPeerError(const PacketView& packet, const sockaddr_in& from) {
+    (void)from;
+    std::string_view message = packet.GetErrorMessage();
+    TFTP_INFO("Transfer aborted by client: %.*s", static_cast<int>(message.size()), message.data());
+    Finish();
+}
+
+void Transfer::Abort(const char* reason) {
+    if (!IsFinished()) {
+        TFTP_WARN("Transfer aborted (%s): %s", reason, config_.filepath.c_str());
+        Finish();
+    }
+}
+
+bool Transfer::Send(const TftpPacket& packet) {
+    std::vector<uint8_t> data = packet.Serialize();
+    if (!channel_.Send(data.data(), data.size())) {
+        TFTP_ERROR("Packet send failed, aborting transfer: %s", config_.filepath.c_str());
+        Finish();
+        return false;
+    }
+    CountMetric(Metrics::kPacketsSent);
+    return true;
+}
+
+bool Transfer::SendAck(uint16_t block_number) {
+    uint8_t buffer[codec::kHeaderSize];
+    size_t size = codec::EncodeAck(buffer, block_number);
+    if (!channel_.Send(buffer, size)) {
+        TFTP_ERROR("Packet send failed, aborting transfer: %s", config_.filepath.c_str());
+        Finish();
+        return false;
+    }
+    CountMetric(Metrics::kPacketsSent);
+    return true;
+}
+
+bool Transfer::SendBatch(const net::OutgoingDatagram* datagrams, size_t count) {
+    if (!channel_.SendBatch(datagrams, count)) {
+        TFTP_ERROR("Packet send failed, aborting transfer: %s", config_.filepath.c_str());
+        Finish();
+        return false;
+    }
+    CountMetric(Metrics::kPacketsSent, count);
+    return true;
+}
+
+void Transfer::Fail(ErrorCode code, const std::string& message) {
+    TFTP_ERROR("Error sent: %s (code: %d)", message.c_str(), static_cast<int>(code));
+    uint8_t buffer[codec::kHeaderSize + kMaxErrorMessageLength + 1];
+    size_t size = codec::EncodeError(buffer, sizeof(buffer), code, message);
+    if (size > 0 && channel_.Send(buffer, size)) {
+        CountMetric(Metrics::kPacketsSent);
+    }
+    if (config_.metrics) {
+        config_.metrics->CountError(code);
+    }
+    Finish();
+}
+
+void Transfer::Complete() {
+    End(State::kCompleted);
+    deadline_ = Clock::time_point::max();
+}
+
+void Transfer::Finish() {
+    End(State::kFailed);
+}
+
+void Transfer::End(State state) {
+    if (state_ != State::kActive) {
+        return;
+    }
+    state_ = state;
+    if (config_.metrics) {
+        config_.metrics->Add(state == State::kCompleted ? Metrics::kTransfersCompleted : Metrics::kTransfersFailed);
+        config_.metrics->TransferDuration().Record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started_at_).count()));
+    }
+}
+
+void Transfer::ApplyNegotiatedTimeout() {
+    // RFC 2349: the client asked for this retransmission interval, so it is neither adapted nor backed off
+    if (options_.timeout_secs > 0) {
+        std::chrono::seconds timeout(options_.timeout_secs);
+        rtt_ = RttEstimator(timeout, timeout, timeout);
+    }
+}
+
+void Transfer::ArmTimer(Clock::time_point now) {
+    retries_ = 0;
+    deadline_ = now + rtt_.Rto();
+}
+
+void Transfer::StartRound(Clock::time_point now) {
+    ArmTimer(now);
+    round_sent_at_ = now;
+    round_open_ = true;
+    round_retransmitted_ = false;
+}
+
+void Transfer::SampleRound(Clock::time_point now) {
+    if (!round_open_) {
+        return;
+    }
+    round_open_ = false;
+    if (round_retransmitted_) {
+        return;
+    }
+    auto rtt = std::chrono::duration_cast<RttEstimator::Duration>(now - round_sent_at_);
+    rtt_.Sample(rtt);
+    if (config_.metrics) {
+        config_.metrics->AckRtt().Record(static_cast<uint64_t>(std::max<int64_t>(0, rtt.count())));
+    }
+}
+
+void Transfer::MarkRetransmitted() {
+    round_retransmitted_ = true;
+}
+
+bool Transfer::ConsumeRetry(Clock::time_point now) {
+    CountMetric(Metrics::kTimeouts);
+    if (++retries_ > kMaxRetries) {
+        return false;
+    }
+    round_retransmitted_ = true;
+    rtt_.Backoff();
+    deadline_ = now + rtt_.Rto();
+    return true;
+}
+
+Transfer::Clock::duration Transfer::Throttle(uint64_t bytes, Clock::time_point now) {
+    if (!config_.rate_limiter) {
+        return Clock::duration::zero();
+    }
+    return config_.rate_limiter->Reserve(peer_, bytes, now);
+}
+
+void Transfer::Postpone(Clock::time_point until) {
+    deadline_ = until;
+}
+
+void Transfer::AwaitIo() {
+    awaiting_io_ = true;
+    deadline_ = Clock::time_point::max();
+}
+
+void Transfer::AnswerTransferSize(uint64_t size) {
+    auto it = oack_options_.find("tsize");
+    if (it != oack_options_.end()) {
+        it->second = std::to_string(size);
+        TFTP_INFO("Transfer size answered: %s bytes", it->second.c_str());
+    }
+}
+
+void Transfer::CountMetric(Metrics::Counter counter, uint64_t value) {
+    if (config_.metrics) {
+        config_.metrics->Add(counter, value);
+    }
+}
+
+void Transfer::RecordFirstByte(Clock::time_point now) {
+    if (config_.metrics && !first_byte_recorded_) {
+        first_byte_recorded_ = true;
+        config_.metrics->TimeToFirstByte().Record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - started_at_).count()));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ReadTransfer
+// ---------------------------------------------------------------------------
+
+ReadTransfer::ReadTransfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config,
+                           const TftpPacket& request, std::unique_ptr<ReadSource> source)
+    : Transfer(channel, peer, std::move(config)),
+      source_(std::move(source)),
+      read_ahead_(dynamic_cast<ReadAheadSource*>(source_.get())),
+      source_open_(false),
+      awaiting_oack_ack_(false),
+      file_size_(0),
+      total_blocks_(0),
+      window_start_(1),
+      window_end_(0),
+      window_restarted_(false),
+      window_postponed_(false) {
+    NegotiateOptions(request, options_, oack_options_);
+    ApplyNegotiatedTimeout();
+}
+
+ReadTransfer::~ReadTransfer() {
+    if (source_open_) {
+        source_->Close();
+    }
+}
+
+void ReadTransfer::Start(Clock::time_point now) {
+    TFTP_INFO("File read request: %s", config_.filepath.c_str());
+
+    if (!source_) {
+        Fail(ErrorCode::kFileNotFound, "File not found");
+        return;
+    }
+    // Before an OACK the size comes from Stat and the source is only opened once ACK 0
+    // arrives, so a client that just probes tsize and aborts never has the file opened or read
+    if (!oack_options_.empty() && source_->Stat(config_.filepath, file_size_)) {
+        if (!CheckFileSize()) {
+            return;
+        }
+    } else if (!OpenSource()) {
+        return;
+    }
+
+    // If options were accepted, the client must acknowledge the OACK with ACK 0 before DATA 1
+    if (!oack_options_.empty()) {
+        TFTP_INFO("RRQ contains options, sending OACK");
+        AnswerTransferSize(file_size_);
+        awaiting_oack_ack_ = true;
+        if (Send(TftpPacket::CreateOACK(oack_options_))) {
+            StartRound(now);
+        }
+        return;
+    }
+
+    SendNextWindow(now);
+}
+
+void ReadTransfer::OnPacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) {
+    (void)from;
+    if (packet.GetOpCode() != OpCode::kAcknowledge) {
+        TFTP_ERROR("Invalid ACK");
+        Finish();
+        return;
+    }
+
+    if (awaiting_oack_ack_) {
+        if (packet.GetBlockNumber() != 0) {
+            TFTP_ERROR("Invalid OACK acknowledgement");
+            Finish();
+            return;
+        }
+        SampleRound(now);
+        awaiting_oack_ack_ = false;
+        if (!source_open_ && !OpenSource()) {
+            return;
+        }
+        SendNextWindow(now);
+        return;
+    }
+
+    // Nothing of the postponed window has been sent, so there is nothing new to acknowledge
+    if (window_postponed_ || AwaitingIo()) {
+        TFTP_INFO("Ignoring ACK #%d while the next window waits", packet.GetBlockNumber());
+        return;
+    }
+
+    // Number of blocks newly acknowledged, computed modulo 2^16 so block numbers may wrap
+    size_t window_length = static_cast<size_t>(window_end_ - window_start_ + 1);
+    size_t acked = static_cast<uint16_t>(packet.GetBlockNumber() - static_cast<uint16_t>(window_start_ - 1));
+    if (acked > window_length) {
+        // A delayed ACK of an earlier round; nothing to do
+        TFTP_INFO("Ignoring stale ACK #%d", packet.GetBlockNumber());
+        return;
+    }
+    if (acked == 0) {
+        // RFC 1123: a duplicate ACK must not trigger a resend, or every duplicate doubles the
+        // traffic (Sorcerer's Apprentice); the retransmission timer recovers a lost block.
+        // With a window the client reports a lost first block this way, so the window is
+        // restarted once per round
+        if (options_.window_size == 1 || window_restarted_) {
+            TFTP_INFO("Ignoring duplicate ACK #%d", packet.GetBlockNumber());
+            return;
+        }
+        TFTP_INFO("Window ACK without progress, resending from block %llu",
+                 static_cast<unsigned long long>(window_start_));
+        window_restarted_ = true;
+        MarkRetransmitted();
+        // Resends are charged but not delayed; the peer is already waiting for them
+        Throttle(WindowBytes(), now);
+        if (SendWindow()) {
+            CountMetric(Metrics::kRetransmits, window_end_ - window_start_ + 1);
+        }
+        return;
+    }
+
+    // A partial ACK means the client lost a block inside the window; the next window restarts after it
+    if (acked < window_length) {
+        TFTP_INFO("Partial window ACK: %zu of %zu blocks, resending from block %llu",
+                 acked, window_length, static_cast<unsigned long long>(window_start_ + acked));
+    }
+    if (acked > 0) {
+        SampleRound(now);
+    }
+    window_start_ += acked;
+
+    if (window_start_ > total_blocks_) {
+        TFTP_INFO("File transfer completed: %s (%llu bytes, blksize %zu, windowsize %zu)",
+                 config_.filepath.c_str(), static_cast<unsigned long long>(file_size_),
+                 options_.block_size, options_.window_size);
+        Complete();
+        return;
+    }
+
+    window_restarted_ = false;
+    SendNextWindow(now);
+}
+
+void ReadTransfer::OnTimeout(Clock::time_point now) {
+    if (window_postponed_) {
+        window_postponed_ = false;
+        if (SendWindow()) {
+            RecordFirstByte(now);
+            StartRound(now);
+        }
+        return;
+    }
+
+    if (!ConsumeRetry(now)) {
+        TFTP_ERROR("ACK timeout");
+        Finish();
+        return;
+    }
+
+    if (awaiting_oack_ack_) {
+        TFTP_WARN("OACK acknowledgement timeout, resending OACK (%d)", retries_);
+        if (Send(TftpPacket::CreateOACK(oack_options_))) {
+            CountMetric(Metrics::kRetransmits);
+        }
+        return;
+    }
+
+    // Window lost: retransmit from the last acknowledged block
+    TFTP_WARN("ACK timeout, retransmitting from block %llu (%d, next timeout %lld ms)",
+             static_cast<unsigned long long>(window_start_), retries_,
+             static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(rtt_.Rto()).count()));
+    Throttle(WindowBytes(), now);
+    if (SendWindow()) {
+        CountMetric(Metrics::kRetransmits, window_end_ - window_start_ + 1);
+    }
+}
+
+void ReadTransfer::OnIoReady(Clock::time_point now) {
+    SendNextWindow(now);
+}
+
+bool ReadTransfer::OpenSource() {
+    if (!source_->Open(config_.filepath)) {
+        Fail(ErrorCode::kFileNotFound, "File not found");
+        return false;
+    }
+    source_open_ = true;
+    // The file may have changed since Stat; the transfer follows what was opened
+    file_size_ = source_->Size();
+    if (!CheckFileSize()) {
+        return false;
+    }
+    // The read-ahead starts on the first windows now, in chunks of the negotiated window
+    if (read_ahead_) {
+        read_ahead_->Prefetch(0, static_cast<size_t>(std::min<uint64_t>(
+            file_size_, static_cast<uint64_t>(options_.block_size) * options_.window_size)));
+    }
+    return true;
+}
+
+bool ReadTransfer::CheckFileSize() {
+    if (file_size_ > config_.max_size) {
+        Fail(ErrorCode::kDiskFull, "File size too large");
+        return false;
+    }
+    total_blocks_ = file_size_ / options_.block_size + 1;
+    return true;
+}
+
+void ReadTransfer::SendNextWindow(Clock::time_point now) {
+    // A window the read-ahead is still reading is sent once it is in memory, not read here
+    if (read_ahead_ && io_notifier_ &&
+        !read_ahead_->WhenReady((window_start_ - 1) * options_.block_size, io_notifier_)) {
+        AwaitIo();
+        return;
+    }
+    Clock::duration delay = Throttle(WindowBytes(), now);
+    if (delay > Clock::duration::zero()) {
+        window_postponed_ = true;
+        Postpone(now + delay);
+        return;
+    }
+    if (SendWindow()) {
+        RecordFirstByte(now);
+        StartRound(now);
+    }
+}
+
+uint64_t ReadTransfer::WindowBytes() const {
+    uint64_t end = std::min<uint64_t>(window_start_ + options_.window_size - 1, total_blocks_);
+    return std::min<uint64_t>(file_size_, end * options_.block_size) -
+           std::min<uint64_t>(file_size_, (window_start_ - 1) * options_.block_size);
+}
+
+bool ReadTransfer::SendWindow() {
+    window_end_ = std::min<uint64_t>(window_start_ + options_.window_size - 1, total_blocks_);
+
+    // A batch holds up to a full window of encoded packets (bounded by kMaxBatchBytes). The
+    // send buffer is sized once, when the channel first lends no storage, so steady-state
+    // windows do not allocate
+    const size_t slot_size = options_.block_size + codec::kHeaderSize;
+    if (batch_.empty()) {
+        batch_.resize(std::max<size_t>(1, std::min(options_.window_size, kMaxBatchBytes / slot_size)));
+    }
+
+    // A block the source can lend (a mapped file) is sent in place behind a header from the
+    // static table; any other block is read straight behind its header slot, all of a batch
+    // with one ReadBatch call. Up to batch_.size() packets are handed to the engine in one call
+    uint64_t block = window_start_;
+    while (block <= window_end_) {
+        size_t count = 0;
+        size_t batch_size = static_cast<size_t>(std::min<uint64_t>(batch_.size(), window_end_ - block + 1));
+        uint8_t* storage = nullptr;
+        reads_.clear();
+        for (; count < batch_size; ++count, ++block) {
+            uint64_t offset = (block - 1) * options_.block_size;
+            size_t block_size = static_cast<size_t>(std::min<uint64_t>(options_.block_size, file_size_ - offset));
+
+            const uint8_t* borrowed = block_size > 0 ? source_->PeekAt(offset, block_size) : nullptr;
+            if (borrowed) {
+                batch_[count].data = codec::DataHeader(static_cast<uint16_t>(block));
+                batch_[count].size = codec::kHeaderSize;
+                batch_[count].payload = borrowed;
+                batch_[count].payload_size = block_size;
+                batch_[count].immutable = true;
+                batch_[count].addr = peer_;
+                continue;
+            }
+
+            // Taken for the first block that is read, so a batch of lent blocks needs none
+            if (storage == nullptr) {
+                storage = channel_.BatchBuffer(batch_size * slot_size);
+            }
+            if (storage == nullptr) {
+                if (send_buffer_.Empty()) {
+                    send_buffer_.Resize(batch_.size() * slot_size);
+                }
+                storage = send_buffer_.Data();
+            }
+            uint8_t* packet = storage + count * slot_size;
+            ReadRequest read;
+            read.offset = offset;
+            read.buffer = packet + codec::kHeaderSize;
+            read.length = block_size;
+            reads_.push_back(read);
+            codec::EncodeDataHeader(packet, static_cast<uint16_t>(block));
+
+            batch_[count].data = packet;
+            batch_[count].size = codec::kHeaderSize + block_size;
+            batch_[count].payload = nullptr;
+            batch_[count].payload_size = 0;
+            batch_[count].immutable = false;
+            batch_[count].addr = peer_;
+        }
+        if (!reads_.empty()) {
+            bool ok = source_->ReadBatch(reads_.data(), reads_.size());
+            for (size_t i = 0; ok && i < reads_.size(); ++i) {
+                ok = reads_[i].bytes_read == reads_[i].length;
+            }
+            if (!ok) {
+                TFTP_ERROR("Read source failed between offsets %llu and %llu: %s",
+                          static_cast<unsigned long long>(reads_.front().offset),
+                          static_cast<unsigned long long>(reads_.back().offset + reads_.back().length),
+                          config_.filepath.c_str());
+                Fail(ErrorCode::kNotDefined, "File read error");
+                return false;
+            }
+        }
+        if (!SendBatch(batch_.data(), count)) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            CountMetric(Metrics::kBytesSent, batch_[i].Length() - codec::kHeaderSize);
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// WriteTransfer
+// ---------------------------------------------------------------------------
+
+WriteTransfer::WriteTransfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config,
+                             const TftpPacket& request, std::unique_ptr<WriteSink> sink)
+    : Transfer(channel, peer, std::move(config)),
+      sink_(std::move(sink)),
+      write_behind_(dynamic_cast<WriteBehindSink*>(sink_.get())),
+      sink_open_(false),
+      committed_(false),
+      has_expected_size_(false),
+      expected_file_size_(0),
+      total_received_(0),
+      expected_block_(1),
+      received_in_window_(0),
+      gap_acked_(false),
+      duplicate_acked_(false),
+      ack_postponed_(false) {
+    // Get expected file size from tsize option
+    if (request.HasOption("tsize")) {
+        std::string tsize_str = request.GetOption("tsize");
+        try {
+            expected_file_size_ = std::stoull(tsize_str);
+            has_expected_size_ = true;
+            TFTP_INFO("Expected file size from tsize option: %llu bytes",
+                     static_cast<unsigned long long>(expected_file_size_));
+        } catch (const std::exception& e) {
+            TFTP_WARN("Invalid tsize option value: %s, error: %s", tsize_str.c_str(), e.what());
+        }
+    }
+    NegotiateOptions(request, options_, oack_options_);
+    ApplyNegotiatedTimeout();
+}
+
+WriteTransfer::~WriteTransfer() {
+    // Discard the partial upload on every exit path that does not commit
+    if (sink_open_ && !committed_) {
+        sink_->Abort();
+    }
+}
+
+void WriteTransfer::Start(Clock::time_point now) {
+    TFTP_INFO("File write request: %s", config_.filepath.c_str());
+
+    if (has_expected_size_ && expected_file_size_ > config_.max_size) {
+        TFTP_ERROR("Announced tsize exceeds limit: %llu > %zu",
+                  static_cast<unsigned long long>(expected_file_size_), config_.max_size);
+        Fail(ErrorCode::kDiskFull, "File size too large");
+        return;
+    }
+
+    // Open the sink before acknowledging, so an unwritable target is reported instead of ACK 0
+    if (!sink_ || !sink_->Open(config_.filepath, has_expected_size_ ? expected_file_size_ : 0)) {
+        TFTP_ERROR("Cannot open write sink: %s", config_.filepath.c_str());
+        Fail(ErrorCode::kAccessViolation, "File write failed");
+        return;
+    }
+    sink_open_ = true;
+
+    // If options were accepted, send OACK, otherwise send normal ACK 0
+    if (!oack_options_.empty()) {
+        TFTP_INFO("WRQ contains options, sending OACK (blksize %zu)", options_.block_size);
+        if (!Send(TftpPacket::CreateOACK(oack_options_))) {
+            return;
+        }
+    } else {
+        TFTP_INFO("WRQ without options, sending ACK 0");
+        if (!SendAck(0)) {
+            return;
+        }
+    }
+    StartRound(now);
+}
+
+void WriteTransfer::OnPacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) {
+    (void)from;
+    if (packet.GetOpCode() != OpCode::kData) {
+        TFTP_ERROR("Invalid packet (not a data packet): OpCode=%d", static_cast<int>(packet.GetOpCode()));
+        Fail(ErrorCode::kIllegalOperation, "Illegal operation");
+        return;
+    }
+
+    // Distance from the expected block modulo 2^16, so block numbers may wrap past 65535
+    uint16_t ahead = static_cast<uint16_t>(packet.GetBlockNumber() - expected_block_);
+    if (ahead >= 0x8000) {
+        // An already stored block: the client missed our ACK and retransmitted
+        TFTP_INFO("Duplicate data block #%d (expected #%d)", packet.GetBlockNumber(), expected_block_);
+        // The postponed ACK answers it
+        if (ack_postponed_ || AwaitingIo()) {
+            return;
+        }
+        // Lock-step re-ACKs every duplicate (each one follows a client timeout); a resent window
+        // is re-ACKed once, not once per block
+        if (options_.window_size == 1 || !duplicate_acked_) {
+            duplicate_acked_ = true;
+            received_in_window_ = 0;
+            if (SendAck(static_cast<uint16_t>(expected_block_ - 1))) {
+                CountMetric(Metrics::kRetransmits);
+            }
+        }
+        return;
+    }
+    if (ahead != 0 && options_.window_size > 1 && ahead < options_.window_size) {
+        // A block inside the window was lost: ACK the last in-order block once to restart the window (RFC 7440)
+        TFTP_WARN("Window gap: received block #%d, expected #%d", packet.GetBlockNumber(), expected_block_);
+        if (!gap_acked_) {
+            gap_acked_ = true;
+            received_in_window_ = 0;
+            SendAck(static_cast<uint16_t>(expected_block_ - 1));
+        }
+        return;
+    }
+    if (ahead != 0) {
+        // Beyond anything the window allows; dropped like a corrupt datagram, the timer recovers
+        TFTP_WARN("Ignoring unexpected block number: %d (expected: %d)", packet.GetBlockNumber(), expected_block_);
+        return;
+    }
+
+    // File size limit check
+    const uint8_t* block_data = packet.GetPayload();
+    const size_t block_length = packet.GetPayloadSize();
+    if (total_received_ + block_length > config_.max_size) {
+        TFTP_ERROR("File size exceeded limit: %llu > %zu",
+                  static_cast<unsigned long long>(total_received_ + block_length), config_.max_size);
+        Fail(ErrorCode::kDiskFull, "File size too large");
+        return;
+    }
+
+    // Additional safety check: if using tsize option and received data exceeds expected size significantly
+    if (has_expected_size_ && total_received_ + block_length > expected_file_size_ + options_.block_size) {
+        TFTP_ERROR("Received data significantly exceeds tsize: %llu > %llu + %zu",
+                  static_cast<unsigned long long>(total_received_ + block_length),
+                  static_cast<unsigned long long>(expected_file_size_), options_.block_size);
+        Fail(ErrorCode::kDiskFull, "File size exceeds tsize");
+        return;
+    }
+
+    // Each in-order block goes to the sink before it is acknowledged
+    if (!sink_->Write(total_received_, block_data, block_length)) {
+        TFTP_ERROR("Write sink failed for block #%d", expected_block_);
+        Fail(ErrorCode::kDiskFull, "File write failed");
+        return;
+    }
+    total_received_ += block_length;
+    // The first block after an ACK answers it
+    SampleRound(now);
+    CountMetric(Metrics::kBytesReceived, block_length);
+    RecordFirstByte(now);
+    TFTP_INFO("Received data block #%d, block_size=%zu bytes, total=%llu bytes",
+             expected_block_, block_length, static_cast<unsigned long long>(total_received_));
+    gap_acked_ = false;
+    duplicate_acked_ = false;
+
+    // RFC 1350: Transfer ends when data packet size < negotiated block size (512 by default)
+    // When using tsize option, still need to wait for termination packet if file size is a multiple of it
+    bool last_packet = (block_length < options_.block_size);
+
+    // Publish the file before the final ACK so that a failed commit can still be reported
+    if (last_packet) {
+        TFTP_INFO("All data received: %llu bytes, %d blocks. Committing file...",
+                 static_cast<unsigned long long>(total_received_), expected_block_);
+        committed_ = true;
+        if (write_behind_ && io_notifier_) {
+            // The last writes and the commit (fsync, rename) run on the I/O stage; the final
+            // ACK follows them (OnIoReady)
+            Throttle(block_length, now);
+            expected_block_++;
+            write_behind_->CommitAsync(io_notifier_);
+            AwaitIo();
+            return;
+        }
+        if (!sink_->Commit()) {
+            TFTP_ERROR("File write failed: %s", config_.filepath.c_str());
+            Fail(ErrorCode::kAccessViolation, "File write failed");
+            return;
+        }
+    }
+
+    // The client sends no more until the window is acknowledged, so holding back the ACK
+    // keeps the upload within the bandwidth limits; the last block is acknowledged at once
+    Clock::duration delay = Throttle(block_length, now);
+    bool ack_due = ++received_in_window_ >= options_.window_size;
+    // While the disk is further behind than the write-behind allows, the ACK waits for it
+    if (ack_due && !last_packet && write_behind_ && !write_behind_->WaitForRoom(io_notifier_)) {
+        received_in_window_ = 0;
+        expected_block_++;
+        AwaitIo();
+        return;
+    }
+    if (ack_due && !last_packet && delay > Clock::duration::zero()) {
+        received_in_window_ = 0;
+        ack_postponed_ = true;
+        expected_block_++;
+        Postpone(now + delay);
+        return;
+    }
+
+    // Send ACK once per window, and always for the last block
+    bool acked = false;
+    if (ack_due || last_packet) {
+        if (!SendAck(expected_block_)) {
+            return;
+        }
+        TFTP_INFO("Sent ACK for block #%d", expected_block_);
+        received_in_window_ = 0;
+        acked = true;
+    }
+
+    expected_block_++;
+
+    if (last_packet) {
+        TFTP_INFO("File receive completed: %s (%llu bytes)", config_.filepath.c_str(),
+                 static_cast<unsigned long long>(total_received_));
+        Complete();
+        return;
+    }
+    if (acked) {
+        StartRound(now);
+    } else {
+        ArmTimer(now);
+    }
+}
+
+void WriteTransfer::OnIoReady(Clock::time_point now) {
+    uint16_t last_block = static_cast<uint16_t>(expected_block_ - 1);
+    switch (write_behind_->GetCommitState()) {
+        case WriteBehindSink::CommitState::kNone:
+            // The held ACK of a window, once the disk has caught up
+            if (!write_behind_->WaitForRoom(io_notifier_)) {
+                AwaitIo();
+            } else if (SendAck(last_block)) {
+                StartRound(now);
+            }
+            return;
+        case WriteBehindSink::CommitState::kPending:
+            AwaitIo();
+            return;
+        case WriteBehindSink::CommitState::kFailed:
+            TFTP_ERROR("File write failed: %s", config_.filepath.c_str());
+            Fail(ErrorCode::kAccessViolation, "File write failed");
+            return;
+        case WriteBehindSink::CommitState::kSucceeded:
+            if (!SendAck(last_block)) {
+                return;
+            }
+            TFTP_INFO("File receive completed: %s (%llu bytes)", config_.filepath.c_str(),
+                     static_cast<unsigned long long>(total_received_));
+            Complete();
+            return;
+    }
+}
+
+void WriteTransfer::OnTimeout(Clock::time_point now) {
+    if (ack_postponed_) {
+        ack_postponed_ = false;
+        if (SendAck(static_cast<uint16_t>(expected_block_ - 1))) {
+            StartRound(now);
+        }
+        return;
+    }
+
+    if (!ConsumeRetry(now)) {
+        TFTP_ERROR("Data packet receive timeout for block #%d", expected_block_);
+        Finish();
+        return;
+    }
+
+    received_in_window_ = 0;
+
+    // Nothing received yet after an OACK: the OACK itself was lost. The block number alone
+    // cannot tell, since it is 1 again once it has wrapped; a non-final block is never empty
+    if (total_received_ == 0 && !oack_options_.empty()) {
+        TFTP_WARN("Data packet timeout for block #1, resending OACK (%d)", retries_);
+        if (Send(TftpPacket::CreateOACK(oack_options_))) {
+            CountMetric(Metrics::kRetransmits);
+        }
+        return;
+    }
+
+    // Re-acknowledge the last in-order block so the client resends from there
+    uint16_t last_block = static_cast<uint16_t>(expected_block_ - 1);
+    TFTP_WARN("Data packet timeout for block #%d, re-sending ACK #%d (%d)", expected_block_, last_block, retries_);
+    if (SendAck(last_block)) {
+        CountMetric(Metrics::kRetransmits);
+    }
+}
+
+} // namespace internal
+} // namespace tftpserver
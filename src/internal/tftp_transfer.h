@@ -0,0 +1,278 @@
+/**
+ * @file tftp_transfer.h
+ * @brief Event-driven TFTP transfer state machines shared by all server engines
+ */
+
+#ifndef TFTP_TRANSFER_H_
+#define TFTP_TRANSFER_H_
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include "tftp/tftp_common.h"
+#include "tftp/tftp_file_io.h"
+#include "tftp/tftp_packet.h"
+#include "tftp/tftp_packet_view.h"
+#include "tftp/tftp_socket.h"
+#include "internal/tftp_buffer_pool.h"
+#include "internal/tftp_metrics_impl.h"
+#include "internal/tftp_rate_limiter.h"
+#include "internal/tftp_rtt_estimator.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tftpserver {
+namespace internal {
+
+class ReadAheadSource;
+class WriteBehindSink;
+
+// Per-transfer parameters negotiated through RFC 2347 options
+struct TransferOptions {
+    size_t block_size = kMaxDataSize;  // blksize (RFC 2348)
+    size_t window_size = 1;            // windowsize (RFC 7440)
+    int timeout_secs = 0;              // timeout (RFC 2349); 0 when not negotiated
+};
+
+// Address and port match (the transfer ID of RFC 1350)
+bool SameEndpoint(const sockaddr_in& a, const sockaddr_in& b);
+
+// Fills options from the request and collects the values to acknowledge in an OACK
+void NegotiateOptions(const TftpPacket& request, TransferOptions& options,
+                      std::unordered_map<std::string, std::string>& oack_options);
+
+/**
+ * @brief Packet output of a transfer, provided by the engine that drives it
+ *
+ * Packets arrive already encoded; the buffers are only borrowed for the duration of the call,
+ * except for the storage the channel itself lends with BatchBuffer.
+ */
+class TransferChannel {
+public:
+    virtual ~TransferChannel() = default;
+
+    // Sends to the transfer's peer; false means the packet could not be sent at all
+    virtual bool Send(const uint8_t* data, size_t size) = 0;
+
+    // Sends to another address (used to reject packets with an unknown transfer ID)
+    virtual bool SendTo(const sockaddr_in& addr, const uint8_t* data, size_t size) = 0;
+
+    // Sends a window of datagrams addressed to the peer; engines override this with a batched send
+    virtual bool SendBatch(const net::OutgoingDatagram* datagrams, size_t count);
+
+    // Storage of at least size bytes for the packets of the next SendBatch. An engine that
+    // sends asynchronously lends memory it keeps unchanged until the kernel is done with it,
+    // so that the batch is sent without a copy; nullptr lets the transfer use its own buffer
+    virtual uint8_t* BatchBuffer(size_t size);
+};
+
+// Server settings captured when a transfer is created
+struct TransferConfig {
+    std::string filepath;  // Resolved path (root directory applied)
+    size_t max_size = 0;
+    int timeout_secs = kDefaultTimeout;                  // Ceiling of the adaptive retransmission timeout
+    int retransmit_floor_ms = kDefaultRetransmitFloorMs;  // Floor of the adaptive retransmission timeout
+    Metrics* metrics = nullptr;  // Server counters; must outlive the transfer (optional)
+    RateLimiter* rate_limiter = nullptr;  // Bandwidth limits; must outlive the transfer (optional)
+};
+
+/**
+ * @brief Non-blocking state machine of a single RRQ or WRQ
+ *
+ * The engine calls Start once, then HandlePacket for every datagram received on the
+ * transfer's socket and OnTimeout once Deadline has passed, until IsFinished.
+ * No method blocks on the network. An engine that sets an I/O notifier also calls
+ * HandleIoReady after the notifier ran; the transfer then waits for the read-ahead and
+ * write-behind stages without blocking on the disk either.
+ */
+class Transfer : public PoolAllocated {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Transfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config);
+    virtual ~Transfer();
+
+    // Disable copy
+    Transfer(const Transfer&) = delete;
+    Transfer& operator=(const Transfer&) = delete;
+
+    virtual void Start(Clock::time_point now) = 0;
+    // The view only has to stay valid for the duration of the call
+    void HandlePacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now);
+    virtual void OnTimeout(Clock::time_point now) = 0;
+
+    // Called on an I/O thread when disk work the transfer waits for has finished; it must only
+    // wake the engine, and may run after the transfer is gone. Set before Start
+    void SetIoNotifier(std::function<void()> notifier) { io_notifier_ = std::move(notifier); }
+    // Resumes the transfer after the notifier ran; ignored unless it is waiting (AwaitingIo)
+    void HandleIoReady(Clock::time_point now);
+    bool AwaitingIo() const { return awaiting_io_; }
+
+    // Ends the transfer without notifying the peer (engine shutdown)
+    void Abort(const char* reason);
+
+    bool IsFinished() const { return state_ != State::kActive; }
+    bool Succeeded() const { return state_ == State::kCompleted; }
+    Clock::time_point Deadline() const { return deadline_; }
+    size_t BlockSize() const { return options_.block_size; }
+    const std::string& GetPath() const { return config_.filepath; }
+
+protected:
+    enum class State { kActive, kCompleted, kFailed };
+
+    // Packets that passed the transfer ID check (IsPeer); ERROR packets go to OnPeerError instead
+    virtual void OnPacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) = 0;
+    // Whether a datagram belongs to this transfer; the default accepts the requesting client only
+    virtual bool IsPeer(const sockaddr_in& from) const;
+    // The default ends the transfer
+    virtual void OnPeerError(const PacketView& packet, const sockaddr_in& from);
+    // Continues a transfer that called AwaitIo; the default does nothing
+    virtual void OnIoReady(Clock::time_point now);
+
+    // Sends to the peer; a send failure ends the transfer
+    bool Send(const TftpPacket& packet);
+    // Encodes the ACK on the stack, without touching the heap
+    bool SendAck(uint16_t block_number);
+    bool SendBatch(const net::OutgoingDatagram* datagrams, size_t count);
+    // Sends an ERROR to the peer and ends the transfer
+    void Fail(ErrorCode code, const std::string& message);
+    void Complete();
+    void Finish();
+
+    // Pins the retransmission timeout to a negotiated timeout option; call after NegotiateOptions
+    void ApplyNegotiatedTimeout();
+    // Restarts the retransmission timer and clears the retry count
+    void ArmTimer(Clock::time_point now);
+    // Arms the timer for a freshly sent packet that the peer must answer and notes its send time
+    void StartRound(Clock::time_point now);
+    // Takes an RTT sample from the answer to the current round, unless it was retransmitted (Karn's rule)
+    void SampleRound(Clock::time_point now);
+    // Excludes the current round from RTT sampling after a resend that was not caused by a timeout
+    void MarkRetransmitted();
+    // Counts a timeout and backs off the timer; false once the retry budget is exhausted
+    bool ConsumeRetry(Clock::time_point now);
+
+    // Charges payload bytes to the bandwidth limits; returns how long to hold back the next packet
+    Clock::duration Throttle(uint64_t bytes, Clock::time_point now);
+    // Holds the transfer until the given time: OnTimeout is called then, with the retry state untouched
+    void Postpone(Clock::time_point until);
+    // Holds the transfer without a deadline until the I/O notifier has run (OnIoReady)
+    void AwaitIo();
+    // Puts the file size in the OACK if the RRQ asked for it with tsize (RFC 2349)
+    void AnswerTransferSize(uint64_t size);
+
+    // Metrics hooks; no-ops without TransferConfig::metrics
+    void CountMetric(Metrics::Counter counter, uint64_t value = 1);
+    // Time to first byte is taken from the first call only
+    void RecordFirstByte(Clock::time_point now);
+
+    TransferChannel& channel_;
+    sockaddr_in peer_;
+    TransferConfig config_;
+    TransferOptions options_;
+    std::unordered_map<std::string, std::string> oack_options_;
+    int retries_;
+    RttEstimator rtt_;
+    std::function<void()> io_notifier_;  // Empty: disk work is waited for in place
+
+private:
+    // Moves an active transfer to its final state
+    void End(State state);
+
+    State state_;
+    bool awaiting_io_;
+    Clock::time_point deadline_;
+    Clock::time_point started_at_;
+    bool first_byte_recorded_;
+    Clock::time_point round_sent_at_;  // When the packet awaiting an answer was first sent
+    bool round_open_;                  // The current round has not been sampled yet
+    bool round_retransmitted_;         // Karn's rule: no RTT sample from a retransmitted round
+};
+
+/**
+ * @brief RRQ: sends windows of blocks pulled from a ReadSource
+ */
+class ReadTransfer : public Transfer {
+public:
+    ReadTransfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config,
+                 const TftpPacket& request, std::unique_ptr<ReadSource> source);
+    ~ReadTransfer() override;
+
+    void Start(Clock::time_point now) override;
+    void OnTimeout(Clock::time_point now) override;
+
+protected:
+    void OnPacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) override;
+    void OnIoReady(Clock::time_point now) override;
+
+private:
+    // Opens the source, takes its size and starts reading ahead; false (after sending the ERROR) on failure
+    bool OpenSource();
+    // Enforces the size limit on file_size_ and derives the block count
+    bool CheckFileSize();
+    // Sends blocks window_start_ .. window_end_
+    bool SendWindow();
+    // Sends the window starting at window_start_, or postpones it until the bandwidth limits allow
+    void SendNextWindow(Clock::time_point now);
+    // Payload bytes of the window starting at window_start_
+    uint64_t WindowBytes() const;
+
+    std::unique_ptr<ReadSource> source_;
+    ReadAheadSource* read_ahead_;               // source_, if it reads ahead on the I/O stage
+    PooledBuffer send_buffer_;                  // Encoded DATA packets of a batch the channel lends no storage for
+    std::vector<net::OutgoingDatagram> batch_;  // One entry per packet slot of a batch
+    std::vector<ReadRequest> reads_;            // Copied blocks of the current batch
+    bool source_open_;
+    bool awaiting_oack_ack_;
+    uint64_t file_size_;
+    uint64_t total_blocks_;
+    uint64_t window_start_;  // First unacknowledged block (absolute, so the 16-bit number may wrap)
+    uint64_t window_end_;    // Last block of the window in flight
+    bool window_restarted_;  // The window was already resent for an ACK without progress
+    bool window_postponed_;  // The next window waits for the bandwidth limits (Postpone)
+};
+
+/**
+ * @brief WRQ: acknowledges windows of blocks and streams them into a WriteSink
+ */
+class WriteTransfer : public Transfer {
+public:
+    WriteTransfer(TransferChannel& channel, const sockaddr_in& peer, TransferConfig config,
+                  const TftpPacket& request, std::unique_ptr<WriteSink> sink);
+    ~WriteTransfer() override;
+
+    void Start(Clock::time_point now) override;
+    void OnTimeout(Clock::time_point now) override;
+
+protected:
+    void OnPacket(const PacketView& packet, const sockaddr_in& from, Clock::time_point now) override;
+    void OnIoReady(Clock::time_point now) override;
+
+private:
+    std::unique_ptr<WriteSink> sink_;
+    WriteBehindSink* write_behind_;  // sink_, if it writes on the I/O stage
+    bool sink_open_;
+    bool committed_;
+    bool has_expected_size_;
+    uint64_t expected_file_size_;
+    uint64_t total_received_;
+    uint16_t expected_block_;
+    size_t received_in_window_;  // Blocks received since the last ACK (RFC 7440)
+    bool gap_acked_;             // Window restart already requested for the current gap
+    bool duplicate_acked_;       // Last in-order block already re-ACKed for the current duplicates
+    bool ack_postponed_;         // The ACK of the last window waits for the bandwidth limits (Postpone)
+};
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_TRANSFER_H_
@@ -0,0 +1,586 @@
+/**
+ * @file tftp_uring.cpp
+ * @brief Minimal io_uring wrapper (Linux) used by the kIoUring I/O backend
+ */
+
+#include "internal/tftp_uring.h"
+#include "tftp/tftp_logger.h"
+
+#ifdef TFTP_HAVE_IO_URING
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+#ifdef TFTP_HAVE_IO_URING
+
+namespace {
+
+constexpr unsigned kFileRingEntries = 64;
+constexpr unsigned kFileRingFiles = 1024;
+
+int SysSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+void PrepareCommon(io_uring_sqe* sqe, uint8_t opcode, int fd, bool fixed, uint64_t user_data) {
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->flags = fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->user_data = user_data;
+}
+
+// Loopback round trip through a multishot recvmsg on a fixed file and a provided buffer ring:
+// every interface the backend relies on, so older kernels are rejected up front
+bool ProbeIoUring() {
+    IoUring ring;
+    if (!ring.Init(8) || !ring.RegisterFileTable(2)) {
+        return false;
+    }
+    BufferRing buffers;
+    if (!buffers.Init(ring, 0, 4, 256)) {
+        return false;
+    }
+    int receiver = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    int sender = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    bool ok = false;
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (receiver >= 0 && sender >= 0 && bind(receiver, reinterpret_cast<sockaddr*>(&addr), addr_len) == 0 &&
+        getsockname(receiver, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0 && ring.UpdateFile(0, receiver)) {
+        msghdr pattern = {};
+        pattern.msg_namelen = sizeof(sockaddr_in);
+        io_uring_sqe* sqe = ring.GetSqe();
+        PrepareRecvMsgMultishot(sqe, 0, true, &pattern, 0, 1);
+        const uint8_t probe[] = {'u', 'r', 'i', 'n', 'g'};
+        iovec iov = {const_cast<uint8_t*>(probe), sizeof(probe)};
+        msghdr message = {};
+        message.msg_name = &addr;
+        message.msg_namelen = sizeof(addr);
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        sqe = ring.GetSqe();
+        PrepareSendMsg(sqe, sender, false, &message, 2);
+
+        bool received = false;
+        bool sent = false;
+        std::vector<io_uring_cqe> completions;
+        for (int attempt = 0; attempt < 10 && !(received && sent); ++attempt) {
+            ring.SubmitAndWait(1, 100);
+            completions.clear();
+            ring.Reap(completions);
+            for (const io_uring_cqe& cqe : completions) {
+                uint16_t id = 0;
+                if (cqe.user_data == 2) {
+                    sent = cqe.res == static_cast<int>(sizeof(probe));
+                } else if (cqe.user_data == 1 && cqe.res > 0 && (cqe.flags & IORING_CQE_F_MORE) &&
+                           CompletionBuffer(cqe, id)) {
+                    sockaddr_in from;
+                    const uint8_t* payload = nullptr;
+                    size_t payload_length = 0;
+                    received = ParseRecvMsg(buffers.Buffer(id), static_cast<size_t>(cqe.res), pattern, from,
+                                            payload, payload_length) &&
+                               payload_length == sizeof(probe) && std::memcmp(payload, probe, sizeof(probe)) == 0;
+                }
+            }
+        }
+        ok = received && sent;
+    }
+    if (receiver >= 0) {
+        close(receiver);
+    }
+    if (sender >= 0) {
+        close(sender);
+    }
+    return ok;
+}
+
+thread_local std::shared_ptr<FileRing> t_file_ring;
+
+} // namespace
+
+bool IoUringAvailable() {
+    static const bool available = [] {
+        bool ok = ProbeIoUring();
+        if (!ok) {
+            TFTP_INFO("io_uring is not usable on this kernel; the portable I/O backend will be used");
+        }
+        return ok;
+    }();
+    return available;
+}
+
+// ---------------------------------------------------------------------------
+// IoUring
+// ---------------------------------------------------------------------------
+
+IoUring::IoUring()
+    : fd_(-1), sq_ring_(nullptr), sq_ring_size_(0), cq_ring_(nullptr), cq_ring_size_(0),
+      sqes_(nullptr), sqes_size_(0), sq_head_(nullptr), sq_tail_(nullptr), sq_mask_(0),
+      sq_entries_(0), sqe_tail_(0), cq_head_(nullptr), cq_tail_(nullptr), cq_mask_(0), cqes_(nullptr) {
+}
+
+IoUring::~IoUring() {
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool IoUring::Init(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    // Multishot receives post many completions per entry, so the completion queue is larger
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+    params.cq_entries = entries * 8;
+    int fd = SysSetup(entries, &params);
+    if (fd < 0) {
+        TFTP_DEBUG("io_uring_setup failed: %s", strerror(errno));
+        return false;
+    }
+    if ((params.features & IORING_FEAT_NODROP) == 0 || (params.features & IORING_FEAT_EXT_ARG) == 0) {
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    void* sq = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                    IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        return false;
+    }
+    sq_ring_ = sq;
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        void* cq = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                        IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            return false;
+        }
+        cq_ring_ = cq;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    uint8_t* sq_base = static_cast<uint8_t*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq_base + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq_base + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq_base + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = *sq_tail_;
+    // Entries are always used in ring order, so the indirection array is the identity
+    unsigned* array = reinterpret_cast<unsigned*>(sq_base + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+        array[i] = i;
+    }
+
+    uint8_t* cq_base = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq_base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq_base + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq_base + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq_base + params.cq_off.cqes);
+    return true;
+}
+
+io_uring_sqe* IoUring::GetSqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+        Submit();
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+unsigned IoUring::FlushQueue() {
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+}
+
+int IoUring::Enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size) {
+    for (;;) {
+        int result = static_cast<int>(
+            syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, arg, arg_size));
+        if (result >= 0 || errno != EINTR) {
+            return result;
+        }
+    }
+}
+
+unsigned IoUring::Unsubmitted() const {
+    return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+}
+
+int IoUring::Submit() {
+    unsigned pending = FlushQueue();
+    if (pending == 0) {
+        return 0;
+    }
+    return Enter(pending, 0, 0, nullptr, 0);
+}
+
+int IoUring::SubmitAndWait(unsigned min_complete, int timeout_ms) {
+    unsigned pending = FlushQueue();
+    if (min_complete == 0 || timeout_ms == 0) {
+        return pending == 0 ? 0 : Enter(pending, 0, 0, nullptr, 0);
+    }
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    io_uring_getevents_arg arg;
+    std::memset(&arg, 0, sizeof(arg));
+    __kernel_timespec timeout;
+    if (timeout_ms > 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uintptr_t>(&timeout);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    int result = (flags & IORING_ENTER_EXT_ARG) ? Enter(pending, min_complete, flags, &arg, sizeof(arg))
+                                                : Enter(pending, min_complete, flags, nullptr, 0);
+    if (result < 0 && errno == ETIME) {
+        return 0;  // Waiting timed out; entries were still submitted
+    }
+    return result;
+}
+
+size_t IoUring::Reap(std::vector<io_uring_cqe>& out) {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    size_t count = tail - head;
+    for (; head != tail; ++head) {
+        out.push_back(cqes_[head & cq_mask_]);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+bool IoUring::RegisterFileTable(unsigned count) {
+    io_uring_rsrc_register reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.nr = count;
+    reg.flags = IORING_RSRC_REGISTER_SPARSE;
+    return SysRegister(fd_, IORING_REGISTER_FILES2, &reg, sizeof(reg)) == 0;
+}
+
+bool IoUring::UpdateFile(unsigned slot, int fd) {
+    io_uring_files_update update;
+    std::memset(&update, 0, sizeof(update));
+    update.offset = slot;
+    update.fds = reinterpret_cast<uintptr_t>(&fd);
+    return SysRegister(fd_, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+}
+
+bool IoUring::RegisterBufferRing(uint16_t group, void* ring, unsigned entries) {
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uintptr_t>(ring);
+    reg.ring_entries = entries;
+    reg.bgid = group;
+    return SysRegister(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+}
+
+void IoUring::UnregisterBufferRing(uint16_t group) {
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.bgid = group;
+    SysRegister(fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+}
+
+bool IoUring::RegisterBuffers(const iovec* buffers, unsigned count) {
+    return SysRegister(fd_, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+}
+
+bool IoUring::Supports(uint8_t opcode) {
+    constexpr unsigned kProbeOps = 256;
+    std::vector<uint8_t> storage(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op));
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (SysRegister(fd_, IORING_REGISTER_PROBE, probe, kProbeOps) != 0 || opcode > probe->last_op) {
+        return false;
+    }
+    return (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+// ---------------------------------------------------------------------------
+// BufferRing
+// ---------------------------------------------------------------------------
+
+BufferRing::BufferRing()
+    : ring_(nullptr), buffers_(nullptr), mapped_size_(0), group_(0), count_(0), tail_(0), buffer_size_(0) {
+}
+
+BufferRing::~BufferRing() {
+    if (ring_ != nullptr) {
+        ring_->UnregisterBufferRing(group_);
+    }
+    if (buffers_ != nullptr) {
+        munmap(buffers_, mapped_size_);
+    }
+}
+
+bool BufferRing::Init(IoUring& ring, uint16_t group, unsigned count, size_t buffer_size) {
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        return false;
+    }
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    mapped_size_ = (count * sizeof(io_uring_buf) + page - 1) / page * page;
+    void* mapping = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    buffers_ = static_cast<io_uring_buf_ring*>(mapping);
+    if (!ring.RegisterBufferRing(group, buffers_, count)) {
+        TFTP_DEBUG("Cannot register io_uring buffer ring: %s", strerror(errno));
+        return false;
+    }
+    ring_ = &ring;
+    group_ = group;
+    count_ = count;
+    buffer_size_ = buffer_size;
+    storage_.resize(static_cast<size_t>(count) * buffer_size);
+    tail_ = 0;
+    for (unsigned id = 0; id < count; ++id) {
+        Add(static_cast<uint16_t>(id));
+    }
+    __atomic_store_n(&buffers_->tail, tail_, __ATOMIC_RELEASE);
+    return true;
+}
+
+void BufferRing::Add(uint16_t id) {
+    // Entries start at the ring base; the header's flexible array member does not in C++,
+    // where its empty-struct wrapper takes up space
+    io_uring_buf* buffer = reinterpret_cast<io_uring_buf*>(buffers_) + (tail_ & (count_ - 1));
+    buffer->addr = reinterpret_cast<uintptr_t>(Buffer(id));
+    buffer->len = static_cast<uint32_t>(buffer_size_);
+    buffer->bid = id;
+    ++tail_;
+}
+
+void BufferRing::Recycle(uint16_t id) {
+    Add(id);
+    __atomic_store_n(&buffers_->tail, tail_, __ATOMIC_RELEASE);
+}
+
+// ---------------------------------------------------------------------------
+// Submission helpers
+// ---------------------------------------------------------------------------
+
+void PrepareRecvMsgMultishot(io_uring_sqe* sqe, int fd, bool fixed, msghdr* pattern, uint16_t group,
+                             uint64_t user_data) {
+    PrepareCommon(sqe, IORING_OP_RECVMSG, fd, fixed, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(pattern);
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = group;
+}
+
+void PrepareSendMsg(io_uring_sqe* sqe, int fd, bool fixed, const msghdr* message, uint64_t user_data) {
+    PrepareCommon(sqe, IORING_OP_SENDMSG, fd, fixed, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(message);
+    sqe->len = 1;
+    // A full socket buffer fails the send at once, as on the portable path, instead of having
+    // the kernel wait for room
+    sqe->msg_flags = MSG_DONTWAIT;
+}
+
+#ifdef TFTP_HAVE_IO_URING_SEND_ZC
+void PrepareSendZeroCopy(io_uring_sqe* sqe, int fd, bool fixed, const uint8_t* data, size_t size,
+                         const sockaddr_in* to, int buffer_index, uint64_t user_data) {
+    PrepareCommon(sqe, IORING_OP_SEND_ZC, fd, fixed, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(data);
+    sqe->len = static_cast<uint32_t>(size);
+    sqe->addr2 = reinterpret_cast<uintptr_t>(to);
+    sqe->addr_len = sizeof(sockaddr_in);
+    sqe->msg_flags = MSG_DONTWAIT;
+    if (buffer_index >= 0) {
+        sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+        sqe->buf_index = static_cast<uint16_t>(buffer_index);
+    }
+}
+
+void PrepareSendMsgZeroCopy(io_uring_sqe* sqe, int fd, bool fixed, const msghdr* message, uint64_t user_data) {
+    PrepareSendMsg(sqe, fd, fixed, message, user_data);
+    sqe->opcode = IORING_OP_SENDMSG_ZC;
+}
+#endif
+
+void PrepareRead(io_uring_sqe* sqe, int fd, bool fixed, uint8_t* buffer, size_t length, uint64_t offset,
+                 uint64_t user_data) {
+    PrepareCommon(sqe, IORING_OP_READ, fd, fixed, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(buffer);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->off = offset;
+}
+
+void PrepareCancel(io_uring_sqe* sqe, uint64_t target_user_data, uint64_t user_data) {
+    PrepareCommon(sqe, IORING_OP_ASYNC_CANCEL, -1, false, user_data);
+    sqe->addr = target_user_data;
+}
+
+bool CompletionBuffer(const io_uring_cqe& cqe, uint16_t& id) {
+    if ((cqe.flags & IORING_CQE_F_BUFFER) == 0) {
+        return false;
+    }
+    id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    return true;
+}
+
+bool ParseRecvMsg(const uint8_t* buffer, size_t length, const msghdr& pattern, sockaddr_in& from,
+                  const uint8_t*& payload, size_t& payload_length) {
+    // Layout: io_uring_recvmsg_out, the name area, the control area, then the payload
+    io_uring_recvmsg_out out;
+    if (length < sizeof(out)) {
+        return false;
+    }
+    std::memcpy(&out, buffer, sizeof(out));
+    size_t header = sizeof(out) + pattern.msg_namelen + pattern.msg_controllen;
+    if ((out.flags & MSG_TRUNC) != 0 || header > length || out.payloadlen > length - header ||
+        out.namelen < sizeof(sockaddr_in) || pattern.msg_namelen < sizeof(sockaddr_in)) {
+        return false;
+    }
+    std::memcpy(&from, buffer + sizeof(out), sizeof(from));
+    if (from.sin_family != AF_INET) {
+        return false;
+    }
+    payload = buffer + header;
+    payload_length = out.payloadlen;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// FileRing
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<FileRing> FileRing::ForThisThread() {
+    return t_file_ring;
+}
+
+void FileRing::EnableForThisThread(bool enable) {
+    if (!enable) {
+        t_file_ring.reset();
+        return;
+    }
+    if (t_file_ring || !IoUringAvailable()) {
+        return;
+    }
+    std::shared_ptr<FileRing> ring(new FileRing());
+    if (ring->Init()) {
+        t_file_ring = std::move(ring);
+    }
+}
+
+bool FileRing::Init() {
+    if (!ring_.Init(kFileRingEntries) || !ring_.RegisterFileTable(kFileRingFiles)) {
+        return false;
+    }
+    for (unsigned slot = kFileRingFiles; slot > 0; --slot) {
+        free_slots_.push_back(static_cast<int>(slot - 1));
+    }
+    owner_ = std::this_thread::get_id();
+    return true;
+}
+
+bool FileRing::IsOwnedByThisThread() const {
+    return owner_ == std::this_thread::get_id();
+}
+
+int FileRing::AddFile(int fd) {
+    std::lock_guard<std::mutex> lock(files_mutex_);
+    if (free_slots_.empty()) {
+        return -1;
+    }
+    int slot = free_slots_.back();
+    if (!ring_.UpdateFile(static_cast<unsigned>(slot), fd)) {
+        return -1;
+    }
+    free_slots_.pop_back();
+    return slot;
+}
+
+void FileRing::RemoveFile(int slot) {
+    std::lock_guard<std::mutex> lock(files_mutex_);
+    ring_.UpdateFile(static_cast<unsigned>(slot), -1);
+    free_slots_.push_back(slot);
+}
+
+bool FileRing::ReadBatch(int fd, int slot, ReadRequest* requests, size_t count) {
+    bool fixed = slot >= 0;
+    bool ok = true;
+    for (size_t first = 0; first < count; first += kFileRingEntries) {
+        size_t batch = std::min<size_t>(count - first, kFileRingEntries);
+        for (size_t i = first; i < first + batch; ++i) {
+            PrepareRead(ring_.GetSqe(), fixed ? slot : fd, fixed, requests[i].buffer, requests[i].length,
+                        requests[i].offset, i);
+        }
+        size_t done = 0;
+        while (done < batch) {
+            if (ring_.SubmitAndWait(1, -1) < 0) {
+                TFTP_ERROR("io_uring file read submission failed: %s", strerror(errno));
+                return false;  // The entries stay queued in the kernel; nothing more can be trusted
+            }
+            completions_.clear();
+            done += ring_.Reap(completions_);
+            for (const io_uring_cqe& cqe : completions_) {
+                ReadRequest& request = requests[cqe.user_data];
+                if (cqe.res < 0) {
+                    TFTP_ERROR("File read error at offset %llu (%s)",
+                              static_cast<unsigned long long>(request.offset), strerror(-cqe.res));
+                    ok = false;
+                    request.bytes_read = 0;
+                } else {
+                    request.bytes_read = static_cast<size_t>(cqe.res);
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+#else
+
+bool IoUringAvailable() {
+    return false;
+}
+
+#endif // TFTP_HAVE_IO_URING
+
+} // namespace internal
+} // namespace tftpserver
@@ -0,0 +1,214 @@
+/**
+ * @file tftp_uring.h
+ * @brief Minimal io_uring wrapper (Linux) used by the kIoUring I/O backend
+ */
+
+#ifndef TFTP_URING_H_
+#define TFTP_URING_H_
+
+#if defined(__linux__) && !defined(TFTP_DISABLE_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// Multishot recvmsg and provided buffer rings are the newest interfaces used
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_CQE_F_MORE)
+#define TFTP_HAVE_IO_URING 1
+#endif
+// Zero-copy sends (SEND_ZC from registered buffers, SENDMSG_ZC) are optional; the running
+// kernel is asked with IoUring::Supports
+#if defined(IORING_RECVSEND_FIXED_BUF) && defined(IORING_SEND_ZC_REPORT_USAGE)
+#define TFTP_HAVE_IO_URING_SEND_ZC 1
+#endif
+#endif
+#endif
+
+#include "tftp/tftp_file_io.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef TFTP_HAVE_IO_URING
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+namespace tftpserver {
+namespace internal {
+
+// True when the running kernel offers every io_uring feature the backend needs (probed once)
+bool IoUringAvailable();
+
+#ifdef TFTP_HAVE_IO_URING
+
+/**
+ * @brief One io_uring instance driven through the raw system calls (no liburing dependency)
+ *
+ * Submission entries are queued with GetSqe and handed to the kernel together by Submit or
+ * SubmitAndWait, so everything queued during one loop iteration costs one system call.
+ * Completions are copied out by Reap, which keeps handlers free to queue new entries.
+ * Not thread-safe: one thread submits and reaps.
+ */
+class IoUring {
+public:
+    IoUring();
+    ~IoUring();
+
+    // Disable copy
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    bool Init(unsigned entries);
+    bool IsValid() const { return fd_ >= 0; }
+
+    // Next submission entry, zeroed; queued entries are submitted first when the queue is full.
+    // nullptr only if the kernel takes nothing
+    io_uring_sqe* GetSqe();
+    // Hands queued entries to the kernel without waiting; returns the number submitted or -1
+    int Submit();
+    // Submits, then waits until min_complete completions are ready or timeout_ms passes (-1 waits
+    // indefinitely, 0 only submits)
+    int SubmitAndWait(unsigned min_complete, int timeout_ms);
+    // Entries handed out by GetSqe that the kernel has not taken yet
+    unsigned Unsubmitted() const;
+    // Appends all ready completions to out and releases them to the kernel; returns how many
+    size_t Reap(std::vector<io_uring_cqe>& out);
+
+    // Sparse table of count fixed files; entries flagged IOSQE_FIXED_FILE name a slot instead of an fd
+    bool RegisterFileTable(unsigned count);
+    // Puts fd into slot, or empties it with -1
+    bool UpdateFile(unsigned slot, int fd);
+    bool RegisterBufferRing(uint16_t group, void* ring, unsigned entries);
+    void UnregisterBufferRing(uint16_t group);
+    // Pins buffers for operations naming them by index (IORING_REGISTER_BUFFERS)
+    bool RegisterBuffers(const iovec* buffers, unsigned count);
+    // True when the kernel implements opcode (IORING_REGISTER_PROBE)
+    bool Supports(uint8_t opcode);
+
+private:
+    int Enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size);
+    // Publishes queued entries; returns the number the kernel has not consumed yet
+    unsigned FlushQueue();
+
+    int fd_;
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* cq_ring_;
+    size_t cq_ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sqe_tail_;  // Local tail: entries handed out by GetSqe
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+};
+
+/**
+ * @brief Provided buffers (IORING_REGISTER_PBUF_RING) that multishot receives fill
+ *
+ * The kernel picks a free buffer for every datagram and names it in the completion; the
+ * owner hands it back with Recycle once the datagram is consumed.
+ */
+class BufferRing {
+public:
+    BufferRing();
+    ~BufferRing();
+
+    // Disable copy
+    BufferRing(const BufferRing&) = delete;
+    BufferRing& operator=(const BufferRing&) = delete;
+
+    // count must be a power of two; the ring must outlive this object
+    bool Init(IoUring& ring, uint16_t group, unsigned count, size_t buffer_size);
+    bool IsValid() const { return ring_ != nullptr; }
+
+    uint16_t Group() const { return group_; }
+    size_t BufferSize() const { return buffer_size_; }
+    uint8_t* Buffer(uint16_t id) { return storage_.data() + static_cast<size_t>(id) * buffer_size_; }
+    // Gives a buffer back to the kernel
+    void Recycle(uint16_t id);
+
+private:
+    void Add(uint16_t id);
+
+    IoUring* ring_;
+    io_uring_buf_ring* buffers_;
+    size_t mapped_size_;
+    uint16_t group_;
+    unsigned count_;
+    uint16_t tail_;
+    size_t buffer_size_;
+    std::vector<uint8_t> storage_;
+};
+
+// Submission entry builders; fixed means fd is a slot of the registered file table
+void PrepareRecvMsgMultishot(io_uring_sqe* sqe, int fd, bool fixed, msghdr* pattern, uint16_t group,
+                             uint64_t user_data);
+// Never waits for socket buffer space: a full buffer completes with -EAGAIN
+void PrepareSendMsg(io_uring_sqe* sqe, int fd, bool fixed, const msghdr* message, uint64_t user_data);
+#ifdef TFTP_HAVE_IO_URING_SEND_ZC
+// Zero-copy sends. Their first completion carries IORING_CQE_F_MORE when a notification
+// follows, sent once the kernel no longer reads the data; the data must stay unchanged until
+// then. buffer_index names the registered buffer holding data, or is -1 for plain memory
+void PrepareSendZeroCopy(io_uring_sqe* sqe, int fd, bool fixed, const uint8_t* data, size_t size,
+                         const sockaddr_in* to, int buffer_index, uint64_t user_data);
+void PrepareSendMsgZeroCopy(io_uring_sqe* sqe, int fd, bool fixed, const msghdr* message, uint64_t user_data);
+#endif
+void PrepareRead(io_uring_sqe* sqe, int fd, bool fixed, uint8_t* buffer, size_t length, uint64_t offset,
+                 uint64_t user_data);
+void PrepareCancel(io_uring_sqe* sqe, uint64_t target_user_data, uint64_t user_data);
+
+// Buffer id of a completion that used a provided buffer; false if it carries none
+bool CompletionBuffer(const io_uring_cqe& cqe, uint16_t& id);
+
+// Locates sender and payload of a multishot recvmsg completion in its buffer (pattern is the
+// msghdr the receive was armed with); false for truncated or malformed datagrams
+bool ParseRecvMsg(const uint8_t* buffer, size_t length, const msghdr& pattern, sockaddr_in& from,
+                  const uint8_t*& payload, size_t& payload_length);
+
+/**
+ * @brief Per-thread ring for batched positioned file reads (FileReadSource::ReadBatch)
+ *
+ * Engine threads switch it on when the kIoUring backend is selected. Sources register their
+ * file in the ring's fixed file table on Open; the table is shared under a lock because a
+ * source may be closed on another thread than the one that opened it.
+ */
+class FileRing {
+public:
+    // Ring of the calling thread, or nullptr when the thread has not enabled one
+    static std::shared_ptr<FileRing> ForThisThread();
+    static void EnableForThisThread(bool enable);
+
+    // Registers fd; returns its slot or -1 when the table is full
+    int AddFile(int fd);
+    void RemoveFile(int slot);
+
+    // Reads all requests in one submission; runs only on the owning thread
+    bool ReadBatch(int fd, int slot, ReadRequest* requests, size_t count);
+    bool IsOwnedByThisThread() const;
+
+private:
+    FileRing() = default;
+    bool Init();
+
+    IoUring ring_;
+    std::mutex files_mutex_;
+    std::vector<int> free_slots_;
+    std::vector<io_uring_cqe> completions_;
+    std::thread::id owner_;
+};
+
+#endif // TFTP_HAVE_IO_URING
+
+} // namespace internal
+} // namespace tftpserver
+
+#endif // TFTP_URING_H_
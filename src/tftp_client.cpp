@@ -1,93 +1,304 @@
 #include "tftp/tftp_server.h"
 #include "tftp/tftp_validation.h"
 #include "tftp/tftp_logger.h"
+#include "tftp/tftp_socket.h"
+#include "internal/tftp_client_session.h"
+#include "internal/tftp_netascii.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#endif
 
 namespace tftpserver {
 
-// TftpClient implementation (currently stubbed with parameter validation)
+namespace {
+
+// Download target of the buffer API: blocks are appended as they arrive
+class BufferWriteSink : public WriteSink {
+public:
+    explicit BufferWriteSink(std::vector<uint8_t>& buffer) : buffer_(buffer) {}
+
+    bool Open(const std::string& path, uint64_t size_hint) override {
+        (void)path;
+        buffer_.clear();
+        if (size_hint > 0 && size_hint <= validation::kMaxTransferSize) {
+            buffer_.reserve(static_cast<size_t>(size_hint));
+        }
+        return true;
+    }
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override {
+        (void)offset;  // Blocks arrive in order, so appending is enough
+        if (buffer_.size() + length > validation::kMaxTransferSize) {
+            return false;
+        }
+        buffer_.insert(buffer_.end(), data, data + length);
+        return true;
+    }
+    bool Commit() override { return true; }
+    void Abort() override { buffer_.clear(); }
+
+private:
+    std::vector<uint8_t>& buffer_;
+};
+
+// Upload source of the buffer API
+class BufferReadSource : public ReadSource {
+public:
+    explicit BufferReadSource(const std::vector<uint8_t>& buffer) : buffer_(buffer) {}
+
+    bool Open(const std::string& path) override {
+        (void)path;
+        return true;
+    }
+    uint64_t Size() const override { return buffer_.size(); }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        bytes_read = 0;
+        if (offset < buffer_.size()) {
+            bytes_read = std::min(length, static_cast<size_t>(buffer_.size() - offset));
+            std::memcpy(buffer, buffer_.data() + offset, bytes_read);
+        }
+        return true;
+    }
+    void Close() override {}
+
+private:
+    const std::vector<uint8_t>& buffer_;
+};
+
+} // namespace
+
+// TftpClient implementation: every transfer is an internal::ClientSession driven by RunClientSessions
 class TftpClient::Impl {
 public:
-    Impl() : timeout_seconds_(kDefaultTimeout), transfer_mode_(TransferMode::kOctet), last_error_("No error") {}
-    
-    bool DownloadFile(const std::string& host, const std::string& filename, 
+    Impl() : max_parallel_(kDefaultClientParallelTransfers), last_error_("No error") {}
+
+    bool DownloadFile(const std::string& host, const std::string& filename,
                       std::vector<uint8_t>& output_buffer, uint16_t port) {
-        // Validate parameters
-        if (!validation::ValidateHost(host)) {
-            last_error_ = "Invalid host: " + host;
+        // Clear output buffer
+        output_buffer.clear();
+        BufferWriteSink sink(output_buffer);
+        return DownloadFile(host, filename, static_cast<WriteSink&>(sink), port);
+    }
+
+    bool DownloadFile(const std::string& host, const std::string& filename, WriteSink& sink, uint16_t port) {
+        sockaddr_in server = {};
+        if (!ValidateRequest(host, filename, port) || !Resolve(host, port, server)) {
             return false;
         }
-        
-        if (!validation::ValidateFilename(filename)) {
-            last_error_ = "Invalid filename: " + filename;
+        // In netascii mode the translation stage sits between the session and the caller's sink
+        internal::NetAsciiWriteSink netascii(sink);
+        internal::ClientSession session(server, filename, options_,
+                                        IsNetAscii() ? static_cast<WriteSink&>(netascii) : sink);
+        return RunOne(session);
+    }
+
+    bool UploadFile(const std::string& host, const std::string& filename,
+                    const std::vector<uint8_t>& data, uint16_t port) {
+        if (!validation::ValidateDataBuffer(data)) {
+            last_error_ = "Invalid data buffer (too large): " + std::to_string(data.size());
             return false;
         }
-        
-        if (!validation::ValidatePort(port)) {
-            last_error_ = "Invalid port: " + std::to_string(port);
+        BufferReadSource source(data);
+        return UploadFile(host, filename, static_cast<ReadSource&>(source), port);
+    }
+
+    bool UploadFile(const std::string& host, const std::string& filename, ReadSource& source, uint16_t port) {
+        sockaddr_in server = {};
+        if (!ValidateRequest(host, filename, port) || !Resolve(host, port, server)) {
             return false;
         }
-        
-        // Clear output buffer
-        output_buffer.clear();
-        
-        // TODO: Implement actual download logic
-        TFTP_ERROR("TftpClient::DownloadFile not yet implemented");
-        last_error_ = "DownloadFile not yet implemented";
-        return false;
+        internal::NetAsciiReadSource netascii(source);
+        internal::ClientSession session(server, filename, options_,
+                                        IsNetAscii() ? static_cast<ReadSource&>(netascii) : source);
+        return RunOne(session);
     }
-    
-    bool UploadFile(const std::string& host, const std::string& filename, 
-                    const std::vector<uint8_t>& data, uint16_t port) {
-        // Validate parameters
+
+    bool RunTransfers(const std::string& host, std::vector<ClientTransfer>& transfers, uint16_t port) {
+        sockaddr_in server = {};
         if (!validation::ValidateHost(host)) {
             last_error_ = "Invalid host: " + host;
             return false;
         }
-        
-        if (!validation::ValidateFilename(filename)) {
-            last_error_ = "Invalid filename: " + filename;
-            return false;
-        }
-        
         if (!validation::ValidatePort(port)) {
             last_error_ = "Invalid port: " + std::to_string(port);
             return false;
         }
-        
-        if (!validation::ValidateDataBuffer(data)) {
-            last_error_ = "Invalid data buffer (too large): " + std::to_string(data.size());
+        if (!Resolve(host, port, server)) {
             return false;
         }
-        
-        // TODO: Implement actual upload logic
-        TFTP_ERROR("TftpClient::UploadFile not yet implemented");
-        last_error_ = "UploadFile not yet implemented";
-        return false;
+
+        // Transfers that fail validation are reported without being started
+        std::vector<std::unique_ptr<WriteSink>> sinks;
+        std::vector<std::unique_ptr<ReadSource>> sources;
+        std::vector<std::unique_ptr<internal::ClientSession>> sessions(transfers.size());
+        std::vector<internal::ClientSession*> runnable;
+        for (size_t i = 0; i < transfers.size(); ++i) {
+            ClientTransfer& transfer = transfers[i];
+            transfer.success = false;
+            transfer.error.clear();
+            transfer.bytes = 0;
+            transfer.elapsed_us = 0;
+            transfer.first_byte_us = 0;
+            if (!validation::ValidateFilename(transfer.filename)) {
+                transfer.error = "Invalid filename: " + transfer.filename;
+                continue;
+            }
+            if (transfer.upload) {
+                ReadSource* source = transfer.source;
+                if (!source) {
+                    sources.push_back(std::make_unique<BufferReadSource>(transfer.data));
+                    source = sources.back().get();
+                }
+                if (IsNetAscii()) {
+                    sources.push_back(std::make_unique<internal::NetAsciiReadSource>(*source));
+                    source = sources.back().get();
+                }
+                sessions[i] = std::make_unique<internal::ClientSession>(server, transfer.filename, options_, *source);
+            } else {
+                WriteSink* sink = transfer.sink;
+                if (!sink) {
+                    sinks.push_back(std::make_unique<BufferWriteSink>(transfer.data));
+                    sink = sinks.back().get();
+                }
+                if (IsNetAscii()) {
+                    sinks.push_back(std::make_unique<internal::NetAsciiWriteSink>(*sink));
+                    sink = sinks.back().get();
+                }
+                sessions[i] = std::make_unique<internal::ClientSession>(server, transfer.filename, options_, *sink);
+            }
+            runnable.push_back(sessions[i].get());
+        }
+
+        internal::RunClientSessions(runnable, max_parallel_);
+
+        bool all_succeeded = true;
+        last_error_ = "No error";
+        for (size_t i = 0; i < transfers.size(); ++i) {
+            ClientTransfer& transfer = transfers[i];
+            if (sessions[i]) {
+                transfer.success = sessions[i]->Succeeded();
+                transfer.error = sessions[i]->GetError();
+                transfer.bytes = sessions[i]->GetBytesTransferred();
+                transfer.elapsed_us = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(sessions[i]->GetElapsed()).count());
+                transfer.first_byte_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    sessions[i]->GetTimeToFirstByte()).count());
+            }
+            if (!transfer.success) {
+                if (all_succeeded) {
+                    last_error_ = transfer.filename + ": " + transfer.error;
+                }
+                all_succeeded = false;
+            }
+        }
+        return all_succeeded;
     }
-    
+
     void SetTimeout(int seconds) {
         if (!validation::ValidateTimeout(seconds)) {
             TFTP_ERROR("SetTimeout: invalid timeout value: %d", seconds);
             throw TftpException("Invalid timeout: " + std::to_string(seconds));
         }
-        timeout_seconds_ = seconds;
+        options_.timeout_secs = seconds;
     }
-    
+
     void SetTransferMode(TransferMode mode) {
         if (!validation::ValidateTransferMode(mode)) {
             TFTP_ERROR("SetTransferMode: invalid transfer mode: %d", static_cast<int>(mode));
             throw TftpException("Invalid transfer mode: " + std::to_string(static_cast<int>(mode)));
         }
-        transfer_mode_ = mode;
+        options_.mode = mode;
+    }
+
+    void SetBlockSize(size_t block_size) {
+        if (block_size < kMinBlockSize || block_size > kMaxBlockSize) {
+            TFTP_ERROR("SetBlockSize: invalid block size: %zu", block_size);
+            throw TftpException("Invalid block size: " + std::to_string(block_size));
+        }
+        options_.block_size = block_size;
     }
-    
+
+    void SetWindowSize(size_t window_size) {
+        if (window_size < kMinWindowSize || window_size > kMaxWindowSize) {
+            TFTP_ERROR("SetWindowSize: invalid window size: %zu", window_size);
+            throw TftpException("Invalid window size: " + std::to_string(window_size));
+        }
+        options_.window_size = window_size;
+    }
+
+    void SetTransferSizeOption(bool enable) {
+        options_.transfer_size = enable;
+    }
+
+    void SetMaxParallelTransfers(size_t count) {
+        if (count == 0) {
+            TFTP_ERROR("SetMaxParallelTransfers: count must be positive");
+            throw TftpException("Invalid parallel transfer count: 0");
+        }
+        max_parallel_ = count;
+    }
+
     std::string GetLastError() const {
         return last_error_;
     }
 
 private:
-    int timeout_seconds_;
-    TransferMode transfer_mode_;
+    bool IsNetAscii() const { return options_.mode == TransferMode::kNetAscii; }
+
+    bool ValidateRequest(const std::string& host, const std::string& filename, uint16_t port) {
+        // Validate parameters
+        if (!validation::ValidateHost(host)) {
+            last_error_ = "Invalid host: " + host;
+            return false;
+        }
+
+        if (!validation::ValidateFilename(filename)) {
+            last_error_ = "Invalid filename: " + filename;
+            return false;
+        }
+
+        if (!validation::ValidatePort(port)) {
+            last_error_ = "Invalid port: " + std::to_string(port);
+            return false;
+        }
+        return true;
+    }
+
+    bool Resolve(const std::string& host, uint16_t port, sockaddr_in& server) {
+        if (!socket_library_.IsInitialized()) {
+            last_error_ = "Socket library initialization failed";
+            return false;
+        }
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+            last_error_ = "Cannot resolve host: " + host;
+            return false;
+        }
+        std::memcpy(&server, result->ai_addr, sizeof(server));
+        freeaddrinfo(result);
+        server.sin_port = htons(port);
+        return true;
+    }
+
+    bool RunOne(internal::ClientSession& session) {
+        internal::RunClientSessions({&session}, 1);
+        last_error_ = session.Succeeded() ? "No error" : session.GetError();
+        return session.Succeeded();
+    }
+
+    net::SocketLibraryGuard socket_library_;
+    internal::ClientOptions options_;
+    size_t max_parallel_;
     std::string last_error_;
 };
 
@@ -95,7 +306,7 @@ TftpClient::TftpClient() : impl_(std::make_unique<Impl>()) {}
 
 TftpClient::~TftpClient() = default;
 
-bool TftpClient::DownloadFile(const std::string& host, const std::string& filename, 
+bool TftpClient::DownloadFile(const std::string& host, const std::string& filename,
                               std::vector<uint8_t>& output_buffer, uint16_t port) {
     if (!impl_) {
         TFTP_ERROR("DownloadFile: client not initialized");
@@ -104,7 +315,16 @@ bool TftpClient::DownloadFile(const std::string& host, const std::string& filena
     return impl_->DownloadFile(host, filename, output_buffer, port);
 }
 
-bool TftpClient::UploadFile(const std::string& host, const std::string& filename, 
+bool TftpClient::DownloadFile(const std::string& host, const std::string& filename,
+                              WriteSink& sink, uint16_t port) {
+    if (!impl_) {
+        TFTP_ERROR("DownloadFile: client not initialized");
+        return false;
+    }
+    return impl_->DownloadFile(host, filename, sink, port);
+}
+
+bool TftpClient::UploadFile(const std::string& host, const std::string& filename,
                             const std::vector<uint8_t>& data, uint16_t port) {
     if (!impl_) {
         TFTP_ERROR("UploadFile: client not initialized");
@@ -113,6 +333,23 @@ bool TftpClient::UploadFile(const std::string& host, const std::string& filename
     return impl_->UploadFile(host, filename, data, port);
 }
 
+bool TftpClient::UploadFile(const std::string& host, const std::string& filename,
+                            ReadSource& source, uint16_t port) {
+    if (!impl_) {
+        TFTP_ERROR("UploadFile: client not initialized");
+        return false;
+    }
+    return impl_->UploadFile(host, filename, source, port);
+}
+
+bool TftpClient::RunTransfers(const std::string& host, std::vector<ClientTransfer>& transfers, uint16_t port) {
+    if (!impl_) {
+        TFTP_ERROR("RunTransfers: client not initialized");
+        return false;
+    }
+    return impl_->RunTransfers(host, transfers, port);
+}
+
 void TftpClient::SetTimeout(int seconds) {
     if (!impl_) {
         TFTP_ERROR("SetTimeout: client not initialized");
@@ -129,6 +366,38 @@ void TftpClient::SetTransferMode(TransferMode mode) {
     impl_->SetTransferMode(mode);
 }
 
+void TftpClient::SetBlockSize(size_t block_size) {
+    if (!impl_) {
+        TFTP_ERROR("SetBlockSize: client not initialized");
+        return;
+    }
+    impl_->SetBlockSize(block_size);
+}
+
+void TftpClient::SetWindowSize(size_t window_size) {
+    if (!impl_) {
+        TFTP_ERROR("SetWindowSize: client not initialized");
+        return;
+    }
+    impl_->SetWindowSize(window_size);
+}
+
+void TftpClient::SetTransferSizeOption(bool enable) {
+    if (!impl_) {
+        TFTP_ERROR("SetTransferSizeOption: client not initialized");
+        return;
+    }
+    impl_->SetTransferSizeOption(enable);
+}
+
+void TftpClient::SetMaxParallelTransfers(size_t count) {
+    if (!impl_) {
+        TFTP_ERROR("SetMaxParallelTransfers: client not initialized");
+        return;
+    }
+    impl_->SetMaxParallelTransfers(count);
+}
+
 std::string TftpClient::GetLastError() const {
     if (!impl_) {
         return "Client not initialized";
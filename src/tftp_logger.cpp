@@ -2,26 +2,300 @@
 #include <windows.h>
 #endif
 
+#include <algorithm>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
 #include <ctime>
 #include <cstdarg>
 #include <cstdio>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "tftp/tftp_logger.h"
 
 
 namespace tftpserver {
 
+namespace {
+
+// How long the writer sleeps when every ring is empty
+constexpr auto kWriterInterval = std::chrono::milliseconds(10);
+constexpr size_t kMaxHexDumpBytes = 256;
+constexpr size_t kHexDumpRowBytes = 16;
+
+int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const char* LevelName(int level) {
+    switch (level) {
+        case kLogTrace: return "TRACE";
+        case kLogDebug: return "DEBUG";
+        case kLogInfo: return "INFO";
+        case kLogWarn: return "WARN";
+        case kLogError: return "ERROR";
+        case kLogCritical: return "CRITICAL";
+        default: return "UNKNOWN";
+    }
+}
+
+// One queued message, copied into the ring so the producer never allocates
+struct LogRecord {
+    int level;
+    int64_t timestamp_us;
+    size_t length;
+    char text[kMaxLogMessageLength];
+};
+
+// Single-producer/single-consumer ring: the owning thread pushes, the writer thread pops
+class LogRing {
+public:
+    explicit LogRing(size_t slots) : records_(std::max<size_t>(slots, 1)), head_(0), tail_(0), closed_(false) {}
+
+    bool Push(int level, int64_t timestamp_us, const char* message, size_t length) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= records_.size()) {
+            return false;
+        }
+        LogRecord& record = records_[head % records_.size()];
+        record.level = level;
+        record.timestamp_us = timestamp_us;
+        record.length = std::min(length, kMaxLogMessageLength);
+        std::memcpy(record.text, message, record.length);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: records [Tail(), Head()) are readable until Release
+    uint64_t Head() const { return head_.load(std::memory_order_acquire); }
+    uint64_t Tail() const { return tail_.load(std::memory_order_relaxed); }
+    const LogRecord& At(uint64_t position) const { return records_[position % records_.size()]; }
+    void Release(uint64_t tail) { tail_.store(tail, std::memory_order_release); }
+
+    // Set when the owning thread exits; the writer discards the ring once it is empty
+    void Close() { closed_.store(true, std::memory_order_release); }
+    bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    std::vector<LogRecord> records_;
+    std::atomic<uint64_t> head_;
+    std::atomic<uint64_t> tail_;
+    std::atomic<bool> closed_;
+};
+
+// Per-thread handle of the ring buffer; closes it when the thread exits
+struct ThreadRing {
+    std::shared_ptr<LogRing> ring;
+
+    ~ThreadRing() {
+        if (ring) {
+            ring->Close();
+        }
+    }
+};
+
+thread_local ThreadRing t_ring;
+
+} // namespace
+
+/**
+ * @brief Background writer of the asynchronous mode
+ */
+class TftpLogger::AsyncWriter {
+public:
+    explicit AsyncWriter(TftpLogger& logger)
+        : logger_(logger),
+          enabled_(false),
+          ring_slots_(kDefaultLogRingSlots),
+          dropped_(0),
+          running_(false),
+          flush_requested_(0),
+          flush_completed_(0),
+          reported_dropped_(0) {}
+
+    ~AsyncWriter() { Stop(); }
+
+    bool Enabled() const { return enabled_.load(std::memory_order_acquire); }
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    void Start(size_t ring_slots) {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        ring_slots_.store(ring_slots, std::memory_order_relaxed);
+        if (running_) {
+            return;
+        }
+        running_ = true;
+        writer_ = std::thread(&AsyncWriter::Run, this);
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            if (!running_) {
+                return;
+            }
+            enabled_.store(false, std::memory_order_release);
+            running_ = false;
+        }
+        wake_cv_.notify_all();
+        writer_.join();
+        // A producer that saw the writer enabled just before Stop may have queued after the
+        // writer's final pass; with the writer gone this thread is the only consumer
+        Drain();
+    }
+
+    void Push(int level, int64_t timestamp_us, const char* message, size_t length) {
+        if (!LocalRing().Push(level, timestamp_us, message, length)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns once everything queued before the call has been written
+    void Flush() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        if (!running_) {
+            return;
+        }
+        uint64_t target = ++flush_requested_;
+        wake_cv_.notify_all();
+        flushed_cv_.wait(lock, [&] { return flush_completed_ >= target || !running_; });
+    }
+
+private:
+    struct Pending {
+        int64_t timestamp_us;
+        size_t ring;
+        uint64_t position;
+    };
+
+    LogRing& LocalRing() {
+        if (!t_ring.ring) {
+            t_ring.ring = std::make_shared<LogRing>(ring_slots_.load(std::memory_order_relaxed));
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.push_back(t_ring.ring);
+        }
+        return *t_ring.ring;
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        while (true) {
+            uint64_t target = flush_requested_;
+            bool stopping = !running_;
+            lock.unlock();
+            Drain();
+            lock.lock();
+            flush_completed_ = target;
+            flushed_cv_.notify_all();
+            if (stopping) {
+                break;
+            }
+            wake_cv_.wait_for(lock, kWriterInterval,
+                              [&] { return !running_ || flush_requested_ != flush_completed_; });
+        }
+    }
+
+    // Writes every queued record, merged across threads by timestamp, with one output call
+    void Drain() {
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            snapshot_ = rings_;
+        }
+
+        pending_.clear();
+        heads_.resize(snapshot_.size());
+        for (size_t i = 0; i < snapshot_.size(); ++i) {
+            heads_[i] = snapshot_[i]->Head();
+            for (uint64_t position = snapshot_[i]->Tail(); position < heads_[i]; ++position) {
+                pending_.push_back({snapshot_[i]->At(position).timestamp_us, i, position});
+            }
+        }
+        std::sort(pending_.begin(), pending_.end(), [](const Pending& a, const Pending& b) {
+            if (a.timestamp_us != b.timestamp_us) {
+                return a.timestamp_us < b.timestamp_us;
+            }
+            return a.ring != b.ring ? a.ring < b.ring : a.position < b.position;
+        });
+
+        uint64_t dropped = Dropped();
+        if (!pending_.empty() || dropped != reported_dropped_) {
+            std::lock_guard<std::mutex> lock(logger_.mutex_);
+            batch_.clear();
+            for (const Pending& entry : pending_) {
+                const LogRecord& record = snapshot_[entry.ring]->At(entry.position);
+                logger_.WriteLine(record.level, record.timestamp_us, record.text, record.length, batch_);
+            }
+            if (dropped != reported_dropped_) {
+                char message[96];
+                int length = snprintf(message, sizeof(message), "%llu log messages dropped (ring buffer full)",
+                                      static_cast<unsigned long long>(dropped - reported_dropped_));
+                logger_.WriteLine(kLogWarn, NowMicros(), message, static_cast<size_t>(length), batch_);
+                reported_dropped_ = dropped;
+            }
+            logger_.WriteOutput(batch_);
+        }
+
+        bool has_closed = false;
+        for (size_t i = 0; i < snapshot_.size(); ++i) {
+            snapshot_[i]->Release(heads_[i]);
+            has_closed = has_closed || snapshot_[i]->IsClosed();
+        }
+        snapshot_.clear();
+
+        // Rings of exited threads are dropped once nothing is left in them
+        if (has_closed) {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                        [](const std::shared_ptr<LogRing>& ring) {
+                                            return ring->IsClosed() && ring->Tail() == ring->Head();
+                                        }),
+                         rings_.end());
+        }
+    }
+
+    TftpLogger& logger_;
+    std::atomic<bool> enabled_;
+    std::atomic<size_t> ring_slots_;
+    std::atomic<uint64_t> dropped_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable flushed_cv_;
+    bool running_;
+    uint64_t flush_requested_;
+    uint64_t flush_completed_;
+    std::thread writer_;
+
+    // Writer thread state, reused between passes
+    std::vector<std::shared_ptr<LogRing>> snapshot_;
+    std::vector<uint64_t> heads_;
+    std::vector<Pending> pending_;
+    std::string batch_;
+    uint64_t reported_dropped_;
+};
+
 TftpLogger& TftpLogger::GetInstance() {
     static TftpLogger instance;
     return instance;
 }
 
+TftpLogger::TftpLogger()
+    : log_level_(TFTP_LOG_LEVEL),
+      async_(std::make_unique<AsyncWriter>(*this)),
+      cached_second_(-1),
+      cached_time_() {
+}
+
 TftpLogger::~TftpLogger() {
+    async_->Stop();
     if (log_file_.is_open()) {
         log_file_.close();
     }
@@ -32,61 +306,115 @@ void TftpLogger::SetLogFile(const std::string& filename) {
     if (log_file_.is_open()) {
         log_file_.close();
     }
-    log_file_.open(filename, std::ios::app);
+    // An empty name (or a file that cannot be opened) sends output back to stderr
+    if (!filename.empty()) {
+        log_file_.open(filename, std::ios::app);
+    }
 }
 
 void TftpLogger::SetLogLevel(int level) {
+    log_level_.store(level, std::memory_order_relaxed);
+}
+
+void TftpLogger::SetAsync(bool enable, size_t ring_slots) {
+    if (enable) {
+        async_->Start(ring_slots);
+    } else {
+        async_->Stop();
+    }
+}
+
+bool TftpLogger::IsAsync() const {
+    return async_->Enabled();
+}
+
+void TftpLogger::Flush() {
+    async_->Flush();
     std::lock_guard<std::mutex> lock(mutex_);
-    log_level_ = level;
+    if (log_file_.is_open()) {
+        log_file_.flush();
+    }
+}
+
+uint64_t TftpLogger::GetDroppedCount() const {
+    return async_->Dropped();
 }
 
 void TftpLogger::Log(int level, const std::string& message) {
-    if (level < log_level_) return;
+    Log(level, message.data(), message.size());
+}
+
+void TftpLogger::Log(int level, const char* message, size_t length) {
+    if (!ShouldLog(level)) return;
+
+    int64_t timestamp_us = NowMicros();
+    if (async_->Enabled()) {
+        async_->Push(level, timestamp_us, message, length);
+        return;
+    }
 
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Get current time
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-
-    // Log level as string
-    std::string level_str;
-    switch (level) {
-        case kLogTrace: level_str = "TRACE"; break;
-        case kLogDebug: level_str = "DEBUG"; break;
-        case kLogInfo: level_str = "INFO"; break;
-        case kLogWarn: level_str = "WARN"; break;
-        case kLogError: level_str = "ERROR"; break;
-        case kLogCritical: level_str = "CRITICAL"; break;
-        default: level_str = "UNKNOWN"; break;
-    }
-
-    // Format log message
-    std::stringstream ss;
-    
-    // Use localtime_s for thread safety on Windows
-    std::tm time_info;
+    line_.clear();
+    WriteLine(level, timestamp_us, message, length, line_);
+    WriteOutput(line_);
+}
+
+void TftpLogger::LogHexDump(int level, const char* label, const uint8_t* data, size_t size) {
+    if (!ShouldLog(level)) return;
+
+    static const char kDigits[] = "0123456789abcdef";
+    char buffer[kMaxLogMessageLength + 1];
+    int prefix = snprintf(buffer, sizeof(buffer), "%s (%zu bytes):", label, size);
+    size_t length = std::min(static_cast<size_t>(std::max(prefix, 0)), kMaxLogMessageLength);
+
+    // Short dumps stay on one line, longer ones get one row per kHexDumpRowBytes
+    const size_t shown = std::min(size, kMaxHexDumpBytes);
+    for (size_t i = 0; i < shown && length + 3 <= kMaxLogMessageLength; ++i) {
+        buffer[length++] = (size > kHexDumpRowBytes && i % kHexDumpRowBytes == 0) ? '\n' : ' ';
+        buffer[length++] = kDigits[data[i] >> 4];
+        buffer[length++] = kDigits[data[i] & 0x0F];
+    }
+    if (shown < size && length + 4 <= kMaxLogMessageLength) {
+        std::memcpy(buffer + length, " ...", 4);
+        length += 4;
+    }
+    Log(level, buffer, length);
+}
+
+void TftpLogger::WriteLine(int level, int64_t timestamp_us, const char* message, size_t length,
+                           std::string& out) {
+    // localtime is only consulted when the second changes
+    int64_t second = timestamp_us / 1000000;
+    if (second != cached_second_) {
+        std::time_t time = static_cast<std::time_t>(second);
+        std::tm time_info;
 #ifdef _WIN32
-    localtime_s(&time_info, &time);
+        // Use localtime_s for thread safety on Windows
+        localtime_s(&time_info, &time);
 #else
-    // On POSIX systems
-    time_info = *std::localtime(&time);
+        localtime_r(&time, &time_info);
 #endif
-    
-    ss << std::put_time(&time_info, "%Y-%m-%d %H:%M:%S")
-       << '.' << std::setfill('0') << std::setw(3) << ms.count()
-       << " [" << level_str << "] " << message << std::endl;
+        std::strftime(cached_time_, sizeof(cached_time_), "%Y-%m-%d %H:%M:%S", &time_info);
+        cached_second_ = second;
+    }
+
+    char prefix[64];
+    int prefix_length = snprintf(prefix, sizeof(prefix), "%s.%03d [%s] ", cached_time_,
+                                 static_cast<int>((timestamp_us / 1000) % 1000), LevelName(level));
+    out.append(prefix, static_cast<size_t>(std::max(prefix_length, 0)));
+    out.append(message, length);
+    out.push_back('\n');
+}
 
-    // Output the log
+void TftpLogger::WriteOutput(const std::string& text) {
     if (log_file_.is_open()) {
-        log_file_ << ss.str();
+        log_file_.write(text.data(), static_cast<std::streamsize>(text.size()));
         log_file_.flush();
     } else {
-        std::cerr << ss.str();
+        std::cerr.write(text.data(), static_cast<std::streamsize>(text.size()));
     }
 }
+
 #ifdef _WIN32
 void OutputDebugLog(const char* level, const char* format, ...) {
     char buf[1024];
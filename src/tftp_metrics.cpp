@@ -0,0 +1,131 @@
+/**
+ * @file tftp_metrics.cpp
+ * @brief Server-wide transfer counters and latency histograms
+ */
+
+#include "tftp/tftp_metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace tftpserver {
+
+namespace {
+
+const char* const kErrorCodeLabels[kErrorCodeCount] = {
+    "not_defined", "file_not_found", "access_violation", "disk_full",
+    "illegal_operation", "unknown_transfer_id", "file_exists", "no_such_user"
+};
+
+const double kExportedQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+void AppendHeader(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void AppendMetric(std::string& out, const char* name, const char* type, const char* help, uint64_t value) {
+    AppendHeader(out, name, type, help);
+    out += name;
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+std::string Seconds(uint64_t microseconds) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.6f", static_cast<double>(microseconds) / 1e6);
+    return buffer;
+}
+
+void AppendSummary(std::string& out, const char* name, const char* help, const HistogramStats& histogram) {
+    AppendHeader(out, name, "summary", help);
+    for (double quantile : kExportedQuantiles) {
+        char label[32];
+        snprintf(label, sizeof(label), "{quantile=\"%g\"} ", quantile);
+        out += name;
+        out += label;
+        out += Seconds(histogram.Percentile(quantile * 100.0));
+        out += '\n';
+    }
+    out += name;
+    out += "_sum " + Seconds(histogram.sum_us) + '\n';
+    out += name;
+    out += "_count " + std::to_string(histogram.count) + '\n';
+}
+
+} // namespace
+
+uint64_t HistogramStats::Percentile(double percentile) const {
+    if (count == 0 || buckets.empty()) {
+        return 0;
+    }
+    percentile = std::min(100.0, std::max(0.0, percentile));
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count)));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (const auto& bucket : buckets) {
+        seen += bucket.second;
+        if (seen >= rank) {
+            return std::max(min_us, std::min(bucket.first, max_us));
+        }
+    }
+    return max_us;
+}
+
+std::string FormatPrometheusMetrics(const ServerStats& stats) {
+    std::string out;
+    out.reserve(4096);
+
+    AppendMetric(out, "tftp_bytes_sent_total", "counter", "DATA payload bytes sent.", stats.bytes_sent);
+    AppendMetric(out, "tftp_bytes_received_total", "counter", "DATA payload bytes received.", stats.bytes_received);
+    AppendMetric(out, "tftp_packets_sent_total", "counter", "Datagrams sent by transfers.", stats.packets_sent);
+    AppendMetric(out, "tftp_packets_received_total", "counter", "Valid datagrams received from transfer peers.",
+                 stats.packets_received);
+    AppendMetric(out, "tftp_retransmits_total", "counter", "Packets sent again after a timeout.", stats.retransmits);
+    AppendMetric(out, "tftp_timeouts_total", "counter", "Retransmission timer expirations.", stats.timeouts);
+
+    AppendHeader(out, "tftp_errors_total", "counter", "ERROR packets sent, by error code.");
+    for (size_t i = 0; i < kErrorCodeCount; ++i) {
+        out += "tftp_errors_total{code=\"";
+        out += kErrorCodeLabels[i];
+        out += "\"} " + std::to_string(stats.errors[i]) + '\n';
+    }
+
+    AppendMetric(out, "tftp_transfers_started_total", "counter", "Accepted read and write requests.",
+                 stats.transfers_started);
+    AppendMetric(out, "tftp_transfers_completed_total", "counter", "Transfers that finished successfully.",
+                 stats.transfers_completed);
+    AppendMetric(out, "tftp_transfers_failed_total", "counter", "Transfers that ended without success.",
+                 stats.transfers_failed);
+    AppendMetric(out, "tftp_active_sessions", "gauge", "Transfers in flight.", stats.active_sessions);
+    AppendMetric(out, "tftp_pool_active_tasks", "gauge", "Thread-pool workers busy with a transfer.",
+                 stats.pool_active_tasks);
+    AppendMetric(out, "tftp_pool_queued_tasks", "gauge", "Requests waiting for a thread-pool worker.",
+                 stats.pool_queued_tasks);
+    AppendMetric(out, "tftp_buffer_pool_allocations_total", "counter",
+                 "Block buffers and session objects handed out.", stats.buffer_pool.allocations);
+    AppendMetric(out, "tftp_buffer_pool_reused_total", "counter", "Allocations served from a free list.",
+                 stats.buffer_pool.reused);
+    AppendMetric(out, "tftp_buffer_pool_discarded_total", "counter", "Blocks returned to the heap.",
+                 stats.buffer_pool.discarded);
+    AppendMetric(out, "tftp_buffer_pool_cached_bytes", "gauge", "Bytes held by the free lists.",
+                 stats.buffer_pool.cached_bytes);
+
+    AppendSummary(out, "tftp_time_to_first_byte_seconds", "Request accepted until the first DATA block.",
+                  stats.time_to_first_byte);
+    AppendSummary(out, "tftp_ack_rtt_seconds", "Transfer packet sent until the peer answers it.", stats.ack_rtt);
+    AppendSummary(out, "tftp_transfer_duration_seconds", "Request accepted until the transfer ended.",
+                  stats.transfer_duration);
+    return out;
+}
+
+} // namespace tftpserver
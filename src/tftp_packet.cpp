@@ -24,26 +24,26 @@ namespace {
     // Read null-terminated string with comprehensive bounds checking
     // Returns empty string on failure, non-empty string on success
     // Updates offset parameter to indicate parsing success/failure position
-    std::string read_string_validated(const std::vector<uint8_t>& data, size_t& offset, size_t max_length = kMaxStringLength) {
+    std::string read_string_validated(const uint8_t* data, size_t size, size_t& offset, size_t max_length = kMaxStringLength) {
         std::string result;
         size_t start_offset = offset;
         
         // Validate offset is within bounds
-        if (offset >= data.size()) {
-            TFTP_ERROR("read_string: offset %zu exceeds data size %zu", offset, data.size());
+        if (offset >= size) {
+            TFTP_ERROR("read_string: offset %zu exceeds data size %zu", offset, size);
             offset = SIZE_MAX;  // Signal failure with invalid offset
             return std::string();
         }
         
         // Read characters with multiple safety checks
         size_t chars_read = 0;
-        while (offset < data.size() && data[offset] != 0 && chars_read < max_length) {
+        while (offset < size && data[offset] != 0 && chars_read < max_length) {
             result += static_cast<char>(data[offset++]);
             chars_read++;
         }
         
         // Validate string termination
-        if (offset >= data.size()) {
+        if (offset >= size) {
             TFTP_ERROR("read_string: reached end of data without null terminator at offset %zu", offset);
             offset = SIZE_MAX;  // Signal failure
             return std::string();
@@ -54,7 +54,7 @@ namespace {
         if (chars_read >= max_length) {
             // If we read the maximum length, check if there are more non-null characters
             // This indicates the string exceeds the maximum allowed length
-            if (offset < data.size() && data[offset] != 0) {
+            if (offset < size && data[offset] != 0) {
                 TFTP_ERROR("read_string: string exceeds maximum length %zu at offset %zu", max_length, start_offset);
                 TFTP_INFO("read_string_validated: SETTING OFFSET TO SIZE_MAX AND RETURNING");
                 offset = SIZE_MAX;  // Signal failure
@@ -63,7 +63,7 @@ namespace {
         }
         
         // Skip null terminator safely
-        if (offset < data.size() && data[offset] == 0) {
+        if (offset < size && data[offset] == 0) {
             ++offset;
         }
         
@@ -77,7 +77,7 @@ namespace {
     // Legacy wrapper that maintains old behavior for backwards compatibility
     std::string read_string(const std::vector<uint8_t>& data, size_t& offset, size_t max_length = kMaxStringLength) {
         size_t saved_offset = offset;
-        std::string result = read_string_validated(data, offset, max_length);
+        std::string result = read_string_validated(data.data(), data.size(), offset, max_length);
         if (offset == SIZE_MAX) {
             // Restore offset on failure for legacy compatibility
             offset = saved_offset;
@@ -100,6 +100,13 @@ namespace {
         }
     }
 
+    // RFC 2090 requests multicast with an empty value; every other option needs one
+    bool allows_empty_value(const std::string& option_name) {
+        return option_name.size() == sizeof(kMulticastOptionName) - 1 &&
+               std::equal(option_name.begin(), option_name.end(), kMulticastOptionName,
+                          [](unsigned char a, char b) { return std::tolower(a) == b; });
+    }
+
     // Convert string to TransferMode
     TransferMode string_to_mode(const std::string& mode_str) {
         std::string lower_mode;
@@ -137,7 +144,7 @@ TftpPacket TftpPacket::CreateWriteRequest(const std::string& filename, TransferM
 }
 
 TftpPacket TftpPacket::CreateData(uint16_t block_number, const std::vector<uint8_t>& data) {
-    if (data.size() > kMaxDataSize) {
+    if (data.size() > kMaxBlockSize) {
         throw TftpException("Data size exceeds maximum allowed size");
     }
     
@@ -149,7 +156,7 @@ TftpPacket TftpPacket::CreateData(uint16_t block_number, const std::vector<uint8
 }
 
 TftpPacket TftpPacket::CreateData(uint16_t block_number, std::vector<uint8_t>&& data) {
-    if (data.size() > kMaxDataSize) {
+    if (data.size() > kMaxBlockSize) {
         throw TftpException("Data size exceeds maximum allowed size");
     }
     
@@ -338,42 +345,44 @@ std::vector<uint8_t> TftpPacket::Serialize() const {
 // NOTE: TFTP uses network byte order (big-endian) for all multi-byte values
 // We use ntohs() to convert from network byte order to host byte order
 bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
+    return Deserialize(data.data(), data.size(), kMaxDataSize);
+}
+
+bool TftpPacket::Deserialize(const uint8_t* data, size_t size, size_t max_data_size) {
     // Reset state first to ensure clean state on failure
     ResetState();
     
     // Comprehensive input validation
-    if (data.empty()) {
+    if (data == nullptr || size == 0) {
         TFTP_ERROR("Empty packet data");
         return false;
     }
     
-    if (data.size() < kMinPacketSize || data.size() > kMaxPacketSize) {
-        TFTP_ERROR("Invalid packet size %zu (min=%zu, max=%zu)", data.size(), kMinPacketSize, kMaxPacketSize);
+    if (max_data_size < kMinBlockSize || max_data_size > kMaxBlockSize) {
+        TFTP_ERROR("Invalid maximum data size %zu (min=%zu, max=%zu)", max_data_size, kMinBlockSize, kMaxBlockSize);
         return false;
     }
     
-    if (data.size() < sizeof(uint16_t)) {
-        TFTP_ERROR("Packet too small for opcode: size=%zu", data.size());
+    // Non-DATA packets keep the RFC 1350 limit even when a smaller blksize was negotiated
+    const size_t max_packet_size = std::max(kMaxPacketSize, max_data_size + 4);
+    if (size < kMinPacketSize || size > max_packet_size) {
+        TFTP_ERROR("Invalid packet size %zu (min=%zu, max=%zu)", size, kMinPacketSize, max_packet_size);
         return false;
     }
     
-    // Detailed hex dump of the entire packet
-    TFTP_INFO("Full packet analysis: size=%zu bytes", data.size());
-    std::string hex_dump;
-    for (size_t i = 0; i < data.size(); ++i) {
-        char buf[4];
-        snprintf(buf, sizeof(buf), "%02X ", data[i]);
-        hex_dump += buf;
-        if ((i + 1) % 16 == 0) {
-            hex_dump += "\n";
-        }
+    if (size < sizeof(uint16_t)) {
+        TFTP_ERROR("Packet too small for opcode: size=%zu", size);
+        return false;
     }
-    TFTP_INFO("Complete hex dump:\n%s", hex_dump.c_str());
+    
+    // Detailed hex dump of the entire packet (only formatted when INFO is enabled)
+    TFTP_INFO("Full packet analysis: size=%zu bytes", size);
+    TFTP_LOG_HEX(kLogInfo, "Complete hex dump", data, size);
     
     // opcode (convert from network byte order to host byte order) - with bounds checking
     uint16_t opcode_network;
-    if (data.size() < sizeof(uint16_t)) {
-        TFTP_ERROR("Insufficient data for opcode: size=%zu", data.size());
+    if (size < sizeof(uint16_t)) {
+        TFTP_ERROR("Insufficient data for opcode: size=%zu", size);
         return false;
     }
     std::memcpy(&opcode_network, &data[0], sizeof(uint16_t));
@@ -392,7 +401,7 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
         case OpCode::kReadRequest:
         case OpCode::kWriteRequest: {
             // Parse into temporary variables first to ensure atomic success/failure
-            std::string temp_filename = read_string_validated(data, offset, kMaxFilenameLength);
+            std::string temp_filename = read_string_validated(data, size, offset, kMaxFilenameLength);
             if (offset == SIZE_MAX) {
                 TFTP_ERROR("Failed to parse filename (invalid or oversized)");
                 return false;
@@ -404,12 +413,12 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
             TFTP_INFO("Parsed filename: %s", temp_filename.c_str());
             
             // mode with bounds checking
-            if (offset >= data.size()) {
+            if (offset >= size) {
                 TFTP_ERROR("Packet too small for mode");
                 return false;
             }
             
-            std::string mode_str = read_string_validated(data, offset, kMaxStringLength);
+            std::string mode_str = read_string_validated(data, size, offset, kMaxStringLength);
             if (offset == SIZE_MAX) {
                 TFTP_ERROR("Failed to parse mode string (invalid or oversized)");
                 return false;
@@ -431,14 +440,14 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
             // options (if present) with comprehensive validation
             std::unordered_map<std::string, std::string> temp_options;
             size_t options_count = 0;
-            TFTP_INFO("Checking for options, remaining bytes: %zu", data.size() - offset);
-            TFTP_INFO("Loop conditions: offset=%zu < data.size()=%zu? %s, options_count=%zu < kMaxOptionsCount=%zu? %s", 
-                     offset, data.size(), (offset < data.size()) ? "true" : "false",
+            TFTP_INFO("Checking for options, remaining bytes: %zu", size - offset);
+            TFTP_INFO("Loop conditions: offset=%zu < size=%zu? %s, options_count=%zu < kMaxOptionsCount=%zu? %s", 
+                     offset, size, (offset < size) ? "true" : "false",
                      options_count, kMaxOptionsCount, (options_count < kMaxOptionsCount) ? "true" : "false");
             
-            while (offset < data.size() && options_count < kMaxOptionsCount) {
+            while (offset < size && options_count < kMaxOptionsCount) {
                 TFTP_INFO("Entering option parsing loop iteration %zu", options_count);
-                std::string option_name = read_string_validated(data, offset, kMaxOptionNameLength);
+                std::string option_name = read_string_validated(data, size, offset, kMaxOptionNameLength);
                 
                 // Check for parsing failure (indicated by offset being set to SIZE_MAX)
                 TFTP_INFO("After read_string_validated: offset=%zu, SIZE_MAX=%zu", offset, SIZE_MAX);
@@ -453,12 +462,12 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
                     break;
                 }
                 
-                if (offset >= data.size()) {
+                if (offset >= size) {
                     TFTP_ERROR("Missing option value for option: %s", option_name.c_str());
                     return false;
                 }
                 
-                std::string option_value = read_string_validated(data, offset, kMaxOptionValueLength);
+                std::string option_value = read_string_validated(data, size, offset, kMaxOptionValueLength);
                 
                 // Check for parsing failure (indicated by offset being set to SIZE_MAX)
                 if (offset == SIZE_MAX) {
@@ -466,7 +475,7 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
                     return false;
                 }
                 
-                if (option_value.empty()) {
+                if (option_value.empty() && !allows_empty_value(option_name)) {
                     TFTP_ERROR("Empty option value not allowed for option: %s", option_name.c_str());
                     return false;
                 }
@@ -476,7 +485,7 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
                 TFTP_INFO("TFTP option: %s = %s", option_name.c_str(), option_value.c_str());
             }
             
-            if (options_count >= kMaxOptionsCount && offset < data.size()) {
+            if (options_count >= kMaxOptionsCount && offset < size) {
                 TFTP_ERROR("Too many options in packet (max=%zu)", kMaxOptionsCount);
                 return false;
             }
@@ -491,41 +500,41 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
             break;
         }
         case OpCode::kData: {
-            if (data.size() < 4) {
-                TFTP_ERROR("DATA packet too small: size=%zu", data.size());
+            if (size < 4) {
+                TFTP_ERROR("DATA packet too small: size=%zu", size);
                 return false;
             }
             
             // block number (convert from network byte order to host byte order) with bounds checking
             uint16_t block_number_network;
-            if (data.size() < 4) {
-                TFTP_ERROR("Insufficient data for DATA block number: size=%zu", data.size());
+            if (size < 4) {
+                TFTP_ERROR("Insufficient data for DATA block number: size=%zu", size);
                 return false;
             }
             std::memcpy(&block_number_network, &data[2], sizeof(uint16_t));
             block_number_ = ntohs(block_number_network);
             
             // data with size validation
-            size_t data_size = data.size() - 4;
-            if (data_size > kMaxDataSize) {
-                TFTP_ERROR("DATA payload too large: %zu bytes (max=%zu)", data_size, kMaxDataSize);
+            size_t data_size = size - 4;
+            if (data_size > max_data_size) {
+                TFTP_ERROR("DATA payload too large: %zu bytes (max=%zu)", data_size, max_data_size);
                 return false;
             }
-            data_.assign(data.begin() + 4, data.end());
+            data_.assign(data + 4, data + size);
             
             TFTP_INFO("DATA packet: block=%u, data_size=%zu", block_number_, data_.size());
             break;
         }
         case OpCode::kAcknowledge: {
-            if (data.size() != 4) {
-                TFTP_ERROR("ACK packet has incorrect size: %zu (expected: 4)", data.size());
+            if (size != 4) {
+                TFTP_ERROR("ACK packet has incorrect size: %zu (expected: 4)", size);
                 return false;
             }
             
             // block number (convert from network byte order to host byte order) with bounds checking
             uint16_t block_number_network;
-            if (data.size() < 4) {
-                TFTP_ERROR("Insufficient data for ACK block number: size=%zu", data.size());
+            if (size < 4) {
+                TFTP_ERROR("Insufficient data for ACK block number: size=%zu", size);
                 return false;
             }
             std::memcpy(&block_number_network, &data[2], sizeof(uint16_t));
@@ -535,15 +544,15 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
             break;
         }
         case OpCode::kError: {
-            if (data.size() < 5) {
-                TFTP_ERROR("ERROR packet too small: size=%zu", data.size());
+            if (size < 5) {
+                TFTP_ERROR("ERROR packet too small: size=%zu", size);
                 return false;
             }
             
             // error code (convert from network byte order to host byte order) with bounds checking
             uint16_t error_code_network;
-            if (data.size() < 4) {
-                TFTP_ERROR("Insufficient data for ERROR code: size=%zu", data.size());
+            if (size < 4) {
+                TFTP_ERROR("Insufficient data for ERROR code: size=%zu", size);
                 return false;
             }
             std::memcpy(&error_code_network, &data[2], sizeof(uint16_t));
@@ -557,7 +566,7 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
             
             // error message with length validation (parse to temporary first)
             offset = 4;  // Error message starts after opcode (2 bytes) + error code (2 bytes)
-            std::string temp_error_message = read_string_validated(data, offset, kMaxErrorMessageLength);
+            std::string temp_error_message = read_string_validated(data, size, offset, kMaxErrorMessageLength);
             if (offset == SIZE_MAX) {
                 TFTP_ERROR("Failed to parse error message (invalid or oversized)");
                 return false;
@@ -578,10 +587,10 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
             // OACK packet: opcode + (option + 0 + value + 0)* with comprehensive validation
             std::unordered_map<std::string, std::string> temp_oack_options;
             size_t options_count = 0;
-            TFTP_INFO("Parsing OACK packet, remaining bytes: %zu", data.size() - offset);
+            TFTP_INFO("Parsing OACK packet, remaining bytes: %zu", size - offset);
             
-            while (offset < data.size() && options_count < kMaxOptionsCount) {
-                std::string option_name = read_string_validated(data, offset, kMaxOptionNameLength);
+            while (offset < size && options_count < kMaxOptionsCount) {
+                std::string option_name = read_string_validated(data, size, offset, kMaxOptionNameLength);
                 if (offset == SIZE_MAX) {
                     TFTP_ERROR("Failed to parse OACK option name (invalid or oversized)");
                     return false;
@@ -591,12 +600,12 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
                     break;
                 }
                 
-                if (offset >= data.size()) {
+                if (offset >= size) {
                     TFTP_ERROR("Missing option value for OACK option: %s", option_name.c_str());
                     return false;
                 }
                 
-                std::string option_value = read_string_validated(data, offset, kMaxOptionValueLength);
+                std::string option_value = read_string_validated(data, size, offset, kMaxOptionValueLength);
                 if (offset == SIZE_MAX) {
                     TFTP_ERROR("Failed to parse OACK option value for option: %s (invalid or oversized)", option_name.c_str());
                     return false;
@@ -611,7 +620,7 @@ bool TftpPacket::Deserialize(const std::vector<uint8_t>& data) {
                 TFTP_INFO("OACK option: %s = %s", option_name.c_str(), option_value.c_str());
             }
             
-            if (options_count >= kMaxOptionsCount && offset < data.size()) {
+            if (options_count >= kMaxOptionsCount && offset < size) {
                 TFTP_ERROR("Too many options in OACK packet (max=%zu)", kMaxOptionsCount);
                 return false;
             }
@@ -0,0 +1,283 @@
+/**
+ * @file tftp_packet_view.cpp
+ * @brief Allocation-free TFTP packet codec working on caller-provided buffers
+ */
+
+#include "tftp/tftp_packet_view.h"
+#include "tftp/tftp_logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <vector>
+
+namespace tftpserver {
+
+namespace {
+
+uint16_t ReadUint16(const uint8_t* data) {
+    return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+void WriteUint16(uint8_t* data, uint16_t value) {
+    data[0] = static_cast<uint8_t>(value >> 8);
+    data[1] = static_cast<uint8_t>(value & 0xFF);
+}
+
+// Reads a NUL-terminated string of at most max_length characters starting at offset;
+// on success offset is moved past the terminator
+bool ReadString(const uint8_t* data, size_t size, size_t& offset, size_t max_length, std::string_view& out) {
+    if (offset >= size) {
+        return false;
+    }
+    const uint8_t* start = data + offset;
+    size_t limit = std::min(size - offset, max_length + 1);
+    const void* terminator = std::memchr(start, 0, limit);
+    if (terminator == nullptr) {
+        return false;
+    }
+    size_t length = static_cast<size_t>(static_cast<const uint8_t*>(terminator) - start);
+    out = std::string_view(reinterpret_cast<const char*>(start), length);
+    offset += length + 1;
+    return true;
+}
+
+// RFC 2090 requests multicast with an empty value; every other option needs one
+bool AllowsEmptyValue(std::string_view name) {
+    return name.size() == sizeof(kMulticastOptionName) - 1 &&
+           std::equal(name.begin(), name.end(), kMulticastOptionName,
+                      [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+}
+
+bool EqualsIgnoreCase(std::string_view value, std::string_view lower) {
+    if (value.size() != lower.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < value.size(); ++i) {
+        char c = value[i];
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != lower[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseMode(std::string_view mode, TransferMode& result) {
+    if (EqualsIgnoreCase(mode, "netascii")) {
+        result = TransferMode::kNetAscii;
+    } else if (EqualsIgnoreCase(mode, "octet")) {
+        result = TransferMode::kOctet;
+    } else if (EqualsIgnoreCase(mode, "mail")) {
+        result = TransferMode::kMail;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void PacketView::Reset() {
+    op_code_ = OpCode::kReadRequest;
+    block_number_ = 0;
+    error_code_ = ErrorCode::kNotDefined;
+    payload_ = nullptr;
+    payload_size_ = 0;
+    filename_ = std::string_view();
+    mode_ = TransferMode::kOctet;
+    error_message_ = std::string_view();
+    option_count_ = 0;
+}
+
+bool PacketView::Parse(const uint8_t* data, size_t size, size_t max_data_size) {
+    Reset();
+
+    if (data == nullptr || size == 0) {
+        TFTP_ERROR("Empty packet data");
+        return false;
+    }
+    if (max_data_size < kMinBlockSize || max_data_size > kMaxBlockSize) {
+        TFTP_ERROR("Invalid maximum data size %zu (min=%zu, max=%zu)", max_data_size, kMinBlockSize, kMaxBlockSize);
+        return false;
+    }
+
+    // Non-DATA packets keep the RFC 1350 limit even when a smaller blksize was negotiated
+    const size_t max_packet_size = std::max(kMaxPacketSize, max_data_size + codec::kHeaderSize);
+    if (size < kMinPacketSize || size > max_packet_size) {
+        TFTP_ERROR("Invalid packet size %zu (min=%zu, max=%zu)", size, kMinPacketSize, max_packet_size);
+        return false;
+    }
+
+    uint16_t opcode_value = ReadUint16(data);
+    if (opcode_value < 1 || opcode_value > 6) {
+        TFTP_ERROR("Invalid opcode value: %u", opcode_value);
+        return false;
+    }
+    OpCode op_code = static_cast<OpCode>(opcode_value);
+
+    switch (op_code) {
+        case OpCode::kReadRequest:
+        case OpCode::kWriteRequest: {
+            size_t offset = 2;
+            std::string_view filename;
+            if (!ReadString(data, size, offset, kMaxFilenameLength, filename) || filename.empty()) {
+                TFTP_ERROR("Invalid filename in request");
+                return false;
+            }
+            std::string_view mode;
+            if (!ReadString(data, size, offset, kMaxStringLength, mode) || mode.empty()) {
+                TFTP_ERROR("Invalid mode string in request");
+                return false;
+            }
+            TransferMode transfer_mode;
+            if (!ParseMode(mode, transfer_mode)) {
+                TFTP_ERROR("Invalid mode: %.*s", static_cast<int>(mode.size()), mode.data());
+                return false;
+            }
+            if (!ParseOptions(data, size, offset)) {
+                return false;
+            }
+            filename_ = filename;
+            mode_ = transfer_mode;
+            break;
+        }
+        case OpCode::kData: {
+            size_t payload_size = size - codec::kHeaderSize;
+            if (payload_size > max_data_size) {
+                TFTP_ERROR("DATA payload too large: %zu bytes (max=%zu)", payload_size, max_data_size);
+                return false;
+            }
+            block_number_ = ReadUint16(data + 2);
+            payload_ = data + codec::kHeaderSize;
+            payload_size_ = payload_size;
+            break;
+        }
+        case OpCode::kAcknowledge: {
+            if (size != codec::kHeaderSize) {
+                TFTP_ERROR("ACK packet has incorrect size: %zu (expected: 4)", size);
+                return false;
+            }
+            block_number_ = ReadUint16(data + 2);
+            break;
+        }
+        case OpCode::kError: {
+            if (size < codec::kHeaderSize + 1) {
+                TFTP_ERROR("ERROR packet too small: size=%zu", size);
+                return false;
+            }
+            uint16_t error_code_value = ReadUint16(data + 2);
+            if (error_code_value > 7) {
+                TFTP_ERROR("Invalid error code: %u", error_code_value);
+                return false;
+            }
+            size_t offset = codec::kHeaderSize;
+            std::string_view message;
+            if (!ReadString(data, size, offset, kMaxErrorMessageLength, message)) {
+                TFTP_ERROR("Failed to parse error message (invalid or oversized)");
+                return false;
+            }
+            error_code_ = static_cast<ErrorCode>(error_code_value);
+            error_message_ = message;
+            break;
+        }
+        case OpCode::kOACK: {
+            if (!ParseOptions(data, size, 2)) {
+                return false;
+            }
+            break;
+        }
+    }
+
+    op_code_ = op_code;
+    return true;
+}
+
+bool PacketView::ParseOptions(const uint8_t* data, size_t size, size_t offset) {
+    size_t count = 0;
+    while (offset < size && count < kMaxOptionsCount) {
+        std::string_view name;
+        if (!ReadString(data, size, offset, kMaxOptionNameLength, name)) {
+            TFTP_ERROR("Failed to parse option name (invalid or oversized)");
+            return false;
+        }
+        if (name.empty()) {
+            break;
+        }
+        std::string_view value;
+        if (!ReadString(data, size, offset, kMaxOptionValueLength, value) ||
+            (value.empty() && !AllowsEmptyValue(name))) {
+            TFTP_ERROR("Invalid value for option: %.*s", static_cast<int>(name.size()), name.data());
+            return false;
+        }
+        options_[count++] = Option(name, value);
+    }
+    if (count >= kMaxOptionsCount && offset < size) {
+        TFTP_ERROR("Too many options in packet (max=%zu)", kMaxOptionsCount);
+        return false;
+    }
+    option_count_ = count;
+    return true;
+}
+
+bool PacketView::HasOption(std::string_view name) const {
+    for (size_t i = 0; i < option_count_; ++i) {
+        if (options_[i].first == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view PacketView::GetOption(std::string_view name) const {
+    for (size_t i = option_count_; i > 0; --i) {
+        if (options_[i - 1].first == name) {
+            return options_[i - 1].second;
+        }
+    }
+    return std::string_view();
+}
+
+namespace codec {
+
+void EncodeDataHeader(uint8_t* buffer, uint16_t block_number) {
+    WriteUint16(buffer, static_cast<uint16_t>(OpCode::kData));
+    WriteUint16(buffer + 2, block_number);
+}
+
+const uint8_t* DataHeader(uint16_t block_number) {
+    // One header per block number (256 KiB), built on first use
+    static const std::vector<uint8_t> headers = [] {
+        std::vector<uint8_t> table(kHeaderSize * 65536);
+        for (size_t block = 0; block < 65536; ++block) {
+            EncodeDataHeader(table.data() + block * kHeaderSize, static_cast<uint16_t>(block));
+        }
+        return table;
+    }();
+    return headers.data() + static_cast<size_t>(block_number) * kHeaderSize;
+}
+
+size_t EncodeAck(uint8_t* buffer, uint16_t block_number) {
+    WriteUint16(buffer, static_cast<uint16_t>(OpCode::kAcknowledge));
+    WriteUint16(buffer + 2, block_number);
+    return kHeaderSize;
+}
+
+size_t EncodeError(uint8_t* buffer, size_t capacity, ErrorCode code, std::string_view message) {
+    size_t size = kHeaderSize + message.size() + 1;
+    if (size > capacity) {
+        return 0;
+    }
+    WriteUint16(buffer, static_cast<uint16_t>(OpCode::kError));
+    WriteUint16(buffer + 2, static_cast<uint16_t>(code));
+    if (!message.empty()) {
+        std::memcpy(buffer + kHeaderSize, message.data(), message.size());
+    }
+    buffer[size - 1] = 0;
+    return size;
+}
+
+} // namespace codec
+
+} // namespace tftpserver
@@ -2,6 +2,7 @@
 #include "tftp/tftp_validation.h"
 #include "tftp/tftp_logger.h"
 #include "internal/tftp_server_impl.h"
+#include "internal/tftp_uring.h"
 
 namespace tftpserver {
 
@@ -58,6 +59,57 @@ void TftpServer::SetReadCallback(std::function<bool(const std::string&, std::vec
     impl_->SetReadCallback(std::move(callback));
 }
 
+void TftpServer::SetReadCallbackCache(int ttl_ms, size_t max_bytes) {
+    if (!impl_) {
+        TFTP_ERROR("SetReadCallbackCache: server not initialized");
+        return;
+    }
+    
+    if (!validation::ValidateCallbackCacheTtl(ttl_ms)) {
+        throw TftpException("Invalid callback cache TTL: " + std::to_string(ttl_ms));
+    }
+    
+    // Note: any size is valid, results larger than max_bytes are not kept
+    impl_->SetReadCallbackCache(ttl_ms, max_bytes);
+}
+
+void TftpServer::InvalidateReadCallbackCache(const std::string& filename) {
+    if (!impl_) {
+        TFTP_ERROR("InvalidateReadCallbackCache: server not initialized");
+        return;
+    }
+    impl_->InvalidateReadCallbackCache(filename);
+}
+
+CallbackCacheStats TftpServer::GetReadCallbackCacheStats() const {
+    if (!impl_) {
+        return CallbackCacheStats();
+    }
+    return impl_->GetReadCallbackCacheStats();
+}
+
+void TftpServer::InvalidatePathCache() {
+    if (!impl_) {
+        TFTP_ERROR("InvalidatePathCache: server not initialized");
+        return;
+    }
+    impl_->InvalidatePathCache();
+}
+
+void TftpServer::SetReadSourceFactory(ReadSourceFactory factory) {
+    if (!impl_) {
+        TFTP_ERROR("SetReadSourceFactory: server not initialized");
+        return;
+    }
+    
+    if (!validation::ValidateCallback(factory)) {
+        TFTP_ERROR("SetReadSourceFactory: factory is null");
+        throw TftpException("Read source factory cannot be null");
+    }
+    
+    impl_->SetReadSourceFactory(std::move(factory));
+}
+
 void TftpServer::SetWriteCallback(std::function<bool(const std::string&, const std::vector<uint8_t>&)> callback) {
     if (!impl_) {
         TFTP_ERROR("SetWriteCallback: server not initialized");
@@ -72,6 +124,78 @@ void TftpServer::SetWriteCallback(std::function<bool(const std::string&, const s
     impl_->SetWriteCallback(std::move(callback));
 }
 
+void TftpServer::SetWriteSinkFactory(WriteSinkFactory factory) {
+    if (!impl_) {
+        TFTP_ERROR("SetWriteSinkFactory: server not initialized");
+        return;
+    }
+    
+    if (!validation::ValidateCallback(factory)) {
+        TFTP_ERROR("SetWriteSinkFactory: factory is null");
+        throw TftpException("Write sink factory cannot be null");
+    }
+    
+    impl_->SetWriteSinkFactory(std::move(factory));
+}
+
+void TftpServer::SetFileCacheSize(size_t max_bytes) {
+    if (!impl_) {
+        TFTP_ERROR("SetFileCacheSize: server not initialized");
+        return;
+    }
+    
+    // Note: any size is valid, 0 disables the cache
+    impl_->SetFileCacheSize(max_bytes);
+}
+
+FileCacheStats TftpServer::GetFileCacheStats() const {
+    if (!impl_) {
+        return FileCacheStats();
+    }
+    return impl_->GetFileCacheStats();
+}
+
+void TftpServer::SetAsyncFileIo(size_t read_ahead_windows, size_t write_behind_bytes) {
+    if (!impl_) {
+        TFTP_ERROR("SetAsyncFileIo: server not initialized");
+        return;
+    }
+    
+    if (!validation::ValidateReadAheadWindows(read_ahead_windows)) {
+        throw TftpException("Invalid read-ahead depth: " + std::to_string(read_ahead_windows));
+    }
+    
+    // Note: any size is valid, 0 disables write-behind
+    impl_->SetAsyncFileIo(read_ahead_windows, write_behind_bytes);
+}
+
+void TftpServer::SetFsyncPolicy(FsyncPolicy policy) {
+    if (!impl_) {
+        TFTP_ERROR("SetFsyncPolicy: server not initialized");
+        return;
+    }
+    
+    impl_->SetFsyncPolicy(policy);
+}
+
+void TftpServer::SetPackFile(const std::string& path) {
+    if (!impl_) {
+        TFTP_ERROR("SetPackFile: server not initialized");
+        return;
+    }
+    
+    // Note: the pack is checked when it is mapped, an empty path disables it
+    impl_->SetPackFile(path);
+}
+
+bool TftpServer::ReloadPackFile() {
+    if (!impl_) {
+        TFTP_ERROR("ReloadPackFile: server not initialized");
+        return false;
+    }
+    return impl_->ReloadPackFile();
+}
+
 void TftpServer::SetSecureMode(bool secure) {
     if (!impl_) {
         TFTP_ERROR("SetSecureMode: server not initialized");
@@ -110,4 +234,151 @@ void TftpServer::SetTimeout(int seconds) {
     impl_->SetTimeout(seconds);
 }
 
+void TftpServer::SetRetransmitFloor(int milliseconds) {
+    if (!impl_) {
+        TFTP_ERROR("SetRetransmitFloor: server not initialized");
+        return;
+    }
+    
+    if (!validation::ValidateRetransmitFloor(milliseconds)) {
+        TFTP_ERROR("SetRetransmitFloor: invalid floor value");
+        throw TftpException("Invalid retransmit floor: " + std::to_string(milliseconds));
+    }
+    
+    impl_->SetRetransmitFloor(milliseconds);
+}
+
+void TftpServer::SetTransferEngine(TransferEngine engine, size_t reactor_threads) {
+    if (!impl_) {
+        TFTP_ERROR("SetTransferEngine: server not initialized");
+        return;
+    }
+    
+    impl_->SetTransferEngine(engine, reactor_threads);
+}
+
+void TftpServer::SetIoBackend(IoBackend backend) {
+    if (!impl_) {
+        TFTP_ERROR("SetIoBackend: server not initialized");
+        return;
+    }
+    
+    impl_->SetIoBackend(backend);
+}
+
+bool TftpServer::IsIoBackendAvailable(IoBackend backend) {
+    return backend == IoBackend::kPortable || internal::IoUringAvailable();
+}
+
+void TftpServer::SetThreadPoolSize(size_t count) {
+    if (!impl_) {
+        TFTP_ERROR("SetThreadPoolSize: server not initialized");
+        return;
+    }
+    
+    impl_->SetThreadPoolSize(count);
+}
+
+void TftpServer::SetWorkerAffinity(bool pin_to_cores) {
+    if (!impl_) {
+        TFTP_ERROR("SetWorkerAffinity: server not initialized");
+        return;
+    }
+    
+    impl_->SetWorkerAffinity(pin_to_cores);
+}
+
+void TftpServer::SetListenerCount(size_t count) {
+    if (!impl_) {
+        TFTP_ERROR("SetListenerCount: server not initialized");
+        return;
+    }
+    
+    impl_->SetListenerCount(count);
+}
+
+void TftpServer::SetTransferPortRange(uint16_t first_port, uint16_t last_port) {
+    if (!impl_) {
+        TFTP_ERROR("SetTransferPortRange: server not initialized");
+        return;
+    }
+    
+    if (!validation::ValidatePortRange(first_port, last_port)) {
+        throw TftpException("Invalid transfer port range: " + std::to_string(first_port) + "-" +
+                            std::to_string(last_port));
+    }
+    
+    impl_->SetTransferPortRange(first_port, last_port);
+}
+
+void TftpServer::SetSocketBufferSizes(int receive_bytes, int send_bytes) {
+    if (!impl_) {
+        TFTP_ERROR("SetSocketBufferSizes: server not initialized");
+        return;
+    }
+    
+    if (!validation::ValidateSocketBufferSize(receive_bytes) || !validation::ValidateSocketBufferSize(send_bytes)) {
+        throw TftpException("Invalid socket buffer sizes: " + std::to_string(receive_bytes) + ", " +
+                            std::to_string(send_bytes));
+    }
+    
+    impl_->SetSocketBufferSizes(receive_bytes, send_bytes);
+}
+
+void TftpServer::SetMaxQueuedRequests(size_t count) {
+    if (!impl_) {
+        TFTP_ERROR("SetMaxQueuedRequests: server not initialized");
+        return;
+    }
+    
+    impl_->SetMaxQueuedRequests(count);
+}
+
+void TftpServer::SetBandwidthLimits(uint64_t global_bytes_per_second, uint64_t client_bytes_per_second) {
+    if (!impl_) {
+        TFTP_ERROR("SetBandwidthLimits: server not initialized");
+        return;
+    }
+    
+    impl_->SetBandwidthLimits(global_bytes_per_second, client_bytes_per_second);
+}
+
+void TftpServer::SetMulticastGroup(const std::string& address, uint16_t first_port, size_t port_count) {
+    if (!impl_) {
+        TFTP_ERROR("SetMulticastGroup: server not initialized");
+        return;
+    }
+    
+    if (!impl_->SetMulticastGroup(address, first_port, port_count)) {
+        throw TftpException("Invalid multicast group: " + address + ":" + std::to_string(first_port));
+    }
+}
+
+std::vector<ListenerStats> TftpServer::GetListenerStats() const {
+    if (!impl_) {
+        return std::vector<ListenerStats>();
+    }
+    return impl_->GetListenerStats();
+}
+
+ServerStats TftpServer::GetStats() const {
+    if (!impl_) {
+        return ServerStats();
+    }
+    return impl_->GetStats();
+}
+
+std::string TftpServer::GetPrometheusMetrics() const {
+    return FormatPrometheusMetrics(GetStats());
+}
+
+void TftpServer::SetMetricsPort(uint16_t port) {
+    if (!impl_) {
+        TFTP_ERROR("SetMetricsPort: server not initialized");
+        return;
+    }
+    
+    impl_->SetMetricsPort(port);
+}
+
 } // namespace tftpserver
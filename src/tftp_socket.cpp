@@ -132,6 +132,22 @@ int UdpSocket::ReceiveFromTimeout(void* buffer, size_t buffer_size, SocketAddres
     return impl_->ReceiveFromTimeout(buffer, buffer_size, sender_addr, timeout_ms);
 }
 
+int UdpSocket::SendBatch(const OutgoingDatagram* datagrams, size_t count) {
+    return impl_->SendBatch(datagrams, count);
+}
+
+int UdpSocket::ReceiveBatch(IncomingDatagram* datagrams, size_t count, int timeout_ms) {
+    return impl_->ReceiveBatch(datagrams, count, timeout_ms);
+}
+
+bool UdpSocket::SetSegmentationOffload(bool enable) {
+    return impl_->SetSegmentationOffload(enable);
+}
+
+bool UdpSocket::SetReceiveOffload(bool enable) {
+    return impl_->SetReceiveOffload(enable);
+}
+
 void UdpSocket::Close() {
     impl_->Close();
 }
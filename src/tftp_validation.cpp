@@ -79,6 +79,65 @@ bool ValidateTimeout(int timeout_seconds) {
     return true;
 }
 
+bool ValidateRetransmitFloor(int milliseconds) {
+    if (milliseconds < kMinRetransmitFloorMs) {
+        TFTP_ERROR("Retransmit floor too small: %d < %d", milliseconds, kMinRetransmitFloorMs);
+        return false;
+    }
+    
+    if (milliseconds > kMaxRetransmitFloorMs) {
+        TFTP_ERROR("Retransmit floor too large: %d > %d", milliseconds, kMaxRetransmitFloorMs);
+        return false;
+    }
+    
+    return true;
+}
+
+bool ValidatePortRange(uint16_t first_port, uint16_t last_port) {
+    if (first_port == 0 && last_port == 0) {
+        return true;
+    }
+    
+    if (first_port == 0 || last_port < first_port) {
+        TFTP_ERROR("Invalid port range: %u-%u", first_port, last_port);
+        return false;
+    }
+    
+    return true;
+}
+
+bool ValidateSocketBufferSize(int bytes) {
+    if (bytes < 0 || bytes > kMaxSocketBufferSize) {
+        TFTP_ERROR("Socket buffer size out of range: %d (0-%d)", bytes, kMaxSocketBufferSize);
+        return false;
+    }
+    
+    return true;
+}
+
+bool ValidateReadAheadWindows(size_t windows) {
+    if (windows > kMaxReadAheadWindows) {
+        TFTP_ERROR("Read-ahead too deep: %zu > %zu windows", windows, kMaxReadAheadWindows);
+        return false;
+    }
+    
+    return true;
+}
+
+bool ValidateCallbackCacheTtl(int milliseconds) {
+    if (milliseconds < 0) {
+        TFTP_ERROR("Callback cache TTL cannot be negative: %d", milliseconds);
+        return false;
+    }
+    
+    if (milliseconds > kMaxCallbackCacheTtlMs) {
+        TFTP_ERROR("Callback cache TTL too long: %d > %d ms", milliseconds, kMaxCallbackCacheTtlMs);
+        return false;
+    }
+    
+    return true;
+}
+
 bool ValidateTransferSize(size_t size) {
     if (size < kMinTransferSize) {
         TFTP_ERROR("Transfer size too small: %zu < %zu", size, kMinTransferSize);
@@ -0,0 +1,142 @@
+/**
+ * @file tftp_buffer_pool_test.cpp
+ * @brief Unit tests for BufferPool, PoolAllocated and PooledBuffer
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_buffer_pool.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+namespace {
+
+struct Base : public PoolAllocated {
+    virtual ~Base() = default;
+    uint8_t base_bytes[40];
+};
+
+struct Derived : public Base {
+    uint8_t derived_bytes[3000];
+};
+
+} // namespace
+
+TEST(TftpBufferPoolTest, RecyclesBlocksOfOneClass) {
+    BufferPool::TrimThisThread();
+    EXPECT_EQ(BufferPool::BlockSize(1000), 1024u);
+    EXPECT_EQ(BufferPool::BlockSize(1), BufferPool::kMinClassSize);
+    EXPECT_EQ(BufferPool::BlockSize(BufferPool::kMaxClassSize + 1), BufferPool::kMaxClassSize + 1);
+
+    BufferPoolStats before = BufferPool::GetStats();
+    void* block = BufferPool::Allocate(1000);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % BufferPool::kAlignment, 0u);
+    std::memset(block, 0xab, 1000);
+    BufferPool::Free(block, 1000);
+    // Any size of the same class gets the block back
+    void* again = BufferPool::Allocate(600);
+    EXPECT_EQ(again, block);
+    BufferPool::Free(again, 600);
+
+    BufferPoolStats after = BufferPool::GetStats();
+    EXPECT_GE(after.allocations - before.allocations, 2u);
+    EXPECT_GE(after.reused - before.reused, 1u);
+    BufferPool::TrimThisThread();
+}
+
+TEST(TftpBufferPoolTest, FreeListsAreBounded) {
+    BufferPool::TrimThisThread();
+    const size_t kBlocks = 40;
+    const size_t size = BufferPool::kMaxClassSize;
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < kBlocks; ++i) {
+        blocks.push_back(BufferPool::Allocate(size));
+    }
+    BufferPoolStats before = BufferPool::GetStats();
+    for (void* block : blocks) {
+        BufferPool::Free(block, size);
+    }
+    BufferPoolStats after = BufferPool::GetStats();
+
+    // The thread keeps kMinCachedBlocks of the largest class and the depot kDepotBytes worth
+    const size_t kept = BufferPool::kMinCachedBlocks + BufferPool::kDepotBytes / size;
+    EXPECT_GE(after.discarded - before.discarded, kBlocks - kept);
+    EXPECT_LE(after.cached_bytes, before.cached_bytes + kept * size);
+
+    // Past the largest class nothing is pooled
+    void* large = BufferPool::Allocate(size + 1);
+    BufferPool::Free(large, size + 1);
+    EXPECT_EQ(BufferPool::GetStats().discarded, after.discarded + 1);
+    BufferPool::TrimThisThread();
+}
+
+TEST(TftpBufferPoolTest, BlocksFreedOnAnotherThreadAreReused) {
+    BufferPool::TrimThisThread();
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < 16; ++i) {
+        blocks.push_back(BufferPool::Allocate(2048));
+    }
+    // Freed by a thread that then exits, as a retired worker does
+    std::thread worker([&blocks]() {
+        for (void* block : blocks) {
+            BufferPool::Free(block, 2048);
+        }
+    });
+    worker.join();
+
+    std::set<void*> freed(blocks.begin(), blocks.end());
+    BufferPoolStats before = BufferPool::GetStats();
+    void* block = BufferPool::Allocate(2048);
+    EXPECT_EQ(BufferPool::GetStats().reused, before.reused + 1);
+    EXPECT_EQ(freed.count(block), 1u);
+    BufferPool::Free(block, 2048);
+    BufferPool::TrimThisThread();
+}
+
+TEST(TftpBufferPoolTest, ObjectsAreAllocatedBySize) {
+    BufferPool::TrimThisThread();
+    std::unique_ptr<Base> object = std::make_unique<Derived>();
+    void* address = object.get();
+    // Deleted through the base, which has to hand back the derived size
+    object.reset();
+    object = std::make_unique<Derived>();
+    EXPECT_EQ(static_cast<void*>(object.get()), address);
+    object.reset();
+
+    std::unique_ptr<Base> small = std::make_unique<Base>();
+    EXPECT_NE(static_cast<void*>(small.get()), address);
+    small.reset();
+    BufferPool::TrimThisThread();
+}
+
+TEST(TftpBufferPoolTest, PooledBufferResizesAndMoves) {
+    const uint8_t bytes[5] = {1, 2, 3, 4, 5};
+    PooledBuffer buffer(bytes, sizeof(bytes));
+    ASSERT_EQ(buffer.Size(), 5u);
+    EXPECT_EQ(std::memcmp(buffer.Data(), bytes, 5), 0);
+
+    // Within the block the contents stay
+    uint8_t* data = buffer.Data();
+    buffer.Resize(BufferPool::kMinClassSize);
+    EXPECT_EQ(buffer.Data(), data);
+    EXPECT_EQ(std::memcmp(buffer.Data(), bytes, 5), 0);
+
+    PooledBuffer moved(std::move(buffer));
+    EXPECT_TRUE(buffer.Empty());
+    EXPECT_EQ(buffer.Data(), nullptr);
+    EXPECT_EQ(moved.Data(), data);
+
+    moved.Resize(4096);
+    EXPECT_EQ(moved.Size(), 4096u);
+    moved.Data()[4095] = 7;
+    buffer = std::move(moved);
+    EXPECT_EQ(buffer.Data()[4095], 7);
+    buffer.Reset();
+    EXPECT_TRUE(buffer.Empty());
+}
@@ -0,0 +1,259 @@
+/**
+ * @file tftp_callback_cache_test.cpp
+ * @brief Unit tests for CallbackCache
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_callback_cache.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+namespace {
+
+// Read callback that blocks until released, so that requests can pile up behind it
+class GatedCallback {
+public:
+    bool operator()(const std::string& path, std::vector<uint8_t>& data) {
+        calls_++;
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return open_; });
+        data.assign(path.begin(), path.end());
+        return true;
+    }
+
+    void Open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        cv_.notify_all();
+    }
+
+    int Calls() const { return calls_.load(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool open_ = false;
+    std::atomic<int> calls_{0};
+};
+
+CallbackCache::ReadCallback Counting(std::atomic<int>& calls, size_t size = 16) {
+    return [&calls, size](const std::string&, std::vector<uint8_t>& data) {
+        calls++;
+        data.assign(size, static_cast<uint8_t>(calls.load()));
+        return true;
+    };
+}
+
+// Waits until the cache counts waiting requests, since they block inside Get
+void WaitForCoalesced(const CallbackCache& cache, uint64_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (cache.GetStats().coalesced < count && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+} // namespace
+
+TEST(TftpCallbackCacheTest, ConcurrentRequestsShareOneCall) {
+    auto gate = std::make_shared<GatedCallback>();
+    CallbackCache cache;
+    CallbackCache::Generation generation = cache.NewGeneration(
+        [gate](const std::string& path, std::vector<uint8_t>& data) { return (*gate)(path, data); });
+
+    const int kRequests = 8;
+    std::vector<CallbackCache::Content> results(kRequests);
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() { results[0] = cache.Get(generation, "/root/a.bin"); });
+    while (gate->Calls() == 0) {
+        std::this_thread::yield();
+    }
+    for (int i = 1; i < kRequests; ++i) {
+        threads.emplace_back([&, i]() { results[i] = cache.Get(generation, "/root/a.bin"); });
+    }
+    WaitForCoalesced(cache, kRequests - 1);
+    gate->Open();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(gate->Calls(), 1);
+    for (const auto& result : results) {
+        ASSERT_TRUE(result);
+        EXPECT_EQ(result, results[0]);
+    }
+    CallbackCacheStats stats = cache.GetStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.coalesced, static_cast<uint64_t>(kRequests - 1));
+    // Without a TTL nothing outlives the call
+    EXPECT_EQ(stats.entries, 0u);
+    EXPECT_TRUE(cache.Get(generation, "/root/a.bin"));
+    EXPECT_EQ(gate->Calls(), 2);
+}
+
+TEST(TftpCallbackCacheTest, ResultsExpireAfterTtl) {
+    std::atomic<int> calls{0};
+    CallbackCache cache;
+    CallbackCache::Generation generation = cache.NewGeneration(Counting(calls));
+    cache.SetLimits(std::chrono::milliseconds(50), 1024);
+
+    auto first = cache.Get(generation, "/root/a");
+    auto second = cache.Get(generation, "/root/a");
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_EQ(cache.GetStats().hits, 1u);
+    EXPECT_EQ(cache.GetStats().cached_bytes, 16u);
+
+    // Another path is generated on its own
+    cache.Get(generation, "/root/b");
+    EXPECT_EQ(calls.load(), 2);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    auto third = cache.Get(generation, "/root/a");
+    EXPECT_NE(third, first);
+    EXPECT_EQ(calls.load(), 3);
+}
+
+TEST(TftpCallbackCacheTest, ByteLimitEvictsLeastRecentlyUsed) {
+    std::atomic<int> calls{0};
+    CallbackCache cache;
+    CallbackCache::Generation generation = cache.NewGeneration(Counting(calls, 100));
+    cache.SetLimits(std::chrono::seconds(60), 250);
+
+    cache.Get(generation, "/a");
+    cache.Get(generation, "/b");
+    cache.Get(generation, "/a");  // /b is now the least recently used
+    cache.Get(generation, "/c");
+    CallbackCacheStats stats = cache.GetStats();
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_EQ(stats.cached_bytes, 200u);
+
+    int before = calls.load();
+    cache.Get(generation, "/a");
+    cache.Get(generation, "/c");
+    EXPECT_EQ(calls.load(), before);
+    cache.Get(generation, "/b");
+    EXPECT_EQ(calls.load(), before + 1);
+
+    // A result larger than the limit is served but not kept
+    generation = cache.NewGeneration(Counting(calls, 300));
+    EXPECT_EQ(cache.GetStats().entries, 0u);
+    ASSERT_TRUE(cache.Get(generation, "/big"));
+    EXPECT_EQ(cache.GetStats().entries, 0u);
+
+    // Lowering the limit evicts down to it
+    generation = cache.NewGeneration(Counting(calls, 100));
+    cache.Get(generation, "/a");
+    cache.Get(generation, "/b");
+    cache.SetLimits(std::chrono::seconds(60), 150);
+    EXPECT_EQ(cache.GetStats().entries, 1u);
+    EXPECT_EQ(cache.GetStats().cached_bytes, 100u);
+}
+
+TEST(TftpCallbackCacheTest, InvalidateDropsKeptAndInFlightResults) {
+    std::atomic<int> calls{0};
+    CallbackCache cache;
+    CallbackCache::Generation generation = cache.NewGeneration(Counting(calls));
+    cache.SetLimits(std::chrono::seconds(60), 1024);
+
+    cache.Get(generation, "/a");
+    cache.Get(generation, "/b");
+    cache.Invalidate("/a");
+    EXPECT_EQ(cache.GetStats().entries, 1u);
+    cache.Get(generation, "/a");
+    cache.Get(generation, "/b");
+    EXPECT_EQ(calls.load(), 3);
+
+    cache.Clear();
+    EXPECT_EQ(cache.GetStats().entries, 0u);
+    EXPECT_EQ(cache.GetStats().cached_bytes, 0u);
+
+    // Content invalidated while it is being generated may be stale: it answers that call only
+    auto gate = std::make_shared<GatedCallback>();
+    generation = cache.NewGeneration(
+        [gate](const std::string& path, std::vector<uint8_t>& data) { return (*gate)(path, data); });
+    CallbackCache::Content result;
+    std::thread request([&]() { result = cache.Get(generation, "/a"); });
+    while (gate->Calls() == 0) {
+        std::this_thread::yield();
+    }
+    cache.Invalidate("/a");
+    gate->Open();
+    request.join();
+    ASSERT_TRUE(result);
+    EXPECT_EQ(cache.GetStats().entries, 0u);
+    cache.Get(generation, "/a");
+    EXPECT_EQ(gate->Calls(), 2);
+    EXPECT_EQ(cache.GetStats().entries, 1u);
+}
+
+TEST(TftpCallbackCacheTest, GenerationsNeverShareCalls) {
+    auto gate = std::make_shared<GatedCallback>();
+    CallbackCache cache;
+    cache.SetLimits(std::chrono::seconds(60), 1024);
+    CallbackCache::Generation old_generation = cache.NewGeneration(
+        [gate](const std::string& path, std::vector<uint8_t>& data) { return (*gate)(path, data); });
+    CallbackCache::Content old_result;
+    std::thread old_request([&]() { old_result = cache.Get(old_generation, "/a"); });
+    while (gate->Calls() == 0) {
+        std::this_thread::yield();
+    }
+
+    // A request of the new callback makes its own call instead of waiting for the old one
+    std::atomic<int> calls{0};
+    CallbackCache::Generation generation = cache.NewGeneration(Counting(calls));
+    CallbackCache::Content result = cache.Get(generation, "/a");
+    ASSERT_TRUE(result);
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_EQ(cache.GetStats().coalesced, 0u);
+
+    // A request still configured with the old callback shares the old call
+    CallbackCache::Content joined;
+    std::thread joined_request([&]() { joined = cache.Get(old_generation, "/a"); });
+    WaitForCoalesced(cache, 1);
+    gate->Open();
+    old_request.join();
+    joined_request.join();
+    ASSERT_TRUE(old_result);
+    EXPECT_EQ(joined, old_result);
+    EXPECT_EQ(std::string(old_result->begin(), old_result->end()), "/a");
+
+    // Only the current generation's result is kept, and the old callback is still called
+    EXPECT_EQ(cache.GetStats().entries, 1u);
+    EXPECT_EQ(cache.Get(generation, "/a"), result);
+    EXPECT_NE(cache.Get(old_generation, "/a"), result);
+    EXPECT_EQ(gate->Calls(), 2);
+    EXPECT_EQ(cache.GetStats().entries, 1u);
+}
+
+TEST(TftpCallbackCacheTest, FailedCallsAreNotKept) {
+    std::atomic<int> calls{0};
+    CallbackCache cache;
+    CallbackCache::Generation generation;
+    EXPECT_FALSE(cache.Get(generation, "/a"));
+
+    cache.SetLimits(std::chrono::seconds(60), 1024);
+    generation = cache.NewGeneration([&calls](const std::string&, std::vector<uint8_t>&) {
+        calls++;
+        return false;
+    });
+    EXPECT_FALSE(cache.Get(generation, "/a"));
+    EXPECT_FALSE(cache.Get(generation, "/a"));
+    EXPECT_EQ(calls.load(), 2);
+
+    generation = cache.NewGeneration([&calls](const std::string&, std::vector<uint8_t>&) -> bool {
+        calls++;
+        throw std::runtime_error("generator failed");
+    });
+    EXPECT_FALSE(cache.Get(generation, "/a"));
+    EXPECT_FALSE(cache.Get(generation, "/a"));
+    EXPECT_EQ(calls.load(), 4);
+    EXPECT_EQ(cache.GetStats().entries, 0u);
+}
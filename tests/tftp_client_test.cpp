@@ -0,0 +1,223 @@
+/**
+ * @file tftp_client_test.cpp
+ * @brief Tests for TftpClient against the server running on loopback
+ */
+
+#include <gtest/gtest.h>
+#include "tftp/tftp_server.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver;
+
+namespace {
+
+constexpr uint16_t kClientTestPort = 6974;  // Different port from other tests
+constexpr const char* kClientRootDir = "./client_test_files";
+
+std::vector<uint8_t> MakeContent(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+    return data;
+}
+
+std::vector<uint8_t> ReadFile(const std::string& name) {
+    std::ifstream file(std::string(kClientRootDir) + "/" + name, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+// Sink recording how the client drives it
+class RecordingSink : public WriteSink {
+public:
+    bool Open(const std::string& path, uint64_t size_hint) override {
+        opened_path = path;
+        this->size_hint = size_hint;
+        return true;
+    }
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override {
+        EXPECT_EQ(offset, this->data.size());
+        this->data.insert(this->data.end(), data, data + length);
+        return true;
+    }
+    bool Commit() override {
+        committed = true;
+        return true;
+    }
+    void Abort() override { aborted = true; }
+
+    std::string opened_path;
+    uint64_t size_hint = 0;
+    std::vector<uint8_t> data;
+    bool committed = false;
+    bool aborted = false;
+};
+
+} // namespace
+
+class TftpClientTest : public ::testing::TestWithParam<TransferEngine> {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories(kClientRootDir);
+        WriteFile("small.bin", MakeContent(1300, 1));
+        // Exactly two blocks of 512, so the transfer ends with an empty block
+        WriteFile("exact.bin", MakeContent(1024, 2));
+        WriteFile("large.bin", MakeContent(300 * 1024 + 7, 3));
+
+        server_ = std::make_unique<TftpServer>(kClientRootDir, kClientTestPort);
+        server_->SetTransferEngine(GetParam(), 2);
+        server_->SetThreadPoolSize(8);
+        ASSERT_TRUE(server_->Start());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    void TearDown() override {
+        server_->Stop();
+        server_.reset();
+        std::filesystem::remove_all(kClientRootDir);
+    }
+
+    void WriteFile(const std::string& name, const std::vector<uint8_t>& data) {
+        std::ofstream file(std::string(kClientRootDir) + "/" + name, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    std::unique_ptr<TftpServer> server_;
+};
+
+TEST_P(TftpClientTest, DownloadAndUpload) {
+    TftpClient client;
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(client.DownloadFile("127.0.0.1", "small.bin", data, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(data, ReadFile("small.bin"));
+    ASSERT_TRUE(client.DownloadFile("localhost", "exact.bin", data, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(data, ReadFile("exact.bin"));
+
+    std::vector<uint8_t> upload = MakeContent(5000, 9);
+    ASSERT_TRUE(client.UploadFile("127.0.0.1", "uploaded.bin", upload, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(ReadFile("uploaded.bin"), upload);
+}
+
+TEST_P(TftpClientTest, NegotiatedOptions) {
+    TftpClient client;
+    client.SetBlockSize(1428);
+    client.SetWindowSize(8);
+
+    // The sink is told the size from the OACK before the first block
+    RecordingSink sink;
+    ASSERT_TRUE(client.DownloadFile("127.0.0.1", "large.bin", sink, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(sink.opened_path, "large.bin");
+    EXPECT_EQ(sink.size_hint, 300u * 1024 + 7);
+    EXPECT_TRUE(sink.committed);
+    EXPECT_FALSE(sink.aborted);
+    EXPECT_EQ(sink.data, ReadFile("large.bin"));
+
+    std::vector<uint8_t> upload = MakeContent(200 * 1024, 4);
+    ASSERT_TRUE(client.UploadFile("127.0.0.1", "windowed.bin", upload, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(ReadFile("windowed.bin"), upload);
+}
+
+TEST_P(TftpClientTest, BlockNumbersWrap) {
+    // More than 65535 blocks of 8 bytes
+    WriteFile("wrap.bin", MakeContent(600000, 5));
+    TftpClient client;
+    client.SetBlockSize(8);
+    client.SetWindowSize(64);
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(client.DownloadFile("127.0.0.1", "wrap.bin", data, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(data, ReadFile("wrap.bin"));
+}
+
+TEST_P(TftpClientTest, ReportsServerErrors) {
+    TftpClient client;
+    RecordingSink sink;
+    EXPECT_FALSE(client.DownloadFile("127.0.0.1", "missing.bin", sink, kClientTestPort));
+    EXPECT_NE(client.GetLastError().find("File not found"), std::string::npos) << client.GetLastError();
+    EXPECT_TRUE(sink.opened_path.empty());
+
+    std::vector<uint8_t> data;
+    EXPECT_FALSE(client.DownloadFile("127.0.0.1", "../outside.bin", data, kClientTestPort));
+    EXPECT_FALSE(client.DownloadFile("", "small.bin", data, kClientTestPort));
+    EXPECT_THROW(client.SetBlockSize(4), TftpException);
+    EXPECT_THROW(client.SetWindowSize(0), TftpException);
+    EXPECT_THROW(client.SetMaxParallelTransfers(0), TftpException);
+}
+
+TEST_P(TftpClientTest, BatchRunsConcurrently) {
+    TftpClient client;
+    client.SetBlockSize(1024);
+    client.SetWindowSize(4);
+    client.SetMaxParallelTransfers(6);
+
+    std::vector<ClientTransfer> transfers;
+    for (int i = 0; i < 20; ++i) {
+        ClientTransfer transfer;
+        transfer.filename = (i % 2 == 0) ? "small.bin" : "large.bin";
+        transfers.push_back(transfer);
+    }
+    ClientTransfer upload;
+    upload.filename = "batch_upload.bin";
+    upload.upload = true;
+    upload.data = MakeContent(70000, 6);
+    transfers.push_back(upload);
+    ClientTransfer missing;
+    missing.filename = "missing.bin";
+    transfers.push_back(missing);
+
+    EXPECT_FALSE(client.RunTransfers("127.0.0.1", transfers, kClientTestPort));
+    std::vector<uint8_t> small = ReadFile("small.bin");
+    std::vector<uint8_t> large = ReadFile("large.bin");
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(transfers[i].success) << i << ": " << transfers[i].error;
+        EXPECT_EQ(transfers[i].data, (i % 2 == 0) ? small : large);
+        EXPECT_EQ(transfers[i].bytes, transfers[i].data.size());
+        EXPECT_GT(transfers[i].elapsed_us, 0u);
+        EXPECT_GT(transfers[i].first_byte_us, 0u);
+        EXPECT_LE(transfers[i].first_byte_us, transfers[i].elapsed_us);
+    }
+    EXPECT_TRUE(transfers[20].success) << transfers[20].error;
+    EXPECT_EQ(ReadFile("batch_upload.bin"), transfers[20].data);
+    EXPECT_FALSE(transfers[21].success);
+    EXPECT_NE(client.GetLastError().find("missing.bin"), std::string::npos);
+}
+
+TEST_P(TftpClientTest, NetAsciiTranslatesLineEnds) {
+    std::string text;
+    for (int i = 0; i < 400; ++i) {
+        text += "line " + std::to_string(i) + (i % 7 == 0 ? "\r" : "") + "\n";
+    }
+    std::vector<uint8_t> content(text.begin(), text.end());
+    size_t breaks = std::count(content.begin(), content.end(), '\n') + std::count(content.begin(), content.end(), '\r');
+    WriteFile("text.txt", content);
+
+    TftpClient client;
+    client.SetTransferMode(TransferMode::kNetAscii);
+    client.SetBlockSize(1024);
+    client.SetWindowSize(4);
+
+    // tsize announces the translated size; both ends store bare LF
+    RecordingSink sink;
+    ASSERT_TRUE(client.DownloadFile("127.0.0.1", "text.txt", sink, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(sink.size_hint, content.size() + breaks);
+    EXPECT_EQ(sink.data, content);
+
+    ASSERT_TRUE(client.UploadFile("127.0.0.1", "text_upload.txt", content, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(ReadFile("text_upload.txt"), content);
+
+    // The wire carries CR LF, so more bytes travel than the file holds
+    std::vector<ClientTransfer> transfers(1);
+    transfers[0].filename = "text.txt";
+    ASSERT_TRUE(client.RunTransfers("127.0.0.1", transfers, kClientTestPort)) << client.GetLastError();
+    EXPECT_EQ(transfers[0].data, content);
+    EXPECT_EQ(transfers[0].bytes, content.size() + breaks);
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, TftpClientTest,
+                         ::testing::Values(TransferEngine::kThreadPool, TransferEngine::kEventDriven));
@@ -0,0 +1,135 @@
+/**
+ * @file tftp_file_cache_test.cpp
+ * @brief Unit tests for FileCache and CachedReadSource
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_file_cache.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+class TftpFileCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories(kTestDir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(kTestDir);
+    }
+
+    std::string WriteFile(const std::string& name, size_t size, uint8_t seed) {
+        std::string path = std::string(kTestDir) + "/" + name;
+        std::vector<char> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(seed + i);
+        }
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        return path;
+    }
+
+    static constexpr const char* kTestDir = "./file_cache_test_files";
+};
+
+TEST_F(TftpFileCacheTest, DisabledByDefault) {
+    FileCache cache;
+    std::string path = WriteFile("a.bin", 1000, 1);
+    EXPECT_FALSE(cache.IsEnabled());
+    EXPECT_EQ(cache.Acquire(path), nullptr);
+    EXPECT_EQ(cache.GetStats().misses, 0u);
+}
+
+TEST_F(TftpFileCacheTest, HitSharesMapping) {
+    FileCache cache(1024 * 1024);
+    std::string path = WriteFile("a.bin", 5000, 3);
+
+    auto first = cache.Acquire(path);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(first->Size(), 5000u);
+    EXPECT_EQ(first->Data()[10], static_cast<uint8_t>(3 + 10));
+
+    // Same file through a different spelling of the path
+    auto second = cache.Acquire(std::string(kTestDir) + "/./a.bin");
+    EXPECT_EQ(first.get(), second.get());
+
+    FileCacheStats stats = cache.GetStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.cached_bytes, 5000u);
+}
+
+TEST_F(TftpFileCacheTest, InvalidatedWhenFileChanges) {
+    FileCache cache(1024 * 1024);
+    std::string path = WriteFile("a.bin", 1000, 1);
+    auto old_file = cache.Acquire(path);
+    ASSERT_NE(old_file, nullptr);
+
+    // Replace with a different size so the change is detected even with coarse timestamps
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::string new_path = WriteFile("a.bin.new", 2000, 9);
+    std::filesystem::rename(new_path, path);
+
+    auto new_file = cache.Acquire(path);
+    ASSERT_NE(new_file, nullptr);
+    EXPECT_NE(old_file.get(), new_file.get());
+    EXPECT_EQ(new_file->Size(), 2000u);
+    EXPECT_EQ(new_file->Data()[0], 9);
+
+    // The old snapshot stays readable while referenced
+    EXPECT_EQ(old_file->Size(), 1000u);
+    EXPECT_EQ(old_file->Data()[0], 1);
+    EXPECT_EQ(cache.GetStats().misses, 2u);
+}
+
+TEST_F(TftpFileCacheTest, EvictsLeastRecentlyUsed) {
+    FileCache cache(10000);
+    std::string a = WriteFile("a.bin", 4000, 1);
+    std::string b = WriteFile("b.bin", 4000, 2);
+    std::string c = WriteFile("c.bin", 4000, 3);
+
+    ASSERT_NE(cache.Acquire(a), nullptr);
+    ASSERT_NE(cache.Acquire(b), nullptr);
+    ASSERT_NE(cache.Acquire(a), nullptr);  // b becomes the LRU entry
+    ASSERT_NE(cache.Acquire(c), nullptr);
+
+    FileCacheStats stats = cache.GetStats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_LE(stats.cached_bytes, 10000u);
+
+    ASSERT_NE(cache.Acquire(a), nullptr);
+    EXPECT_EQ(cache.GetStats().hits, 2u);
+}
+
+TEST_F(TftpFileCacheTest, OversizedFileFallsBackToPositionedReads) {
+    auto cache = std::make_shared<FileCache>(1000);
+    std::string path = WriteFile("big.bin", 3000, 5);
+
+    CachedReadSource source(cache);
+    ASSERT_TRUE(source.Open(path));
+    EXPECT_EQ(source.Size(), 3000u);
+
+    std::vector<uint8_t> buffer(512);
+    size_t bytes_read = 0;
+    ASSERT_TRUE(source.ReadAt(2900, buffer.data(), buffer.size(), bytes_read));
+    EXPECT_EQ(bytes_read, 100u);
+    EXPECT_EQ(buffer[0], static_cast<uint8_t>(5 + 2900));
+    source.Close();
+
+    EXPECT_EQ(cache->GetStats().entries, 0u);
+}
+
+TEST_F(TftpFileCacheTest, MissingFile) {
+    auto cache = std::make_shared<FileCache>(1000);
+    CachedReadSource source(cache);
+    EXPECT_FALSE(source.Open(std::string(kTestDir) + "/missing.bin"));
+}
@@ -0,0 +1,352 @@
+/**
+ * @file tftp_io_stage_test.cpp
+ * @brief Unit tests for IoStage, ReadAheadSource and WriteBehindSink
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_io_stage.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+namespace {
+
+// In-memory source counting the reads made on the test thread and how far the others got
+class MemorySource : public ReadSource {
+public:
+    MemorySource(std::vector<uint8_t> data, std::thread::id caller) : data_(std::move(data)), caller_(caller) {}
+
+    bool Open(const std::string&) override { return true; }
+    uint64_t Size() const override { return data_.size(); }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        bytes_read = offset < data_.size() ? std::min<size_t>(length, data_.size() - offset) : 0;
+        std::memcpy(buffer, data_.data() + offset, bytes_read);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::this_thread::get_id() == caller_) {
+            caller_reads_++;
+        } else {
+            background_end_ = std::max<uint64_t>(background_end_, offset + bytes_read);
+        }
+        return true;
+    }
+    void Prefetch(uint64_t offset, size_t length) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hinted_end_ = std::max<uint64_t>(hinted_end_, offset + length);
+    }
+    void Close() override {}
+
+    size_t CallerReads() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return caller_reads_;
+    }
+    // Waits until the background reads reach end
+    bool WaitForBackground(uint64_t end) {
+        for (int i = 0; i < 200; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (background_end_ >= end) {
+                    return true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return false;
+    }
+    uint64_t HintedEnd() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hinted_end_;
+    }
+
+private:
+protected:
+    std::vector<uint8_t> data_;
+    std::thread::id caller_;
+    std::mutex mutex_;
+    size_t caller_reads_ = 0;
+    uint64_t background_end_ = 0;
+    uint64_t hinted_end_ = 0;
+};
+
+// Sink recording blocks in order; writes wait while the gate is closed and fail from fail_at on
+class GatedSink : public WriteSink {
+public:
+    bool Open(const std::string&, uint64_t) override { return true; }
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        gate_changed_.wait(lock, [this]() { return open_; });
+        if (writes_ >= fail_at_) {
+            return false;
+        }
+        writes_++;
+        EXPECT_EQ(offset, data_.size());
+        data_.insert(data_.end(), data, data + length);
+        return true;
+    }
+    bool Commit() override {
+        committed_ = true;
+        return true;
+    }
+    void Abort() override { aborted_ = true; }
+
+    void SetGate(bool open) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = open;
+        gate_changed_.notify_all();
+    }
+
+    std::mutex mutex_;
+    std::condition_variable gate_changed_;
+    bool open_ = true;
+    size_t writes_ = 0;
+    size_t fail_at_ = SIZE_MAX;
+    std::vector<uint8_t> data_;
+    std::atomic<bool> committed_{false};
+    std::atomic<bool> aborted_{false};
+};
+
+// Memory source whose background reads wait while the gate is closed
+class GatedSource : public MemorySource {
+public:
+    using MemorySource::MemorySource;
+
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        if (std::this_thread::get_id() != caller_) {
+            std::unique_lock<std::mutex> lock(gate_mutex_);
+            gate_changed_.wait(lock, [this]() { return open_; });
+        }
+        return MemorySource::ReadAt(offset, buffer, length, bytes_read);
+    }
+
+    void SetGate(bool open) {
+        std::lock_guard<std::mutex> lock(gate_mutex_);
+        open_ = open;
+        gate_changed_.notify_all();
+    }
+
+private:
+    std::mutex gate_mutex_;
+    std::condition_variable gate_changed_;
+    bool open_ = false;
+};
+
+// Notifier counting its calls, for the tests to wait on
+class Notified {
+public:
+    std::function<void()> Notifier() {
+        return [this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            calls_++;
+            changed_.notify_all();
+        };
+    }
+
+    bool WaitFor(int calls) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, std::chrono::seconds(5), [&]() { return calls_ >= calls; });
+    }
+
+    int Calls() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return calls_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    int calls_ = 0;
+};
+
+std::vector<uint8_t> Pattern(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(i * 13 + (i >> 9));
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(TftpIoStageTest, ReadAheadServesLaterWindowsFromMemory) {
+    const size_t kBlock = 512;
+    const size_t kWindow = 4;
+    const std::vector<uint8_t> content = Pattern(kBlock * kWindow * 20 + 100);
+    auto stage = std::make_shared<IoStage>(2);
+    auto memory = std::make_unique<MemorySource>(content, std::this_thread::get_id());
+    MemorySource& backing = *memory;
+    ReadAheadSource source(std::move(memory), stage, 2);
+    ASSERT_TRUE(source.Open("file"));
+    ASSERT_EQ(source.Size(), content.size());
+
+    std::vector<uint8_t> blocks(kWindow * kBlock);
+    std::vector<ReadRequest> requests(kWindow);
+    for (uint64_t window = 0; window * kWindow * kBlock < content.size(); ++window) {
+        uint64_t begin = window * kWindow * kBlock;
+        for (size_t i = 0; i < kWindow; ++i) {
+            requests[i] = ReadRequest();
+            requests[i].offset = begin + i * kBlock;
+            requests[i].buffer = blocks.data() + i * kBlock;
+            requests[i].length = kBlock;
+        }
+        if (window > 0) {
+            // The previous batch asked for this window and the next; once the stage reads the
+            // next one, this one is ready
+            ASSERT_TRUE(backing.WaitForBackground(std::min<uint64_t>(content.size(), begin + 2 * kWindow * kBlock)));
+        }
+        ASSERT_TRUE(source.ReadBatch(requests.data(), requests.size()));
+        for (size_t i = 0; i < kWindow; ++i) {
+            size_t expected = requests[i].offset < content.size()
+                                  ? std::min<size_t>(kBlock, content.size() - requests[i].offset) : 0;
+            ASSERT_EQ(requests[i].bytes_read, expected);
+            EXPECT_EQ(std::memcmp(requests[i].buffer, content.data() + requests[i].offset, expected), 0);
+        }
+    }
+    // Only the first window was read on the calling thread (and the final partial block, if the
+    // test got to it before the stage marked it ready)
+    size_t caller_reads = backing.CallerReads();
+    EXPECT_GE(caller_reads, kWindow);
+    EXPECT_LE(caller_reads, kWindow + 1);
+    EXPECT_GE(backing.HintedEnd(), 3 * kWindow * kBlock);
+
+    // A jump back is read directly
+    uint8_t byte = 0;
+    size_t bytes_read = 0;
+    ASSERT_TRUE(source.ReadAt(7, &byte, 1, bytes_read));
+    EXPECT_EQ(bytes_read, 1u);
+    EXPECT_EQ(byte, content[7]);
+    EXPECT_EQ(backing.CallerReads(), caller_reads + 1);
+    source.Close();
+}
+
+TEST(TftpIoStageTest, ReadAheadPrefetchesFirstWindowAndNotifies) {
+    const size_t kWindow = 4 * 512;
+    const std::vector<uint8_t> content = Pattern(kWindow * 3);
+    auto stage = std::make_shared<IoStage>(1);
+    auto gated = std::make_unique<GatedSource>(content, std::this_thread::get_id());
+    GatedSource& backing = *gated;
+    ReadAheadSource source(std::move(gated), stage, 2);
+    ASSERT_TRUE(source.Open("file"));
+
+    // Nothing in flight: waiting would not help
+    Notified notified;
+    EXPECT_TRUE(source.WhenReady(0, notified.Notifier()));
+
+    source.Prefetch(0, kWindow);
+    EXPECT_FALSE(source.WhenReady(0, notified.Notifier()));
+    EXPECT_EQ(notified.Calls(), 0);
+    backing.SetGate(true);
+    ASSERT_TRUE(notified.WaitFor(1));
+    EXPECT_TRUE(source.WhenReady(0, notified.Notifier()));
+
+    // The first window comes from memory, read in chunks of the prefetched window
+    std::vector<uint8_t> window(kWindow);
+    size_t bytes_read = 0;
+    ASSERT_TRUE(source.ReadAt(0, window.data(), window.size(), bytes_read));
+    EXPECT_EQ(bytes_read, kWindow);
+    EXPECT_EQ(std::memcmp(window.data(), content.data(), kWindow), 0);
+    EXPECT_EQ(backing.CallerReads(), 0u);
+    source.Close();
+}
+
+TEST(TftpIoStageTest, WriteBehindNeverBlocksAndSignalsRoom) {
+    auto stage = std::make_shared<IoStage>(2);
+    auto gated = std::make_unique<GatedSink>();
+    GatedSink& backing = *gated;
+    WriteBehindSink sink(std::move(gated), stage, 2048);
+    ASSERT_TRUE(sink.Open("file", 0));
+
+    const std::vector<uint8_t> content = Pattern(512 * 8 + 100);
+    backing.SetGate(false);
+    Notified room;
+    // Writes are queued at once while the disk is stalled; room is reported to the caller
+    for (size_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(sink.Write(i * 512, content.data() + i * 512, 512));
+    }
+    EXPECT_TRUE(sink.WaitForRoom(room.Notifier()));
+    ASSERT_TRUE(sink.Write(4 * 512, content.data() + 4 * 512, 512));
+    EXPECT_FALSE(sink.WaitForRoom(room.Notifier()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(room.Calls(), 0);
+    backing.SetGate(true);
+    ASSERT_TRUE(room.WaitFor(1));
+    EXPECT_TRUE(sink.WaitForRoom(room.Notifier()));
+
+    for (size_t offset = 5 * 512; offset < content.size(); offset += 512) {
+        ASSERT_TRUE(sink.Write(offset, content.data() + offset, std::min<size_t>(512, content.size() - offset)));
+    }
+    // The commit runs behind the queued blocks on the stage
+    Notified committed;
+    sink.CommitAsync(committed.Notifier());
+    ASSERT_TRUE(committed.WaitFor(1));
+    EXPECT_EQ(sink.GetCommitState(), WriteBehindSink::CommitState::kSucceeded);
+    EXPECT_TRUE(backing.committed_.load());
+    EXPECT_EQ(backing.data_, content);
+}
+
+TEST(TftpIoStageTest, WriteBehindReportsBackgroundFailure) {
+    auto stage = std::make_shared<IoStage>(1);
+    auto gated = std::make_unique<GatedSink>();
+    GatedSink& backing = *gated;
+    backing.fail_at_ = 2;
+    WriteBehindSink sink(std::move(gated), stage, 1024 * 1024);
+    ASSERT_TRUE(sink.Open("file", 0));
+
+    const std::vector<uint8_t> content = Pattern(512 * 4);
+    for (size_t i = 0; i < 4; ++i) {
+        // Accepted while the failure is still ahead of the disk; never after it was seen
+        if (!sink.Write(i * 512, content.data() + i * 512, 512)) {
+            break;
+        }
+    }
+    EXPECT_FALSE(sink.Commit());
+    EXPECT_TRUE(backing.aborted_.load());
+    EXPECT_FALSE(backing.committed_.load());
+    EXPECT_EQ(backing.data_.size(), 2 * 512u);
+
+    // The same failure, found by the commit on the stage
+    auto failing = std::make_unique<GatedSink>();
+    GatedSink& second = *failing;
+    second.fail_at_ = 0;
+    WriteBehindSink async_sink(std::move(failing), stage, 1024 * 1024);
+    ASSERT_TRUE(async_sink.Open("file", 0));
+    async_sink.Write(0, content.data(), 512);
+    Notified committed;
+    async_sink.CommitAsync(committed.Notifier());
+    ASSERT_TRUE(committed.WaitFor(1));
+    EXPECT_EQ(async_sink.GetCommitState(), WriteBehindSink::CommitState::kFailed);
+    EXPECT_TRUE(second.aborted_.load());
+    EXPECT_FALSE(second.committed_.load());
+}
+
+TEST(TftpIoStageTest, CompletionsWakeUntilClosed) {
+    std::atomic<int> wakes{0};
+    auto completions = std::make_shared<IoCompletions>([&wakes]() { wakes++; });
+    std::function<void()> first = IoCompletions::Notifier(completions, 7);
+    std::function<void()> second = IoCompletions::Notifier(completions, 9);
+
+    EXPECT_FALSE(completions->Wait(std::chrono::milliseconds(1)));
+    std::thread io([&]() { second(); });
+    EXPECT_TRUE(completions->Wait(std::chrono::seconds(5)));
+    io.join();
+    first();
+    std::vector<uint64_t> ids;
+    completions->Take(ids);
+    EXPECT_EQ(ids, (std::vector<uint64_t>{9, 7}));
+    EXPECT_EQ(wakes.load(), 2);
+
+    completions->Close();
+    first();
+    ids.clear();
+    completions->Take(ids);
+    EXPECT_TRUE(ids.empty());
+    EXPECT_EQ(wakes.load(), 2);
+}
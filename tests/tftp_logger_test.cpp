@@ -0,0 +1,140 @@
+/**
+ * @file tftp_logger_test.cpp
+ * @brief Unit tests for the asynchronous logger and the lazy hex dump
+ */
+
+#include <gtest/gtest.h>
+#include "tftp/tftp_logger.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver;
+
+class TftpLoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        saved_level_ = TftpLogger::GetInstance().GetLogLevel();
+        std::remove(kLogPath);
+        TftpLogger::GetInstance().SetLogFile(kLogPath);
+        TftpLogger::GetInstance().SetLogLevel(kLogInfo);
+    }
+
+    void TearDown() override {
+        TftpLogger& logger = TftpLogger::GetInstance();
+        logger.SetAsync(false);
+        logger.SetLogLevel(saved_level_);
+        logger.SetLogFile("");  // Back to stderr for the rest of the suite
+        std::remove(kLogPath);
+    }
+
+    static std::vector<std::string> ReadLines() {
+        std::vector<std::string> lines;
+        std::ifstream file(kLogPath);
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    static constexpr const char* kLogPath = "./logger_test.log";
+    int saved_level_ = kLogInfo;
+};
+
+TEST_F(TftpLoggerTest, AsyncWriterKeepsEveryMessageInThreadOrder) {
+    TftpLogger& logger = TftpLogger::GetInstance();
+    logger.SetAsync(true);
+    ASSERT_TRUE(logger.IsAsync());
+    uint64_t dropped_before = logger.GetDroppedCount();
+
+    constexpr int kThreads = 4;
+    constexpr int kMessages = 50;  // Below the ring capacity, so nothing can be dropped
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < kMessages; ++i) {
+                TftpLogger::GetInstance().LogFormat(kLogInfo, "logger-test thread %d message %d", t, i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    logger.Flush();
+    EXPECT_EQ(logger.GetDroppedCount(), dropped_before);
+
+    std::vector<int> next(kThreads, 0);
+    for (const std::string& line : ReadLines()) {
+        int t = 0;
+        int i = 0;
+        size_t pos = line.find("logger-test thread ");
+        if (pos == std::string::npos) {
+            continue;
+        }
+        ASSERT_NE(line.find("[INFO]"), std::string::npos) << line;
+        ASSERT_EQ(std::sscanf(line.c_str() + pos, "logger-test thread %d message %d", &t, &i), 2) << line;
+        ASSERT_GE(t, 0);
+        ASSERT_LT(t, kThreads);
+        EXPECT_EQ(i, next[t]) << line;
+        next[t] = i + 1;
+    }
+    for (int t = 0; t < kThreads; ++t) {
+        EXPECT_EQ(next[t], kMessages);
+    }
+}
+
+TEST_F(TftpLoggerTest, FullRingDropsAndReports) {
+    TftpLogger& logger = TftpLogger::GetInstance();
+    logger.SetAsync(true, 4);
+    uint64_t dropped_before = logger.GetDroppedCount();
+
+    // A fresh thread gets a ring of the requested size
+    constexpr int kMessages = 2000;
+    std::thread producer([] {
+        for (int i = 0; i < kMessages; ++i) {
+            TftpLogger::GetInstance().LogFormat(kLogInfo, "logger-test burst %d", i);
+        }
+    });
+    producer.join();
+    logger.SetAsync(false);
+
+    uint64_t dropped = logger.GetDroppedCount() - dropped_before;
+    size_t written = 0;
+    bool reported = false;
+    for (const std::string& line : ReadLines()) {
+        written += line.find("logger-test burst ") != std::string::npos;
+        reported = reported || line.find("log messages dropped") != std::string::npos;
+    }
+    EXPECT_EQ(written + dropped, static_cast<uint64_t>(kMessages));
+    EXPECT_EQ(reported, dropped > 0);
+}
+
+TEST_F(TftpLoggerTest, HexDumpOnlyWhenLevelEnabled) {
+    TftpLogger& logger = TftpLogger::GetInstance();
+    const uint8_t ack[] = {0x00, 0x04, 0xbe, 0xef};
+
+    logger.SetLogLevel(kLogWarn);
+    logger.LogHexDump(kLogInfo, "hidden", ack, sizeof(ack));
+
+    logger.SetLogLevel(kLogInfo);
+    logger.LogHexDump(kLogInfo, "ack", ack, sizeof(ack));
+
+    std::vector<uint8_t> large(300, 0xab);
+    logger.LogHexDump(kLogInfo, "large", large.data(), large.size());
+
+    std::vector<std::string> lines = ReadLines();
+    ASSERT_FALSE(lines.empty());
+    for (const std::string& line : lines) {
+        EXPECT_EQ(line.find("hidden"), std::string::npos);
+    }
+    EXPECT_NE(lines[0].find("[INFO] ack (4 bytes): 00 04 be ef"), std::string::npos) << lines[0];
+
+    // 256 bytes shown in rows of 16, then the truncation marker
+    ASSERT_EQ(lines.size(), 2u + 16u);
+    EXPECT_NE(lines[1].find("large (300 bytes):"), std::string::npos);
+    EXPECT_EQ(lines[2], "ab ab ab ab ab ab ab ab ab ab ab ab ab ab ab ab");
+    EXPECT_NE(lines.back().find(" ..."), std::string::npos);
+}
@@ -0,0 +1,135 @@
+/**
+ * @file tftp_metrics_test.cpp
+ * @brief Unit tests for the metric histograms, sharded counters and the scrape endpoint
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_metrics_impl.h"
+#include "tftp/tftp_metrics.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+TEST(TftpHistogramTest, BucketsCoverTheirValues) {
+    // Every value falls in a bucket whose bound is at least the value and within 1/8 of it
+    for (uint64_t value : {0ull, 1ull, 7ull, 8ull, 9ull, 15ull, 16ull, 100ull, 1000ull, 123456ull, 1ull << 39}) {
+        size_t index = Histogram::BucketIndex(value);
+        ASSERT_LT(index, Histogram::kBucketCount);
+        uint64_t bound = Histogram::BucketUpperBound(index);
+        EXPECT_GE(bound, value);
+        EXPECT_LE(bound - value, value / 8) << value;
+        if (index > 0) {
+            EXPECT_LT(Histogram::BucketUpperBound(index - 1), value) << value;
+        }
+    }
+    EXPECT_EQ(Histogram::BucketIndex(~0ull), Histogram::kBucketCount - 1);
+}
+
+TEST(TftpHistogramTest, PercentilesFromSnapshot) {
+    Histogram histogram;
+    EXPECT_EQ(histogram.Snapshot().Percentile(50), 0u);
+
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value);
+    }
+    HistogramStats stats = histogram.Snapshot();
+    EXPECT_EQ(stats.count, 1000u);
+    EXPECT_EQ(stats.sum_us, 500500u);
+    EXPECT_EQ(stats.min_us, 1u);
+    EXPECT_EQ(stats.max_us, 1000u);
+
+    uint64_t p50 = stats.Percentile(50);
+    uint64_t p99 = stats.Percentile(99);
+    EXPECT_GE(p50, 500u);
+    EXPECT_LE(p50, 500u + 500u / 8);
+    EXPECT_GE(p99, 990u);
+    EXPECT_LE(p99, 1000u);
+    EXPECT_EQ(stats.Percentile(0), 1u);
+    EXPECT_EQ(stats.Percentile(100), 1000u);
+}
+
+TEST(TftpMetricsTest, ShardedCountersSumAcrossThreads) {
+    Metrics metrics;
+    constexpr int kThreads = 8;
+    constexpr int kIncrements = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&metrics] {
+            for (int i = 0; i < kIncrements; ++i) {
+                metrics.Add(Metrics::kPacketsSent);
+                metrics.Add(Metrics::kBytesSent, 512);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    metrics.Add(Metrics::kTransfersStarted, 3);
+    metrics.Add(Metrics::kTransfersCompleted);
+    metrics.CountError(ErrorCode::kFileNotFound);
+
+    ServerStats stats = metrics.Snapshot();
+    EXPECT_EQ(stats.packets_sent, static_cast<uint64_t>(kThreads) * kIncrements);
+    EXPECT_EQ(stats.bytes_sent, static_cast<uint64_t>(kThreads) * kIncrements * 512);
+    EXPECT_EQ(stats.active_sessions, 2u);
+    EXPECT_EQ(stats.errors[static_cast<size_t>(ErrorCode::kFileNotFound)], 1u);
+}
+
+TEST(TftpMetricsTest, PrometheusFormat) {
+    Metrics metrics;
+    metrics.Add(Metrics::kBytesSent, 4096);
+    metrics.CountError(ErrorCode::kAccessViolation);
+    metrics.AckRtt().Record(1500);
+    ServerStats stats = metrics.Snapshot();
+    stats.buffer_pool.reused = 12;
+
+    std::string text = FormatPrometheusMetrics(stats);
+    EXPECT_NE(text.find("# TYPE tftp_bytes_sent_total counter\ntftp_bytes_sent_total 4096\n"), std::string::npos);
+    EXPECT_NE(text.find("tftp_errors_total{code=\"access_violation\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE tftp_ack_rtt_seconds summary\n"), std::string::npos);
+    EXPECT_NE(text.find("tftp_ack_rtt_seconds{quantile=\"0.99\"} 0.001500\n"), std::string::npos);
+    EXPECT_NE(text.find("tftp_ack_rtt_seconds_count 1\n"), std::string::npos);
+    EXPECT_NE(text.find("tftp_transfer_duration_seconds_count 0\n"), std::string::npos);
+    EXPECT_NE(text.find("tftp_buffer_pool_reused_total 12\n"), std::string::npos);
+}
+
+#ifndef _WIN32
+TEST(TftpMetricsTest, EndpointServesRenderedText) {
+    MetricsEndpoint endpoint([] { return std::string("tftp_test_metric 42\n"); });
+    ASSERT_TRUE(endpoint.Start(0));
+    ASSERT_NE(endpoint.GetPort(), 0);
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(sock, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(endpoint.GetPort());
+    ASSERT_EQ(connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+
+    const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(send(sock, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+    std::string response;
+    char buffer[256];
+    ssize_t n;
+    while ((n = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, static_cast<size_t>(n));
+    }
+    close(sock);
+    endpoint.Stop();
+
+    EXPECT_EQ(response.compare(0, 15, "HTTP/1.0 200 OK"), 0) << response;
+    EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4\r\n"), std::string::npos);
+    EXPECT_NE(response.find("\r\n\r\ntftp_test_metric 42\n"), std::string::npos);
+}
+#endif
@@ -0,0 +1,249 @@
+/**
+ * @file tftp_multicast_test.cpp
+ * @brief Unit tests for the multicast group pool and the RFC 2090 transfer state machine
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_multicast.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+namespace {
+
+// Records every datagram with its destination, decoded back into packets
+class RecordingChannel : public TransferChannel {
+public:
+    struct Sent {
+        sockaddr_in to;
+        TftpPacket packet;
+    };
+
+    explicit RecordingChannel(const sockaddr_in& peer) : peer_(peer) {}
+
+    bool Send(const uint8_t* data, size_t size) override { return SendTo(peer_, data, size); }
+    bool SendTo(const sockaddr_in& addr, const uint8_t* data, size_t size) override {
+        TftpPacket packet;
+        EXPECT_TRUE(packet.Deserialize(data, size, kMaxBlockSize));
+        sent.push_back(Sent{addr, packet});
+        return true;
+    }
+
+    std::vector<Sent> sent;
+
+private:
+    sockaddr_in peer_;
+};
+
+class MemoryReadSource : public ReadSource {
+public:
+    explicit MemoryReadSource(size_t size) : data_(size) {
+        for (size_t i = 0; i < size; ++i) {
+            data_[i] = static_cast<uint8_t>(i);
+        }
+    }
+    bool Open(const std::string& path) override {
+        (void)path;
+        return true;
+    }
+    uint64_t Size() const override { return data_.size(); }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        bytes_read = offset >= data_.size() ? 0 : std::min<size_t>(length, data_.size() - offset);
+        std::memcpy(buffer, data_.data() + offset, bytes_read);
+        return true;
+    }
+    void Close() override {}
+
+private:
+    std::vector<uint8_t> data_;
+};
+
+sockaddr_in MakeAddress(uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+bool SameAddress(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+void Deliver(Transfer& transfer, const TftpPacket& packet, const sockaddr_in& from, Transfer::Clock::time_point now) {
+    std::vector<uint8_t> data = packet.Serialize();
+    PacketView view;
+    ASSERT_TRUE(view.Parse(data.data(), data.size(), kMaxBlockSize));
+    transfer.HandlePacket(view, from, now);
+}
+
+TransferConfig MakeConfig() {
+    TransferConfig config;
+    config.filepath = "kernel.img";
+    config.max_size = 1024 * 1024;
+    config.timeout_secs = 1;
+    return config;
+}
+
+class TftpMulticastTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(pool_.Configure("239.255.0.69", 1758, 2));
+        request_ = TftpPacket::CreateReadRequest("kernel.img", TransferMode::kOctet);
+        request_.SetOption("multicast", "");
+    }
+
+    // The multicast option value the transfer sent to a client in its last OACK
+    std::string LastOackFor(const RecordingChannel& channel, const sockaddr_in& client) {
+        for (auto it = channel.sent.rbegin(); it != channel.sent.rend(); ++it) {
+            if (SameAddress(it->to, client) && it->packet.GetOpCode() == OpCode::kOACK) {
+                return it->packet.GetOption("multicast");
+            }
+        }
+        return std::string();
+    }
+
+    MulticastGroupPool pool_;
+    TftpPacket request_;
+    sockaddr_in group_ = {};
+    sockaddr_in master_ = MakeAddress(40000);
+    sockaddr_in joiner_ = MakeAddress(40001);
+};
+
+} // namespace
+
+TEST(TftpMulticastRequestTest, DetectsOptionCaseInsensitively) {
+    TftpPacket request = TftpPacket::CreateReadRequest("kernel.img", TransferMode::kOctet);
+    EXPECT_FALSE(IsMulticastRequest(request));
+    request.SetOption("MultiCast", "");
+    EXPECT_TRUE(IsMulticastRequest(request));
+
+    std::vector<uint8_t> data = request.Serialize();
+    PacketView view;
+    ASSERT_TRUE(view.Parse(data.data(), data.size(), kMaxDataSize));
+    EXPECT_TRUE(IsMulticastRequest(view));
+
+    // The empty value is only accepted for the multicast option
+    TftpPacket parsed;
+    ASSERT_TRUE(parsed.Deserialize(data));
+    EXPECT_TRUE(IsMulticastRequest(parsed));
+}
+
+TEST_F(TftpMulticastTest, PoolHandsOutEachPortOnce) {
+    EXPECT_TRUE(pool_.IsEnabled());
+    MulticastGroupLease first = pool_.Acquire();
+    MulticastGroupLease second = pool_.Acquire();
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_FALSE(pool_.Acquire());
+    EXPECT_EQ(ntohs(first.Address().sin_port), 1758);
+    EXPECT_EQ(ntohs(second.Address().sin_port), 1759);
+
+    first.Release();
+    MulticastGroupLease again = pool_.Acquire();
+    ASSERT_TRUE(again);
+    EXPECT_EQ(ntohs(again.Address().sin_port), 1758);
+
+    EXPECT_FALSE(pool_.Configure("10.0.0.1", 1758, 1));
+    EXPECT_TRUE(pool_.Configure("", 0, 0));
+    EXPECT_FALSE(pool_.IsEnabled());
+    EXPECT_FALSE(pool_.Acquire());
+}
+
+TEST_F(TftpMulticastTest, LateJoinerCatchesUpAsMaster) {
+    auto now = Transfer::Clock::now();
+    RecordingChannel channel(master_);
+    MulticastGroupLease lease = pool_.Acquire();
+    group_ = lease.Address();
+    MulticastTransfer transfer(channel, master_, MakeConfig(), request_, std::make_unique<MemoryReadSource>(1200),
+                               std::move(lease));
+    transfer.Start(now);
+    EXPECT_EQ(LastOackFor(channel, master_), "239.255.0.69,1758,1");
+
+    // The master's ACK of the OACK starts the group stream
+    Deliver(transfer, TftpPacket::CreateAck(0), master_, now);
+    ASSERT_EQ(channel.sent.size(), 2u);
+    EXPECT_TRUE(SameAddress(channel.sent[1].to, group_));
+    EXPECT_EQ(channel.sent[1].packet.GetBlockNumber(), 1);
+
+    // A second client joins after block 1 and is not the master
+    ASSERT_TRUE(transfer.Join(joiner_));
+    EXPECT_EQ(LastOackFor(channel, joiner_), "239.255.0.69,1758,0");
+    EXPECT_EQ(transfer.GetMemberCount(), 2u);
+
+    // ACKs from a non-master are not answered, nor are duplicate ACKs
+    size_t sent = channel.sent.size();
+    Deliver(transfer, TftpPacket::CreateAck(1), joiner_, now);
+    Deliver(transfer, TftpPacket::CreateAck(0), master_, now);
+    EXPECT_EQ(channel.sent.size(), sent);
+
+    Deliver(transfer, TftpPacket::CreateAck(1), master_, now);
+    Deliver(transfer, TftpPacket::CreateAck(2), master_, now);
+    ASSERT_EQ(channel.sent.back().packet.GetBlockNumber(), 3);
+    EXPECT_EQ(channel.sent.back().packet.GetData().size(), 176u);
+
+    // The master finishes; the joiner is promoted and asks for the block it missed
+    Deliver(transfer, TftpPacket::CreateAck(3), master_, now);
+    EXPECT_FALSE(transfer.IsFinished());
+    EXPECT_EQ(LastOackFor(channel, joiner_), "239.255.0.69,1758,1");
+    Deliver(transfer, TftpPacket::CreateAck(0), joiner_, now);
+    EXPECT_TRUE(SameAddress(channel.sent.back().to, group_));
+    EXPECT_EQ(channel.sent.back().packet.GetBlockNumber(), 1);
+
+    // It already holds blocks 2 and 3 from the group stream
+    Deliver(transfer, TftpPacket::CreateAck(3), joiner_, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+TEST_F(TftpMulticastTest, SilentMasterIsReplaced) {
+    auto now = Transfer::Clock::now();
+    RecordingChannel channel(master_);
+    MulticastTransfer transfer(channel, master_, MakeConfig(), request_, std::make_unique<MemoryReadSource>(100),
+                               pool_.Acquire());
+    transfer.Start(now);
+    Deliver(transfer, TftpPacket::CreateAck(0), master_, now);
+    ASSERT_TRUE(transfer.Join(joiner_));
+
+    // Block 1 is resent to the group until the master's retry budget runs out
+    int timeouts = 0;
+    while (LastOackFor(channel, joiner_) != "239.255.0.69,1758,1" && timeouts < 100) {
+        transfer.OnTimeout(transfer.Deadline());
+        timeouts++;
+    }
+    ASSERT_LT(timeouts, 100);
+    EXPECT_EQ(transfer.GetMemberCount(), 1u);
+
+    // A packet from the dropped master is now from an unknown transfer ID
+    Deliver(transfer, TftpPacket::CreateAck(1), master_, now);
+    EXPECT_FALSE(transfer.IsFinished());
+
+    Deliver(transfer, TftpPacket::CreateAck(1), joiner_, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+TEST_F(TftpMulticastTest, MemberLeavesWithError) {
+    auto now = Transfer::Clock::now();
+    RecordingChannel channel(master_);
+    MulticastTransfer transfer(channel, master_, MakeConfig(), request_, std::make_unique<MemoryReadSource>(100),
+                               pool_.Acquire());
+    transfer.Start(now);
+    ASSERT_TRUE(transfer.Join(joiner_));
+
+    Deliver(transfer, TftpPacket::CreateError(ErrorCode::kNotDefined, "bye"), joiner_, now);
+    EXPECT_EQ(transfer.GetMemberCount(), 1u);
+
+    // The last member leaving ends the transfer without a completed client
+    Deliver(transfer, TftpPacket::CreateError(ErrorCode::kNotDefined, "bye"), master_, now);
+    EXPECT_TRUE(transfer.IsFinished());
+    EXPECT_FALSE(transfer.Succeeded());
+}
@@ -0,0 +1,230 @@
+/**
+ * @file tftp_netascii_test.cpp
+ * @brief Unit tests for the netascii translation stage
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_netascii.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+namespace {
+
+// Byte-at-a-time translation the vectorized code must agree with
+std::vector<uint8_t> ReferenceEncode(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> out;
+    for (uint8_t byte : data) {
+        if (byte == '\n') {
+            out.push_back('\r');
+            out.push_back('\n');
+        } else if (byte == '\r') {
+            out.push_back('\r');
+            out.push_back(0);
+        } else {
+            out.push_back(byte);
+        }
+    }
+    return out;
+}
+
+// Text-like content with line breaks, bare CRs and NULs at random places
+std::vector<uint8_t> MakeText(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, 99);
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        int roll = pick(rng);
+        data[i] = roll < 4 ? '\n' : roll < 6 ? '\r' : roll < 7 ? 0 : static_cast<uint8_t>('a' + roll % 26);
+    }
+    return data;
+}
+
+class MemoryReadSource : public ReadSource {
+public:
+    explicit MemoryReadSource(std::vector<uint8_t> data, bool lend = false) : data_(std::move(data)), lend_(lend) {}
+    bool Open(const std::string& path) override {
+        (void)path;
+        return true;
+    }
+    uint64_t Size() const override { return data_.size(); }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        reads++;
+        bytes_read = offset >= data_.size() ? 0 : std::min<size_t>(length, data_.size() - offset);
+        std::memcpy(buffer, data_.data() + offset, bytes_read);
+        return true;
+    }
+    const uint8_t* PeekAt(uint64_t offset, size_t length) override {
+        EXPECT_LE(offset + length, data_.size());
+        return lend_ ? data_.data() + offset : nullptr;
+    }
+    void Close() override {}
+
+    int reads = 0;
+
+private:
+    std::vector<uint8_t> data_;
+    bool lend_;
+};
+
+class MemoryWriteSink : public WriteSink {
+public:
+    bool Open(const std::string& path, uint64_t size_hint) override {
+        (void)path;
+        hint = size_hint;
+        return true;
+    }
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override {
+        EXPECT_EQ(offset, this->data.size());
+        this->data.insert(this->data.end(), data, data + length);
+        return true;
+    }
+    bool Commit() override {
+        committed = true;
+        return true;
+    }
+    void Abort() override {}
+
+    std::vector<uint8_t> data;
+    uint64_t hint = 0;
+    bool committed = false;
+};
+
+} // namespace
+
+TEST(TftpNetAsciiTest, ScansFindEveryPosition) {
+    // Covers the vector loops, their tails and hits straddling the 16-byte halves
+    for (size_t length = 0; length < 80; ++length) {
+        std::vector<uint8_t> data(length, 'x');
+        EXPECT_EQ(FindLineBreak(data.data(), length), length);
+        EXPECT_EQ(CountLineBreaks(data.data(), length), 0u);
+        for (size_t hit = 0; hit < length; ++hit) {
+            data[hit] = (hit % 2) ? '\r' : '\n';
+            EXPECT_EQ(FindLineBreak(data.data(), length), hit) << length << " " << hit;
+            EXPECT_EQ(FindCarriageReturn(data.data(), length), (hit % 2) ? hit : length);
+            EXPECT_EQ(CountLineBreaks(data.data(), length), 1u);
+            data[hit] = 'x';
+        }
+    }
+
+    // Long enough for the vector counters to be folded several times
+    std::vector<uint8_t> text = MakeText(100000, 7);
+    uint64_t expected = std::count(text.begin(), text.end(), '\n') + std::count(text.begin(), text.end(), '\r');
+    EXPECT_EQ(CountLineBreaks(text.data(), text.size()), expected);
+    std::vector<uint8_t> breaks(70000, '\n');
+    EXPECT_EQ(CountLineBreaks(breaks.data(), breaks.size()), 70000u);
+}
+
+TEST(TftpNetAsciiTest, EncoderHandlesAnySplit) {
+    std::vector<uint8_t> text = MakeText(3000, 1);
+    std::vector<uint8_t> expected = ReferenceEncode(text);
+
+    // Output limits of every size, so pairs are split at every possible point
+    for (size_t capacity = 1; capacity <= 37; ++capacity) {
+        NetAsciiEncoder encoder;
+        std::vector<uint8_t> out;
+        std::vector<uint8_t> chunk(capacity);
+        size_t position = 0;
+        while (out.size() < expected.size()) {
+            size_t consumed = 0;
+            size_t input = std::min<size_t>(text.size() - position, 5);
+            size_t produced = encoder.Encode(text.data() + position, input, chunk.data(), capacity, consumed);
+            ASSERT_GT(produced, 0u);
+            position += consumed;
+            out.insert(out.end(), chunk.begin(), chunk.begin() + produced);
+        }
+        EXPECT_EQ(position, text.size());
+        EXPECT_EQ(out, expected) << "Capacity " << capacity;
+    }
+}
+
+TEST(TftpNetAsciiTest, DecoderHandlesAnySplit) {
+    std::vector<uint8_t> text = MakeText(3000, 2);
+    text.push_back('\r');  // A CR that ends the stream is only resolved by Finish
+    std::vector<uint8_t> wire = ReferenceEncode(text);
+
+    for (size_t block = 1; block <= 33; ++block) {
+        NetAsciiDecoder decoder;
+        std::vector<uint8_t> out;
+        std::vector<uint8_t> buffer(block + 1);
+        for (size_t i = 0; i < wire.size(); i += block) {
+            size_t length = std::min(block, wire.size() - i);
+            size_t produced = decoder.Decode(wire.data() + i, length, buffer.data());
+            out.insert(out.end(), buffer.begin(), buffer.begin() + produced);
+        }
+        size_t produced = decoder.Finish(buffer.data());
+        out.insert(out.end(), buffer.begin(), buffer.begin() + produced);
+        EXPECT_EQ(out, text) << "Block " << block;
+    }
+
+    // A CR followed by anything else is not netascii and is kept
+    const uint8_t invalid[] = {'a', '\r', 'b', '\r', '\r', '\n'};
+    NetAsciiDecoder decoder;
+    uint8_t out[sizeof(invalid) + 1];
+    size_t produced = decoder.Decode(invalid, sizeof(invalid), out);
+    EXPECT_EQ(std::vector<uint8_t>(out, out + produced), std::vector<uint8_t>({'a', '\r', 'b', '\r', '\n'}));
+}
+
+TEST(TftpNetAsciiTest, ReadSourceServesTranslatedBlocks) {
+    std::vector<uint8_t> text = MakeText(3 * NetAsciiReadSource::kChunkSize + 1234, 3);
+    std::vector<uint8_t> expected = ReferenceEncode(text);
+
+    for (bool lend : {false, true}) {
+        auto memory = std::make_unique<MemoryReadSource>(text, lend);
+        MemoryReadSource* inner = memory.get();
+        NetAsciiReadSource source(std::move(memory));
+        uint64_t stat_size = 0;
+        EXPECT_FALSE(source.Stat("text.txt", stat_size));
+        ASSERT_TRUE(source.Open("text.txt"));
+        ASSERT_EQ(source.Size(), expected.size());
+
+        // Sequential blocks, as a transfer reads them
+        const size_t block = 512;
+        std::vector<uint8_t> out;
+        std::vector<uint8_t> buffer(block);
+        for (uint64_t offset = 0;; offset += block) {
+            size_t bytes_read = 0;
+            ASSERT_TRUE(source.ReadAt(offset, buffer.data(), block, bytes_read));
+            out.insert(out.end(), buffer.begin(), buffer.begin() + bytes_read);
+            if (bytes_read < block) {
+                break;
+            }
+        }
+        EXPECT_EQ(out, expected);
+
+        // Retransmissions jump back, possibly into the middle of a CR LF pair
+        for (uint64_t offset : {uint64_t(0), uint64_t(expected.size() / 2), uint64_t(70001), uint64_t(3),
+                                uint64_t(expected.size() - 100)}) {
+            size_t bytes_read = 0;
+            ASSERT_TRUE(source.ReadAt(offset, buffer.data(), block, bytes_read));
+            size_t available = static_cast<size_t>(std::min<uint64_t>(block, expected.size() - offset));
+            ASSERT_EQ(bytes_read, available);
+            EXPECT_TRUE(std::equal(buffer.begin(), buffer.begin() + bytes_read, expected.begin() + offset))
+                << "Offset " << offset;
+        }
+        EXPECT_EQ(inner->reads > 0, !lend);
+        source.Close();
+    }
+}
+
+TEST(TftpNetAsciiTest, WriteSinkStoresFileBytes) {
+    std::vector<uint8_t> text = MakeText(5000, 4);
+    text.push_back('\r');
+    std::vector<uint8_t> wire = ReferenceEncode(text);
+
+    MemoryWriteSink memory;
+    NetAsciiWriteSink sink(memory);
+    ASSERT_TRUE(sink.Open("upload.txt", wire.size()));
+    EXPECT_EQ(memory.hint, wire.size());
+    for (size_t i = 0; i <= wire.size(); i += 512) {
+        size_t length = std::min<size_t>(512, wire.size() - i);
+        ASSERT_TRUE(sink.Write(i, wire.data() + i, length));
+    }
+    ASSERT_TRUE(sink.Commit());
+    EXPECT_TRUE(memory.committed);
+    EXPECT_EQ(memory.data, text);
+}
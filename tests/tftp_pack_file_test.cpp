@@ -0,0 +1,159 @@
+/**
+ * @file tftp_pack_file_test.cpp
+ * @brief Unit tests for PackFile, BuildPackFile and PackReadSource
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_pack_file.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+class TftpPackFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::remove_all(kTestDir);
+        std::filesystem::create_directories(std::string(kTestDir) + "/tree");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(kTestDir);
+    }
+
+    // Writes a file of the test tree; contents are derived from the name
+    void WriteTreeFile(const std::string& name, size_t size) {
+        std::filesystem::path path = std::filesystem::path(kTestDir) / "tree" / name;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(Contents(name, size).data(), static_cast<std::streamsize>(size));
+    }
+
+    static std::string Contents(const std::string& name, size_t size) {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(name.size() * 7 + i * 13 + (i >> 8));
+        }
+        return data;
+    }
+
+    std::string Tree() const { return std::string(kTestDir) + "/tree"; }
+    std::string PackPath() const { return std::string(kTestDir) + "/boot.pack"; }
+
+    static constexpr const char* kTestDir = "./pack_file_test_files";
+};
+
+TEST_F(TftpPackFileTest, FindsEveryPackedFile) {
+    std::vector<std::pair<std::string, size_t>> files;
+    for (size_t i = 0; i < 500; ++i) {
+        files.emplace_back("hosts/01-00-11-22-33-" + std::to_string(i), i % 37);
+    }
+    files.emplace_back("pxelinux.cfg/default", 3000);
+    files.emplace_back("modules/big.c32", 70000);
+    for (const auto& file : files) {
+        WriteTreeFile(file.first, file.second);
+    }
+
+    size_t file_count = 0;
+    ASSERT_TRUE(BuildPackFile(Tree(), PackPath(), file_count));
+    EXPECT_EQ(file_count, files.size());
+    EXPECT_FALSE(std::filesystem::exists(PackPath() + ".tmp"));
+
+    auto pack = PackFile::Open(PackPath());
+    ASSERT_NE(pack, nullptr);
+    EXPECT_EQ(pack->GetFileCount(), files.size());
+    for (const auto& file : files) {
+        PackFile::Entry entry;
+        ASSERT_TRUE(pack->Find(file.first, entry)) << file.first;
+        ASSERT_EQ(entry.size, file.second);
+        EXPECT_EQ(std::memcmp(entry.data, Contents(file.first, file.second).data(), file.second), 0) << file.first;
+    }
+
+    PackFile::Entry entry;
+    EXPECT_FALSE(pack->Find("pxelinux.cfg/missing", entry));
+    EXPECT_FALSE(pack->Find("pxelinux.cfg", entry));
+    EXPECT_FALSE(pack->Find("", entry));
+}
+
+TEST_F(TftpPackFileTest, EmptyTreeMakesEmptyPack) {
+    size_t file_count = 1;
+    ASSERT_TRUE(BuildPackFile(Tree(), PackPath(), file_count));
+    EXPECT_EQ(file_count, 0u);
+    auto pack = PackFile::Open(PackPath());
+    ASSERT_NE(pack, nullptr);
+    PackFile::Entry entry;
+    EXPECT_FALSE(pack->Find("anything", entry));
+}
+
+TEST_F(TftpPackFileTest, RejectsInvalidPacks) {
+    EXPECT_EQ(PackFile::Open(std::string(kTestDir) + "/missing.pack"), nullptr);
+
+    {
+        std::ofstream file(PackPath(), std::ios::binary | std::ios::trunc);
+        file << "this is not a pack file, only some text that is long enough for a header";
+    }
+    EXPECT_EQ(PackFile::Open(PackPath()), nullptr);
+
+    // A pack cut short ends its tables past the end of the file
+    for (size_t i = 0; i < 20; ++i) {
+        WriteTreeFile("file" + std::to_string(i), 10);
+    }
+    size_t file_count = 0;
+    ASSERT_TRUE(BuildPackFile(Tree(), PackPath(), file_count));
+    std::filesystem::resize_file(PackPath(), 200);
+    EXPECT_EQ(PackFile::Open(PackPath()), nullptr);
+}
+
+TEST_F(TftpPackFileTest, NormalizesRequestedNames) {
+    std::string name;
+    EXPECT_TRUE(PackFile::NormalizeName("pxelinux.cfg\\default", true, name));
+    EXPECT_EQ(name, "pxelinux.cfg/default");
+    EXPECT_TRUE(PackFile::NormalizeName("boot//menu///main.cfg", true, name));
+    EXPECT_EQ(name, "boot/menu/main.cfg");
+
+    EXPECT_FALSE(PackFile::NormalizeName("../etc/passwd", true, name));
+    EXPECT_FALSE(PackFile::NormalizeName("/etc/passwd", true, name));
+    EXPECT_FALSE(PackFile::NormalizeName("", false, name));
+    EXPECT_TRUE(PackFile::NormalizeName("../etc/passwd", false, name));
+}
+
+TEST_F(TftpPackFileTest, SourceLendsBlocksFromMapping) {
+    WriteTreeFile("kernel.img", 5000);
+    size_t file_count = 0;
+    ASSERT_TRUE(BuildPackFile(Tree(), PackPath(), file_count));
+    auto pack = PackFile::Open(PackPath());
+    ASSERT_NE(pack, nullptr);
+    const std::string expected = Contents("kernel.img", 5000);
+
+    PackReadSource source(pack);
+    uint64_t size = 0;
+    ASSERT_TRUE(source.Stat("kernel.img", size));
+    EXPECT_EQ(size, 5000u);
+    EXPECT_FALSE(source.Stat("other.img", size));
+    EXPECT_FALSE(source.Open("other.img"));
+    ASSERT_TRUE(source.Open("kernel.img"));
+    ASSERT_EQ(source.Size(), 5000u);
+
+    const uint8_t* block = source.PeekAt(4096, 512);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(std::memcmp(block, expected.data() + 4096, 512), 0);
+    EXPECT_EQ(source.PeekAt(4608, 512), nullptr);
+
+    std::vector<uint8_t> buffer(512);
+    size_t bytes_read = 0;
+    ASSERT_TRUE(source.ReadAt(4608, buffer.data(), buffer.size(), bytes_read));
+    ASSERT_EQ(bytes_read, 5000u - 4608u);
+    EXPECT_EQ(std::memcmp(buffer.data(), expected.data() + 4608, bytes_read), 0);
+    ASSERT_TRUE(source.ReadAt(5000, buffer.data(), buffer.size(), bytes_read));
+    EXPECT_EQ(bytes_read, 0u);
+
+    // The source keeps the mapping alive after the pack itself is released
+    pack.reset();
+    ASSERT_TRUE(source.ReadAt(0, buffer.data(), buffer.size(), bytes_read));
+    EXPECT_EQ(std::memcmp(buffer.data(), expected.data(), bytes_read), 0);
+    source.Close();
+}
@@ -553,6 +553,40 @@ TEST_F(TftpPacketSecurityTest, ProtocolCompliance_ValidOptionCombinations) {
     TestDeserializationSuccess(max_options_packet, "RRQ with maximum allowed options (16)");
 }
 
+TEST_F(TftpPacketSecurityTest, ProtocolCompliance_NegotiatedBlockSize) {
+    // DATA payloads larger than 512 bytes are only valid after blksize negotiation (RFC 2348)
+    const size_t negotiated_block_size = 1428;
+    
+    std::vector<uint8_t> payload = {0x00, 0x01};  // Block number
+    payload.resize(payload.size() + negotiated_block_size, 0x5A);
+    std::vector<uint8_t> data_packet = CreateRawPacket(static_cast<uint16_t>(OpCode::kData), payload);
+    
+    TestDeserializationFailure(data_packet, "1428-byte DATA payload without negotiated block size");
+    
+    TftpPacket packet;
+    ASSERT_TRUE(packet.Deserialize(data_packet.data(), data_packet.size(), negotiated_block_size))
+        << "DATA payload at the negotiated block size should deserialize";
+    EXPECT_EQ(packet.GetBlockNumber(), 1);
+    EXPECT_EQ(packet.GetData().size(), negotiated_block_size);
+    
+    // One byte over the negotiated block size must be rejected
+    data_packet.push_back(0x5A);
+    EXPECT_FALSE(packet.Deserialize(data_packet.data(), data_packet.size(), negotiated_block_size))
+        << "DATA payload larger than the negotiated block size should be rejected";
+    
+    // Out-of-range block sizes are rejected outright
+    EXPECT_FALSE(packet.Deserialize(data_packet.data(), data_packet.size(), kMaxBlockSize + 1));
+    
+    // A small block size does not shrink the limit for non-DATA packets
+    std::vector<uint8_t> error_payload = {0x00, 0x01};
+    std::string message(100, 'E');
+    error_payload.insert(error_payload.end(), message.begin(), message.end());
+    error_payload.push_back(0);
+    std::vector<uint8_t> error_packet = CreateRawPacket(static_cast<uint16_t>(OpCode::kError), error_payload);
+    EXPECT_TRUE(packet.Deserialize(error_packet.data(), error_packet.size(), kMinBlockSize));
+    EXPECT_EQ(packet.GetOpCode(), OpCode::kError);
+}
+
 // ============================================================================
 // COMPREHENSIVE SECURITY VERIFICATION TESTS
 // ============================================================================
@@ -0,0 +1,165 @@
+/**
+ * @file tftp_packet_view_test.cpp
+ * @brief Unit tests for PacketView and the allocation-free encoders
+ */
+
+#include <gtest/gtest.h>
+#include <tftp/tftp_packet.h>
+#include <tftp/tftp_packet_view.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tftpserver;
+
+namespace {
+
+std::vector<uint8_t> Bytes(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+} // namespace
+
+TEST(TftpPacketViewTest, ParsesRequestWithOptions) {
+    TftpPacket request = TftpPacket::CreateReadRequest("boot/kernel.img", TransferMode::kOctet);
+    request.SetOption("blksize", "1428");
+    request.SetOption("windowsize", "16");
+    std::vector<uint8_t> data = request.Serialize();
+
+    PacketView view;
+    ASSERT_TRUE(view.Parse(data.data(), data.size()));
+    EXPECT_EQ(view.GetOpCode(), OpCode::kReadRequest);
+    EXPECT_EQ(view.GetFilename(), "boot/kernel.img");
+    EXPECT_EQ(view.GetMode(), TransferMode::kOctet);
+    EXPECT_EQ(view.GetOptionCount(), 2u);
+    EXPECT_TRUE(view.HasOption("blksize"));
+    EXPECT_EQ(view.GetOption("windowsize"), "16");
+    EXPECT_FALSE(view.HasOption("tsize"));
+    EXPECT_TRUE(view.GetOption("tsize").empty());
+}
+
+TEST(TftpPacketViewTest, ModeIsCaseInsensitive) {
+    std::vector<uint8_t> data = Bytes(std::string("\0\2file\0NetASCII\0", 16));
+    PacketView view;
+    ASSERT_TRUE(view.Parse(data.data(), data.size()));
+    EXPECT_EQ(view.GetOpCode(), OpCode::kWriteRequest);
+    EXPECT_EQ(view.GetMode(), TransferMode::kNetAscii);
+
+    data = Bytes(std::string("\0\2file\0binary\0", 14));
+    EXPECT_FALSE(view.Parse(data.data(), data.size()));
+}
+
+TEST(TftpPacketViewTest, RepeatedOptionResolvesToLast) {
+    std::vector<uint8_t> data = Bytes(std::string("\0\1f\0octet\0blksize\0" "512\0blksize\0" "1024\0", 35));
+    PacketView view;
+    ASSERT_TRUE(view.Parse(data.data(), data.size()));
+    EXPECT_EQ(view.GetOptionCount(), 2u);
+    EXPECT_EQ(view.GetOption("blksize"), "1024");
+
+    TftpPacket packet;
+    ASSERT_TRUE(packet.Deserialize(data));
+    EXPECT_EQ(packet.GetOption("blksize"), "1024");
+}
+
+TEST(TftpPacketViewTest, DataPayloadPointsIntoBuffer) {
+    std::vector<uint8_t> payload(1024, 0x5A);
+    std::vector<uint8_t> data = TftpPacket::CreateData(7, payload).Serialize();
+
+    PacketView view;
+    ASSERT_TRUE(view.Parse(data.data(), data.size(), 1024));
+    EXPECT_EQ(view.GetOpCode(), OpCode::kData);
+    EXPECT_EQ(view.GetBlockNumber(), 7);
+    EXPECT_EQ(view.GetPayload(), data.data() + codec::kHeaderSize);
+    EXPECT_EQ(view.GetPayloadSize(), 1024u);
+
+    // The same payload exceeds the default block size
+    EXPECT_FALSE(view.Parse(data.data(), data.size()));
+    EXPECT_FALSE(view.Parse(data.data(), data.size(), 1000));
+}
+
+TEST(TftpPacketViewTest, RejectsMalformedPackets) {
+    PacketView view;
+    const std::vector<std::string> malformed = {
+        std::string("\0\4\0", 3),                                // Shorter than a header
+        std::string("\0\4\0\1\0", 5),                            // ACK with trailing byte
+        std::string("\0\11\0\1", 4),                             // Unknown opcode
+        std::string("\0\1file", 6),                              // Unterminated filename
+        std::string("\0\1\0octet\0", 9),                         // Empty filename
+        std::string("\0\1file\0octet\0blksize", 20),             // Unterminated option name
+        std::string("\0\1file\0octet\0blksize\0\0", 22),         // Empty option value
+        std::string("\0\5\0\10oops\0", 9),                       // Error code out of range
+        std::string("\0\5\0\1oops", 8),                          // Unterminated error message
+    };
+    for (const std::string& packet : malformed) {
+        std::vector<uint8_t> data = Bytes(packet);
+        EXPECT_FALSE(view.Parse(data.data(), data.size())) << "packet size " << packet.size();
+    }
+}
+
+TEST(TftpPacketViewTest, EnforcesStringAndOptionLimits) {
+    PacketView view;
+
+    std::string filename(kMaxFilenameLength, 'a');
+    std::vector<uint8_t> data = Bytes(std::string("\0\1", 2) + filename + std::string("\0octet\0", 7));
+    EXPECT_TRUE(view.Parse(data.data(), data.size()));
+    data = Bytes(std::string("\0\1", 2) + filename + std::string("a\0octet\0", 8));
+    EXPECT_FALSE(view.Parse(data.data(), data.size()));
+
+    std::string options;
+    for (size_t i = 0; i < kMaxOptionsCount; ++i) {
+        options += "opt" + std::to_string(i) + std::string("\0" "1\0", 3);
+    }
+    data = Bytes(std::string("\0\1f\0octet\0", 10) + options);
+    EXPECT_TRUE(view.Parse(data.data(), data.size()));
+    EXPECT_EQ(view.GetOptionCount(), kMaxOptionsCount);
+    data = Bytes(std::string("\0\1f\0octet\0", 10) + options + std::string("extra\0" "1\0", 8));
+    EXPECT_FALSE(view.Parse(data.data(), data.size()));
+}
+
+TEST(TftpPacketViewTest, AgreesWithTftpPacketOnRandomInput) {
+    std::mt19937 rng(1350);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<size_t> length(0, 80);
+    const char alphabet[] = {'\0', 'a', 'o', 'c', 't', 'e', '1'};
+
+    for (int i = 0; i < 5000; ++i) {
+        std::vector<uint8_t> data(length(rng));
+        for (size_t j = 0; j < data.size(); ++j) {
+            // Mostly printable bytes and terminators so that request bodies are reached
+            if (j == 0) {
+                data[j] = 0;
+            } else if (j == 1) {
+                data[j] = static_cast<uint8_t>(byte(rng) % 8);
+            } else {
+                data[j] = static_cast<uint8_t>(alphabet[byte(rng) % sizeof(alphabet)]);
+            }
+        }
+        TftpPacket packet;
+        PacketView view;
+        bool expected = packet.Deserialize(data.data(), data.size(), kMaxDataSize);
+        ASSERT_EQ(view.Parse(data.data(), data.size()), expected) << "iteration " << i;
+        if (expected) {
+            EXPECT_EQ(view.GetOpCode(), packet.GetOpCode());
+            EXPECT_EQ(view.GetBlockNumber(), packet.GetBlockNumber());
+            EXPECT_EQ(std::string(view.GetFilename()), packet.GetFilename());
+        }
+    }
+}
+
+TEST(TftpPacketViewTest, EncodersMatchTftpPacket) {
+    uint8_t buffer[600];
+
+    size_t size = codec::EncodeAck(buffer, 0xBEEF);
+    EXPECT_EQ(std::vector<uint8_t>(buffer, buffer + size), TftpPacket::CreateAck(0xBEEF).Serialize());
+
+    size = codec::EncodeError(buffer, sizeof(buffer), ErrorCode::kDiskFull, "Disk full");
+    EXPECT_EQ(std::vector<uint8_t>(buffer, buffer + size),
+              TftpPacket::CreateError(ErrorCode::kDiskFull, "Disk full").Serialize());
+    EXPECT_EQ(codec::EncodeError(buffer, 8, ErrorCode::kDiskFull, "Disk full"), 0u);
+
+    std::vector<uint8_t> payload = {1, 2, 3};
+    std::copy(payload.begin(), payload.end(), buffer + codec::kHeaderSize);
+    codec::EncodeDataHeader(buffer, 65535);
+    EXPECT_EQ(std::vector<uint8_t>(buffer, buffer + codec::kHeaderSize + payload.size()),
+              TftpPacket::CreateData(65535, payload).Serialize());
+}
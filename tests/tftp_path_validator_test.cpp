@@ -0,0 +1,151 @@
+/**
+ * @file tftp_path_validator_test.cpp
+ * @brief Unit tests for PathValidator name screening and its resolution cache
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_path_validator.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver::internal;
+
+namespace {
+
+constexpr const char* kRootDir = "./path_validator_root";
+
+class TftpPathValidatorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::create_directories(std::string(kRootDir) + "/sub");
+        std::ofstream(std::string(kRootDir) + "/sub/file.bin") << "data";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(kRootDir);
+    }
+};
+
+} // namespace
+
+TEST(TftpPathNameTest, ScreensNamesInOnePass) {
+    EXPECT_TRUE(PathValidator::IsSafeName("file.txt"));
+    EXPECT_TRUE(PathValidator::IsSafeName("deep/nested/file.with.dots"));
+    EXPECT_TRUE(PathValidator::IsSafeName("."));
+
+    for (const char* name : {"", "..", "../etc/passwd", "a/../b", "./file", "a\\.\\b", ".\\file", "~root",
+                             "$HOME", "100%", "a<b", "a>b", "a|b", "what?", "*.bin", "/etc/passwd"}) {
+        EXPECT_FALSE(PathValidator::IsSafeName(name)) << name;
+    }
+    EXPECT_FALSE(PathValidator::IsSafeName(std::string("file\0.txt", 9)));
+}
+
+TEST_F(TftpPathValidatorTest, ResolvesWithinRoot) {
+    PathValidator validator;
+    ASSERT_TRUE(validator.SetRoot(kRootDir));
+
+    std::string resolved;
+    ASSERT_TRUE(validator.Resolve("sub/file.bin", true, resolved));
+    EXPECT_EQ(std::filesystem::path(resolved),
+              std::filesystem::weakly_canonical(std::filesystem::path(kRootDir) / "sub/file.bin"));
+    // Files that do not exist yet (uploads) resolve as well
+    EXPECT_TRUE(validator.Resolve("sub/new.bin", true, resolved));
+
+    // The root itself is not servable; insecure mode skips only the name screening
+    EXPECT_FALSE(validator.Resolve(".", true, resolved));
+    EXPECT_FALSE(validator.Resolve("../outside", true, resolved));
+    EXPECT_TRUE(validator.Resolve("../outside", false, resolved));
+}
+
+TEST_F(TftpPathValidatorTest, CachesResolutions) {
+    PathValidator validator(2);
+    ASSERT_TRUE(validator.SetRoot(kRootDir));
+
+    std::string first;
+    std::string second;
+    ASSERT_TRUE(validator.Resolve("sub/file.bin", true, first));
+    ASSERT_TRUE(validator.Resolve("sub/file.bin", true, second));
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(validator.GetCacheMisses(), 1u);
+    EXPECT_EQ(validator.GetCacheHits(), 1u);
+
+    // Least recently used entries are evicted at capacity
+    ASSERT_TRUE(validator.Resolve("a.bin", true, first));
+    ASSERT_TRUE(validator.Resolve("b.bin", true, first));
+    EXPECT_EQ(validator.GetCacheSize(), 2u);
+    ASSERT_TRUE(validator.Resolve("sub/file.bin", true, first));
+    EXPECT_EQ(validator.GetCacheMisses(), 4u);
+
+    validator.Invalidate();
+    EXPECT_EQ(validator.GetCacheSize(), 0u);
+}
+
+TEST_F(TftpPathValidatorTest, ShardedCacheFromManyThreads) {
+    PathValidator validator(PathValidator::kMinShardEntries * PathValidator::kMaxShards);
+    ASSERT_TRUE(validator.SetRoot(kRootDir));
+
+    constexpr int kThreads = 4;
+    constexpr int kNames = 64;
+    std::vector<std::thread> threads;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&]() {
+            std::string resolved;
+            for (int round = 0; round < 2; ++round) {
+                for (int i = 0; i < kNames; ++i) {
+                    if (!validator.Resolve("file" + std::to_string(i) + ".bin", true, resolved)) {
+                        failures++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(validator.GetCacheSize(), static_cast<size_t>(kNames));
+    EXPECT_EQ(validator.GetCacheHits() + validator.GetCacheMisses(), static_cast<uint64_t>(kThreads * kNames * 2));
+    EXPECT_GE(validator.GetCacheHits(), static_cast<uint64_t>(kThreads * kNames));
+
+    // Invalidation and a new root reach every shard
+    validator.Invalidate();
+    EXPECT_EQ(validator.GetCacheSize(), 0u);
+    std::string resolved;
+    ASSERT_TRUE(validator.Resolve("sub/file.bin", true, resolved));
+    ASSERT_TRUE(validator.SetRoot(std::string(kRootDir) + "/sub"));
+    EXPECT_EQ(validator.GetCacheSize(), 0u);
+    ASSERT_TRUE(validator.Resolve("file.bin", true, resolved));
+    EXPECT_EQ(std::filesystem::path(resolved),
+              std::filesystem::weakly_canonical(std::filesystem::path(kRootDir) / "sub/file.bin"));
+}
+
+TEST_F(TftpPathValidatorTest, CachedEntriesExpire) {
+    PathValidator validator(16, std::chrono::milliseconds(0));
+    ASSERT_TRUE(validator.SetRoot(kRootDir));
+
+    std::string resolved;
+    ASSERT_TRUE(validator.Resolve("sub/file.bin", true, resolved));
+    ASSERT_TRUE(validator.Resolve("sub/file.bin", true, resolved));
+    EXPECT_EQ(validator.GetCacheHits(), 0u);
+    EXPECT_EQ(validator.GetCacheMisses(), 2u);
+}
+
+#ifndef _WIN32
+TEST_F(TftpPathValidatorTest, SymlinkOutOfRootIsRejected) {
+    std::filesystem::create_directory_symlink("/tmp", std::string(kRootDir) + "/escape");
+
+    PathValidator validator;
+    ASSERT_TRUE(validator.SetRoot(kRootDir));
+    std::string resolved;
+    EXPECT_FALSE(validator.Resolve("escape/file", true, resolved));
+    // The cached resolution keeps the verdict
+    EXPECT_FALSE(validator.Resolve("escape/file", true, resolved));
+    EXPECT_EQ(validator.GetCacheHits(), 1u);
+}
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file tftp_rate_limiter_test.cpp
+ * @brief Unit tests for TokenBucket and RateLimiter
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_rate_limiter.h"
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+using namespace tftpserver::internal;
+using std::chrono::milliseconds;
+
+namespace {
+
+sockaddr_in MakeAddress(const char* ip, uint16_t port) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    inet_pton(AF_INET, ip, &addr.sin_addr);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+long long ToMs(TokenBucket::Clock::duration duration) {
+    return std::chrono::duration_cast<milliseconds>(duration).count();
+}
+
+} // namespace
+
+TEST(TftpTokenBucketTest, ReservesIntoDebt) {
+    auto start = TokenBucket::Clock::now();
+    TokenBucket bucket;
+    EXPECT_EQ(bucket.Reserve(1 << 30, start), TokenBucket::Clock::duration::zero());
+
+    // The burst is the floor of 64 KiB at this rate, and it starts full
+    bucket.SetRate(1000, start);
+    EXPECT_EQ(bucket.Reserve(TokenBucket::kMinBurstBytes, start), TokenBucket::Clock::duration::zero());
+    EXPECT_EQ(ToMs(bucket.Reserve(1000, start)), 1000);
+    EXPECT_EQ(ToMs(bucket.Reserve(500, start)), 1500);
+
+    // The debt is repaid over time, and refills stop at the burst
+    EXPECT_EQ(bucket.Reserve(0, start + milliseconds(1500)), TokenBucket::Clock::duration::zero());
+    auto later = start + std::chrono::hours(1);
+    EXPECT_EQ(bucket.Reserve(TokenBucket::kMinBurstBytes, later), TokenBucket::Clock::duration::zero());
+    EXPECT_GT(bucket.Reserve(1, later), TokenBucket::Clock::duration::zero());
+}
+
+TEST(TftpRateLimiterTest, LimitsEachClientAddress) {
+    auto now = RateLimiter::Clock::now();
+    sockaddr_in first = MakeAddress("10.0.0.1", 1000);
+    sockaddr_in first_other_port = MakeAddress("10.0.0.1", 1001);
+    sockaddr_in second = MakeAddress("10.0.0.2", 1000);
+
+    RateLimiter limiter;
+    limiter.SetLimits(0, 65536);
+    limiter.AddClient(first);
+    limiter.AddClient(first_other_port);
+    limiter.AddClient(second);
+    EXPECT_EQ(limiter.GetClientCount(), 2u);
+
+    // Both transfers of the first host share its bucket; the second host is unaffected
+    EXPECT_EQ(limiter.Reserve(first, 65536, now), RateLimiter::Clock::duration::zero());
+    EXPECT_EQ(ToMs(limiter.Reserve(first_other_port, 65536, now)), 1000);
+    EXPECT_EQ(limiter.Reserve(second, 65536, now), RateLimiter::Clock::duration::zero());
+
+    limiter.RemoveClient(first);
+    EXPECT_EQ(limiter.GetClientCount(), 2u);
+    limiter.RemoveClient(first_other_port);
+    limiter.RemoveClient(second);
+    EXPECT_EQ(limiter.GetClientCount(), 0u);
+}
+
+TEST(TftpRateLimiterTest, GlobalLimitIsShared) {
+    auto now = RateLimiter::Clock::now();
+    sockaddr_in first = MakeAddress("10.0.0.1", 1000);
+    sockaddr_in second = MakeAddress("10.0.0.2", 1000);
+
+    RateLimiter limiter;
+    limiter.AddClient(first);
+    limiter.AddClient(second);
+    EXPECT_EQ(limiter.Reserve(first, 1 << 30, now), RateLimiter::Clock::duration::zero());
+
+    // The second host pays for the burst the first one used
+    limiter.SetLimits(131072, 0);
+    EXPECT_EQ(limiter.Reserve(first, TokenBucket::kMinBurstBytes, now), RateLimiter::Clock::duration::zero());
+    EXPECT_EQ(ToMs(limiter.Reserve(second, 65536, now)), 500);
+
+    // Turning the limits off applies at once
+    limiter.SetLimits(0, 0);
+    EXPECT_EQ(limiter.Reserve(second, 1 << 30, now), RateLimiter::Clock::duration::zero());
+}
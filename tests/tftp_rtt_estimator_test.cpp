@@ -0,0 +1,65 @@
+/**
+ * @file tftp_rtt_estimator_test.cpp
+ * @brief Unit tests for the RFC 6298 retransmission timeout estimator
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_rtt_estimator.h"
+#include <chrono>
+
+using namespace tftpserver::internal;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+TEST(TftpRttEstimatorTest, InitialTimeoutUntilFirstSample) {
+    RttEstimator rtt(seconds(1), milliseconds(200), seconds(5));
+    EXPECT_FALSE(rtt.HasSample());
+    EXPECT_EQ(rtt.Rto(), seconds(1));
+}
+
+TEST(TftpRttEstimatorTest, FirstSampleSetsSrttAndVariance) {
+    RttEstimator rtt(seconds(1), milliseconds(1), seconds(5));
+    rtt.Sample(milliseconds(100));
+    EXPECT_TRUE(rtt.HasSample());
+    EXPECT_EQ(rtt.Srtt(), milliseconds(100));
+    EXPECT_EQ(rtt.RttVar(), milliseconds(50));
+    // RTO = SRTT + 4 * RTTVAR
+    EXPECT_EQ(rtt.Rto(), milliseconds(300));
+}
+
+TEST(TftpRttEstimatorTest, SmoothsLaterSamples) {
+    RttEstimator rtt(seconds(1), milliseconds(1), seconds(5));
+    rtt.Sample(milliseconds(100));
+    rtt.Sample(milliseconds(180));
+    // RTTVAR = 3/4 * 50 + 1/4 * 80, SRTT = 7/8 * 100 + 1/8 * 180
+    EXPECT_EQ(rtt.RttVar(), milliseconds(57) + std::chrono::microseconds(500));
+    EXPECT_EQ(rtt.Srtt(), milliseconds(110));
+    EXPECT_EQ(rtt.Rto(), milliseconds(340));
+
+    // A steady RTT converges towards it, with the variance term bounded below by the clock granularity
+    for (int i = 0; i < 200; ++i) {
+        rtt.Sample(milliseconds(100));
+    }
+    EXPECT_LT(rtt.Rto(), milliseconds(111));
+    EXPECT_GE(rtt.Rto(), milliseconds(110));
+}
+
+TEST(TftpRttEstimatorTest, ClampsToFloorAndCeiling) {
+    RttEstimator rtt(seconds(10), milliseconds(200), seconds(5));
+    EXPECT_EQ(rtt.Rto(), seconds(5));
+
+    rtt.Sample(milliseconds(1));
+    EXPECT_EQ(rtt.Rto(), milliseconds(200));
+}
+
+TEST(TftpRttEstimatorTest, BackoffDoublesUntilNextSample) {
+    RttEstimator rtt(seconds(1), milliseconds(200), seconds(5));
+    rtt.Backoff();
+    EXPECT_EQ(rtt.Rto(), seconds(2));
+    rtt.Backoff();
+    rtt.Backoff();
+    EXPECT_EQ(rtt.Rto(), seconds(5));
+
+    rtt.Sample(milliseconds(50));
+    EXPECT_EQ(rtt.Rto(), milliseconds(200));
+}
@@ -21,6 +21,7 @@
 #include <tftp/tftp_server.h>
 #include <tftp/tftp_packet.h>
 #include <tftp/tftp_common.h>
+#include "internal/tftp_pack_file.h"
 #include <fstream>
 #include <vector>
 #include <thread>
@@ -30,6 +31,9 @@
 #include <cstring>
 #include <filesystem>
 #include <iostream> // Added for standard output
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 using namespace tftpserver;
 
@@ -174,18 +178,18 @@ protected:
             return false;
         }
         
-        uint8_t buffer[1024]={0};  // Buffer larger than normal TFTP packet size
+        std::vector<uint8_t> buffer(kMaxBlockPacketSize);  // Large enough for any negotiated block size
 #ifdef _WIN32
         int addrlen = sizeof(server_addr);
 #else
         socklen_t addrlen = sizeof(server_addr);
 #endif
 
-        int recvlen = recvfrom(sock, reinterpret_cast<char*>(buffer), sizeof(buffer), 0,
+        int recvlen = recvfrom(sock, reinterpret_cast<char*>(buffer.data()), static_cast<int>(buffer.size()), 0,
                               (struct sockaddr*)&server_addr, &addrlen);
         
         if (recvlen > 0) {
-            data.assign(buffer, buffer + recvlen);
+            data.assign(buffer.begin(), buffer.begin() + recvlen);
             return true;
         }
         return false;
@@ -750,6 +754,1284 @@ TEST_F(TftpServerTest, LargeFileTransfer) {
     server.Stop();
 }
 
+// Block size negotiation (RFC 2348) for downloads
+TEST_F(TftpServerTest, BlockSizeNegotiatedDownload) {
+    constexpr size_t kBlockSize = 8192;
+    
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    TftpPacket rrq_packet = TftpPacket::CreateReadRequest(kLargeTestFile, TransferMode::kOctet);
+    rrq_packet.SetOption("blksize", std::to_string(kBlockSize));
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, rrq_packet.Serialize()));
+
+    // Server must answer the option with an OACK before any DATA
+    std::vector<uint8_t> response;
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+    TftpPacket response_packet;
+    ASSERT_TRUE(response_packet.Deserialize(response));
+    ASSERT_EQ(response_packet.GetOpCode(), OpCode::kOACK);
+    ASSERT_EQ(response_packet.GetOption("blksize"), std::to_string(kBlockSize));
+
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(0).Serialize()));
+
+    std::vector<uint8_t> file_data;
+    uint16_t expected_block = 1;
+    bool last_packet = false;
+    while (!last_packet) {
+        ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+        ASSERT_TRUE(response_packet.Deserialize(response.data(), response.size(), kBlockSize));
+        ASSERT_EQ(response_packet.GetOpCode(), OpCode::kData);
+        ASSERT_EQ(response_packet.GetBlockNumber(), expected_block);
+        
+        const std::vector<uint8_t>& block_data = response_packet.GetData();
+        ASSERT_LE(block_data.size(), kBlockSize);
+        file_data.insert(file_data.end(), block_data.begin(), block_data.end());
+        ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(expected_block).Serialize()));
+        
+        last_packet = (block_data.size() < kBlockSize);
+        expected_block++;
+    }
+
+    server.Stop();
+    CloseSocket(client_sock);
+
+    // kLargeFileSize is not a multiple of the block size, so the block count is exact
+    EXPECT_EQ(expected_block - 1, static_cast<int>(kLargeFileSize / kBlockSize + 1));
+    std::ifstream original(std::string(kTestRootDir) + "/" + kLargeTestFile, std::ios::binary);
+    std::vector<uint8_t> original_data((std::istreambuf_iterator<char>(original)),
+                                       std::istreambuf_iterator<char>());
+    ASSERT_EQ(file_data, original_data);
+}
+
+// Transfer size (RFC 2349) on a download: the OACK carries the real size, so a client can
+// preallocate, or just probe the size and abort
+TEST_F(TftpServerTest, TransferSizeAnsweredOnDownload) {
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    TftpPacket rrq_packet = TftpPacket::CreateReadRequest(kLargeTestFile, TransferMode::kOctet);
+    rrq_packet.SetOption("tsize", "0");
+    rrq_packet.SetOption("timeout", "3");
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, rrq_packet.Serialize()));
+
+    std::vector<uint8_t> response;
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+    TftpPacket response_packet;
+    ASSERT_TRUE(response_packet.Deserialize(response));
+    ASSERT_EQ(response_packet.GetOpCode(), OpCode::kOACK);
+    EXPECT_EQ(response_packet.GetOption("tsize"), std::to_string(kLargeFileSize));
+    EXPECT_EQ(response_packet.GetOption("timeout"), "3");
+
+    TftpPacket abort_packet = TftpPacket::CreateError(ErrorCode::kNotDefined, "size probe");
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, abort_packet.Serialize()));
+
+    server.Stop();
+    CloseSocket(client_sock);
+}
+
+// Block size negotiation (RFC 2348) for uploads
+TEST_F(TftpServerTest, BlockSizeNegotiatedUpload) {
+    constexpr size_t kBlockSize = 4096;
+    
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    // Two full blocks plus a short final block
+    std::vector<uint8_t> upload_data(kBlockSize * 2 + 100);
+    for (size_t i = 0; i < upload_data.size(); ++i) {
+        upload_data[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    TftpPacket wrq_packet = TftpPacket::CreateWriteRequest("blksize_upload.dat", TransferMode::kOctet);
+    wrq_packet.SetOption("blksize", std::to_string(kBlockSize));
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, wrq_packet.Serialize()));
+
+    std::vector<uint8_t> response;
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+    TftpPacket response_packet;
+    ASSERT_TRUE(response_packet.Deserialize(response));
+    ASSERT_EQ(response_packet.GetOpCode(), OpCode::kOACK);
+    ASSERT_EQ(response_packet.GetOption("blksize"), std::to_string(kBlockSize));
+
+    uint16_t block_number = 1;
+    for (size_t offset = 0; offset < upload_data.size(); offset += kBlockSize) {
+        size_t block_size = std::min(kBlockSize, upload_data.size() - offset);
+        std::vector<uint8_t> block(upload_data.begin() + offset, upload_data.begin() + offset + block_size);
+        ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateData(block_number, block).Serialize()));
+        
+        ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+        ASSERT_TRUE(response_packet.Deserialize(response));
+        ASSERT_EQ(response_packet.GetOpCode(), OpCode::kAcknowledge);
+        ASSERT_EQ(response_packet.GetBlockNumber(), block_number);
+        block_number++;
+    }
+
+    server.Stop();
+    CloseSocket(client_sock);
+
+    std::ifstream uploaded(std::string(kTestRootDir) + "/blksize_upload.dat", std::ios::binary);
+    std::vector<uint8_t> uploaded_data((std::istreambuf_iterator<char>(uploaded)),
+                                       std::istreambuf_iterator<char>());
+    ASSERT_EQ(uploaded_data, upload_data);
+}
+
+// Window size negotiation (RFC 7440) for downloads, including recovery from a partial window ACK
+TEST_F(TftpServerTest, WindowSizeNegotiatedDownload) {
+    constexpr size_t kBlockSize = 1024;
+    constexpr uint16_t kWindowSize = 4;
+    
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    TftpPacket rrq_packet = TftpPacket::CreateReadRequest(kLargeTestFile, TransferMode::kOctet);
+    rrq_packet.SetOption("blksize", std::to_string(kBlockSize));
+    rrq_packet.SetOption("windowsize", std::to_string(kWindowSize));
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, rrq_packet.Serialize()));
+
+    std::vector<uint8_t> response;
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+    TftpPacket response_packet;
+    ASSERT_TRUE(response_packet.Deserialize(response));
+    ASSERT_EQ(response_packet.GetOpCode(), OpCode::kOACK);
+    ASSERT_EQ(response_packet.GetOption("windowsize"), std::to_string(kWindowSize));
+
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(0).Serialize()));
+
+    // The first window arrives without intermediate ACKs
+    for (uint16_t block = 1; block <= kWindowSize; ++block) {
+        ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+        ASSERT_TRUE(response_packet.Deserialize(response.data(), response.size(), kBlockSize));
+        ASSERT_EQ(response_packet.GetOpCode(), OpCode::kData);
+        ASSERT_EQ(response_packet.GetBlockNumber(), block);
+    }
+
+    // Pretend blocks 3 and 4 were lost: the next window must restart at block 3
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(2).Serialize()));
+
+    std::vector<uint8_t> file_data;
+    {
+        std::ifstream original(std::string(kTestRootDir) + "/" + kLargeTestFile, std::ios::binary);
+        std::vector<uint8_t> head(2 * kBlockSize);
+        original.read(reinterpret_cast<char*>(head.data()), head.size());
+        file_data = head;
+    }
+
+    uint16_t expected_block = 3;
+    bool last_packet = false;
+    while (!last_packet) {
+        ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+        ASSERT_TRUE(response_packet.Deserialize(response.data(), response.size(), kBlockSize));
+        ASSERT_EQ(response_packet.GetOpCode(), OpCode::kData);
+        ASSERT_EQ(response_packet.GetBlockNumber(), expected_block);
+        
+        const std::vector<uint8_t>& block_data = response_packet.GetData();
+        file_data.insert(file_data.end(), block_data.begin(), block_data.end());
+        last_packet = (block_data.size() < kBlockSize);
+        
+        // ACK at the end of each window (windows now start at 3, 7, 11, ...) and on the last block
+        if (last_packet || (expected_block - 3) % kWindowSize == kWindowSize - 1) {
+            ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(expected_block).Serialize()));
+        }
+        expected_block++;
+    }
+
+    server.Stop();
+    CloseSocket(client_sock);
+
+    std::ifstream original(std::string(kTestRootDir) + "/" + kLargeTestFile, std::ios::binary);
+    std::vector<uint8_t> original_data((std::istreambuf_iterator<char>(original)),
+                                       std::istreambuf_iterator<char>());
+    ASSERT_EQ(file_data, original_data);
+}
+
+// Window size negotiation (RFC 7440) for uploads: the server ACKs once per window
+TEST_F(TftpServerTest, WindowSizeNegotiatedUpload) {
+    constexpr size_t kBlockSize = 512;
+    constexpr uint16_t kWindowSize = 4;
+    
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    // One full window plus a short final block
+    std::vector<uint8_t> upload_data(kBlockSize * kWindowSize + 100);
+    for (size_t i = 0; i < upload_data.size(); ++i) {
+        upload_data[i] = static_cast<uint8_t>(i * 13);
+    }
+
+    TftpPacket wrq_packet = TftpPacket::CreateWriteRequest("windowsize_upload.dat", TransferMode::kOctet);
+    wrq_packet.SetOption("windowsize", std::to_string(kWindowSize));
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, wrq_packet.Serialize()));
+
+    std::vector<uint8_t> response;
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+    TftpPacket response_packet;
+    ASSERT_TRUE(response_packet.Deserialize(response));
+    ASSERT_EQ(response_packet.GetOpCode(), OpCode::kOACK);
+    ASSERT_EQ(response_packet.GetOption("windowsize"), std::to_string(kWindowSize));
+
+    uint16_t block_number = 1;
+    for (size_t offset = 0; offset < upload_data.size(); offset += kBlockSize) {
+        size_t block_size = std::min(kBlockSize, upload_data.size() - offset);
+        std::vector<uint8_t> block(upload_data.begin() + offset, upload_data.begin() + offset + block_size);
+        ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateData(block_number, block).Serialize()));
+        
+        bool expect_ack = (block_number % kWindowSize == 0) || (block_size < kBlockSize);
+        if (expect_ack) {
+            ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+            ASSERT_TRUE(response_packet.Deserialize(response));
+            ASSERT_EQ(response_packet.GetOpCode(), OpCode::kAcknowledge);
+            ASSERT_EQ(response_packet.GetBlockNumber(), block_number);
+        } else {
+            // No ACK inside the window
+            ASSERT_FALSE(ReceiveTftpPacket(client_sock, response, server_addr, 100));
+        }
+        block_number++;
+    }
+
+    server.Stop();
+    CloseSocket(client_sock);
+
+    std::ifstream uploaded(std::string(kTestRootDir) + "/windowsize_upload.dat", std::ios::binary);
+    std::vector<uint8_t> uploaded_data((std::istreambuf_iterator<char>(uploaded)),
+                                       std::istreambuf_iterator<char>());
+    ASSERT_EQ(uploaded_data, upload_data);
+}
+
+// Read source that generates its contents and counts lifecycle calls
+class PatternReadSource : public ReadSource {
+public:
+    PatternReadSource(uint64_t size, std::atomic<int>& opens, std::atomic<int>& closes)
+        : size_(size), opens_(opens), closes_(closes) {}
+
+    bool Open(const std::string& path) override {
+        (void)path;
+        opens_++;
+        return true;
+    }
+    uint64_t Size() const override { return size_; }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        bytes_read = static_cast<size_t>(std::min<uint64_t>(length, size_ - std::min(offset, size_)));
+        for (size_t i = 0; i < bytes_read; ++i) {
+            buffer[i] = static_cast<uint8_t>((offset + i) * 31);
+        }
+        return true;
+    }
+    void Close() override { closes_++; }
+
+private:
+    uint64_t size_;
+    std::atomic<int>& opens_;
+    std::atomic<int>& closes_;
+};
+
+// Streaming read source: blocks are pulled from the source instead of a preloaded buffer
+TEST_F(TftpServerTest, StreamingReadSource) {
+    constexpr uint64_t kSourceSize = 3 * 512 + 17;
+    std::atomic<int> opens{0};
+    std::atomic<int> closes{0};
+    
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetReadSourceFactory([&]() -> std::unique_ptr<ReadSource> {
+        return std::make_unique<PatternReadSource>(kSourceSize, opens, closes);
+    });
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> downloaded_data;
+    ASSERT_TRUE(DownloadFile("streamed.bin", downloaded_data));
+    server.Stop();
+
+    ASSERT_EQ(downloaded_data.size(), kSourceSize);
+    for (size_t i = 0; i < downloaded_data.size(); ++i) {
+        ASSERT_EQ(downloaded_data[i], static_cast<uint8_t>(i * 31)) << "Mismatch at offset " << i;
+    }
+    EXPECT_EQ(opens.load(), 1);
+    EXPECT_EQ(closes.load(), 1);
+}
+
+// Legacy whole-file read callback keeps working through the streaming path
+TEST_F(TftpServerTest, LegacyReadCallback) {
+    const std::vector<uint8_t> content(1000, 0x5A);
+    
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetReadCallback([&](const std::string& path, std::vector<uint8_t>& data) {
+        (void)path;
+        data = content;
+        return true;
+    });
+    EXPECT_THROW(server.SetReadSourceFactory(nullptr), TftpException);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> downloaded_data;
+    ASSERT_TRUE(DownloadFile("callback.bin", downloaded_data));
+    server.Stop();
+
+    ASSERT_EQ(downloaded_data, content);
+}
+
+// Setters never wait for a callback in progress; the running transfer keeps its configuration
+TEST_F(TftpServerTest, ReconfigureWhileCallbackRuns) {
+    const std::vector<uint8_t> first_content(1000, 0x11);
+    const std::vector<uint8_t> second_content(700, 0x22);
+    std::atomic<bool> entered(false);
+    std::atomic<bool> release(false);
+
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetReadCallback([&](const std::string& path, std::vector<uint8_t>& data) {
+        (void)path;
+        entered = true;
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        data = first_content;
+        return true;
+    });
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> first_download;
+    bool first_ok = false;
+    std::thread downloader([&]() { first_ok = DownloadFile("slow.bin", first_download); });
+    for (int i = 0; i < 200 && !entered; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(entered);
+
+    auto start = std::chrono::steady_clock::now();
+    server.SetTimeout(3);
+    server.SetSecureMode(true);
+    server.SetMaxTransferSize(64 * 1024);
+    server.SetReadCallback([&](const std::string& path, std::vector<uint8_t>& data) {
+        (void)path;
+        data = second_content;
+        return true;
+    });
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+    release = true;
+    downloader.join();
+    ASSERT_TRUE(first_ok);
+    EXPECT_EQ(first_download, first_content);
+
+    std::vector<uint8_t> second_download;
+    ASSERT_TRUE(DownloadFile("fast.bin", second_download));
+    EXPECT_EQ(second_download, second_content);
+    server.Stop();
+}
+
+// Write sink that records every block it receives
+class RecordingWriteSink : public WriteSink {
+public:
+    struct Record {
+        std::vector<uint8_t> data;
+        std::vector<uint64_t> offsets;
+        bool committed = false;
+        bool aborted = false;
+    };
+
+    explicit RecordingWriteSink(Record& record) : record_(record) {}
+
+    bool Open(const std::string& path, uint64_t size_hint) override {
+        (void)path;
+        (void)size_hint;
+        return true;
+    }
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override {
+        record_.offsets.push_back(offset);
+        record_.data.insert(record_.data.end(), data, data + length);
+        return true;
+    }
+    bool Commit() override {
+        record_.committed = true;
+        return true;
+    }
+    void Abort() override { record_.aborted = true; }
+
+private:
+    Record& record_;
+};
+
+// Streaming write sink: every block is handed over as it arrives, then committed once
+TEST_F(TftpServerTest, StreamingWriteSink) {
+    RecordingWriteSink::Record record;
+    
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetWriteSinkFactory([&]() -> std::unique_ptr<WriteSink> {
+        return std::make_unique<RecordingWriteSink>(record);
+    });
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> upload_data(4 * 512 + 200);
+    for (size_t i = 0; i < upload_data.size(); ++i) {
+        upload_data[i] = static_cast<uint8_t>(i * 17);
+    }
+    ASSERT_TRUE(UploadFile("streamed_upload.dat", upload_data));
+    server.Stop();
+
+    EXPECT_EQ(record.data, upload_data);
+    ASSERT_EQ(record.offsets.size(), 5u);
+    for (size_t i = 0; i < record.offsets.size(); ++i) {
+        EXPECT_EQ(record.offsets[i], i * 512);
+    }
+    EXPECT_TRUE(record.committed);
+    EXPECT_FALSE(record.aborted);
+    EXPECT_FALSE(std::filesystem::exists(std::string(kTestRootDir) + "/streamed_upload.dat"));
+}
+
+// An interrupted upload with the default sink leaves neither the target nor a temporary file behind
+TEST_F(TftpServerTest, AbortedUploadLeavesNoFile) {
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    TftpPacket wrq_packet = TftpPacket::CreateWriteRequest("aborted_upload.dat", TransferMode::kOctet);
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, wrq_packet.Serialize()));
+
+    std::vector<uint8_t> response;
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+    TftpPacket response_packet;
+    ASSERT_TRUE(response_packet.Deserialize(response));
+    ASSERT_EQ(response_packet.GetOpCode(), OpCode::kAcknowledge);
+
+    std::vector<uint8_t> block(512, 0xAB);
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateData(1, block).Serialize()));
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+
+    // Give up mid-transfer
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr,
+                               TftpPacket::CreateError(ErrorCode::kNotDefined, "Cancelled").Serialize()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    server.Stop();
+    CloseSocket(client_sock);
+
+    for (const auto& entry : std::filesystem::directory_iterator(kTestRootDir)) {
+        std::string name = entry.path().filename().string();
+        EXPECT_EQ(name.find("aborted_upload.dat"), std::string::npos) << "Leftover file: " << name;
+    }
+}
+
+// Read cache: repeated downloads of the same file share one mapping
+TEST_F(TftpServerTest, FileCacheServesRepeatedDownloads) {
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetFileCacheSize(16 * 1024 * 1024);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::ifstream original(std::string(kTestRootDir) + "/" + kTestFile, std::ios::binary);
+    std::vector<uint8_t> original_data((std::istreambuf_iterator<char>(original)),
+                                       std::istreambuf_iterator<char>());
+
+    for (int i = 0; i < 3; ++i) {
+        std::vector<uint8_t> downloaded_data;
+        ASSERT_TRUE(DownloadFile(kTestFile, downloaded_data));
+        ASSERT_EQ(downloaded_data, original_data);
+    }
+    server.Stop();
+
+    FileCacheStats stats = server.GetFileCacheStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.entries, 1u);
+}
+
+// Event-driven engine sends cached blocks straight from the mapping, large blocks included
+TEST_F(TftpServerTest, EventDrivenServesCachedFileInPlace) {
+    std::vector<uint8_t> content(1024 * 1024 + 123);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<uint8_t>(i * 13 + (i >> 12));
+    }
+    {
+        std::ofstream file(std::string(kTestRootDir) + "/mapped.dat", std::ios::binary);
+        file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+    }
+
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetTransferEngine(TransferEngine::kEventDriven, 1);
+    server.SetFileCacheSize(16 * 1024 * 1024);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (uint16_t block_size : {512, 32768}) {
+        TftpClient client;
+        client.SetBlockSize(block_size);
+        client.SetWindowSize(8);
+        std::vector<uint8_t> downloaded_data;
+        ASSERT_TRUE(client.DownloadFile("127.0.0.1", "mapped.dat", downloaded_data, kTestPort)) << client.GetLastError();
+        EXPECT_EQ(downloaded_data, content) << "blksize " << block_size;
+    }
+    server.Stop();
+}
+
+// Read-ahead and write-behind on both engines, with a sync after every block
+TEST_F(TftpServerTest, AsyncFileIoTransfers) {
+    std::vector<uint8_t> content(200 * 1024 + 33);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<uint8_t>(i * 11 + (i >> 10));
+    }
+
+    for (TransferEngine engine : {TransferEngine::kEventDriven, TransferEngine::kThreadPool}) {
+        TftpServer server(kTestRootDir, kTestPort);
+        server.SetTransferEngine(engine, 1);
+        server.SetAsyncFileIo(2, 16 * 1024);
+        server.SetFsyncPolicy(FsyncPolicy::kEveryWrite);
+        ASSERT_TRUE(server.Start());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        ASSERT_TRUE(UploadFile("async_io.dat", content));
+        std::vector<uint8_t> downloaded_data;
+        ASSERT_TRUE(DownloadFile("async_io.dat", downloaded_data));
+        EXPECT_EQ(downloaded_data, content);
+
+        TftpClient client;
+        client.SetBlockSize(1024);
+        client.SetWindowSize(8);
+        std::vector<uint8_t> data;
+        ASSERT_TRUE(client.DownloadFile("127.0.0.1", "async_io.dat", data, kTestPort)) << client.GetLastError();
+        EXPECT_EQ(data, content);
+        server.Stop();
+    }
+    EXPECT_THROW(TftpServer(kTestRootDir, kTestPort).SetAsyncFileIo(65, 0), TftpException);
+}
+
+// Reads from a pack: names found by index lookup only, reloaded in place
+TEST_F(TftpServerTest, PackFileServesAndReloads) {
+    const std::string tree = "./pack_server_tree";
+    const std::string pack_path = "./pack_server_test.pack";
+    std::filesystem::remove_all(tree);
+    std::filesystem::create_directories(tree + "/pxelinux.cfg");
+    auto write_tree_file = [&](const std::string& name, const std::string& contents) {
+        std::ofstream file(tree + "/" + name, std::ios::binary | std::ios::trunc);
+        file << contents;
+    };
+    std::string menu(3000, 'm');
+    write_tree_file("pxelinux.cfg/default", menu);
+    write_tree_file("boot.cfg", "version 1");
+    {
+        std::ofstream file(std::string(kTestRootDir) + "/only_on_disk.txt");
+        file << "not in the pack";
+    }
+    size_t file_count = 0;
+    ASSERT_TRUE(internal::BuildPackFile(tree, pack_path, file_count));
+
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetPackFile("./no_such.pack");
+    EXPECT_FALSE(server.Start());
+    server.SetPackFile(pack_path);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(DownloadFile("pxelinux.cfg\\default", data));
+    EXPECT_EQ(std::string(data.begin(), data.end()), menu);
+    TftpClient client;
+    client.SetBlockSize(1024);
+    ASSERT_TRUE(client.DownloadFile("127.0.0.1", "boot.cfg", data, kTestPort)) << client.GetLastError();
+    EXPECT_EQ(std::string(data.begin(), data.end()), "version 1");
+    EXPECT_FALSE(client.DownloadFile("127.0.0.1", "only_on_disk.txt", data, kTestPort));
+    EXPECT_FALSE(client.DownloadFile("127.0.0.1", "../boot.cfg", data, kTestPort));
+
+    // The new pack replaces the old one atomically; a broken one leaves it serving
+    write_tree_file("boot.cfg", "version 2");
+    ASSERT_TRUE(internal::BuildPackFile(tree, pack_path, file_count));
+    ASSERT_TRUE(server.ReloadPackFile());
+    ASSERT_TRUE(client.DownloadFile("127.0.0.1", "boot.cfg", data, kTestPort)) << client.GetLastError();
+    EXPECT_EQ(std::string(data.begin(), data.end()), "version 2");
+    server.SetPackFile("./no_such.pack");
+    EXPECT_FALSE(server.ReloadPackFile());
+    ASSERT_TRUE(client.DownloadFile("127.0.0.1", "boot.cfg", data, kTestPort)) << client.GetLastError();
+    EXPECT_EQ(std::string(data.begin(), data.end()), "version 2");
+
+    // Uploads still go to the root directory
+    std::vector<uint8_t> upload(700, 'u');
+    EXPECT_TRUE(UploadFile("pack_upload.dat", upload));
+    EXPECT_TRUE(std::filesystem::exists(std::string(kTestRootDir) + "/pack_upload.dat"));
+    server.Stop();
+    std::filesystem::remove_all(tree);
+    std::filesystem::remove(pack_path);
+}
+
+// Concurrent downloads share one callback call; kept results are served until invalidated
+TEST_F(TftpServerTest, ReadCallbackCacheCoalescesAndInvalidates) {
+    constexpr int kClients = 4;
+    std::atomic<int> calls{0};
+    std::atomic<uint8_t> version{1};
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetThreadPoolSize(kClients * 2);
+    EXPECT_THROW(server.SetReadCallbackCache(-1, 0), TftpException);
+    server.SetReadCallback([&](const std::string& path, std::vector<uint8_t>& data) {
+        (void)path;
+        // Held until every other request waits on this call (or a deadline passes)
+        if (calls++ == 0) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+            while (server.GetReadCallbackCacheStats().coalesced < kClients - 1 &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+        data.assign(1500, version.load());
+        return true;
+    });
+    server.SetReadCallbackCache(60000, 1024 * 1024);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::atomic<int> succeeded{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < kClients; ++i) {
+        clients.emplace_back([&]() {
+            std::vector<uint8_t> downloaded_data;
+            if (DownloadFile("generated.bin", downloaded_data) &&
+                downloaded_data == std::vector<uint8_t>(1500, 1)) {
+                succeeded++;
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    EXPECT_EQ(succeeded.load(), kClients);
+    EXPECT_EQ(calls.load(), 1);
+    CallbackCacheStats stats = server.GetReadCallbackCacheStats();
+    EXPECT_EQ(stats.coalesced, static_cast<uint64_t>(kClients - 1));
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.cached_bytes, 1500u);
+
+    // Kept result, then the new content once the application drops it
+    version = 2;
+    std::vector<uint8_t> downloaded_data;
+    ASSERT_TRUE(DownloadFile("generated.bin", downloaded_data));
+    EXPECT_EQ(downloaded_data, std::vector<uint8_t>(1500, 1));
+    EXPECT_EQ(server.GetReadCallbackCacheStats().hits, 1u);
+    server.InvalidateReadCallbackCache("generated.bin");
+    ASSERT_TRUE(DownloadFile("generated.bin", downloaded_data));
+    EXPECT_EQ(downloaded_data, std::vector<uint8_t>(1500, 2));
+    EXPECT_EQ(calls.load(), 2);
+
+    server.InvalidateReadCallbackCache();
+    EXPECT_EQ(server.GetReadCallbackCacheStats().entries, 0u);
+    server.Stop();
+}
+
+#ifndef _WIN32
+// A repointed symlink is followed once the cached resolution is dropped
+TEST_F(TftpServerTest, InvalidatePathCacheFollowsChangedSymlink) {
+    std::string root(kTestRootDir);
+    std::ofstream(root + "/first.bin") << "first";
+    std::ofstream(root + "/second.bin") << "second";
+    std::filesystem::create_symlink("first.bin", root + "/current.bin");
+
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(DownloadFile("current.bin", data));
+    EXPECT_EQ(std::string(data.begin(), data.end()), "first");
+
+    std::filesystem::remove(root + "/current.bin");
+    std::filesystem::create_symlink("second.bin", root + "/current.bin");
+    ASSERT_TRUE(DownloadFile("current.bin", data));
+    EXPECT_EQ(std::string(data.begin(), data.end()), "first");
+
+    server.InvalidatePathCache();
+    ASSERT_TRUE(DownloadFile("current.bin", data));
+    EXPECT_EQ(std::string(data.begin(), data.end()), "second");
+    server.Stop();
+}
+#endif
+
+// A transfer in flight keeps the callback it started with; later requests never wait for its call
+TEST_F(TftpServerTest, ReadCallbackReplacedDuringTransfer) {
+    std::mutex mutex;
+    std::condition_variable released_cv;
+    bool released = false;
+    std::atomic<bool> old_called{false};
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetThreadPoolSize(4);
+    server.SetReadCallbackCache(60000, 1024 * 1024);
+    server.SetReadCallback([&](const std::string& path, std::vector<uint8_t>& data) {
+        (void)path;
+        old_called = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        released_cv.wait_for(lock, std::chrono::seconds(5), [&released]() { return released; });
+        data.assign(1500, 'A');
+        return true;
+    });
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> old_data;
+    std::thread old_download([&]() { EXPECT_TRUE(DownloadFile("replaced.bin", old_data)); });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (!old_called && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_TRUE(old_called);
+
+    server.SetReadCallback([](const std::string& path, std::vector<uint8_t>& data) {
+        (void)path;
+        data.assign(1500, 'B');
+        return true;
+    });
+    std::vector<uint8_t> new_data;
+    ASSERT_TRUE(DownloadFile("replaced.bin", new_data));
+    EXPECT_EQ(new_data, std::vector<uint8_t>(1500, 'B'));
+    EXPECT_EQ(server.GetReadCallbackCacheStats().coalesced, 0u);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+    }
+    released_cv.notify_all();
+    old_download.join();
+    EXPECT_EQ(old_data, std::vector<uint8_t>(1500, 'A'));
+
+    // The old call's result is not kept over the new one
+    ASSERT_TRUE(DownloadFile("replaced.bin", new_data));
+    EXPECT_EQ(new_data, std::vector<uint8_t>(1500, 'B'));
+    server.Stop();
+}
+
+// io_uring backend on both engines: uploads, small and large blocks, concurrent sessions
+TEST_F(TftpServerTest, IoUringBackendTransfers) {
+    if (!TftpServer::IsIoBackendAvailable(IoBackend::kIoUring)) {
+        GTEST_SKIP() << "io_uring not available";
+    }
+    std::vector<uint8_t> content(300 * 1024 + 77);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<uint8_t>(i * 29 + (i >> 10));
+    }
+    {
+        std::ofstream file(std::string(kTestRootDir) + "/uring.dat", std::ios::binary);
+        file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+    }
+    std::vector<uint8_t> small_content(content.begin(), content.begin() + 64 * 1024 + 5);
+    {
+        std::ofstream file(std::string(kTestRootDir) + "/uring_small.dat", std::ios::binary);
+        file.write(reinterpret_cast<const char*>(small_content.data()),
+                   static_cast<std::streamsize>(small_content.size()));
+    }
+
+    for (TransferEngine engine : {TransferEngine::kEventDriven, TransferEngine::kThreadPool}) {
+        TftpServer server(kTestRootDir, kTestPort);
+        server.SetTransferEngine(engine, 1);
+        server.SetIoBackend(IoBackend::kIoUring);
+        ASSERT_TRUE(server.Start());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::vector<uint8_t> upload_data(5000);
+        for (size_t i = 0; i < upload_data.size(); ++i) {
+            upload_data[i] = static_cast<uint8_t>(i * 7);
+        }
+        ASSERT_TRUE(UploadFile("uring_upload.dat", upload_data));
+        std::vector<uint8_t> downloaded_data;
+        ASSERT_TRUE(DownloadFile("uring_upload.dat", downloaded_data));
+        EXPECT_EQ(downloaded_data, upload_data);
+
+        for (uint16_t block_size : {512, 32768}) {
+            TftpClient client;
+            client.SetBlockSize(block_size);
+            client.SetWindowSize(8);
+            std::vector<uint8_t> data;
+            ASSERT_TRUE(client.DownloadFile("127.0.0.1", "uring.dat", data, kTestPort)) << client.GetLastError();
+            EXPECT_EQ(data, content) << "blksize " << block_size;
+        }
+        {
+            // A window of more datagrams than the submission queue has entries
+            TftpClient client;
+            client.SetBlockSize(16);
+            client.SetWindowSize(300);
+            std::vector<uint8_t> data;
+            ASSERT_TRUE(client.DownloadFile("127.0.0.1", "uring_small.dat", data, kTestPort)) << client.GetLastError();
+            EXPECT_EQ(data, small_content);
+        }
+
+        std::vector<std::thread> clients;
+        std::atomic<int> succeeded{0};
+        for (int i = 0; i < 4; ++i) {
+            clients.emplace_back([&]() {
+                TftpClient client;
+                client.SetWindowSize(4);
+                std::vector<uint8_t> data;
+                if (client.DownloadFile("127.0.0.1", "uring.dat", data, kTestPort) && data == content) {
+                    succeeded++;
+                }
+            });
+        }
+        for (std::thread& client : clients) {
+            client.join();
+        }
+        EXPECT_EQ(succeeded.load(), 4);
+        server.Stop();
+    }
+}
+
+// io_uring backend sending blocks lent by the file cache in place, small and zero-copy sized
+TEST_F(TftpServerTest, IoUringBackendSendsCachedBlocks) {
+    if (!TftpServer::IsIoBackendAvailable(IoBackend::kIoUring)) {
+        GTEST_SKIP() << "io_uring not available";
+    }
+    std::vector<uint8_t> content(200 * 1024 + 13);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<uint8_t>(i * 31 + (i >> 9));
+    }
+    {
+        std::ofstream file(std::string(kTestRootDir) + "/uring_cached.dat", std::ios::binary);
+        file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+    }
+
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetTransferEngine(TransferEngine::kEventDriven, 1);
+    server.SetIoBackend(IoBackend::kIoUring);
+    server.SetFileCacheSize(16 * 1024 * 1024);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (uint16_t block_size : {512, 8192}) {
+        TftpClient client;
+        client.SetBlockSize(block_size);
+        client.SetWindowSize(8);
+        std::vector<uint8_t> data;
+        ASSERT_TRUE(client.DownloadFile("127.0.0.1", "uring_cached.dat", data, kTestPort)) << client.GetLastError();
+        EXPECT_EQ(data, content) << "blksize " << block_size;
+    }
+
+    // Concurrent sessions, with blocks both below and above the zero-copy size
+    std::vector<std::thread> clients;
+    std::atomic<int> succeeded{0};
+    for (int i = 0; i < 6; ++i) {
+        clients.emplace_back([&, i]() {
+            TftpClient client;
+            client.SetBlockSize(i % 2 == 0 ? 8192 : 1024);
+            client.SetWindowSize(16);
+            std::vector<uint8_t> data;
+            if (client.DownloadFile("127.0.0.1", "uring_cached.dat", data, kTestPort) && data == content) {
+                succeeded++;
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    EXPECT_EQ(succeeded.load(), 6);
+    server.Stop();
+}
+
+// Event-driven engine serves the same protocol as the thread-pool engine
+TEST_F(TftpServerTest, EventDrivenTransfers) {
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetTransferEngine(TransferEngine::kEventDriven, 1);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> upload_data(5000);
+    for (size_t i = 0; i < upload_data.size(); ++i) {
+        upload_data[i] = static_cast<uint8_t>(i * 7);
+    }
+    ASSERT_TRUE(UploadFile("event_upload.dat", upload_data));
+
+    std::vector<uint8_t> downloaded_data;
+    ASSERT_TRUE(DownloadFile("event_upload.dat", downloaded_data));
+    server.Stop();
+
+    EXPECT_EQ(downloaded_data, upload_data);
+}
+
+// Windows larger than the reactor's receive batch: the client's GSO bursts arrive as one coalesced
+// receive (UDP_GRO) whose segments past the batch must be kept, not dropped
+TEST_F(TftpServerTest, EventDrivenUploadWithLargeWindow) {
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetTransferEngine(TransferEngine::kEventDriven, 1);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> upload_data(1024 * 1024);
+    for (size_t i = 0; i < upload_data.size(); ++i) {
+        upload_data[i] = static_cast<uint8_t>(i * 31 + (i >> 12));
+    }
+    for (size_t window_size : {9, 16}) {
+        TftpClient client;
+        client.SetBlockSize(1024);
+        client.SetWindowSize(window_size);
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_TRUE(client.UploadFile("127.0.0.1", "event_window_upload.dat", upload_data, kTestPort))
+            << client.GetLastError();
+        // A lost window tail costs a retransmission timeout per window, minutes for 1 MB
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10)) << "windowsize " << window_size;
+
+        std::vector<uint8_t> downloaded_data;
+        ASSERT_TRUE(DownloadFile("event_window_upload.dat", downloaded_data));
+        EXPECT_EQ(downloaded_data, upload_data);
+    }
+    server.Stop();
+}
+
+// Many concurrent sessions multiplexed on a single event loop thread
+TEST_F(TftpServerTest, EventDrivenConcurrentDownloads) {
+    constexpr int kClients = 32;
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetTransferEngine(TransferEngine::kEventDriven, 1);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::ifstream original(std::string(kTestRootDir) + "/" + kTestFile, std::ios::binary);
+    std::vector<uint8_t> original_data((std::istreambuf_iterator<char>(original)),
+                                       std::istreambuf_iterator<char>());
+
+    std::atomic<int> succeeded{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < kClients; ++i) {
+        clients.emplace_back([&]() {
+            std::vector<uint8_t> downloaded_data;
+            if (DownloadFile(kTestFile, downloaded_data) && downloaded_data == original_data) {
+                succeeded++;
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    server.Stop();
+
+    EXPECT_EQ(succeeded.load(), kClients);
+}
+
+// Several SO_REUSEPORT listeners share the port and report per-listener counters
+TEST_F(TftpServerTest, ShardedListeners) {
+    constexpr int kClients = 8;
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetListenerCount(4);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::ifstream original(std::string(kTestRootDir) + "/" + kTestFile, std::ios::binary);
+    std::vector<uint8_t> original_data((std::istreambuf_iterator<char>(original)),
+                                       std::istreambuf_iterator<char>());
+
+    std::atomic<int> succeeded{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < kClients; ++i) {
+        clients.emplace_back([&]() {
+            std::vector<uint8_t> downloaded_data;
+            if (DownloadFile(kTestFile, downloaded_data) && downloaded_data == original_data) {
+                succeeded++;
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    EXPECT_EQ(succeeded.load(), kClients);
+
+    std::vector<ListenerStats> stats = server.GetListenerStats();
+    server.Stop();
+
+#ifdef SO_REUSEPORT
+    ASSERT_EQ(stats.size(), 4u);
+#endif
+    uint64_t requests = 0;
+    for (const ListenerStats& shard : stats) {
+        requests += shard.requests;
+        EXPECT_EQ(shard.dropped, 0u);
+    }
+    EXPECT_EQ(requests, static_cast<uint64_t>(kClients));
+}
+
+// Server-wide counters and histograms follow completed and rejected transfers
+TEST_F(TftpServerTest, StatsCountTransfers) {
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<uint8_t> downloaded_data;
+    ASSERT_TRUE(DownloadFile(kTestFile, downloaded_data));
+    EXPECT_FALSE(DownloadFile("missing_file.txt", downloaded_data));
+    // The server finishes the download once it has seen the final ACK
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    server.Stop();
+
+    ServerStats stats = server.GetStats();
+    EXPECT_EQ(stats.transfers_started, 2u);
+    EXPECT_EQ(stats.transfers_completed, 1u);
+    EXPECT_EQ(stats.transfers_failed, 1u);
+    EXPECT_EQ(stats.active_sessions, 0u);
+    EXPECT_EQ(stats.bytes_sent, strlen(kTestContent));
+    EXPECT_EQ(stats.errors[static_cast<size_t>(ErrorCode::kFileNotFound)], 1u);
+    EXPECT_EQ(stats.time_to_first_byte.count, 1u);
+    EXPECT_EQ(stats.ack_rtt.count, 1u);
+    EXPECT_EQ(stats.transfer_duration.count, 2u);
+    // Sessions, their buffers and the queued jobs come from the process-wide pool
+    EXPECT_GE(stats.buffer_pool.allocations, 4u);
+    EXPECT_LE(stats.buffer_pool.reused, stats.buffer_pool.allocations);
+
+    std::string text = server.GetPrometheusMetrics();
+    EXPECT_NE(text.find("tftp_transfers_completed_total 1\n"), std::string::npos);
+}
+
+// A retransmitted RRQ does not start a second transfer
+TEST_F(TftpServerTest, DuplicateRequestIgnored) {
+    TftpServer server(kTestRootDir, kTestPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    std::vector<uint8_t> rrq = TftpPacket::CreateReadRequest(kTestFile, TransferMode::kOctet).Serialize();
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, rrq));
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, rrq));
+
+    std::vector<uint8_t> response;
+    sockaddr_in from = {};
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, from));
+    TftpPacket data_packet;
+    ASSERT_TRUE(data_packet.Deserialize(response));
+    EXPECT_EQ(data_packet.GetOpCode(), OpCode::kData);
+    EXPECT_EQ(data_packet.GetBlockNumber(), 1);
+
+    // No second DATA 1 from another session
+    sockaddr_in second_from = {};
+    EXPECT_FALSE(ReceiveTftpPacket(client_sock, response, second_from, 300));
+
+    std::vector<ListenerStats> stats = server.GetListenerStats();
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].requests, 2u);
+    EXPECT_EQ(stats[0].duplicates, 1u);
+    EXPECT_EQ(stats[0].active_sessions, 1u);
+
+    ASSERT_TRUE(SendTftpPacket(client_sock, from, TftpPacket::CreateAck(1).Serialize()));
+    CloseSocket(client_sock);
+    server.Stop();
+}
+
+// Transfers are served from the configured port range, and its sockets are reused
+TEST_F(TftpServerTest, TransferPortRange) {
+    constexpr uint16_t kTransferPort = 47020;
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetTransferPortRange(kTransferPort, kTransferPort);
+    server.SetSocketBufferSizes(256 * 1024, 256 * 1024);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+    for (int round = 0; round < 2; ++round) {
+        sockaddr_in server_addr = {};
+        server_addr.sin_family = AF_INET;
+        inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+        server_addr.sin_port = htons(kTestPort);
+        ASSERT_TRUE(SendTftpPacket(client_sock, server_addr,
+                                   TftpPacket::CreateReadRequest(kTestFile, TransferMode::kOctet).Serialize()));
+
+        std::vector<uint8_t> response;
+        ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+        EXPECT_EQ(ntohs(server_addr.sin_port), kTransferPort);
+        TftpPacket data_packet;
+        ASSERT_TRUE(data_packet.Deserialize(response));
+        ASSERT_EQ(data_packet.GetOpCode(), OpCode::kData);
+        ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(1).Serialize()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    CloseSocket(client_sock);
+    server.Stop();
+
+    EXPECT_THROW(server.SetTransferPortRange(2000, 1000), TftpException);
+    EXPECT_THROW(server.SetSocketBufferSizes(-1, 0), TftpException);
+}
+
+// Past the queue bound a request is refused, and growing the pool serves the queued one
+TEST_F(TftpServerTest, RequestQueueBound) {
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetThreadPoolSize(1);
+    server.SetMaxQueuedRequests(1);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+    std::vector<uint8_t> rrq = TftpPacket::CreateReadRequest(kTestFile, TransferMode::kOctet).Serialize();
+    int clients[3];
+    for (int& client_sock : clients) {
+        client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(client_sock, 0);
+    }
+
+    // The only worker is kept busy by a transfer that is never acknowledged
+    std::vector<uint8_t> response;
+    sockaddr_in from = {};
+    ASSERT_TRUE(SendTftpPacket(clients[0], server_addr, rrq));
+    ASSERT_TRUE(ReceiveTftpPacket(clients[0], response, from));
+    ASSERT_TRUE(SendTftpPacket(clients[1], server_addr, rrq));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ASSERT_TRUE(SendTftpPacket(clients[2], server_addr, rrq));
+    ASSERT_TRUE(ReceiveTftpPacket(clients[2], response, from));
+    TftpPacket error_packet;
+    ASSERT_TRUE(error_packet.Deserialize(response));
+    EXPECT_EQ(error_packet.GetOpCode(), OpCode::kError);
+    EXPECT_EQ(error_packet.GetErrorMessage(), "Server busy");
+    EXPECT_EQ(ntohs(from.sin_port), kTestPort);
+
+    server.SetThreadPoolSize(2);
+    ASSERT_TRUE(ReceiveTftpPacket(clients[1], response, from));
+    TftpPacket data_packet;
+    ASSERT_TRUE(data_packet.Deserialize(response));
+    EXPECT_EQ(data_packet.GetOpCode(), OpCode::kData);
+
+    std::vector<ListenerStats> stats = server.GetListenerStats();
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].rejected, 1u);
+    EXPECT_EQ(stats[0].dropped, 0u);
+
+    for (int client_sock : clients) {
+        CloseSocket(client_sock);
+    }
+    server.Stop();
+}
+
+// Multicast read (RFC 2090): the OACK names the group, DATA arrives on the group socket
+TEST_F(TftpServerTest, MulticastDownload) {
+    constexpr uint16_t kGroupPort = 17580;
+    std::vector<uint8_t> content(1500);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<uint8_t>(i * 13);
+    }
+    std::ofstream(std::string(kTestRootDir) + "/multicast.dat", std::ios::binary)
+        .write(reinterpret_cast<const char*>(content.data()), content.size());
+
+    int group_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(group_sock, 0);
+    int reuse = 1;
+    setsockopt(group_sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    sockaddr_in group_addr = {};
+    group_addr.sin_family = AF_INET;
+    group_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    group_addr.sin_port = htons(kGroupPort);
+    ASSERT_EQ(bind(group_sock, reinterpret_cast<sockaddr*>(&group_addr), sizeof(group_addr)), 0);
+    ip_mreq membership = {};
+    inet_pton(AF_INET, "239.255.0.69", &membership.imr_multiaddr);
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    // Hosts without a multicast route cannot loop group traffic back to themselves
+    inet_pton(AF_INET, "239.255.0.69", &group_addr.sin_addr);
+    std::vector<uint8_t> probe = TftpPacket::CreateAck(0).Serialize();
+    std::vector<uint8_t> response;
+    sockaddr_in from = {};
+    if (setsockopt(group_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&membership),
+                   sizeof(membership)) != 0 ||
+        !SendTftpPacket(group_sock, group_addr, probe) || !ReceiveTftpPacket(group_sock, response, from, 500)) {
+        CloseSocket(group_sock);
+        GTEST_SKIP() << "IPv4 multicast is not available on this host";
+    }
+
+    TftpServer server(kTestRootDir, kTestPort);
+    server.SetTransferEngine(TransferEngine::kEventDriven, 1);
+    server.SetMulticastGroup("239.255.0.69", kGroupPort);
+    ASSERT_TRUE(server.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    int client_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_sock, 0);
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(kTestPort);
+
+    TftpPacket rrq_packet = TftpPacket::CreateReadRequest("multicast.dat", TransferMode::kOctet);
+    rrq_packet.SetOption("multicast", "");
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, rrq_packet.Serialize()));
+
+    TftpPacket packet;
+    ASSERT_TRUE(ReceiveTftpPacket(client_sock, response, server_addr));
+    ASSERT_TRUE(packet.Deserialize(response));
+    ASSERT_EQ(packet.GetOpCode(), OpCode::kOACK);
+    EXPECT_EQ(packet.GetOption("multicast"), "239.255.0.69," + std::to_string(kGroupPort) + ",1");
+
+    std::vector<uint8_t> file_data;
+    uint16_t block = 0;
+    bool last_packet = false;
+    while (!last_packet) {
+        ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(block).Serialize()));
+        ASSERT_TRUE(ReceiveTftpPacket(group_sock, response, from));
+        ASSERT_TRUE(packet.Deserialize(response));
+        ASSERT_EQ(packet.GetOpCode(), OpCode::kData);
+        ASSERT_EQ(packet.GetBlockNumber(), ++block);
+        file_data.insert(file_data.end(), packet.GetData().begin(), packet.GetData().end());
+        last_packet = packet.GetData().size() < kMaxDataSize;
+    }
+    ASSERT_TRUE(SendTftpPacket(client_sock, server_addr, TftpPacket::CreateAck(block).Serialize()));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(server.GetStats().transfers_completed, 1u);
+    server.Stop();
+    CloseSocket(client_sock);
+    CloseSocket(group_sock);
+    EXPECT_EQ(file_data, content);
+}
+
 // Async upload and download test
 TEST_F(TftpServerTest, AsyncFileTransfer) {
     // Create test files in the same directory as other working tests (kTestRootDir)
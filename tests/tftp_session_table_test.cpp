@@ -0,0 +1,75 @@
+/**
+ * @file tftp_session_table_test.cpp
+ * @brief Unit tests for SessionTable and SessionLease
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_session_table.h"
+#include <cstring>
+#include <utility>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+using namespace tftpserver::internal;
+
+namespace {
+
+sockaddr_in MakeAddress(uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+const uint8_t kRequestA[] = {0, 1, 'a', 0, 'o', 'c', 't', 'e', 't', 0};
+const uint8_t kRequestB[] = {0, 1, 'b', 0, 'o', 'c', 't', 'e', 't', 0};
+
+} // namespace
+
+TEST(TftpSessionTableTest, RejectsDuplicateRequest) {
+    SessionTable table;
+    SessionLease first = table.TryAcquire(MakeAddress(1000), kRequestA, sizeof(kRequestA));
+    ASSERT_TRUE(first);
+    EXPECT_FALSE(table.TryAcquire(MakeAddress(1000), kRequestA, sizeof(kRequestA)));
+    EXPECT_EQ(table.Size(), 1u);
+
+    // Another request or another endpoint is a different session
+    SessionLease other_file = table.TryAcquire(MakeAddress(1000), kRequestB, sizeof(kRequestB));
+    SessionLease other_port = table.TryAcquire(MakeAddress(1001), kRequestA, sizeof(kRequestA));
+    EXPECT_TRUE(other_file);
+    EXPECT_TRUE(other_port);
+    EXPECT_EQ(table.Size(), 3u);
+}
+
+TEST(TftpSessionTableTest, LeaseReleasesEntry) {
+    SessionTable table;
+    {
+        SessionLease lease = table.TryAcquire(MakeAddress(1000), kRequestA, sizeof(kRequestA));
+        ASSERT_TRUE(lease);
+        EXPECT_EQ(table.Size(), 1u);
+    }
+    EXPECT_EQ(table.Size(), 0u);
+
+    SessionLease lease = table.TryAcquire(MakeAddress(1000), kRequestA, sizeof(kRequestA));
+    ASSERT_TRUE(lease);
+    lease.Release();
+    EXPECT_FALSE(lease);
+    EXPECT_EQ(table.Size(), 0u);
+}
+
+TEST(TftpSessionTableTest, LeaseMovesOwnership) {
+    SessionTable table;
+    SessionLease original = table.TryAcquire(MakeAddress(1000), kRequestA, sizeof(kRequestA));
+    SessionLease moved = std::move(original);
+    EXPECT_FALSE(original);
+    EXPECT_TRUE(moved);
+
+    original.Release();  // No-op on an empty lease
+    EXPECT_EQ(table.Size(), 1u);
+
+    moved = SessionLease();
+    EXPECT_EQ(table.Size(), 0u);
+}
@@ -0,0 +1,151 @@
+/**
+ * @file tftp_socket_pool_test.cpp
+ * @brief Unit tests for TransferSocketPool and TransferSocketLease
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_socket_pool.h"
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define CLOSESOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define CLOSESOCKET close
+#endif
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+namespace {
+
+constexpr uint16_t kFirstPort = 47010;
+constexpr uint16_t kLastPort = 47012;
+
+uint16_t LocalPort(socket_t sock) {
+    sockaddr_in addr = {};
+#ifdef _WIN32
+    int addrlen = sizeof(addr);
+#else
+    socklen_t addrlen = sizeof(addr);
+#endif
+    getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addrlen);
+    return ntohs(addr.sin_port);
+}
+
+void SendToPort(uint16_t port) {
+    socket_t sender = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    const char payload[] = "stale";
+    sendto(sender, payload, sizeof(payload), 0, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    CLOSESOCKET(sender);
+}
+
+} // namespace
+
+TEST(TftpSocketPoolTest, ReusesEphemeralSockets) {
+    TransferSocketPool pool;
+    ASSERT_TRUE(pool.Open(TransferSocketConfig()));
+
+    TransferSocketLease first = pool.Acquire(true);
+    ASSERT_TRUE(first);
+    socket_t sock = first.Get();
+    EXPECT_NE(LocalPort(sock), 0);
+    EXPECT_EQ(pool.GetLeasedCount(), 1u);
+
+    first.Release();
+    EXPECT_EQ(pool.GetLeasedCount(), 0u);
+    EXPECT_EQ(pool.GetIdleCount(), 1u);
+
+    TransferSocketLease second = pool.Acquire(false);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second.Get(), sock);
+
+    // A closed pool hands out nothing and closes what comes back
+    pool.Close();
+    EXPECT_FALSE(pool.Acquire(true));
+    second.Release();
+    EXPECT_EQ(pool.GetIdleCount(), 0u);
+}
+
+TEST(TftpSocketPoolTest, PortRangeIsBoundUpFront) {
+    TransferSocketConfig config;
+    config.first_port = kFirstPort;
+    config.last_port = kLastPort;
+    TransferSocketPool pool;
+    ASSERT_TRUE(pool.Open(config));
+    EXPECT_EQ(pool.GetIdleCount(), 3u);
+
+    std::vector<TransferSocketLease> leases;
+    for (int i = 0; i < 3; ++i) {
+        leases.push_back(pool.Acquire(true));
+        ASSERT_TRUE(leases.back());
+        uint16_t port = LocalPort(leases.back().Get());
+        EXPECT_GE(port, kFirstPort);
+        EXPECT_LE(port, kLastPort);
+    }
+    // The range is exhausted rather than extended with ephemeral ports
+    EXPECT_FALSE(pool.Acquire(true));
+
+    leases.pop_back();
+    EXPECT_TRUE(pool.Acquire(true));
+}
+
+TEST(TftpSocketPoolTest, StaleDatagramsAreDiscarded) {
+    TransferSocketConfig config;
+    config.first_port = kFirstPort;
+    config.last_port = kFirstPort;
+    TransferSocketPool pool;
+    ASSERT_TRUE(pool.Open(config));
+
+    TransferSocketLease lease = pool.Acquire(true);
+    ASSERT_TRUE(lease);
+    SendToPort(kFirstPort);
+    SendToPort(kFirstPort);
+    lease.Release();
+
+    lease = pool.Acquire(true);
+    ASSERT_TRUE(lease);
+    char buffer[16];
+    EXPECT_LT(recv(lease.Get(), buffer, sizeof(buffer), 0), 0);
+}
+
+TEST(TftpSocketPoolTest, AppliesBufferSizes) {
+    // Small sizes, so that neither the system maximum nor the default hides the change
+    TransferSocketConfig config;
+    config.receive_buffer = 8192;
+    config.send_buffer = 8192;
+    TransferSocketPool pool;
+    ASSERT_TRUE(pool.Open(config));
+    TransferSocketPool default_pool;
+    ASSERT_TRUE(default_pool.Open(TransferSocketConfig()));
+
+    TransferSocketLease sized = pool.Acquire(true);
+    TransferSocketLease unsized = default_pool.Acquire(true);
+    ASSERT_TRUE(sized);
+    ASSERT_TRUE(unsized);
+    for (int option : {SO_RCVBUF, SO_SNDBUF}) {
+        int sized_bytes = 0;
+        int default_bytes = 0;
+#ifdef _WIN32
+        int length = sizeof(int);
+#else
+        socklen_t length = sizeof(int);
+#endif
+        getsockopt(sized.Get(), SOL_SOCKET, option, reinterpret_cast<char*>(&sized_bytes), &length);
+        length = sizeof(int);
+        getsockopt(unsized.Get(), SOL_SOCKET, option, reinterpret_cast<char*>(&default_bytes), &length);
+        EXPECT_GT(sized_bytes, 0);
+        EXPECT_LT(sized_bytes, default_bytes);
+    }
+}
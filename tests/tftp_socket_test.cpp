@@ -0,0 +1,192 @@
+/**
+ * @file tftp_socket_test.cpp
+ * @brief Unit tests for UdpSocket batch send and receive
+ */
+
+#include <gtest/gtest.h>
+#include "tftp/tftp_socket.h"
+#include "internal/tftp_socket_impl.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace tftpserver::net;
+
+class TftpSocketBatchTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(guard_.IsInitialized());
+        ASSERT_TRUE(sender_.Create());
+        ASSERT_TRUE(receiver_.Create());
+        ASSERT_TRUE(receiver_.Bind(SocketAddress("127.0.0.1", 0)));
+
+        sockaddr_in bound = {};
+#ifdef _WIN32
+        int addrlen = sizeof(bound);
+#else
+        socklen_t addrlen = sizeof(bound);
+#endif
+        ASSERT_EQ(getsockname(receiver_.GetNativeHandle(), reinterpret_cast<sockaddr*>(&bound), &addrlen), 0);
+        receiver_addr_ = bound;
+    }
+
+    // Builds count datagrams of the given sizes, each filled with its index
+    std::vector<OutgoingDatagram> MakeBatch(const std::vector<size_t>& sizes) {
+        payloads_.clear();
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            payloads_.emplace_back(sizes[i], static_cast<uint8_t>(i + 1));
+        }
+        std::vector<OutgoingDatagram> batch(sizes.size());
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            batch[i].data = payloads_[i].data();
+            batch[i].size = payloads_[i].size();
+            batch[i].addr = receiver_addr_;
+        }
+        return batch;
+    }
+
+    // Receives until expected datagrams arrived or a receive times out, slot_count at a time
+    std::vector<std::vector<uint8_t>> ReceiveAll(size_t expected, size_t slot_count = 8) {
+        std::vector<std::vector<uint8_t>> received;
+        std::vector<uint8_t> storage(slot_count * 65536);
+        std::vector<IncomingDatagram> slots(slot_count);
+        while (received.size() < expected) {
+            for (size_t i = 0; i < slots.size(); ++i) {
+                slots[i].buffer = storage.data() + i * 65536;
+                slots[i].capacity = 65536;
+            }
+            int count = receiver_.ReceiveBatch(slots.data(), slots.size(), 1000);
+            if (count <= 0) {
+                break;
+            }
+            for (int i = 0; i < count; ++i) {
+                received.emplace_back(slots[i].buffer, slots[i].buffer + slots[i].length);
+            }
+        }
+        return received;
+    }
+
+    void ExpectBatch(const std::vector<std::vector<uint8_t>>& received) {
+        ASSERT_EQ(received.size(), payloads_.size());
+        for (size_t i = 0; i < received.size(); ++i) {
+            EXPECT_EQ(received[i], payloads_[i]) << "Datagram " << i;
+        }
+    }
+
+    SocketLibraryGuard guard_;
+    UdpSocket sender_;
+    UdpSocket receiver_;
+    // Moves all but the first header_size bytes of each datagram into its payload
+    static void Gather(std::vector<OutgoingDatagram>& batch, size_t header_size) {
+        for (OutgoingDatagram& datagram : batch) {
+            size_t split = std::min(header_size, datagram.size);
+            datagram.payload = datagram.data + split;
+            datagram.payload_size = datagram.size - split;
+            datagram.size = split;
+            datagram.immutable = true;
+        }
+    }
+
+    sockaddr_in receiver_addr_ = {};
+    std::vector<std::vector<uint8_t>> payloads_;
+};
+
+TEST_F(TftpSocketBatchTest, SendAndReceiveBatch) {
+    std::vector<OutgoingDatagram> batch = MakeBatch({516, 516, 100, 4, 516});
+    ASSERT_EQ(sender_.SendBatch(batch.data(), batch.size()), 5);
+    ExpectBatch(ReceiveAll(batch.size()));
+}
+
+TEST_F(TftpSocketBatchTest, SegmentationOffloadKeepsDatagramBoundaries) {
+    // A TFTP window: full blocks followed by a short last block
+    sender_.SetSegmentationOffload(true);
+    std::vector<OutgoingDatagram> batch = MakeBatch({516, 516, 516, 516, 516, 200});
+    ASSERT_EQ(sender_.SendBatch(batch.data(), batch.size()), 6);
+    ExpectBatch(ReceiveAll(batch.size()));
+}
+
+TEST_F(TftpSocketBatchTest, ReceiveOffloadSplitsCoalescedDatagrams) {
+    sender_.SetSegmentationOffload(true);
+    receiver_.SetReceiveOffload(true);
+    std::vector<OutgoingDatagram> batch = MakeBatch({1028, 1028, 1028, 1028, 300});
+    ASSERT_EQ(sender_.SendBatch(batch.data(), batch.size()), 5);
+    ExpectBatch(ReceiveAll(batch.size()));
+}
+
+TEST_F(TftpSocketBatchTest, ReceiveOffloadKeepsSegmentsPastTheBatch) {
+    sender_.SetSegmentationOffload(true);
+    receiver_.SetReceiveOffload(true);
+    // More segments than receive slots: the rest comes out of the next receives, in order
+    std::vector<size_t> sizes(15, 516);
+    sizes.push_back(100);
+    std::vector<OutgoingDatagram> batch = MakeBatch(sizes);
+    ASSERT_EQ(sender_.SendBatch(batch.data(), batch.size()), 16);
+    ExpectBatch(ReceiveAll(batch.size(), 3));
+}
+
+TEST_F(TftpSocketBatchTest, GatheredDatagramsArriveWhole) {
+    std::vector<OutgoingDatagram> batch = MakeBatch({516, 516, 100, 4, 516});
+    Gather(batch, 4);
+    ASSERT_EQ(sender_.SendBatch(batch.data(), batch.size()), 5);
+    ExpectBatch(ReceiveAll(batch.size()));
+
+    sender_.SetSegmentationOffload(true);
+    batch = MakeBatch({1028, 1028, 1028, 300});
+    Gather(batch, 4);
+    ASSERT_EQ(sender_.SendBatch(batch.data(), batch.size()), 4);
+    ExpectBatch(ReceiveAll(batch.size()));
+}
+
+#ifdef __linux__
+TEST_F(TftpSocketBatchTest, ZeroCopySendsAreReaped) {
+    using tftpserver::net::internal::SocketImpl;
+    using tftpserver::net::internal::ZeroCopyState;
+
+    ZeroCopyState state;
+    if (!SocketImpl::EnableZeroCopy(sender_.GetNativeHandle(), state)) {
+        GTEST_SKIP() << "SO_ZEROCOPY not supported";
+    }
+    std::vector<OutgoingDatagram> batch = MakeBatch({32768, 32768});
+    Gather(batch, 4);
+    ASSERT_EQ(SocketImpl::SendDatagrams(sender_.GetNativeHandle(), batch.data(), batch.size(), false, &state), 2);
+    EXPECT_EQ(state.issued, 2u);
+    ExpectBatch(ReceiveAll(batch.size()));
+
+    // Payloads stay pinned until the completions are read off the error queue
+    for (int i = 0; i < 100 && state.Pending() > 0; ++i) {
+        SocketImpl::ReapZeroCopy(sender_.GetNativeHandle(), state);
+        if (state.Pending() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    EXPECT_EQ(state.Pending(), 0u);
+
+    // Loopback always copies, after which the socket stops asking for zero-copy
+    if (state.copied) {
+        EXPECT_FALSE(state.IsActive());
+        batch = MakeBatch({32768});
+        Gather(batch, 4);
+        ASSERT_EQ(SocketImpl::SendDatagrams(sender_.GetNativeHandle(), batch.data(), batch.size(), false, &state), 1);
+        EXPECT_EQ(state.issued, 2u);
+        ExpectBatch(ReceiveAll(batch.size()));
+    }
+}
+#endif
+
+TEST_F(TftpSocketBatchTest, ReceiveBatchTimeout) {
+    std::vector<uint8_t> buffer(64);
+    IncomingDatagram slot;
+    slot.buffer = buffer.data();
+    slot.capacity = buffer.size();
+    EXPECT_EQ(receiver_.ReceiveBatch(&slot, 1, 50), 0);
+    EXPECT_EQ(receiver_.ReceiveBatch(&slot, 1, 0), 0);
+}
+
+TEST_F(TftpSocketBatchTest, InvalidParameters) {
+    EXPECT_EQ(sender_.SendBatch(nullptr, 1), -1);
+    UdpSocket closed;
+    OutgoingDatagram datagram;
+    EXPECT_EQ(closed.SendBatch(&datagram, 1), -1);
+}
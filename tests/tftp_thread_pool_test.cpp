@@ -225,4 +225,115 @@ TEST_F(TftpThreadPoolTest, TaskCountAccuracy) {
 
     EXPECT_EQ(pool.GetActiveTaskCount(), 0);
     EXPECT_EQ(pool.GetQueuedTaskCount(), 0);
-}
\ No newline at end of file
+}
+
+TEST_F(TftpThreadPoolTest, PostRunsWithoutFuture) {
+    TftpThreadPool pool(2);
+    std::atomic<int> counter(0);
+
+    // Move-only state is accepted
+    auto value = std::make_unique<int>(5);
+    EXPECT_TRUE(pool.Post([&counter, value = std::move(value)]() { counter.fetch_add(*value); }));
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(pool.Post([&counter]() { counter.fetch_add(1); }));
+    }
+    while (counter.load() < 105) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    pool.Shutdown();
+    EXPECT_FALSE(pool.Post([]() {}));
+}
+
+TEST_F(TftpThreadPoolTest, DequeOwnerTakesNewestAndThievesOldest) {
+    WorkStealingDeque deque(2);
+    std::vector<std::unique_ptr<PoolJob>> jobs;
+    for (int i = 0; i < 10; ++i) {
+        jobs.push_back(std::make_unique<PoolJobImpl<std::function<void()>>>([]() {}));
+        deque.Push(jobs.back().get());
+    }
+    // Pushing past the initial capacity grows the ring without losing jobs
+    EXPECT_EQ(deque.Size(), 10u);
+    EXPECT_EQ(deque.Take(), jobs[9].get());
+    EXPECT_EQ(deque.Steal(), jobs[0].get());
+    EXPECT_EQ(deque.Steal(), jobs[1].get());
+    EXPECT_EQ(deque.Size(), 7u);
+
+    while (deque.Take() != nullptr) {
+    }
+    EXPECT_EQ(deque.Steal(), nullptr);
+    EXPECT_EQ(deque.Size(), 0u);
+}
+
+TEST_F(TftpThreadPoolTest, IdleWorkersStealQueuedJobs) {
+    TftpThreadPool pool(4);
+    std::atomic<bool> release(false);
+    std::atomic<int> done(0);
+
+    // A long task posts follow-up jobs to its own deque; the other workers must run them
+    // while it is still blocked
+    auto blocker = pool.Submit([&pool, &release, &done]() {
+        for (int i = 0; i < 20; ++i) {
+            pool.Post([&done]() { done.fetch_add(1); });
+        }
+        while (!release.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (done.load() < 20 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(done.load(), 20);
+    release = true;
+    blocker.get();
+}
+
+TEST_F(TftpThreadPoolTest, ResizeWhileRunning) {
+    TftpThreadPool pool(2);
+    std::atomic<bool> release(false);
+    std::atomic<int> running(0);
+
+    // Both workers are busy; growing the pool runs the queued tasks without waiting for them
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; ++i) {
+        futures.push_back(pool.Submit([&release, &running]() {
+            running.fetch_add(1);
+            while (!release.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }));
+    }
+    pool.Resize(4);
+    EXPECT_EQ(pool.GetThreadCount(), 4u);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (running.load() < 4 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(running.load(), 4);
+
+    // Shrinking lets the running tasks finish and keeps taking new ones
+    pool.Resize(1);
+    EXPECT_EQ(pool.GetThreadCount(), 1u);
+    release = true;
+    for (auto& future : futures) {
+        future.get();
+    }
+    EXPECT_EQ(pool.Submit([]() { return 7; }).get(), 7);
+
+    // And a retired slot can be started again
+    pool.Resize(3);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 30; ++i) {
+        results.push_back(pool.Submit([i]() { return i; }));
+    }
+    for (int i = 0; i < 30; ++i) {
+        EXPECT_EQ(results[i].get(), i);
+    }
+}
+
+TEST_F(TftpThreadPoolTest, PinnedWorkersRunTasks) {
+    TftpThreadPool pool(2, true);
+    EXPECT_EQ(pool.Submit([]() { return 1; }).get(), 1);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file tftp_timer_wheel_test.cpp
+ * @brief Unit tests for TimerWheel
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_timer_wheel.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+using std::chrono::milliseconds;
+
+class TftpTimerWheelTest : public ::testing::Test {
+protected:
+    TimerWheel::Clock::time_point start_ = TimerWheel::Clock::now();
+};
+
+TEST_F(TftpTimerWheelTest, FiresInDeadlineOrder) {
+    TimerWheel wheel(milliseconds(10), 64, start_);
+    wheel.Schedule(2, start_ + milliseconds(50));
+    wheel.Schedule(1, start_ + milliseconds(20));
+    EXPECT_EQ(wheel.Size(), 2u);
+
+    std::vector<uint64_t> expired;
+    wheel.Advance(start_ + milliseconds(30), expired);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], 1u);
+
+    wheel.Advance(start_ + milliseconds(60), expired);
+    ASSERT_EQ(expired.size(), 2u);
+    EXPECT_EQ(expired[1], 2u);
+    EXPECT_EQ(wheel.Size(), 0u);
+    EXPECT_EQ(wheel.NextTimeoutMs(start_ + milliseconds(60)), -1);
+}
+
+TEST_F(TftpTimerWheelTest, NeverFiresEarly) {
+    TimerWheel wheel(milliseconds(10), 64, start_);
+    wheel.Schedule(1, start_ + milliseconds(25));
+
+    std::vector<uint64_t> expired;
+    wheel.Advance(start_ + milliseconds(24), expired);
+    EXPECT_TRUE(expired.empty());
+    EXPECT_GT(wheel.NextTimeoutMs(start_ + milliseconds(24)), 0);
+
+    wheel.Advance(start_ + milliseconds(30), expired);
+    EXPECT_EQ(expired.size(), 1u);
+}
+
+TEST_F(TftpTimerWheelTest, DeadlinesBeyondOneTurn) {
+    // 8 slots of 10ms: a 1s deadline wraps the wheel many times before it is due
+    TimerWheel wheel(milliseconds(10), 8, start_);
+    wheel.Schedule(7, start_ + milliseconds(1000));
+    wheel.Schedule(8, start_ + milliseconds(15));
+
+    std::vector<uint64_t> expired;
+    for (int ms = 10; ms < 1000; ms += 10) {
+        wheel.Advance(start_ + milliseconds(ms), expired);
+    }
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], 8u);
+
+    // A long jump forward still finds the remaining timer
+    wheel.Advance(start_ + milliseconds(5000), expired);
+    ASSERT_EQ(expired.size(), 2u);
+    EXPECT_EQ(expired[1], 7u);
+}
+
+TEST_F(TftpTimerWheelTest, IgnoresUnarmedDeadline) {
+    TimerWheel wheel(milliseconds(10), 8, start_);
+    wheel.Schedule(1, TimerWheel::Clock::time_point::max());
+    EXPECT_EQ(wheel.Size(), 0u);
+}
+
+TEST_F(TftpTimerWheelTest, NextTimeoutIsEarliestExpiry) {
+    TimerWheel wheel(milliseconds(10), 64, start_);
+    // Waits for the timer rather than for the next tick boundary
+    wheel.Schedule(1, start_ + milliseconds(1000));
+    EXPECT_EQ(wheel.NextTimeoutMs(start_ + milliseconds(3)), 997);
+
+    wheel.Schedule(2, start_ + milliseconds(45));
+    EXPECT_EQ(wheel.NextTimeoutMs(start_ + milliseconds(3)), 47);
+    EXPECT_EQ(wheel.NextTimeoutMs(start_ + milliseconds(60)), 0);
+
+    std::vector<uint64_t> expired;
+    wheel.Advance(start_ + milliseconds(60), expired);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(wheel.NextTimeoutMs(start_ + milliseconds(60)), 940);
+
+    // Found again when it is more than one turn away
+    TimerWheel small(milliseconds(10), 8, start_);
+    small.Schedule(1, start_ + milliseconds(25));
+    small.Schedule(2, start_ + milliseconds(500));
+    small.Advance(start_ + milliseconds(30), expired);
+    EXPECT_EQ(small.NextTimeoutMs(start_ + milliseconds(30)), 470);
+}
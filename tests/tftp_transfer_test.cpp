@@ -0,0 +1,804 @@
+/**
+ * @file tftp_transfer_test.cpp
+ * @brief Unit tests for the Transfer state machines
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_transfer.h"
+#include "internal/tftp_io_stage.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+using std::chrono::milliseconds;
+
+namespace {
+
+// Records everything a transfer sends, decoded back into packets
+class RecordingChannel : public TransferChannel {
+public:
+    bool Send(const uint8_t* data, size_t size) override {
+        sent.push_back(Decode(data, size));
+        return true;
+    }
+    bool SendTo(const sockaddr_in& addr, const uint8_t* data, size_t size) override {
+        (void)addr;
+        rejected.push_back(Decode(data, size));
+        return true;
+    }
+    bool SendBatch(const net::OutgoingDatagram* datagrams, size_t count) override {
+        batches.push_back(count);
+        return TransferChannel::SendBatch(datagrams, count);
+    }
+
+    static TftpPacket Decode(const uint8_t* data, size_t size) {
+        TftpPacket packet;
+        EXPECT_TRUE(packet.Deserialize(data, size, kMaxBlockSize));
+        return packet;
+    }
+
+    std::vector<TftpPacket> sent;
+    std::vector<TftpPacket> rejected;
+    std::vector<size_t> batches;
+};
+
+// Delivers a packet the way an engine does: encoded, then parsed into a view
+void Deliver(Transfer& transfer, const TftpPacket& packet, const sockaddr_in& from, Transfer::Clock::time_point now) {
+    std::vector<uint8_t> data = packet.Serialize();
+    PacketView view;
+    ASSERT_TRUE(view.Parse(data.data(), data.size(), kMaxBlockSize));
+    transfer.HandlePacket(view, from, now);
+}
+
+class MemoryReadSource : public ReadSource {
+public:
+    explicit MemoryReadSource(size_t size) : data_(size) {
+        for (size_t i = 0; i < size; ++i) {
+            data_[i] = static_cast<uint8_t>(i);
+        }
+    }
+    bool Open(const std::string& path) override {
+        (void)path;
+        return true;
+    }
+    uint64_t Size() const override { return data_.size(); }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        bytes_read = offset >= data_.size() ? 0 : std::min<size_t>(length, data_.size() - offset);
+        std::memcpy(buffer, data_.data() + offset, bytes_read);
+        return true;
+    }
+    void Close() override {}
+
+private:
+    std::vector<uint8_t> data_;
+};
+
+// Memory source that reports its size through Stat and counts what the transfer asks of it
+class CountingReadSource : public MemoryReadSource {
+public:
+    explicit CountingReadSource(size_t size) : MemoryReadSource(size), size_(size) {}
+    bool Stat(const std::string& path, uint64_t& size) override {
+        (void)path;
+        stats++;
+        size = size_;
+        return true;
+    }
+    bool Open(const std::string& path) override {
+        opens++;
+        return MemoryReadSource::Open(path);
+    }
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        reads++;
+        return MemoryReadSource::ReadAt(offset, buffer, length, bytes_read);
+    }
+
+    int stats = 0;
+    int opens = 0;
+    int reads = 0;
+
+private:
+    size_t size_;
+};
+
+// Memory source lending blocks in place, the way the mapped file cache does
+class BorrowingReadSource : public CountingReadSource {
+public:
+    explicit BorrowingReadSource(size_t size) : CountingReadSource(size), bytes_(size) {
+        for (size_t i = 0; i < size; ++i) {
+            bytes_[i] = static_cast<uint8_t>(i);
+        }
+    }
+    const uint8_t* PeekAt(uint64_t offset, size_t length) override {
+        EXPECT_LE(offset + length, bytes_.size());
+        peeks++;
+        return bytes_.data() + offset;
+    }
+
+    int peeks = 0;
+
+private:
+    std::vector<uint8_t> bytes_;
+};
+
+// Memory source recording the ReadBatch calls the transfer makes
+class BatchingReadSource : public CountingReadSource {
+public:
+    explicit BatchingReadSource(size_t size) : CountingReadSource(size) {}
+    bool ReadBatch(ReadRequest* requests, size_t count) override {
+        batches.push_back(count);
+        return CountingReadSource::ReadBatch(requests, count);
+    }
+
+    std::vector<size_t> batches;
+};
+
+class DiscardWriteSink : public WriteSink {
+public:
+    bool Open(const std::string& path, uint64_t size_hint) override {
+        (void)path;
+        (void)size_hint;
+        return true;
+    }
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override {
+        (void)offset;
+        (void)data;
+        (void)length;
+        return true;
+    }
+    bool Commit() override { return true; }
+    void Abort() override {}
+};
+
+// Blocks the I/O stage until opened, to hold a transfer in its wait for the disk
+class Gate {
+public:
+    void Pass() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this]() { return open_; });
+    }
+    void Set(bool open) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = open;
+        changed_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool open_ = false;
+};
+
+class GatedReadSource : public MemoryReadSource {
+public:
+    GatedReadSource(size_t size, Gate& gate) : MemoryReadSource(size), gate_(gate) {}
+    bool ReadAt(uint64_t offset, uint8_t* buffer, size_t length, size_t& bytes_read) override {
+        gate_.Pass();
+        return MemoryReadSource::ReadAt(offset, buffer, length, bytes_read);
+    }
+
+private:
+    Gate& gate_;
+};
+
+class GatedWriteSink : public DiscardWriteSink {
+public:
+    explicit GatedWriteSink(Gate& gate) : gate_(gate) {}
+    bool Write(uint64_t offset, const uint8_t* data, size_t length) override {
+        gate_.Pass();
+        return DiscardWriteSink::Write(offset, data, length);
+    }
+    bool Commit() override {
+        gate_.Pass();
+        return true;
+    }
+
+private:
+    Gate& gate_;
+};
+
+sockaddr_in MakeAddress(uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+TransferConfig MakeConfig() {
+    TransferConfig config;
+    config.filepath = "memory.bin";
+    config.max_size = 1024 * 1024;
+    config.timeout_secs = 1;
+    return config;
+}
+
+} // namespace
+
+TEST(TftpTransferTest, ReadTransferRetransmitsAndCompletes) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<MemoryReadSource>(700));
+    transfer.Start(now);
+    ASSERT_EQ(channel.sent.size(), 1u);
+    EXPECT_EQ(channel.sent[0].GetOpCode(), OpCode::kData);
+    EXPECT_EQ(channel.sent[0].GetBlockNumber(), 1);
+    EXPECT_GT(transfer.Deadline(), now);
+
+    // Lost block 1 is resent on timeout
+    transfer.OnTimeout(transfer.Deadline());
+    ASSERT_EQ(channel.sent.size(), 2u);
+    EXPECT_EQ(channel.sent[1].GetBlockNumber(), 1);
+
+    Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+    ASSERT_EQ(channel.sent.size(), 3u);
+    EXPECT_EQ(channel.sent[2].GetBlockNumber(), 2);
+    EXPECT_EQ(channel.sent[2].GetData().size(), 188u);
+
+    Deliver(transfer, TftpPacket::CreateAck(2), peer, now);
+    EXPECT_TRUE(transfer.IsFinished());
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+TEST(TftpTransferTest, ReadTransferSendsWindowAsOneBatch) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("windowsize", "4");
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<MemoryReadSource>(2500));
+    transfer.Start(now);
+    ASSERT_EQ(channel.sent.size(), 1u);
+    EXPECT_EQ(channel.sent[0].GetOpCode(), OpCode::kOACK);
+
+    Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+    ASSERT_EQ(channel.batches, std::vector<size_t>({4}));
+    ASSERT_EQ(channel.sent.size(), 5u);
+    for (uint16_t block = 1; block <= 4; ++block) {
+        const TftpPacket& data = channel.sent[block];
+        EXPECT_EQ(data.GetBlockNumber(), block);
+        ASSERT_EQ(data.GetData().size(), 512u);
+        EXPECT_EQ(data.GetData()[0], static_cast<uint8_t>((block - 1) * 512));
+    }
+
+    // The reused send buffer carries the short final window
+    Deliver(transfer, TftpPacket::CreateAck(4), peer, now);
+    ASSERT_EQ(channel.sent.size(), 6u);
+    EXPECT_EQ(channel.sent[5].GetBlockNumber(), 5);
+    EXPECT_EQ(channel.sent[5].GetData().size(), 452u);
+    EXPECT_EQ(channel.sent[5].GetData()[0], static_cast<uint8_t>(2048));
+
+    Deliver(transfer, TftpPacket::CreateAck(5), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+// Channel lending the storage of every batch, as the io_uring engine does
+class LendingChannel : public RecordingChannel {
+public:
+    uint8_t* BatchBuffer(size_t size) override {
+        requested.push_back(size);
+        lent.assign(size, 0xEE);
+        return lent.data();
+    }
+    bool SendBatch(const net::OutgoingDatagram* datagrams, size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            in_lent_storage.push_back(datagrams[i].data >= lent.data() &&
+                                      datagrams[i].data + datagrams[i].size <= lent.data() + lent.size());
+        }
+        return RecordingChannel::SendBatch(datagrams, count);
+    }
+
+    std::vector<uint8_t> lent;
+    std::vector<size_t> requested;
+    std::vector<bool> in_lent_storage;
+};
+
+TEST(TftpTransferTest, ReadTransferEncodesIntoLentStorage) {
+    LendingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("windowsize", "4");
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<MemoryReadSource>(2500));
+    transfer.Start(now);
+    Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+    ASSERT_EQ(channel.sent.size(), 5u);
+    EXPECT_EQ(channel.requested, std::vector<size_t>({4 * 516u}));
+    EXPECT_EQ(channel.in_lent_storage, std::vector<bool>(4, true));
+    EXPECT_EQ(channel.sent[3].GetData()[0], static_cast<uint8_t>(1024));
+
+    // The short final window asks for one packet
+    Deliver(transfer, TftpPacket::CreateAck(4), peer, now);
+    ASSERT_EQ(channel.sent.size(), 6u);
+    EXPECT_EQ(channel.requested.back(), 516u);
+    EXPECT_EQ(channel.sent[5].GetData().size(), 452u);
+    Deliver(transfer, TftpPacket::CreateAck(5), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+TEST(TftpTransferTest, ReadTransferSendsBorrowedBlocks) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("windowsize", "4");
+    auto source = std::make_unique<BorrowingReadSource>(2500);
+    BorrowingReadSource* counters = source.get();
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::move(source));
+    transfer.Start(now);
+    Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+
+    // Header and borrowed payload are gathered into whole DATA packets
+    ASSERT_EQ(channel.sent.size(), 5u);
+    for (uint16_t block = 1; block <= 4; ++block) {
+        const TftpPacket& data = channel.sent[block];
+        EXPECT_EQ(data.GetBlockNumber(), block);
+        ASSERT_EQ(data.GetData().size(), 512u);
+        EXPECT_EQ(data.GetData()[1], static_cast<uint8_t>((block - 1) * 512 + 1));
+    }
+
+    Deliver(transfer, TftpPacket::CreateAck(4), peer, now);
+    ASSERT_EQ(channel.sent.size(), 6u);
+    EXPECT_EQ(channel.sent[5].GetBlockNumber(), 5);
+    EXPECT_EQ(channel.sent[5].GetData().size(), 452u);
+    Deliver(transfer, TftpPacket::CreateAck(5), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+    EXPECT_EQ(counters->peeks, 5);
+    EXPECT_EQ(counters->reads, 0);
+}
+
+TEST(TftpTransferTest, ReadTransferBatchesWindowReads) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("windowsize", "4");
+    auto source = std::make_unique<BatchingReadSource>(2500);
+    BatchingReadSource* counters = source.get();
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::move(source));
+    transfer.Start(now);
+    Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+
+    // The whole window is read with one call
+    ASSERT_EQ(channel.sent.size(), 5u);
+    ASSERT_EQ(counters->batches, std::vector<size_t>({4}));
+    EXPECT_EQ(channel.sent[3].GetData()[0], static_cast<uint8_t>(2 * 512));
+
+    Deliver(transfer, TftpPacket::CreateAck(4), peer, now);
+    Deliver(transfer, TftpPacket::CreateAck(5), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+    EXPECT_EQ(counters->batches, std::vector<size_t>({4, 1}));
+    EXPECT_EQ(counters->reads, 5);
+}
+
+TEST(TftpTransferTest, RejectsUnknownTransferId) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<MemoryReadSource>(100));
+    transfer.Start(now);
+
+    Deliver(transfer, TftpPacket::CreateAck(1), MakeAddress(40001), now);
+    ASSERT_EQ(channel.rejected.size(), 1u);
+    EXPECT_EQ(channel.rejected[0].GetErrorCode(), ErrorCode::kUnknownTransferId);
+    EXPECT_FALSE(transfer.IsFinished());
+
+    Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+TEST(TftpTransferTest, ReadTransferIgnoresDuplicateAck) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<MemoryReadSource>(1500));
+    transfer.Start(now);
+    Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+    ASSERT_EQ(channel.sent.size(), 2u);
+
+    // Neither a duplicate nor a stale ACK resends block 2 (Sorcerer's Apprentice)
+    Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+    Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+    EXPECT_EQ(channel.sent.size(), 2u);
+    EXPECT_FALSE(transfer.IsFinished());
+
+    Deliver(transfer, TftpPacket::CreateAck(2), peer, now);
+    ASSERT_EQ(channel.sent.size(), 3u);
+    EXPECT_EQ(channel.sent[2].GetBlockNumber(), 3);
+    Deliver(transfer, TftpPacket::CreateAck(3), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+TEST(TftpTransferTest, WriteTransferReAcksDuplicateData) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateWriteRequest("memory.bin", TransferMode::kOctet);
+    WriteTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<DiscardWriteSink>());
+    transfer.Start(now);
+    std::vector<uint8_t> block(512, 0x5a);
+    Deliver(transfer, TftpPacket::CreateData(1, block), peer, now);
+    ASSERT_EQ(channel.sent.size(), 2u);
+
+    // Our ACK 1 was lost and the client resends block 1
+    Deliver(transfer, TftpPacket::CreateData(1, block), peer, now);
+    ASSERT_EQ(channel.sent.size(), 3u);
+    EXPECT_EQ(channel.sent[2].GetOpCode(), OpCode::kAcknowledge);
+    EXPECT_EQ(channel.sent[2].GetBlockNumber(), 1);
+    EXPECT_FALSE(transfer.IsFinished());
+
+    Deliver(transfer, TftpPacket::CreateData(2, std::vector<uint8_t>(10, 0x5a)), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+TEST(TftpTransferTest, BlockNumbersWrapAround) {
+    constexpr size_t kBlockSize = 8;
+    constexpr uint64_t kBlocks = 65536;  // The last block goes out as block 0
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    {
+        RecordingChannel channel;
+        TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+        request.SetOption("blksize", std::to_string(kBlockSize));
+        ReadTransfer transfer(channel, peer, MakeConfig(), request,
+                              std::make_unique<MemoryReadSource>(kBlocks * kBlockSize - 1));
+        transfer.Start(now);
+        for (uint64_t block = 0; block < kBlocks && !transfer.IsFinished(); ++block) {
+            Deliver(transfer, TftpPacket::CreateAck(static_cast<uint16_t>(block)), peer, now);
+        }
+        EXPECT_FALSE(transfer.IsFinished());
+        ASSERT_EQ(channel.sent.back().GetBlockNumber(), 0);
+        EXPECT_EQ(channel.sent.back().GetData().size(), kBlockSize - 1);
+        Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+        EXPECT_TRUE(transfer.Succeeded());
+    }
+    {
+        RecordingChannel channel;
+        TftpPacket request = TftpPacket::CreateWriteRequest("memory.bin", TransferMode::kOctet);
+        request.SetOption("blksize", std::to_string(kBlockSize));
+        WriteTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<DiscardWriteSink>());
+        transfer.Start(now);
+        std::vector<uint8_t> block(kBlockSize, 0x5a);
+        for (uint64_t number = 1; number < kBlocks; ++number) {
+            Deliver(transfer, TftpPacket::CreateData(static_cast<uint16_t>(number), block), peer, now);
+        }
+        EXPECT_FALSE(transfer.IsFinished());
+        Deliver(transfer, TftpPacket::CreateData(0, block), peer, now);
+        EXPECT_EQ(channel.sent.back().GetBlockNumber(), 0);
+
+        // Expecting block 1 again after the wrap: a timeout re-acknowledges block 0, not the OACK
+        now = transfer.Deadline();
+        transfer.OnTimeout(now);
+        ASSERT_EQ(channel.sent.back().GetOpCode(), OpCode::kAcknowledge);
+        EXPECT_EQ(channel.sent.back().GetBlockNumber(), 0);
+        Deliver(transfer, TftpPacket::CreateData(1, std::vector<uint8_t>(kBlockSize - 1, 0x5a)), peer, now);
+        EXPECT_TRUE(transfer.Succeeded());
+        EXPECT_EQ(channel.sent.back().GetBlockNumber(), 1);
+    }
+}
+
+TEST(TftpTransferTest, RetransmitTimeoutFollowsRtt) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TransferConfig config = MakeConfig();
+    config.timeout_secs = 5;
+    config.retransmit_floor_ms = 200;
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    ReadTransfer transfer(channel, peer, std::move(config), request, std::make_unique<MemoryReadSource>(5000));
+    transfer.Start(now);
+    EXPECT_EQ(transfer.Deadline(), now + std::chrono::seconds(1));
+
+    // A 10 ms round trip brings the timeout down to the floor
+    now += milliseconds(10);
+    Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+    EXPECT_EQ(transfer.Deadline(), now + milliseconds(200));
+
+    // Each timeout doubles it
+    now = transfer.Deadline();
+    transfer.OnTimeout(now);
+    EXPECT_EQ(transfer.Deadline(), now + milliseconds(400));
+
+    // The ACK of the retransmitted block is not sampled (Karn's rule), so the backoff stays
+    now += milliseconds(10);
+    Deliver(transfer, TftpPacket::CreateAck(2), peer, now);
+    EXPECT_EQ(transfer.Deadline(), now + milliseconds(400));
+
+    now += milliseconds(10);
+    Deliver(transfer, TftpPacket::CreateAck(3), peer, now);
+    EXPECT_EQ(transfer.Deadline(), now + milliseconds(200));
+}
+
+TEST(TftpTransferTest, NegotiatedTimeoutIsFixed) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateWriteRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("timeout", "3");
+    WriteTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<DiscardWriteSink>());
+    transfer.Start(now);
+    ASSERT_EQ(channel.sent.size(), 1u);
+    EXPECT_EQ(channel.sent[0].GetOpCode(), OpCode::kOACK);
+    EXPECT_EQ(transfer.Deadline(), now + std::chrono::seconds(3));
+
+    // RFC 2349: the requested interval is used as is, without backoff
+    now = transfer.Deadline();
+    transfer.OnTimeout(now);
+    EXPECT_EQ(transfer.Deadline(), now + std::chrono::seconds(3));
+}
+
+TEST(TftpTransferTest, GivesUpAfterRetryBudget) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateWriteRequest("memory.bin", TransferMode::kOctet);
+    WriteTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<DiscardWriteSink>());
+    transfer.Start(now);
+    ASSERT_FALSE(transfer.IsFinished());
+    ASSERT_EQ(channel.sent.size(), 1u);
+    EXPECT_EQ(channel.sent[0].GetOpCode(), OpCode::kAcknowledge);
+
+    int timeouts = 0;
+    while (!transfer.IsFinished() && timeouts < 100) {
+        transfer.OnTimeout(transfer.Deadline());
+        timeouts++;
+    }
+    EXPECT_TRUE(transfer.IsFinished());
+    EXPECT_FALSE(transfer.Succeeded());
+    EXPECT_LT(timeouts, 100);
+}
+
+TEST(TftpTransferTest, ReadTransferWaitsForBandwidth) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+    RateLimiter limiter;
+    limiter.SetLimits(0, 65536);
+
+    {
+        TransferConfig config = MakeConfig();
+        config.rate_limiter = &limiter;
+        TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+        request.SetOption("blksize", std::to_string(kMaxBlockSize));
+        ReadTransfer transfer(channel, peer, std::move(config), request,
+                              std::make_unique<MemoryReadSource>(2 * kMaxBlockSize + 100));
+        EXPECT_EQ(limiter.GetClientCount(), 1u);
+        transfer.Start(now);
+        Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+        ASSERT_EQ(channel.sent.size(), 2u);
+        EXPECT_EQ(channel.sent[1].GetBlockNumber(), 1);
+
+        // The first block used up the burst, so the second waits for about a second
+        Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+        EXPECT_EQ(channel.sent.size(), 2u);
+        EXPECT_GT(transfer.Deadline(), now + milliseconds(900));
+        EXPECT_LT(transfer.Deadline(), now + milliseconds(1100));
+        Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+        EXPECT_EQ(channel.sent.size(), 2u);
+
+        // The wait is not a retransmission timeout: the timer is not backed off from the
+        // floor that the instant ACK brought it down to
+        now = transfer.Deadline();
+        transfer.OnTimeout(now);
+        ASSERT_EQ(channel.sent.size(), 3u);
+        EXPECT_EQ(channel.sent[2].GetBlockNumber(), 2);
+        EXPECT_EQ(transfer.Deadline(), now + milliseconds(kDefaultRetransmitFloorMs));
+
+        while (!transfer.IsFinished() && channel.sent.size() < 10) {
+            now = std::max(now, transfer.Deadline());
+            transfer.OnTimeout(now);
+            Deliver(transfer, TftpPacket::CreateAck(channel.sent.back().GetBlockNumber()), peer, now);
+        }
+        EXPECT_TRUE(transfer.Succeeded());
+        EXPECT_EQ(channel.sent.back().GetBlockNumber(), 3);
+    }
+    EXPECT_EQ(limiter.GetClientCount(), 0u);
+}
+
+TEST(TftpTransferTest, WriteTransferHoldsAckForBandwidth) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+    RateLimiter limiter;
+    limiter.SetLimits(65536, 0);
+
+    TransferConfig config = MakeConfig();
+    config.rate_limiter = &limiter;
+    TftpPacket request = TftpPacket::CreateWriteRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("blksize", std::to_string(kMaxBlockSize));
+    WriteTransfer transfer(channel, peer, std::move(config), request, std::make_unique<DiscardWriteSink>());
+    transfer.Start(now);
+    std::vector<uint8_t> block(kMaxBlockSize, 0x5a);
+    Deliver(transfer, TftpPacket::CreateData(1, block), peer, now);
+    ASSERT_EQ(channel.sent.size(), 2u);
+    EXPECT_EQ(channel.sent[1].GetBlockNumber(), 1);
+
+    // Over the limit the ACK is held back, and a resent block does not force it out
+    Deliver(transfer, TftpPacket::CreateData(2, block), peer, now);
+    Deliver(transfer, TftpPacket::CreateData(2, block), peer, now);
+    EXPECT_EQ(channel.sent.size(), 2u);
+    EXPECT_GT(transfer.Deadline(), now + milliseconds(900));
+
+    transfer.OnTimeout(transfer.Deadline());
+    ASSERT_EQ(channel.sent.size(), 3u);
+    EXPECT_EQ(channel.sent[2].GetOpCode(), OpCode::kAcknowledge);
+    EXPECT_EQ(channel.sent[2].GetBlockNumber(), 2);
+
+    // The final block is acknowledged at once
+    Deliver(transfer, TftpPacket::CreateData(3, std::vector<uint8_t>(100, 0x5a)), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+    EXPECT_EQ(channel.sent.back().GetBlockNumber(), 3);
+}
+
+TEST(TftpTransferTest, ReadTransferAnswersTsizeFromStat) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("tsize", "0");
+    request.SetOption("timeout", "2");
+    auto source = std::make_unique<CountingReadSource>(1500);
+    CountingReadSource* counters = source.get();
+    {
+        ReadTransfer transfer(channel, peer, MakeConfig(), request, std::move(source));
+        transfer.Start(now);
+        ASSERT_EQ(channel.sent.size(), 1u);
+        const TftpPacket& oack = channel.sent[0];
+        EXPECT_EQ(oack.GetOpCode(), OpCode::kOACK);
+        EXPECT_EQ(oack.GetOption("tsize"), "1500");
+        EXPECT_EQ(oack.GetOption("timeout"), "2");
+        EXPECT_EQ(transfer.Deadline(), now + std::chrono::seconds(2));
+
+        // A probing client aborts after the OACK: the file was never opened
+        Deliver(transfer, TftpPacket::CreateError(ErrorCode::kNotDefined, "tsize probe"), peer, now);
+        EXPECT_TRUE(transfer.IsFinished());
+        EXPECT_EQ(counters->stats, 1);
+        EXPECT_EQ(counters->opens, 0);
+        EXPECT_EQ(counters->reads, 0);
+    }
+
+    // A client that goes on has the file opened by ACK 0
+    channel.sent.clear();
+    source = std::make_unique<CountingReadSource>(1500);
+    counters = source.get();
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::move(source));
+    transfer.Start(now);
+    EXPECT_EQ(counters->opens, 0);
+    Deliver(transfer, TftpPacket::CreateAck(0), peer, now);
+    EXPECT_EQ(counters->opens, 1);
+    ASSERT_EQ(channel.sent.size(), 2u);
+    EXPECT_EQ(channel.sent[1].GetBlockNumber(), 1);
+}
+
+TEST(TftpTransferTest, ReadTransferOpensSourceWithoutStat) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    request.SetOption("tsize", "0");
+    ReadTransfer transfer(channel, peer, MakeConfig(), request, std::make_unique<MemoryReadSource>(700));
+    transfer.Start(now);
+    ASSERT_EQ(channel.sent.size(), 1u);
+    EXPECT_EQ(channel.sent[0].GetOption("tsize"), "700");
+
+    // A client offering a size on a read request still gets the real one
+    RecordingChannel other_channel;
+    request.SetOption("tsize", "123");
+    TransferConfig config = MakeConfig();
+    config.max_size = 600;
+    ReadTransfer too_large(other_channel, peer, std::move(config), request, std::make_unique<MemoryReadSource>(700));
+    too_large.Start(now);
+    ASSERT_EQ(other_channel.sent.size(), 1u);
+    EXPECT_EQ(other_channel.sent[0].GetErrorCode(), ErrorCode::kDiskFull);
+}
+
+// With an I/O notifier the first window waits for the read-ahead instead of reading in place
+TEST(TftpTransferTest, ReadTransferWaitsForReadAhead) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+    Gate gate;
+    auto stage = std::make_shared<IoStage>(1);
+    auto completions = std::make_shared<IoCompletions>();
+
+    TftpPacket request = TftpPacket::CreateReadRequest("memory.bin", TransferMode::kOctet);
+    ReadTransfer transfer(channel, peer, MakeConfig(), request,
+                          std::make_unique<ReadAheadSource>(std::make_unique<GatedReadSource>(700, gate), stage, 2));
+    transfer.SetIoNotifier(IoCompletions::Notifier(completions, 1));
+    transfer.Start(now);
+    EXPECT_TRUE(channel.sent.empty());
+    EXPECT_TRUE(transfer.AwaitingIo());
+    EXPECT_EQ(transfer.Deadline(), Transfer::Clock::time_point::max());
+
+    gate.Set(true);
+    std::vector<uint64_t> ids;
+    ASSERT_TRUE(completions->Wait(std::chrono::seconds(5)));
+    completions->Take(ids);
+    transfer.HandleIoReady(now);
+    ASSERT_EQ(channel.sent.size(), 1u);
+    EXPECT_EQ(channel.sent[0].GetBlockNumber(), 1);
+
+    // The next window may still be on its way from the stage
+    Deliver(transfer, TftpPacket::CreateAck(1), peer, now);
+    while (transfer.AwaitingIo()) {
+        ASSERT_TRUE(completions->Wait(std::chrono::seconds(5)));
+        completions->Take(ids);
+        transfer.HandleIoReady(now);
+    }
+    ASSERT_EQ(channel.sent.size(), 2u);
+    EXPECT_EQ(channel.sent[1].GetBlockNumber(), 2);
+    Deliver(transfer, TftpPacket::CreateAck(2), peer, now);
+    EXPECT_TRUE(transfer.Succeeded());
+}
+
+// The ACK of a block the disk is too far behind on, and the final ACK, wait for the I/O stage
+TEST(TftpTransferTest, WriteTransferAcksAfterDisk) {
+    RecordingChannel channel;
+    sockaddr_in peer = MakeAddress(40000);
+    auto now = Transfer::Clock::now();
+    Gate gate;
+    auto stage = std::make_shared<IoStage>(1);
+    auto completions = std::make_shared<IoCompletions>();
+
+    TftpPacket request = TftpPacket::CreateWriteRequest("memory.bin", TransferMode::kOctet);
+    WriteTransfer transfer(channel, peer, MakeConfig(), request,
+                           std::make_unique<WriteBehindSink>(std::make_unique<GatedWriteSink>(gate), stage, 512));
+    transfer.SetIoNotifier(IoCompletions::Notifier(completions, 1));
+    transfer.Start(now);
+    ASSERT_EQ(channel.sent.size(), 1u);
+
+    std::vector<uint8_t> block(512, 0x5a);
+    Deliver(transfer, TftpPacket::CreateData(1, block), peer, now);
+    ASSERT_EQ(channel.sent.size(), 2u);
+    // Block 1 is stuck on the disk, so block 2 goes over the limit: its ACK is held back
+    Deliver(transfer, TftpPacket::CreateData(2, block), peer, now);
+    Deliver(transfer, TftpPacket::CreateData(2, block), peer, now);
+    EXPECT_EQ(channel.sent.size(), 2u);
+    EXPECT_TRUE(transfer.AwaitingIo());
+
+    gate.Set(true);
+    ASSERT_TRUE(completions->Wait(std::chrono::seconds(5)));
+    std::vector<uint64_t> ids;
+    completions->Take(ids);
+    transfer.HandleIoReady(now);
+    ASSERT_EQ(channel.sent.size(), 3u);
+    EXPECT_EQ(channel.sent[2].GetBlockNumber(), 2);
+
+    // The final ACK follows the commit on the stage; a resent final block does not force it out
+    gate.Set(false);
+    Deliver(transfer, TftpPacket::CreateData(3, std::vector<uint8_t>(100, 0x5a)), peer, now);
+    Deliver(transfer, TftpPacket::CreateData(3, std::vector<uint8_t>(100, 0x5a)), peer, now);
+    EXPECT_EQ(channel.sent.size(), 3u);
+    EXPECT_FALSE(transfer.IsFinished());
+    gate.Set(true);
+    ASSERT_TRUE(completions->Wait(std::chrono::seconds(5)));
+    completions->Take(ids);
+    transfer.HandleIoReady(now);
+    ASSERT_EQ(channel.sent.size(), 4u);
+    EXPECT_EQ(channel.sent[3].GetOpCode(), OpCode::kAcknowledge);
+    EXPECT_EQ(channel.sent[3].GetBlockNumber(), 3);
+    EXPECT_TRUE(transfer.Succeeded());
+}
@@ -0,0 +1,272 @@
+/**
+ * @file tftp_uring_test.cpp
+ * @brief Unit tests for the io_uring wrapper and batched file reads
+ */
+
+#include <gtest/gtest.h>
+#include "internal/tftp_uring.h"
+#include "internal/tftp_file_io_impl.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef TFTP_HAVE_IO_URING
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+using namespace tftpserver;
+using namespace tftpserver::internal;
+
+#ifdef TFTP_HAVE_IO_URING
+
+namespace {
+
+class TftpUringTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (!IoUringAvailable()) {
+            GTEST_SKIP() << "io_uring not available";
+        }
+    }
+};
+
+// Bound loopback UDP socket; addr receives the bound address
+int OpenLoopbackSocket(sockaddr_in& addr) {
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrlen = sizeof(addr);
+    if (sock < 0 || bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addrlen) != 0) {
+        return -1;
+    }
+    return sock;
+}
+
+} // namespace
+
+TEST_F(TftpUringTest, MultishotReceiveDeliversEveryDatagram) {
+    IoUring ring;
+    ASSERT_TRUE(ring.Init(16));
+    ASSERT_TRUE(ring.RegisterFileTable(4));
+    BufferRing buffers;
+    ASSERT_TRUE(buffers.Init(ring, 3, 8, 256));
+
+    sockaddr_in receiver_addr;
+    sockaddr_in sender_addr;
+    int receiver = OpenLoopbackSocket(receiver_addr);
+    int sender = OpenLoopbackSocket(sender_addr);
+    ASSERT_GE(receiver, 0);
+    ASSERT_GE(sender, 0);
+    ASSERT_TRUE(ring.UpdateFile(2, receiver));
+
+    msghdr pattern = {};
+    pattern.msg_namelen = sizeof(sockaddr_in);
+    PrepareRecvMsgMultishot(ring.GetSqe(), 2, true, &pattern, buffers.Group(), 1);
+
+    // Twenty sends through the ring: more datagrams than buffers, recycled as they are consumed
+    const size_t kDatagrams = 20;
+    std::vector<std::vector<uint8_t>> payloads;
+    std::vector<iovec> iovecs(kDatagrams);
+    std::vector<msghdr> messages(kDatagrams);
+    for (size_t i = 0; i < kDatagrams; ++i) {
+        payloads.emplace_back(10 + i, static_cast<uint8_t>(i));
+    }
+    size_t next_send = 0;
+    size_t sent = 0;
+    std::vector<size_t> received;
+    std::vector<io_uring_cqe> completions;
+    bool armed = true;
+    for (int round = 0; round < 100 && received.size() < kDatagrams; ++round) {
+        // A few sends per round, so the receive keeps up with its eight buffers
+        for (int i = 0; i < 4 && next_send < kDatagrams; ++i, ++next_send) {
+            iovecs[next_send] = {payloads[next_send].data(), payloads[next_send].size()};
+            messages[next_send] = msghdr();
+            messages[next_send].msg_name = &receiver_addr;
+            messages[next_send].msg_namelen = sizeof(receiver_addr);
+            messages[next_send].msg_iov = &iovecs[next_send];
+            messages[next_send].msg_iovlen = 1;
+            PrepareSendMsg(ring.GetSqe(), sender, false, &messages[next_send], 100 + next_send);
+        }
+        if (!armed) {
+            PrepareRecvMsgMultishot(ring.GetSqe(), 2, true, &pattern, buffers.Group(), 1);
+            armed = true;
+        }
+        ASSERT_GE(ring.SubmitAndWait(1, 100), 0);
+        completions.clear();
+        ring.Reap(completions);
+        for (const io_uring_cqe& cqe : completions) {
+            if (cqe.user_data >= 100) {
+                EXPECT_EQ(cqe.res, static_cast<int>(payloads[cqe.user_data - 100].size()));
+                sent++;
+                continue;
+            }
+            if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+                armed = false;
+            }
+            uint16_t id = 0;
+            if (cqe.res <= 0 || !CompletionBuffer(cqe, id)) {
+                continue;
+            }
+            sockaddr_in from;
+            const uint8_t* payload = nullptr;
+            size_t length = 0;
+            ASSERT_TRUE(ParseRecvMsg(buffers.Buffer(id), static_cast<size_t>(cqe.res), pattern, from, payload, length));
+            EXPECT_EQ(from.sin_port, sender_addr.sin_port);
+            ASSERT_GE(length, 10u);
+            size_t index = length - 10;
+            ASSERT_LT(index, kDatagrams);
+            EXPECT_EQ(std::vector<uint8_t>(payload, payload + length), payloads[index]);
+            received.push_back(index);
+            buffers.Recycle(id);
+        }
+    }
+    EXPECT_EQ(sent, kDatagrams);
+    EXPECT_EQ(received.size(), kDatagrams);
+
+    // A datagram larger than the buffer is reported truncated and rejected
+    std::vector<uint8_t> oversized(600, 'x');
+    ASSERT_EQ(sendto(sender, oversized.data(), oversized.size(), 0, reinterpret_cast<sockaddr*>(&receiver_addr),
+                     sizeof(receiver_addr)), static_cast<ssize_t>(oversized.size()));
+    if (!armed) {
+        PrepareRecvMsgMultishot(ring.GetSqe(), 2, true, &pattern, buffers.Group(), 1);
+    }
+    bool rejected = false;
+    for (int round = 0; round < 10 && !rejected; ++round) {
+        ring.SubmitAndWait(1, 100);
+        completions.clear();
+        ring.Reap(completions);
+        for (const io_uring_cqe& cqe : completions) {
+            uint16_t id = 0;
+            if (cqe.res > 0 && CompletionBuffer(cqe, id)) {
+                sockaddr_in from;
+                const uint8_t* payload = nullptr;
+                size_t length = 0;
+                EXPECT_FALSE(ParseRecvMsg(buffers.Buffer(id), static_cast<size_t>(cqe.res), pattern, from, payload,
+                                          length));
+                rejected = true;
+                buffers.Recycle(id);
+            }
+        }
+    }
+    EXPECT_TRUE(rejected);
+    close(receiver);
+    close(sender);
+}
+
+#ifdef TFTP_HAVE_IO_URING_SEND_ZC
+TEST_F(TftpUringTest, ZeroCopySendsReleaseDataWithLastCompletion) {
+    IoUring ring;
+    ASSERT_TRUE(ring.Init(16));
+    EXPECT_TRUE(ring.Supports(IORING_OP_SENDMSG));
+    if (!ring.Supports(IORING_OP_SEND_ZC) || !ring.Supports(IORING_OP_SENDMSG_ZC)) {
+        GTEST_SKIP() << "io_uring zero-copy sends not available";
+    }
+
+    sockaddr_in receiver_addr;
+    sockaddr_in sender_addr;
+    int receiver = OpenLoopbackSocket(receiver_addr);
+    int sender = OpenLoopbackSocket(sender_addr);
+    ASSERT_GE(receiver, 0);
+    ASSERT_GE(sender, 0);
+
+    // One datagram from a registered buffer, one gathered from a header and a separate payload
+    std::vector<uint8_t> registered(8192);
+    for (size_t i = 0; i < registered.size(); ++i) {
+        registered[i] = static_cast<uint8_t>(i * 13);
+    }
+    iovec buffer = {registered.data(), registered.size()};
+    bool fixed = ring.RegisterBuffers(&buffer, 1);
+    PrepareSendZeroCopy(ring.GetSqe(), sender, false, registered.data() + 100, 5000, &receiver_addr,
+                        fixed ? 0 : -1, 1);
+    const uint8_t header[] = {0, 3, 0, 1};
+    std::vector<uint8_t> payload(6000, 'z');
+    iovec parts[2] = {{const_cast<uint8_t*>(header), sizeof(header)}, {payload.data(), payload.size()}};
+    msghdr message = {};
+    message.msg_name = &receiver_addr;
+    message.msg_namelen = sizeof(receiver_addr);
+    message.msg_iov = parts;
+    message.msg_iovlen = 2;
+    PrepareSendMsgZeroCopy(ring.GetSqe(), sender, false, &message, 2);
+
+    // Each send completes with its result and later with a notification releasing its data
+    int results[3] = {0, 0, 0};
+    int released[3] = {0, 0, 0};
+    std::vector<io_uring_cqe> completions;
+    for (int round = 0; round < 20 && (released[1] == 0 || released[2] == 0); ++round) {
+        ASSERT_GE(ring.SubmitAndWait(1, 100), 0);
+        completions.clear();
+        ring.Reap(completions);
+        for (const io_uring_cqe& cqe : completions) {
+            ASSERT_TRUE(cqe.user_data == 1 || cqe.user_data == 2);
+            if ((cqe.flags & IORING_CQE_F_NOTIF) != 0) {
+                released[cqe.user_data]++;
+            } else {
+                results[cqe.user_data] = cqe.res;
+            }
+            // Only the last completion of a send lacks IORING_CQE_F_MORE
+            EXPECT_EQ((cqe.flags & IORING_CQE_F_MORE) == 0, (cqe.flags & IORING_CQE_F_NOTIF) != 0);
+        }
+    }
+    EXPECT_EQ(results[1], 5000);
+    EXPECT_EQ(results[2], static_cast<int>(sizeof(header) + payload.size()));
+    EXPECT_EQ(released[1], 1);
+    EXPECT_EQ(released[2], 1);
+
+    std::vector<uint8_t> datagram(65536);
+    ssize_t length = recv(receiver, datagram.data(), datagram.size(), 0);
+    ASSERT_EQ(length, 5000);
+    EXPECT_TRUE(std::equal(datagram.begin(), datagram.begin() + length, registered.begin() + 100));
+    length = recv(receiver, datagram.data(), datagram.size(), 0);
+    ASSERT_EQ(length, static_cast<ssize_t>(sizeof(header) + payload.size()));
+    EXPECT_TRUE(std::equal(header, header + sizeof(header), datagram.begin()));
+    EXPECT_TRUE(std::equal(payload.begin(), payload.end(), datagram.begin() + sizeof(header)));
+    close(receiver);
+    close(sender);
+}
+#endif
+
+TEST_F(TftpUringTest, FileSourceReadsBatchThroughThreadRing) {
+    const std::string path = "uring_batch_test.dat";
+    std::vector<uint8_t> content(10000);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<uint8_t>(i * 31 + (i >> 8));
+    }
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+    }
+
+    FileRing::EnableForThisThread(true);
+    ASSERT_NE(FileRing::ForThisThread(), nullptr);
+    {
+        FileReadSource source;
+        ASSERT_TRUE(source.Open(path));
+
+        // Twenty 512-byte blocks, the last one running past the end of the file
+        std::vector<std::vector<uint8_t>> blocks(20, std::vector<uint8_t>(512));
+        std::vector<ReadRequest> requests(blocks.size());
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            requests[i].offset = i * 512;
+            requests[i].buffer = blocks[i].data();
+            requests[i].length = 512;
+        }
+        ASSERT_TRUE(source.ReadBatch(requests.data(), requests.size()));
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            size_t expected = std::min<size_t>(512, content.size() - i * 512);
+            ASSERT_EQ(requests[i].bytes_read, expected);
+            EXPECT_EQ(std::memcmp(blocks[i].data(), content.data() + i * 512, expected), 0) << "Block " << i;
+        }
+        source.Close();
+    }
+    FileRing::EnableForThisThread(false);
+    EXPECT_EQ(FileRing::ForThisThread(), nullptr);
+    std::remove(path.c_str());
+}
+
+#endif // TFTP_HAVE_IO_URING